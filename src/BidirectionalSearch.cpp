@@ -0,0 +1,93 @@
+// ===============================================================================================
+// Evacuation Solver: Bidirectional search implementation
+// Description: Label bookkeeping of the two sides and the route that goes through the meeting
+// junction
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "BidirectionalSearch.h"
+
+void NABidirectionalSearch::Side::Reset(size_t junctionCount)
+{
+	Cost.assign(junctionCount, CASPER_INFINITY);
+	PredEdge.assign(junctionCount, NAGraphSnapshot::NoEdge);
+	Tag.assign(junctionCount, 0);
+	Touched.clear();
+	Heap.clear();
+	Scanned = 0;
+}
+
+void NABidirectionalSearch::Side::Clear()
+{
+	for (const auto j : Touched)
+	{
+		Cost[j] = CASPER_INFINITY;
+		PredEdge[j] = NAGraphSnapshot::NoEdge;
+	}
+	Touched.clear();
+	Heap.clear();
+}
+
+// smallest label that is still current. outdated heap entries are dropped on the way.
+double NABidirectionalSearch::Side::Top()
+{
+	while (!Heap.empty() && Heap.front().first > Cost[Heap.front().second])
+	{
+		std::pop_heap(Heap.begin(), Heap.end(), std::greater<Label>());
+		Heap.pop_back();
+	}
+	return Heap.empty() ? CASPER_INFINITY : Heap.front().first;
+}
+
+bool NABidirectionalSearch::Side::Set(long junction, double cost, NAGraphEdgeIndex edge, size_t tag)
+{
+	if (cost >= Cost[junction]) return false;
+	if (Cost[junction] >= CASPER_INFINITY) Touched.push_back(junction);
+	Cost[junction] = cost;
+	PredEdge[junction] = edge;
+	Tag[junction] = tag;
+	Heap.push_back(Label(cost, junction));
+	std::push_heap(Heap.begin(), Heap.end(), std::greater<Label>());
+	return true;
+}
+
+NABidirectionalSearch::NABidirectionalSearch(NAGraphSnapshotPtr _graph) : graph(_graph), stamp(0), queryCount(0), forwardScanned(0), backwardScanned(0)
+{
+	forward.Reset(graph->JunctionCount());
+	backward.Reset(graph->JunctionCount());
+	edgeCost.assign(graph->EdgeCount(), CASPER_INFINITY);
+	edgeStamp.assign(graph->EdgeCount(), 0);
+}
+
+size_t NABidirectionalSearch::MemoryUsage() const
+{
+	return sizeof(double) * (forward.Cost.capacity() + backward.Cost.capacity() + edgeCost.capacity()) + sizeof(NAGraphEdgeIndex) * (forward.PredEdge.capacity() + backward.PredEdge.capacity()) +
+		sizeof(size_t) * (forward.Tag.capacity() + backward.Tag.capacity()) + sizeof(unsigned int) * edgeStamp.capacity();
+}
+
+// the forward chain is walked back from the meeting junction to the evacuee and the backward chain forward to the safe zone
+void NABidirectionalSearch::BuildRoute(long meet, NAHierarchyRoute & route) const
+{
+	long x = meet;
+	route.SourceTag = forward.Tag[meet];
+	route.TargetTag = backward.Tag[meet];
+
+	for (NAGraphEdgeIndex e = forward.PredEdge[x]; e != NAGraphSnapshot::NoEdge; e = forward.PredEdge[x])
+	{
+		route.Edges.push_back(e);
+		x = graph->GetFromJunction(e);
+	}
+	std::reverse(route.Edges.begin(), route.Edges.end());
+
+	x = meet;
+	for (NAGraphEdgeIndex e = backward.PredEdge[x]; e != NAGraphSnapshot::NoEdge; e = backward.PredEdge[x])
+	{
+		route.Edges.push_back(e);
+		x = graph->GetToJunction(e);
+	}
+}
@@ -0,0 +1,160 @@
+// ===============================================================================================
+// Evacuation Solver: Bidirectional search
+// Description: A bidirectional search over the graph snapshot from the evacuee to a virtual
+// super-sink that is connected to every safe zone. The forward frontier stops growing once it
+// meets the backward frontier that comes out of all the safe zones at once.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "NAGraph.h"
+#include "ContractionHierarchy.h"
+
+// The super-sink is never materialized: every safe zone junction starts the backward search with its safe zone cost as
+// its label. The edge costs are asked from the caller during the query and each edge is asked only once per query so
+// the two searches always see the same cost for the same edge. The search stops as soon as the smallest forward label
+// plus the smallest backward label can no longer beat the best meeting junction.
+class NABidirectionalSearch
+{
+private:
+	typedef std::pair<double, long> Label;
+
+	// one direction of the search. the labels are reset through the touched list.
+	struct Side
+	{
+		std::vector<double>           Cost;
+		std::vector<NAGraphEdgeIndex> PredEdge;
+		std::vector<size_t>           Tag;
+		std::vector<long>             Touched;
+		std::vector<Label>            Heap;
+		size_t                        Scanned;
+
+		void   Reset(size_t junctionCount);
+		void   Clear();
+		double Top();
+		bool   Set(long junction, double cost, NAGraphEdgeIndex edge, size_t tag);
+	};
+
+	NAGraphSnapshotPtr            graph;
+	Side                          forward;
+	Side                          backward;
+	std::vector<double>           edgeCost;
+	std::vector<unsigned int>     edgeStamp;
+	unsigned int                  stamp;
+
+	size_t                        queryCount;
+	size_t                        forwardScanned;
+	size_t                        backwardScanned;
+
+	void BuildRoute(long meet, NAHierarchyRoute & route) const;
+
+public:
+	NABidirectionalSearch(NAGraphSnapshotPtr _graph);
+	virtual ~NABidirectionalSearch(void) { }
+
+	NABidirectionalSearch(const NABidirectionalSearch & that) = delete;
+	NABidirectionalSearch & operator=(const NABidirectionalSearch &) = delete;
+
+	// the closest target from any of the sources. 'CostOf' gives the current cost of a snapshot edge. with 'bidirectional'
+	// off the backward side only holds the super-sink edges and the forward side runs until it settles the meeting junction,
+	// which is exactly what the regular forward search would have scanned.
+	template <class CostOf> bool Nearest(const std::vector<NAHierarchySeed> & sources, const std::vector<NAHierarchySeed> & targets, CostOf costOf,
+		NAHierarchyRoute & route, bool bidirectional = true)
+	{
+		NAGraphStarItr begin, end;
+		long meet = -1, w = -1;
+		double best = CASPER_INFINITY, topF = 0.0, topB = 0.0, c = 0.0;
+		bool goForward = true;
+
+		auto EdgeCost = [&](NAGraphEdgeIndex e) -> double
+		{
+			if (edgeStamp[e] != stamp)
+			{
+				edgeStamp[e] = stamp;
+				edgeCost[e] = costOf(e);
+			}
+			return edgeCost[e];
+		};
+
+		forward.Clear();
+		backward.Clear();
+		forward.Scanned = backward.Scanned = 0;
+		route.Cost = CASPER_INFINITY;
+		route.Edges.clear();
+
+		// a wrap around of the stamp would make an old cost look current so every stamp is cleared
+		if (++stamp == 0)
+		{
+			std::fill(edgeStamp.begin(), edgeStamp.end(), 0);
+			stamp = 1;
+		}
+
+		for (const auto & t : targets)
+			if (t.Junction >= 0 && (size_t)t.Junction < backward.Cost.size() && t.Offset < CASPER_INFINITY) backward.Set(t.Junction, t.Offset, NAGraphSnapshot::NoEdge, t.Tag);
+		for (const auto & s : sources)
+			if (s.Junction >= 0 && (size_t)s.Junction < forward.Cost.size() && s.Offset < CASPER_INFINITY && forward.Set(s.Junction, s.Offset, NAGraphSnapshot::NoEdge, s.Tag)
+				&& s.Offset + backward.Cost[s.Junction] < best)
+			{
+				best = s.Offset + backward.Cost[s.Junction];
+				meet = s.Junction;
+			}
+
+		for (;;)
+		{
+			topF = forward.Top();
+			topB = backward.Top();
+			if (bidirectional ? topF + topB >= best : topF >= best) break;
+
+			// the side with the smaller frontier moves next so neither of them grows much past the meeting point
+			goForward = !bidirectional || topB >= CASPER_INFINITY || (topF < CASPER_INFINITY && forward.Heap.size() <= backward.Heap.size());
+			Side & side = goForward ? forward : backward;
+			Side & other = goForward ? backward : forward;
+			Label top = side.Heap.front();
+			std::pop_heap(side.Heap.begin(), side.Heap.end(), std::greater<Label>());
+			side.Heap.pop_back();
+
+			if (goForward) graph->ForwardStar(top.second, begin, end);
+			else graph->BackwardStar(top.second, begin, end);
+			for (auto e = begin; e != end; ++e)
+			{
+				++side.Scanned;
+				c = EdgeCost(*e);
+				if (c >= CASPER_INFINITY) continue;
+				w = goForward ? graph->GetToJunction(*e) : graph->GetFromJunction(*e);
+				if (side.Set(w, top.first + c, *e, side.Tag[top.second]) && side.Cost[w] + other.Cost[w] < best)
+				{
+					best = side.Cost[w] + other.Cost[w];
+					meet = w;
+				}
+			}
+		}
+
+		// a forward only query is a comparison run so it stays out of the totals
+		if (bidirectional)
+		{
+			++queryCount;
+			forwardScanned += forward.Scanned;
+			backwardScanned += backward.Scanned;
+		}
+		if (meet < 0) return false;
+
+		route.Cost = best;
+		BuildRoute(meet, route);
+		return true;
+	}
+
+	size_t GetQueryCount()           const { return queryCount; }
+	size_t GetForwardScanned()       const { return forwardScanned; }
+	size_t GetBackwardScanned()      const { return backwardScanned; }
+	size_t GetLastForwardScanned()   const { return forward.Scanned; }
+	size_t GetLastBackwardScanned()  const { return backward.Scanned; }
+	size_t MemoryUsage()             const;
+};
+
+typedef std::shared_ptr<NABidirectionalSearch> NABidirectionalSearchPtr;
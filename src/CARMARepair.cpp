@@ -0,0 +1,134 @@
+// ===============================================================================================
+// Evacuation Solver: Lifelong CARMA tree repair
+// Description: Implementation of the LPA* style repair of the CARMA tree
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "StdAfx.h"
+#include "CARMARepair.h"
+
+CARMATreeRepair::CARMATreeRepair(NAEdgeMap * closedList, std::shared_ptr<NAVertexCache> vertexCache, std::shared_ptr<NAEdgeCache> edgeCache,
+	EvcSolverMethod solverMethod, double pop2Route) : graph(closedList, vertexCache, edgeCache, solverMethod, pop2Route), core(graph)
+{
+}
+
+// A clean edge keeps the cost it was labeled with so that untouched parts of the tree stay exactly consistent
+double CARMARepairGraph::Cost(NAEdge * edge) const
+{
+	return edge->GetDirtyState() == EdgeDirtyState::CleanState ? edge->GetCleanCost() : edge->GetCost(minPop2Route, method);
+}
+
+// An edge without a tree parent was seeded by a safe zone with a fraction of its cost and that seed is scaled to the new cost
+double CARMARepairGraph::Seed(NAEdge * edge, double cost) const
+{
+	if (edge->TreePrevious) return CASPER_INFINITY;
+	return edge->GetCleanCost() > 0.0 ? edge->GetCarmaH() * (cost / edge->GetCleanCost()) : edge->GetCarmaH();
+}
+
+HRESULT CARMARepairGraph::EndVertex(NAEdge * edge, NAVertexPtr & vertex)
+{
+	HRESULT hr = S_OK;
+	long junctionEID = -1;
+
+	if (edge->TreePrevious && edge->TreePrevious->GetHJunction() >= 0)
+	{
+		vertex = vcache->Get(edge->TreePrevious->GetHJunction());
+		return hr;
+	}
+	if (FAILED(hr = ecache->QueryJunction(edge, QueryDirection::Forward, junctionEID))) return hr;
+	vertex = vcache->Get(junctionEID);
+	return hr;
+}
+
+void CARMATreeRepair::RemoveSubtree(NAEdge * head, std::vector<NAEdge *> & evicted)
+{
+	NAEdge * e = nullptr;
+	std::stack<NAEdge *> subtree;
+
+	if (head->TreePrevious) head->TreePrevious->TreeNext.unordered_erase(head, NAEdge::IsEqualNAEdgePtr);
+	head->TreePrevious = nullptr;
+	subtree.push(head);
+	while (!subtree.empty())
+	{
+		e = subtree.top();
+		subtree.pop();
+		graph.tree->Erase(e);
+		evicted.push_back(e);
+		for (const auto & i : e->TreeNext)
+		{
+			i->TreePrevious = nullptr;
+			subtree.push(i);
+		}
+		e->TreeNext.clear();
+	}
+}
+
+HRESULT CARMATreeRepair::Repair(const std::vector<NAEdge *> & dirty, double radius, std::vector<NAEdge *> & evicted)
+{
+	HRESULT hr = S_OK;
+	ArrayList<NAEdgePtr> * adj = nullptr;
+	std::vector<NAEdge *> cleanUp;
+	NAVertexPtr vertex = nullptr;
+
+	graph.queryResult = S_OK;
+	if (!core.Repair(dirty, radius)) return FAILED(graph.queryResult) ? graph.queryResult : E_FAIL;
+	const std::vector<NAEdge *> & order = core.Decided();
+
+	// move the surviving edges to their new parents first so that the evicted subtrees below only carry evicted edges
+	for (const auto & e : order)
+	{
+		const auto & s = core.State(e);
+		if (s.Evicted) continue;
+		if (s.G != s.OldG) graph.vcache->Get(e->GetHJunction())->UpdateHeuristic(e, s.G);
+		if (s.BestNext != e->TreePrevious)
+		{
+			if (e->TreePrevious) e->TreePrevious->TreeNext.unordered_erase(e, NAEdge::IsEqualNAEdgePtr);
+			e->TreePrevious = s.BestNext;
+			if (s.BestNext) s.BestNext->TreeNext.push_back(e);
+		}
+	}
+	for (const auto & e : order) if (core.State(e).Evicted && graph.tree->Exist(e)) RemoveSubtree(e, evicted);
+
+	// and finally the repaired dirty edges take their new cost as the clean one
+	for (const auto & e : order) if (graph.tree->Exist(e) && e->GetDirtyState() != EdgeDirtyState::CleanState) cleanUp.push_back(e);
+	for (size_t i = 0; i < cleanUp.size(); i += NAEdge::BatchSize)
+		NAEdge::SetCleanBatch(&cleanUp[i], min(NAEdge::BatchSize, cleanUp.size() - i), graph.method, graph.minPop2Route);
+
+	// An evicted edge next to a safe zone can only be found again if that safe zone edge is seeded again. Just like
+	// 'MarkDirtyEdgesAsUnVisited' the whole destination subtree goes with it. The list grows inside the loop on purpose.
+	for (size_t i = 0; i < evicted.size(); ++i)
+	{
+		if (FAILED(hr = graph.EndVertex(evicted[i], vertex))) return hr;
+		if (!vertex) continue;
+		if (FAILED(hr = graph.ecache->QueryAdjacencies(vertex, evicted[i], QueryDirection::Forward, &adj))) return hr;
+		for (const auto & next : *adj) if (!next->TreePrevious && graph.tree->Exist(next)) RemoveSubtree(next, evicted);
+	}
+
+	return hr;
+}
+
+double CARMATreeRepair::FrontierRadius(std::shared_ptr<NAEdgeCache> ecache, std::shared_ptr<NAEdgeContainer> leafs)
+{
+	double radius = CASPER_INFINITY;
+	NAEdgePtr leaf = nullptr;
+
+	for (NAEdgeIterator i = leafs->begin(); i != leafs->end(); i++)
+	{
+		if (i->second & 1)
+		{
+			leaf = ecache->Get(i->first, esriNEDAlongDigitized);
+			if (leaf && leaf->GetHJunction() >= 0) radius = min(radius, leaf->GetCarmaH());
+		}
+		if (i->second & 2)
+		{
+			leaf = ecache->Get(i->first, esriNEDAgainstDigitized);
+			if (leaf && leaf->GetHJunction() >= 0) radius = min(radius, leaf->GetCarmaH());
+		}
+	}
+	return radius;
+}
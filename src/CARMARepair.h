@@ -0,0 +1,104 @@
+// ===============================================================================================
+// Evacuation Solver: Lifelong CARMA tree repair
+// Description: Repairs the CARMA tree of the previous loop after reservation changes in the style
+// of LPA* / D* Lite. Every edge keeps its old label (g) and a one step look-ahead (rhs) and only
+// the edges that become inconsistent are processed, instead of throwing away whole dirty subtrees.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "StdAfx.h"
+#include "NAEdge.h"
+#include "NAVertex.h"
+#include "LifelongRepair.h"
+
+// The repair core works on the edge graph of the closed list just like the CARMA Dijkstra: the label of an edge is the cost
+// from its from-junction to a safe zone through the edge itself and it continues through one of the closed edges that
+// leave its to-junction. The old labels are the CARMA heuristics that are already stored on the edges.
+// Edges that are not closed yet are never looked at. Their labels were at least the radius of the last loop so any
+// repaired label up to that radius is exact. Edges that end up above it (or unreachable) are evicted from the tree and
+// the usual leaf and dirty-parent logic of the CARMA loop grows them again.
+// The closed list as seen by the repair core
+class CARMARepairGraph
+{
+public:
+	typedef NAEdge * Edge;
+
+	NAEdgeMap                      * tree;
+	std::shared_ptr<NAVertexCache> vcache;
+	std::shared_ptr<NAEdgeCache>   ecache;
+	EvcSolverMethod                method;
+	double                         minPop2Route;
+	HRESULT                        queryResult;
+
+	CARMARepairGraph(NAEdgeMap * closedList, std::shared_ptr<NAVertexCache> vertexCache, std::shared_ptr<NAEdgeCache> edgeCache, EvcSolverMethod solverMethod,
+		double pop2Route) : tree(closedList), vcache(vertexCache), ecache(edgeCache), method(solverMethod), minPop2Route(pop2Route), queryResult(S_OK) { }
+
+	static inline NAEdge * None() { return nullptr; }
+	inline bool InTree(NAEdge * edge) const { return edge->GetHJunction() >= 0 && tree->Exist(edge); }
+	inline double OldLabel(NAEdge * edge) const { return edge->GetCarmaH(); }
+	inline size_t Slot(NAEdge * edge) const { return NAEdgeSlot::Of(edge); }
+	inline double OldCost(NAEdge * edge) const { return edge->GetCleanCost(); }
+	inline NAEdge * OldParent(NAEdge * edge) const { return edge->TreePrevious; }
+	double Cost(NAEdge * edge) const;
+	double Seed(NAEdge * edge, double cost) const;
+	HRESULT EndVertex(NAEdge * edge, NAVertexPtr & vertex);
+
+	template <class Visit> bool ForEachNext(NAEdge * edge, Visit visit)
+	{
+		NAVertexPtr end = nullptr;
+		ArrayList<NAEdgePtr> * adj = nullptr;
+
+		if (FAILED(queryResult = EndVertex(edge, end))) return false;
+
+		// a junction that was never labeled has no closed edges leaving it
+		if (!end) return true;
+		if (FAILED(queryResult = ecache->QueryAdjacencies(end, edge, QueryDirection::Forward, &adj))) return false;
+		for (const auto & next : *adj) visit(next);
+		return true;
+	}
+
+	template <class Visit> bool ForEachPrevious(NAEdge * edge, Visit visit)
+	{
+		ArrayList<NAEdgePtr> * adj = nullptr;
+		NAVertexPtr vertex = vcache->Get(edge->GetHJunction());
+
+		if (!vertex) return true;
+		if (FAILED(queryResult = ecache->QueryAdjacencies(vertex, edge, QueryDirection::Backward, &adj))) return false;
+		for (const auto & prev : *adj) visit(prev);
+		return true;
+	}
+};
+
+class CARMATreeRepair
+{
+private:
+	CARMARepairGraph                 graph;
+	LifelongRepair<CARMARepairGraph> core;
+
+	void RemoveSubtree(NAEdge * head, std::vector<NAEdge *> & evicted);
+
+public:
+	CARMATreeRepair(NAEdgeMap * closedList, std::shared_ptr<NAVertexCache> vertexCache, std::shared_ptr<NAEdgeCache> edgeCache,
+		EvcSolverMethod solverMethod, double pop2Route);
+	virtual ~CARMATreeRepair(void) { }
+
+	CARMATreeRepair(const CARMATreeRepair & that) = delete;
+	CARMATreeRepair & operator=(const CARMATreeRepair &) = delete;
+
+	// Repairs the tree after the cost changes of the given closed dirty edges. The repaired edges are clean afterwards and
+	// the ones that had to leave the tree are appended to 'evicted' like the removed edges of 'NonRecursiveMarkAndRemove'.
+	HRESULT Repair(const std::vector<NAEdge *> & dirty, double radius, std::vector<NAEdge *> & evicted);
+
+	// number of inconsistent edges that were processed by the last repair
+	inline unsigned int GetRepairCount() const { return core.GetRepairCount(); }
+
+	// the smallest label among the leafs of the last CARMA loop. Everything outside the tree is at least this far.
+	static double FrontierRadius(std::shared_ptr<NAEdgeCache> ecache, std::shared_ptr<NAEdgeContainer> leafs);
+};
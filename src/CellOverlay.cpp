@@ -0,0 +1,324 @@
+// ===============================================================================================
+// Evacuation Solver: Partition overlay implementation
+// Description: Cell partitioning, clique customization of the dirty cells, and the many-to-nearest
+// query over the overlay
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "CellOverlay.h"
+
+const unsigned int NACellOverlay::CellSize;
+const unsigned int NACellOverlay::NoCell;
+
+NACellOverlay::NACellOverlay(NAGraphSnapshotPtr _graph) : graph(_graph), stamp(0), customizedCells(0), queryCount(0), settledCount(0), lastSettledCount(0)
+{
+	const long junctionCount = (long)graph->JunctionCount();
+	const NAGraphEdgeIndex edgeCount = (NAGraphEdgeIndex)graph->EdgeCount();
+	std::vector<long> queue;
+	std::vector<char> isBoundary(junctionCount, 0);
+	NAGraphStarItr begin, end;
+	unsigned int cells = 0;
+	long w = -1;
+
+	// breadth first region growing. a cell stops growing once it is full and the rest of its frontier starts new cells.
+	cellOf.assign(junctionCount, NoCell);
+	queue.reserve(CellSize);
+	for (long s = 0; s < junctionCount; ++s)
+	{
+		if (cellOf[s] != NoCell) continue;
+		queue.clear();
+		queue.push_back(s);
+		cellOf[s] = cells;
+		for (size_t q = 0; q < queue.size() && queue.size() < CellSize; ++q)
+		{
+			for (int dir = 0; dir < 2; ++dir)
+			{
+				if (dir == 0) graph->ForwardStar(queue[q], begin, end);
+				else graph->BackwardStar(queue[q], begin, end);
+				for (auto i = begin; i != end && queue.size() < CellSize; ++i)
+				{
+					w = dir == 0 ? graph->GetToJunction(*i) : graph->GetFromJunction(*i);
+					if (cellOf[w] != NoCell) continue;
+					cellOf[w] = cells;
+					queue.push_back(w);
+				}
+			}
+		}
+		++cells;
+	}
+
+	// both ends of an edge between two cells are boundary junctions of their own cell
+	for (NAGraphEdgeIndex e = 0; e < edgeCount; ++e)
+		if (cellOf[graph->GetFromJunction(e)] != cellOf[graph->GetToJunction(e)])
+		{
+			isBoundary[graph->GetFromJunction(e)] = 1;
+			isBoundary[graph->GetToJunction(e)] = 1;
+		}
+
+	boundaryOffset.assign(cells + 1, 0);
+	for (long j = 0; j < junctionCount; ++j) if (isBoundary[j]) ++boundaryOffset[cellOf[j] + 1];
+	for (unsigned int c = 1; c <= cells; ++c) boundaryOffset[c] += boundaryOffset[c - 1];
+
+	std::vector<unsigned int> next(boundaryOffset.begin(), boundaryOffset.end() - 1);
+	boundaries.resize(boundaryOffset.back());
+	boundaryIndex.assign(junctionCount, UINT_MAX);
+	for (long j = 0; j < junctionCount; ++j)
+		if (isBoundary[j])
+		{
+			boundaryIndex[j] = next[cellOf[j]] - boundaryOffset[cellOf[j]];
+			boundaries[next[cellOf[j]]++] = j;
+		}
+
+	cliqueOffset.assign(cells + 1, 0);
+	for (unsigned int c = 0; c < cells; ++c)
+	{
+		size_t b = boundaryOffset[c + 1] - boundaryOffset[c];
+		cliqueOffset[c + 1] = cliqueOffset[c] + b * b;
+	}
+	clique.assign(cliqueOffset.back(), CASPER_INFINITY);
+
+	// the first customization starts from the snapshot costs and covers every cell
+	edgeCost.resize(edgeCount);
+	for (NAGraphEdgeIndex e = 0; e < edgeCount; ++e) edgeCost[e] = graph->GetCost(e);
+	dirty.assign(cells, 1);
+	dirtyCells.reserve(cells);
+	for (unsigned int c = 0; c < cells; ++c) dirtyCells.push_back(c);
+
+	cost.assign(junctionCount, CASPER_INFINITY);
+	predEdge.assign(junctionCount, NAGraphSnapshot::NoEdge);
+	predJunction.assign(junctionCount, -1);
+	viaBoundary.assign(junctionCount, 0);
+	tag.assign(junctionCount, 0);
+	targetOffset.assign(junctionCount, CASPER_INFINITY);
+	targetTag.assign(junctionCount, 0);
+	openStamp.assign(cells, 0);
+}
+
+size_t NACellOverlay::MemoryUsage() const
+{
+	return sizeof(unsigned int) * (cellOf.capacity() + boundaryIndex.capacity() + boundaryOffset.capacity() + openStamp.capacity()) + sizeof(long) * (boundaries.capacity() + predJunction.capacity()) + viaBoundary.capacity() +
+		sizeof(double) * (clique.capacity() + edgeCost.capacity() + cost.capacity() + targetOffset.capacity()) + sizeof(NAGraphEdgeIndex) * predEdge.capacity() +
+		sizeof(size_t) * (cliqueOffset.capacity() + tag.capacity() + targetTag.capacity());
+}
+
+void NACellOverlay::ResetLabels()
+{
+	for (const auto j : touched)
+	{
+		cost[j] = CASPER_INFINITY;
+		predEdge[j] = NAGraphSnapshot::NoEdge;
+		predJunction[j] = -1;
+		viaBoundary[j] = 0;
+	}
+	touched.clear();
+	heap.clear();
+}
+
+// Dijkstra from 'source' that never leaves the cell. It stops once 'target' is settled or runs out if there is no target.
+void NACellOverlay::LocalSearch(unsigned int cell, long source, long target)
+{
+	NAGraphStarItr begin, end;
+	long w = -1;
+	double d = 0.0;
+	char via = 0;
+
+	cost[source] = 0.0;
+	touched.push_back(source);
+	heap.push_back(Label(0.0, source));
+
+	while (!heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end(), std::greater<Label>());
+		Label top = heap.back();
+		heap.pop_back();
+		if (top.first > cost[top.second]) continue;
+		if (top.second == target) break;
+
+		// a tie is enough to mark a junction: one of its cheapest paths goes through another boundary junction
+		via = viaBoundary[top.second] || (top.second != source && boundaryIndex[top.second] != UINT_MAX) ? 1 : 0;
+		graph->ForwardStar(top.second, begin, end);
+		for (auto i = begin; i != end; ++i)
+		{
+			w = graph->GetToJunction(*i);
+			if (cellOf[w] != cell || edgeCost[*i] >= CASPER_INFINITY) continue;
+			d = top.first + edgeCost[*i];
+			if (d == cost[w]) viaBoundary[w] |= via;
+			if (d >= cost[w]) continue;
+			if (cost[w] >= CASPER_INFINITY) touched.push_back(w);
+			cost[w] = d;
+			viaBoundary[w] = via;
+			predEdge[w] = *i;
+			predJunction[w] = top.second;
+			heap.push_back(Label(d, w));
+			std::push_heap(heap.begin(), heap.end(), std::greater<Label>());
+		}
+	}
+}
+
+void NACellOverlay::CustomizeCell(unsigned int cell)
+{
+	const unsigned int first = boundaryOffset[cell], count = boundaryOffset[cell + 1] - first;
+	double * row = nullptr;
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		LocalSearch(cell, boundaries[first + i], -1);
+		row = &(clique[cliqueOffset[cell] + (size_t)i * count]);
+		for (unsigned int j = 0; j < count; ++j) row[j] = viaBoundary[boundaries[first + j]] ? CASPER_INFINITY : cost[boundaries[first + j]];
+		ResetLabels();
+	}
+	++customizedCells;
+}
+
+void NACellOverlay::Customize()
+{
+	for (const auto c : dirtyCells)
+	{
+		CustomizeCell(c);
+		dirty[c] = 0;
+	}
+	dirtyCells.clear();
+}
+
+void NACellOverlay::UnpackShortcut(unsigned int cell, long from, long to, std::vector<NAGraphEdgeIndex> & edges)
+{
+	size_t mark = edges.size();
+	LocalSearch(cell, from, to);
+	for (long x = to; x != from && predEdge[x] != NAGraphSnapshot::NoEdge; x = predJunction[x]) edges.push_back(predEdge[x]);
+	std::reverse(edges.begin() + mark, edges.end());
+	ResetLabels();
+}
+
+bool NACellOverlay::Nearest(const std::vector<NAHierarchySeed> & sources, const std::vector<NAHierarchySeed> & targets, NAHierarchyRoute & route)
+{
+	struct Step
+	{
+		NAGraphEdgeIndex Edge;
+		long             From;
+		long             To;
+	};
+	std::vector<Step> steps;
+	NAGraphStarItr begin, end;
+	long w = -1, meet = -1;
+	unsigned int cell = NoCell, i = 0, count = 0;
+	double best = CASPER_INFINITY;
+	const double * row = nullptr;
+
+	auto Relax = [&](long from, long to, double c, NAGraphEdgeIndex edge)
+	{
+		if (c >= best || c >= cost[to]) return;
+		if (cost[to] >= CASPER_INFINITY) touched.push_back(to);
+		cost[to] = c;
+		predEdge[to] = edge;
+		predJunction[to] = from;
+		tag[to] = tag[from];
+		heap.push_back(Label(c, to));
+		std::push_heap(heap.begin(), heap.end(), std::greater<Label>());
+	};
+
+	ResetLabels();
+	for (const auto j : targetTouched) targetOffset[j] = CASPER_INFINITY;
+	targetTouched.clear();
+	route.Cost = CASPER_INFINITY;
+	route.Edges.clear();
+	++queryCount;
+	lastSettledCount = 0;
+
+	// a new stamp opens no cell. on a wrap around every stamp is cleared so an old cell does not look open again.
+	if (++stamp == 0)
+	{
+		std::fill(openStamp.begin(), openStamp.end(), 0);
+		stamp = 1;
+	}
+
+	for (const auto & t : targets)
+	{
+		if (t.Junction < 0 || (size_t)t.Junction >= targetOffset.size() || t.Offset >= CASPER_INFINITY || t.Offset >= targetOffset[t.Junction]) continue;
+		if (targetOffset[t.Junction] >= CASPER_INFINITY) targetTouched.push_back(t.Junction);
+		targetOffset[t.Junction] = t.Offset;
+		targetTag[t.Junction] = t.Tag;
+		openStamp[cellOf[t.Junction]] = stamp;
+	}
+	if (targetTouched.empty()) return false;
+
+	for (const auto & s : sources)
+	{
+		if (s.Junction < 0 || (size_t)s.Junction >= cost.size() || s.Offset >= CASPER_INFINITY || s.Offset >= cost[s.Junction]) continue;
+		if (cost[s.Junction] >= CASPER_INFINITY) touched.push_back(s.Junction);
+		cost[s.Junction] = s.Offset;
+		tag[s.Junction] = s.Tag;
+		openStamp[cellOf[s.Junction]] = stamp;
+		heap.push_back(Label(s.Offset, s.Junction));
+	}
+	std::make_heap(heap.begin(), heap.end(), std::greater<Label>());
+
+	while (!heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end(), std::greater<Label>());
+		Label top = heap.back();
+		heap.pop_back();
+		if (top.first > cost[top.second]) continue;
+		if (top.first >= best) break;
+		++lastSettledCount;
+
+		if (targetOffset[top.second] < CASPER_INFINITY && top.first + targetOffset[top.second] < best)
+		{
+			best = top.first + targetOffset[top.second];
+			meet = top.second;
+		}
+
+		// inside an open cell every edge is followed. a closed cell is only ever entered at a boundary junction and is
+		// left either through the clique to another one of its boundary junctions or over an edge to the next cell.
+		cell = cellOf[top.second];
+		bool open = openStamp[cell] == stamp || boundaryIndex[top.second] == UINT_MAX;
+		graph->ForwardStar(top.second, begin, end);
+		for (auto e = begin; e != end; ++e)
+		{
+			w = graph->GetToJunction(*e);
+			if (edgeCost[*e] >= CASPER_INFINITY || (!open && cellOf[w] == cell)) continue;
+			Relax(top.second, w, top.first + edgeCost[*e], *e);
+		}
+		if (!open)
+		{
+			count = boundaryOffset[cell + 1] - boundaryOffset[cell];
+			row = &(clique[cliqueOffset[cell] + (size_t)boundaryIndex[top.second] * count]);
+			for (i = 0; i < count; ++i)
+			{
+				w = boundaries[boundaryOffset[cell] + i];
+				if (w == top.second || row[i] >= CASPER_INFINITY) continue;
+				Relax(top.second, w, top.first + row[i], NAGraphSnapshot::NoEdge);
+			}
+		}
+	}
+	settledCount += lastSettledCount;
+
+	if (meet < 0)
+	{
+		ResetLabels();
+		return false;
+	}
+
+	route.Cost = best;
+	route.SourceTag = tag[meet];
+	route.TargetTag = targetTag[meet];
+
+	// the labels are needed by the local searches that unpack the shortcuts so the chain is copied out first
+	for (long x = meet; predJunction[x] >= 0; x = predJunction[x])
+	{
+		Step s = { predEdge[x], predJunction[x], x };
+		steps.push_back(s);
+	}
+	ResetLabels();
+
+	for (auto s = steps.rbegin(); s != steps.rend(); ++s)
+	{
+		if (s->Edge != NAGraphSnapshot::NoEdge) route.Edges.push_back(s->Edge);
+		else UnpackShortcut(cellOf[s->From], s->From, s->To, route.Edges);
+	}
+	return true;
+}
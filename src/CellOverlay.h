@@ -0,0 +1,105 @@
+// ===============================================================================================
+// Evacuation Solver: Partition overlay
+// Description: A customizable partition overlay of the graph snapshot. The junctions are split into
+// cells and every cell keeps a table of the current costs between its boundary junctions. Only the
+// cells that have an edge whose cost changed are customized again so reservations stay cheap, and
+// the per-evacuee search jumps over every cell it does not start or end in.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "NAGraph.h"
+#include "ContractionHierarchy.h"
+
+// The cells are grown breadth first over the undirected snapshot until they hold 'CellSize' junctions. A boundary
+// junction has an edge to or from another cell. The clique of a cell is a dense boundary-by-boundary table of the cost
+// of the cheapest path that stays inside the cell; it is the only thing a query looks at when it crosses the cell. A pair
+// whose cheapest path already goes through a third boundary junction of the cell is left out of the clique (infinite)
+// since the query gets the same cost through that junction, which keeps the rows short on grid-like networks.
+// The edge costs are owned by the overlay: the caller sets them one by one and each change of an edge inside a cell
+// marks that cell dirty. 'Customize' recomputes the dirty cliques only.
+class NACellOverlay
+{
+private:
+	typedef std::pair<double, long> Label;
+
+	NAGraphSnapshotPtr            graph;
+	std::vector<unsigned int>     cellOf;
+	std::vector<unsigned int>     boundaryIndex;
+	std::vector<unsigned int>     boundaryOffset;
+	std::vector<long>             boundaries;
+	std::vector<size_t>           cliqueOffset;
+	std::vector<double>           clique;
+	std::vector<double>           edgeCost;
+	std::vector<char>             dirty;
+	std::vector<unsigned int>     dirtyCells;
+
+	// labels of the query and of the local searches. they are reset through the touched lists.
+	std::vector<double>           cost;
+	std::vector<NAGraphEdgeIndex> predEdge;
+	std::vector<long>             predJunction;
+	std::vector<char>             viaBoundary;
+	std::vector<size_t>           tag;
+	std::vector<long>             touched;
+	std::vector<double>           targetOffset;
+	std::vector<size_t>           targetTag;
+	std::vector<long>             targetTouched;
+	std::vector<unsigned int>     openStamp;
+	std::vector<Label>            heap;
+	unsigned int                  stamp;
+
+	size_t                        customizedCells;
+	size_t                        queryCount;
+	size_t                        settledCount;
+	size_t                        lastSettledCount;
+
+	void ResetLabels();
+	void LocalSearch(unsigned int cell, long source, long target);
+	void CustomizeCell(unsigned int cell);
+	void UnpackShortcut(unsigned int cell, long from, long to, std::vector<NAGraphEdgeIndex> & edges);
+
+public:
+	static const unsigned int CellSize = 256;
+	static const unsigned int NoCell = UINT_MAX;
+
+	NACellOverlay(NAGraphSnapshotPtr _graph);
+	virtual ~NACellOverlay(void) { }
+
+	NACellOverlay(const NACellOverlay & that) = delete;
+	NACellOverlay & operator=(const NACellOverlay &) = delete;
+
+	// a changed cost of an edge inside a cell dirties that cell. edges between cells are read by the query directly.
+	inline void SetCost(NAGraphEdgeIndex e, double c)
+	{
+		if (e == NAGraphSnapshot::NoEdge || edgeCost[e] == c) return;
+		edgeCost[e] = c;
+		unsigned int cell = cellOf[graph->GetFromJunction(e)];
+		if (cell == cellOf[graph->GetToJunction(e)] && !dirty[cell])
+		{
+			dirty[cell] = 1;
+			dirtyCells.push_back(cell);
+		}
+	}
+
+	void Customize();
+
+	// the closest target from any of the sources on the current costs. the cells of the sources and the targets are
+	// searched edge by edge and every other cell only through its clique.
+	bool Nearest(const std::vector<NAHierarchySeed> & sources, const std::vector<NAHierarchySeed> & targets, NAHierarchyRoute & route);
+
+	size_t CellCount()           const { return boundaryOffset.empty() ? 0 : boundaryOffset.size() - 1; }
+	size_t BoundaryCount()       const { return boundaries.size(); }
+	size_t GetCustomizedCells()  const { return customizedCells; }
+	size_t GetQueryCount()       const { return queryCount; }
+	size_t GetSettledCount()     const { return settledCount; }
+	size_t GetLastSettledCount() const { return lastSettledCount; }
+	size_t MemoryUsage()         const;
+};
+
+typedef std::shared_ptr<NACellOverlay> NACellOverlayPtr;
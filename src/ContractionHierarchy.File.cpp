@@ -0,0 +1,81 @@
+// ===============================================================================================
+// Evacuation Solver: Contraction hierarchy disk cache
+// Description: Saves and loads the hierarchy next to the network dataset. Kept apart from the
+// contraction itself since the wide file names only open with the MSVC streams.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "StdAfx.h"
+#include "ContractionHierarchy.h"
+
+// bump this whenever the file layout changes so that old cache files are simply rebuilt
+static const unsigned int HierarchyFileMagic = 0x48434143; // "CACH"
+static const unsigned int HierarchyFileVersion = 1;
+
+bool NAContractionHierarchy::Save(const std::wstring & path, const std::wstring & key, unsigned long long fingerprint) const
+{
+	unsigned int header[2] = { HierarchyFileMagic, HierarchyFileVersion };
+	unsigned long long sizes[7] = { fingerprint, (unsigned long long)junctionCount, (unsigned long long)arcs.size(), (unsigned long long)upArcs.size(),
+		(unsigned long long)downArcs.size(), (unsigned long long)shortcutCount, (unsigned long long)key.size() };
+	std::ofstream file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!file.is_open() || IsEmpty()) return false;
+
+	file.write(reinterpret_cast<const char *>(header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+	file.write(reinterpret_cast<const char *>(key.c_str()), key.size() * sizeof(wchar_t));
+	file.write(reinterpret_cast<const char *>(arcs.data()), arcs.size() * sizeof(NAHierarchyArc));
+	file.write(reinterpret_cast<const char *>(upOffset.data()), upOffset.size() * sizeof(unsigned int));
+	file.write(reinterpret_cast<const char *>(upArcs.data()), upArcs.size() * sizeof(unsigned int));
+	file.write(reinterpret_cast<const char *>(downOffset.data()), downOffset.size() * sizeof(unsigned int));
+	file.write(reinterpret_cast<const char *>(downArcs.data()), downArcs.size() * sizeof(unsigned int));
+	return file.good();
+}
+
+bool NAContractionHierarchy::Load(const std::wstring & path, const std::wstring & key, unsigned long long fingerprint)
+{
+	unsigned int header[2] = { 0, 0 };
+	unsigned long long sizes[7] = { 0, 0, 0, 0, 0, 0, 0 };
+	std::wstring savedKey;
+	std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+	if (!file.is_open()) return false;
+
+	if (!file.read(reinterpret_cast<char *>(header), sizeof(header))) return false;
+	if (header[0] != HierarchyFileMagic || header[1] != HierarchyFileVersion) return false;
+	if (!file.read(reinterpret_cast<char *>(sizes), sizeof(sizes))) return false;
+	if (sizes[0] != fingerprint || sizes[1] == 0 || sizes[6] != key.size()) return false;
+	savedKey.resize(key.size());
+	if (!savedKey.empty() && !file.read(reinterpret_cast<char *>(&(savedKey[0])), savedKey.size() * sizeof(wchar_t))) return false;
+	if (savedKey != key) return false;
+
+	junctionCount = (size_t)sizes[1];
+	shortcutCount = (size_t)sizes[5];
+	arcs.resize((size_t)sizes[2]);
+	upOffset.resize(junctionCount + 1);
+	upArcs.resize((size_t)sizes[3]);
+	downOffset.resize(junctionCount + 1);
+	downArcs.resize((size_t)sizes[4]);
+	file.read(reinterpret_cast<char *>(arcs.data()), arcs.size() * sizeof(NAHierarchyArc));
+	file.read(reinterpret_cast<char *>(upOffset.data()), upOffset.size() * sizeof(unsigned int));
+	file.read(reinterpret_cast<char *>(upArcs.data()), upArcs.size() * sizeof(unsigned int));
+	file.read(reinterpret_cast<char *>(downOffset.data()), downOffset.size() * sizeof(unsigned int));
+	file.read(reinterpret_cast<char *>(downArcs.data()), downArcs.size() * sizeof(unsigned int));
+
+	// a truncated file is as good as no file
+	if (!file || upOffset.back() != upArcs.size() || downOffset.back() != downArcs.size())
+	{
+		arcs.clear();
+		upOffset.clear();
+		upArcs.clear();
+		downOffset.clear();
+		downArcs.clear();
+		junctionCount = 0;
+		shortcutCount = 0;
+		return false;
+	}
+	return true;
+}
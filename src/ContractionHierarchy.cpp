@@ -0,0 +1,365 @@
+// ===============================================================================================
+// Evacuation Solver: Contraction hierarchy implementation
+// Description: Junction contraction with witness searches and the many-to-nearest query
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "ContractionHierarchy.h"
+
+const unsigned int NAContractionHierarchy::WitnessSettleLimit;
+
+static inline void EraseArcId(std::vector<unsigned int> & list, unsigned int id)
+{
+	for (size_t i = 0; i < list.size(); ++i)
+		if (list[i] == id)
+		{
+			list[i] = list.back();
+			list.pop_back();
+			return;
+		}
+}
+
+void NAContractionHierarchy::Build(const NAGraphSnapshot & graph)
+{
+	typedef std::pair<double, long> Label;
+	std::vector<std::vector<unsigned int>> outArcs, inArcs, up, down;
+	std::vector<unsigned int> deletedNeighbors;
+	std::vector<char> contracted;
+	std::vector<double> witness;
+	std::vector<long> witnessTouched;
+	std::vector<Label> witnessHeap, queue;
+	long from = -1, to = -1;
+	double cost = 0.0, priority = 0.0;
+	bool found = false;
+
+	arcs.clear();
+	upOffset.clear();
+	upArcs.clear();
+	downOffset.clear();
+	downArcs.clear();
+	shortcutCount = 0;
+	junctionCount = graph.JunctionCount();
+	if (junctionCount == 0) return;
+
+	outArcs.resize(junctionCount);
+	inArcs.resize(junctionCount);
+	up.resize(junctionCount);
+	down.resize(junctionCount);
+	deletedNeighbors.assign(junctionCount, 0);
+	contracted.assign(junctionCount, 0);
+	witness.assign(junctionCount, CASPER_INFINITY);
+
+	// original arcs. loops can never be part of a shortest path and only the cheapest of parallel edges is kept.
+	arcs.reserve(graph.EdgeCount() * 2);
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)graph.EdgeCount(); ++e)
+	{
+		from = graph.GetFromJunction(e);
+		to = graph.GetToJunction(e);
+		cost = graph.GetCost(e);
+		if (from == to || cost >= CASPER_INFINITY) continue;
+		found = false;
+		for (const auto a : outArcs[from])
+			if (arcs[a].ToJunction == to)
+			{
+				if (cost < arcs[a].Cost) arcs[a] = NAHierarchyArc(from, to, cost, e);
+				found = true;
+				break;
+			}
+		if (found) continue;
+		outArcs[from].push_back((unsigned int)arcs.size());
+		inArcs[to].push_back((unsigned int)arcs.size());
+		arcs.push_back(NAHierarchyArc(from, to, cost, e));
+	}
+
+	// Dijkstra from 'source' on the remaining graph without going through 'via'. It stops at 'limit' or after
+	// settling 'WitnessSettleLimit' junctions. Whatever it did not reach keeps an infinite witness.
+	auto WitnessSearch = [&](long source, long via, double limit)
+	{
+		unsigned int settled = 0;
+		for (const auto j : witnessTouched) witness[j] = CASPER_INFINITY;
+		witnessTouched.clear();
+		witnessHeap.clear();
+		witness[source] = 0.0;
+		witnessTouched.push_back(source);
+		witnessHeap.push_back(Label(0.0, source));
+
+		while (!witnessHeap.empty() && settled < WitnessSettleLimit)
+		{
+			std::pop_heap(witnessHeap.begin(), witnessHeap.end(), std::greater<Label>());
+			Label top = witnessHeap.back();
+			witnessHeap.pop_back();
+			if (top.first > witness[top.second]) continue;
+			if (top.first > limit) break;
+			++settled;
+
+			for (const auto a : outArcs[top.second])
+			{
+				long next = arcs[a].ToJunction;
+				double d = top.first + arcs[a].Cost;
+				if (next == via || d > limit || d >= witness[next]) continue;
+				if (witness[next] >= CASPER_INFINITY) witnessTouched.push_back(next);
+				witness[next] = d;
+				witnessHeap.push_back(Label(d, next));
+				std::push_heap(witnessHeap.begin(), witnessHeap.end(), std::greater<Label>());
+			}
+		}
+	};
+
+	// finds the shortcuts that contracting 'x' needs. the simulation only counts them.
+	auto Contract = [&](long x, bool simulate) -> int
+	{
+		int shortcuts = 0;
+		double maxOut = 0.0;
+		for (const auto a : outArcs[x]) maxOut = std::max(maxOut, arcs[a].Cost);
+
+		// the arc lists of x can not change while x is contracted since no shortcut ever starts or ends at x
+		for (size_t i = 0; i < inArcs[x].size(); ++i)
+		{
+			unsigned int in = inArcs[x][i];
+			long u = arcs[in].FromJunction;
+			WitnessSearch(u, x, arcs[in].Cost + maxOut);
+
+			for (size_t k = 0; k < outArcs[x].size(); ++k)
+			{
+				unsigned int out = outArcs[x][k];
+				long w = arcs[out].ToJunction;
+				double via = arcs[in].Cost + arcs[out].Cost;
+				if (w == u || witness[w] <= via) continue;
+				++shortcuts;
+				if (simulate) continue;
+
+				// a shortcut replaces a more expensive arc between the same junctions
+				bool dominated = false;
+				for (const auto a : outArcs[u])
+					if (arcs[a].ToJunction == w)
+					{
+						if (arcs[a].Cost <= via) dominated = true;
+						else
+						{
+							EraseArcId(outArcs[u], a);
+							EraseArcId(inArcs[w], a);
+						}
+						break;
+					}
+				if (dominated) continue;
+				outArcs[u].push_back((unsigned int)arcs.size());
+				inArcs[w].push_back((unsigned int)arcs.size());
+				arcs.push_back(NAHierarchyArc(u, w, via, NAGraphSnapshot::NoEdge, in, out));
+				++shortcutCount;
+			}
+		}
+		return shortcuts;
+	};
+
+	auto Priority = [&](long x) -> double
+	{
+		return (double)Contract(x, true) - (double)(inArcs[x].size() + outArcs[x].size()) + (double)deletedNeighbors[x];
+	};
+
+	queue.reserve(junctionCount);
+	for (long x = 0; x < (long)junctionCount; ++x) queue.push_back(Label(Priority(x), x));
+	std::make_heap(queue.begin(), queue.end(), std::greater<Label>());
+
+	// lazy updates: a junction is only contracted if its recomputed priority is still the smallest one
+	while (!queue.empty())
+	{
+		std::pop_heap(queue.begin(), queue.end(), std::greater<Label>());
+		long x = queue.back().second;
+		queue.pop_back();
+		if (contracted[x]) continue;
+
+		priority = Priority(x);
+		if (!queue.empty() && priority > queue.front().first)
+		{
+			queue.push_back(Label(priority, x));
+			std::push_heap(queue.begin(), queue.end(), std::greater<Label>());
+			continue;
+		}
+
+		Contract(x, false);
+		contracted[x] = 1;
+
+		// everything still attached to x goes to a junction with a higher rank
+		for (const auto a : outArcs[x])
+		{
+			EraseArcId(inArcs[arcs[a].ToJunction], a);
+			++deletedNeighbors[arcs[a].ToJunction];
+			up[x].push_back(a);
+		}
+		for (const auto a : inArcs[x])
+		{
+			EraseArcId(outArcs[arcs[a].FromJunction], a);
+			++deletedNeighbors[arcs[a].FromJunction];
+			down[x].push_back(a);
+		}
+		std::vector<unsigned int>().swap(outArcs[x]);
+		std::vector<unsigned int>().swap(inArcs[x]);
+	}
+
+	upOffset.assign(junctionCount + 1, 0);
+	downOffset.assign(junctionCount + 1, 0);
+	for (size_t x = 0; x < junctionCount; ++x)
+	{
+		upOffset[x + 1] = upOffset[x] + (unsigned int)up[x].size();
+		downOffset[x + 1] = downOffset[x] + (unsigned int)down[x].size();
+	}
+	upArcs.reserve(upOffset.back());
+	downArcs.reserve(downOffset.back());
+	for (size_t x = 0; x < junctionCount; ++x)
+	{
+		upArcs.insert(upArcs.end(), up[x].begin(), up[x].end());
+		downArcs.insert(downArcs.end(), down[x].begin(), down[x].end());
+	}
+	arcs.shrink_to_fit();
+}
+
+NAHierarchyQuery::NAHierarchyQuery(const NAContractionHierarchy & _hierarchy) : hierarchy(_hierarchy), hasTargets(false)
+{
+	targetCost.assign(hierarchy.JunctionCount(), CASPER_INFINITY);
+	targetArc.assign(hierarchy.JunctionCount(), UINT_MAX);
+	targetTag.assign(hierarchy.JunctionCount(), 0);
+	sourceCost.assign(hierarchy.JunctionCount(), CASPER_INFINITY);
+	sourceArc.assign(hierarchy.JunctionCount(), UINT_MAX);
+	sourceTag.assign(hierarchy.JunctionCount(), 0);
+}
+
+// There is no pruning here: every junction above a target may be where some evacuee meets it.
+void NAHierarchyQuery::SetTargets(const std::vector<NAHierarchySeed> & targets)
+{
+	long next = -1;
+	double d = 0.0;
+
+	for (const auto j : targetTouched)
+	{
+		targetCost[j] = CASPER_INFINITY;
+		targetArc[j] = UINT_MAX;
+	}
+	targetTouched.clear();
+	heap.clear();
+	hasTargets = false;
+
+	for (const auto & t : targets)
+	{
+		if (t.Junction < 0 || (size_t)t.Junction >= targetCost.size() || t.Offset >= CASPER_INFINITY || t.Offset >= targetCost[t.Junction]) continue;
+		if (targetCost[t.Junction] >= CASPER_INFINITY) targetTouched.push_back(t.Junction);
+		targetCost[t.Junction] = t.Offset;
+		targetTag[t.Junction] = t.Tag;
+		heap.push_back(Label(t.Offset, t.Junction));
+		hasTargets = true;
+	}
+	std::make_heap(heap.begin(), heap.end(), std::greater<Label>());
+
+	while (!heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end(), std::greater<Label>());
+		Label top = heap.back();
+		heap.pop_back();
+		if (top.first > targetCost[top.second]) continue;
+
+		for (unsigned int i = hierarchy.downOffset[top.second]; i < hierarchy.downOffset[top.second + 1]; ++i)
+		{
+			const NAHierarchyArc & arc = hierarchy.arcs[hierarchy.downArcs[i]];
+			next = arc.FromJunction;
+			d = top.first + arc.Cost;
+			if (d >= targetCost[next]) continue;
+			if (targetCost[next] >= CASPER_INFINITY) targetTouched.push_back(next);
+			targetCost[next] = d;
+			targetArc[next] = hierarchy.downArcs[i];
+			targetTag[next] = targetTag[top.second];
+			heap.push_back(Label(d, next));
+			std::push_heap(heap.begin(), heap.end(), std::greater<Label>());
+		}
+	}
+}
+
+bool NAHierarchyQuery::Nearest(const std::vector<NAHierarchySeed> & sources, NAHierarchyRoute & route)
+{
+	long next = -1, meet = -1;
+	double d = 0.0, best = CASPER_INFINITY;
+	std::vector<unsigned int> chain;
+
+	for (const auto j : sourceTouched)
+	{
+		sourceCost[j] = CASPER_INFINITY;
+		sourceArc[j] = UINT_MAX;
+	}
+	sourceTouched.clear();
+	heap.clear();
+	route.Cost = CASPER_INFINITY;
+	route.Edges.clear();
+	if (!hasTargets) return false;
+
+	for (const auto & s : sources)
+	{
+		if (s.Junction < 0 || (size_t)s.Junction >= sourceCost.size() || s.Offset >= CASPER_INFINITY || s.Offset >= sourceCost[s.Junction]) continue;
+		if (sourceCost[s.Junction] >= CASPER_INFINITY) sourceTouched.push_back(s.Junction);
+		sourceCost[s.Junction] = s.Offset;
+		sourceTag[s.Junction] = s.Tag;
+		heap.push_back(Label(s.Offset, s.Junction));
+	}
+	std::make_heap(heap.begin(), heap.end(), std::greater<Label>());
+
+	// the labels only grow so once the smallest one is as big as the best meeting cost nothing can beat it
+	while (!heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end(), std::greater<Label>());
+		Label top = heap.back();
+		heap.pop_back();
+		if (top.first > sourceCost[top.second]) continue;
+		if (top.first >= best) break;
+
+		if (targetCost[top.second] < CASPER_INFINITY && top.first + targetCost[top.second] < best)
+		{
+			best = top.first + targetCost[top.second];
+			meet = top.second;
+		}
+
+		for (unsigned int i = hierarchy.upOffset[top.second]; i < hierarchy.upOffset[top.second + 1]; ++i)
+		{
+			const NAHierarchyArc & arc = hierarchy.arcs[hierarchy.upArcs[i]];
+			next = arc.ToJunction;
+			d = top.first + arc.Cost;
+			if (d >= sourceCost[next] || d >= best) continue;
+			if (sourceCost[next] >= CASPER_INFINITY) sourceTouched.push_back(next);
+			sourceCost[next] = d;
+			sourceArc[next] = hierarchy.upArcs[i];
+			sourceTag[next] = sourceTag[top.second];
+			heap.push_back(Label(d, next));
+			std::push_heap(heap.begin(), heap.end(), std::greater<Label>());
+		}
+	}
+	if (meet < 0) return false;
+
+	route.Cost = best;
+	route.SourceTag = sourceTag[meet];
+	route.TargetTag = targetTag[meet];
+
+	// the upward half is walked back from the meeting junction so it is unpacked in reverse
+	for (long x = meet; sourceArc[x] != UINT_MAX; x = hierarchy.arcs[sourceArc[x]].FromJunction) chain.push_back(sourceArc[x]);
+	for (auto a = chain.rbegin(); a != chain.rend(); ++a) Unpack(*a, route.Edges);
+	for (long x = meet; targetArc[x] != UINT_MAX; x = hierarchy.arcs[targetArc[x]].ToJunction) Unpack(targetArc[x], route.Edges);
+	return true;
+}
+
+// a shortcut expands into its first arc and then its second one, both of which may be shortcuts themselves
+void NAHierarchyQuery::Unpack(unsigned int arc, std::vector<NAGraphEdgeIndex> & edges)
+{
+	unpack.clear();
+	unpack.push_back(arc);
+	while (!unpack.empty())
+	{
+		const NAHierarchyArc & a = hierarchy.arcs[unpack.back()];
+		unpack.pop_back();
+		if (a.IsShortcut())
+		{
+			unpack.push_back(a.Second);
+			unpack.push_back(a.First);
+		}
+		else edges.push_back(a.Edge);
+	}
+}
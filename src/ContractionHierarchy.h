@@ -0,0 +1,136 @@
+// ===============================================================================================
+// Evacuation Solver: Contraction hierarchy
+// Description: A contraction hierarchy of the free-flow costs of the graph snapshot along with a
+// many-to-nearest query. The shortest path (SP) solver does not care about capacity so every evacuee
+// simply goes to its closest safe zone and this answers that with two small upward searches.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "NAGraph.h"
+
+// One arc of the hierarchy. An original arc is a snapshot edge and a shortcut is made of two arcs that go through the
+// junction which was contracted when the shortcut was added.
+struct NAHierarchyArc
+{
+	long             FromJunction;
+	long             ToJunction;
+	double           Cost;
+	NAGraphEdgeIndex Edge;
+	unsigned int     First;
+	unsigned int     Second;
+
+	NAHierarchyArc(void) : FromJunction(-1), ToJunction(-1), Cost(0.0), Edge(NAGraphSnapshot::NoEdge), First(UINT_MAX), Second(UINT_MAX) { }
+	NAHierarchyArc(long from, long to, double cost, NAGraphEdgeIndex edge, unsigned int first = UINT_MAX, unsigned int second = UINT_MAX) :
+		FromJunction(from), ToJunction(to), Cost(cost), Edge(edge), First(first), Second(second) { }
+
+	inline bool IsShortcut() const { return Edge == NAGraphSnapshot::NoEdge; }
+};
+
+// A start or an end of a query. The offset is the cost of getting from the evacuee to the junction or from the
+// junction into the safe zone and the tag is handed back so the caller knows which one the route used.
+struct NAHierarchySeed
+{
+	long   Junction;
+	double Offset;
+	size_t Tag;
+
+	NAHierarchySeed(long junction, double offset, size_t tag) : Junction(junction), Offset(offset), Tag(tag) { }
+};
+
+struct NAHierarchyRoute
+{
+	double                        Cost;
+	size_t                        SourceTag;
+	size_t                        TargetTag;
+	std::vector<NAGraphEdgeIndex> Edges;
+
+	NAHierarchyRoute(void) : Cost(CASPER_INFINITY), SourceTag(0), TargetTag(0) { }
+};
+
+// Junctions are contracted one by one in the order of their edge difference (shortcuts needed minus arcs removed) plus
+// the number of neighbors already contracted, which keeps the hierarchy flat in every part of the network. A shortcut is
+// skipped only if a local witness search finds another path that is as cheap; if the search gives up first the shortcut
+// is added anyway so the hierarchy stays exact. Every arc ends up stored at its lower ranked junction: the up arcs are
+// the ones leaving it and the down arcs are the ones entering it.
+class NAContractionHierarchy
+{
+private:
+	size_t                        junctionCount;
+	std::vector<NAHierarchyArc>   arcs;
+	std::vector<unsigned int>     upOffset;
+	std::vector<unsigned int>     upArcs;
+	std::vector<unsigned int>     downOffset;
+	std::vector<unsigned int>     downArcs;
+	size_t                        shortcutCount;
+
+	friend class NAHierarchyQuery;
+
+public:
+	// a witness search settles at most this many junctions before it gives up
+	static const unsigned int WitnessSettleLimit = 500;
+
+	NAContractionHierarchy(void) : junctionCount(0), shortcutCount(0) { }
+	virtual ~NAContractionHierarchy(void) { }
+
+	NAContractionHierarchy(const NAContractionHierarchy & that) = delete;
+	NAContractionHierarchy & operator=(const NAContractionHierarchy &) = delete;
+
+	void Build(const NAGraphSnapshot & graph);
+
+	// the disk cache is only accepted if the key (network identity and cost attribute) and the snapshot fingerprint both match
+	bool Load(const std::wstring & path, const std::wstring & key, unsigned long long fingerprint);
+	bool Save(const std::wstring & path, const std::wstring & key, unsigned long long fingerprint) const;
+
+	bool   IsEmpty()          const { return junctionCount == 0; }
+	size_t JunctionCount()    const { return junctionCount; }
+	size_t GetShortcutCount() const { return shortcutCount; }
+	size_t MemoryUsage()      const { return sizeof(NAHierarchyArc) * arcs.capacity() + sizeof(unsigned int) * (upOffset.capacity() + upArcs.capacity() + downOffset.capacity() + downArcs.capacity()); }
+};
+
+typedef std::shared_ptr<NAContractionHierarchy> NAContractionHierarchyPtr;
+
+// The search space of one side of the queries. 'SetTargets' runs the downward (backward) search from all targets at
+// once and keeps its labels. Each 'Nearest' call is then an upward search from the sources that stops as soon as its
+// smallest label can no longer beat the best meeting junction. The labels are reset through a list of touched
+// junctions so a query never pays for the size of the network.
+class NAHierarchyQuery
+{
+private:
+	typedef std::pair<double, long> Label;
+
+	const NAContractionHierarchy & hierarchy;
+	std::vector<double>            targetCost;
+	std::vector<unsigned int>      targetArc;
+	std::vector<size_t>            targetTag;
+	std::vector<long>              targetTouched;
+	std::vector<double>            sourceCost;
+	std::vector<unsigned int>      sourceArc;
+	std::vector<size_t>            sourceTag;
+	std::vector<long>              sourceTouched;
+	std::vector<Label>             heap;
+	std::vector<unsigned int>      unpack;
+	bool                           hasTargets;
+
+	void Unpack(unsigned int arc, std::vector<NAGraphEdgeIndex> & edges);
+
+public:
+	NAHierarchyQuery(const NAContractionHierarchy & _hierarchy);
+	virtual ~NAHierarchyQuery(void) { }
+
+	NAHierarchyQuery(const NAHierarchyQuery & that) = delete;
+	NAHierarchyQuery & operator=(const NAHierarchyQuery &) = delete;
+
+	// targets with an infinite offset are left out
+	void SetTargets(const std::vector<NAHierarchySeed> & targets);
+	bool HasTargets() const { return hasTargets; }
+
+	// the closest target from any of the sources. the route edges are the snapshot edges from the source junction to the target junction.
+	bool Nearest(const std::vector<NAHierarchySeed> & sources, NAHierarchyRoute & route);
+};
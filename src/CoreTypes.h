@@ -0,0 +1,47 @@
+// ===============================================================================================
+// Evacuation Solver: Core types
+// Description: The few definitions that the graph snapshot and the searches on it share with
+// the rest of the solver. This header does not depend on ATL or ArcObjects so those pieces can
+// also be compiled and tested on their own.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef CASPER_INFINITY
+#define CASPER_INFINITY 3.402823466e+38
+#endif
+
+// StdAfx.h points this to the debug heap. outside of the solver project a plain new is all there is.
+#ifndef DEBUG_NEW_PLACEMENT
+#define DEBUG_NEW_PLACEMENT
+#endif
+
+enum class EdgeDirection       : unsigned char { None = 0x0, Along = 0x1, Against = 0x2, Both = 0x3 };
+enum class NAEdgeMapGeneration : unsigned char { None = 0x0, OldGen = 0x1, NewGen = 0x2, AllGens = 0x3 };
+enum class EdgeDirtyState      : unsigned char { CleanState = 0x0, CostIncreased = 0x1, CostDecreased = 0x2 };
+
+template <class T> inline bool CheckFlag(T var, T flag)
+{
+	typedef typename std::underlying_type<T>::type U;
+	return (static_cast<U>(var) & static_cast<U>(flag)) != 0;
+}
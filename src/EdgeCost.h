@@ -0,0 +1,135 @@
+// ===============================================================================================
+// Evacuation Solver: Capacity aware edge cost
+// Description: The cost of an edge under its reservations and the dirty test against its clean
+// cost, once for a single edge and once for a whole batch of edges in flat arrays (AVX2 when the
+// build targets it). Both only see the traffic model and the solver method as template types.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "TrafficPolicies.h"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// The 'Model' type gives InitDelayCostPerPop, CriticalDensPerCap, GetSaturationDensPerCap(), GetSpeedTable() and
+// GetCongestionPercentage<TrafficPolicy>(capacity, flow). The 'Method' type is an enum with CASPERSolver and CCRPSolver.
+// In the solver these are TrafficModel and EvcSolverMethod which are not visible here.
+
+// This is where the actual capacity aware part is happening:
+// We take the original values of the edge and recalculate the
+// new travel cost based on number of reserved spots by previous evacuees.
+template <class TrafficPolicy, class Model, class Method> inline double TrafficSpeedRatio(const Model * model, double capacity, double allPop, Method method)
+{
+	double speedPercent = 1.0;
+	if      (method == Method::CASPERSolver) speedPercent = model->template GetCongestionPercentage<TrafficPolicy>(capacity, allPop);
+	else if (method == Method::CCRPSolver  ) speedPercent = allPop > model->CriticalDensPerCap * capacity ? 0.0 : 1.0;
+	speedPercent = std::min(1.0, std::max(0.0001, speedPercent));
+	return speedPercent;
+}
+
+template <class TrafficPolicy, class Model, class Method> inline double CapacityAwareCost(const Model * model, double originalCost, double capacity, double reservedPop,
+	double newPop, Method method, double * globalDeltaCost = nullptr)
+{
+	if (capacity <= 0.0 || originalCost >= CASPER_INFINITY) return CASPER_INFINITY;
+	double speedPercent = 1.0;
+	if (model->InitDelayCostPerPop > 0.0) newPop = std::min(newPop, originalCost / model->InitDelayCostPerPop);
+	newPop += reservedPop;
+
+	speedPercent = TrafficSpeedRatio<TrafficPolicy>(model, capacity, newPop, method);
+
+	// this extra output tells CASPER how much will this edge reservation affects the cost according to the traffic model
+	if (globalDeltaCost) *globalDeltaCost = originalCost * (TrafficSpeedRatio<TrafficPolicy>(model, capacity, reservedPop, method) - speedPercent);
+	return originalCost / speedPercent;
+}
+
+// the relative cost change of an edge. an edge that was never cleaned is always considered increased.
+inline EdgeDirtyState CostChange(double cost, double cleanCost)
+{
+	if (cleanCost <= 0.0) return EdgeDirtyState::CostIncreased;
+	double costchange = (cost / cleanCost) - 1.0;
+	if (costchange >  FLT_EPSILON) return EdgeDirtyState::CostIncreased;
+	if (costchange < -FLT_EPSILON) return EdgeDirtyState::CostDecreased;
+	return EdgeDirtyState::CleanState;
+}
+
+// structure of arrays mirror of the edge fields that 'CapacityAwareCost' reads
+struct EdgeCostBatch
+{
+	static const size_t Size = 1024;
+
+	size_t Count;
+	double OriginalCost[Size];
+	double Capacity    [Size];
+	double ReservedPop [Size];
+	double CleanCost   [Size];
+	double Flow        [Size];
+	double Speed       [Size];
+	double Cost        [Size];
+};
+
+// same math as 'CapacityAwareCost' but one step at a time for the whole batch
+template <class TrafficPolicy, class Model, class Method> void CostKernel(EdgeCostBatch & b, const Model * model, Method method, double newPop)
+{
+	size_t i = 0;
+	const double initDelay = model->InitDelayCostPerPop, critical = model->CriticalDensPerCap, saturation = model->GetSaturationDensPerCap();
+	const SpeedDensityTable & table = model->GetSpeedTable();
+
+	for (i = 0; i < b.Count; ++i)
+	{
+		double pop = initDelay > 0.0 ? std::min(newPop, b.OriginalCost[i] / initDelay) : newPop;
+		b.Flow[i] = pop + b.ReservedPop[i];
+	}
+
+	if (method == Method::CASPERSolver)
+	{
+		// the cached models already pay for a lookup per edge so they go through the model
+		if (TrafficPolicy::Cached) for (i = 0; i < b.Count; ++i) b.Speed[i] = model->template GetCongestionPercentage<TrafficPolicy>(b.Capacity[i], b.Flow[i]);
+		else for (i = 0; i < b.Count; ++i) b.Speed[i] = b.Flow[i] > critical * b.Capacity[i] ? TrafficPolicy::SpeedPercent(critical, saturation, b.Capacity[i], b.Flow[i], table) : 1.0;
+	}
+	else if (method == Method::CCRPSolver) for (i = 0; i < b.Count; ++i) b.Speed[i] = b.Flow[i] > critical * b.Capacity[i] ? 0.0 : 1.0;
+	else for (i = 0; i < b.Count; ++i) b.Speed[i] = 1.0;
+
+	i = 0;
+	#ifdef __AVX2__
+	const __m256d one = _mm256_set1_pd(1.0), minSpeed = _mm256_set1_pd(0.0001), zero = _mm256_setzero_pd(), inf = _mm256_set1_pd(CASPER_INFINITY);
+	for (; i + 4 <= b.Count; i += 4)
+	{
+		__m256d speed = _mm256_min_pd(one, _mm256_max_pd(minSpeed, _mm256_loadu_pd(b.Speed + i)));
+		__m256d orig  = _mm256_loadu_pd(b.OriginalCost + i);
+		__m256d block = _mm256_or_pd(_mm256_cmp_pd(_mm256_loadu_pd(b.Capacity + i), zero, _CMP_LE_OQ), _mm256_cmp_pd(orig, inf, _CMP_GE_OQ));
+		_mm256_storeu_pd(b.Cost + i, _mm256_blendv_pd(_mm256_div_pd(orig, speed), inf, block));
+	}
+	#endif
+	for (; i < b.Count; ++i)
+	{
+		if (b.Capacity[i] <= 0.0 || b.OriginalCost[i] >= CASPER_INFINITY) b.Cost[i] = CASPER_INFINITY;
+		else b.Cost[i] = b.OriginalCost[i] / std::min(1.0, std::max(0.0001, b.Speed[i]));
+	}
+}
+
+// same test as 'CostChange' for every edge of a batch that went through 'CostKernel'
+inline void CostChangeBatch(const EdgeCostBatch & b, EdgeDirtyState * states)
+{
+	size_t i = 0;
+	#ifdef __AVX2__
+	const __m256d one = _mm256_set1_pd(1.0), zero = _mm256_setzero_pd(), eps = _mm256_set1_pd(FLT_EPSILON), negEps = _mm256_set1_pd(-FLT_EPSILON);
+	for (; i + 4 <= b.Count; i += 4)
+	{
+		__m256d clean  = _mm256_loadu_pd(b.CleanCost + i);
+		__m256d change = _mm256_sub_pd(_mm256_div_pd(_mm256_loadu_pd(b.Cost + i), clean), one);
+		int neverClean = _mm256_movemask_pd(_mm256_cmp_pd(clean, zero, _CMP_LE_OQ));
+		int increased  = _mm256_movemask_pd(_mm256_cmp_pd(change, eps, _CMP_GT_OQ)) | neverClean;
+		int decreased  = _mm256_movemask_pd(_mm256_cmp_pd(change, negEps, _CMP_LT_OQ)) & ~neverClean;
+		for (int k = 0; k < 4; ++k)
+			states[i + k] = (increased >> k) & 1 ? EdgeDirtyState::CostIncreased : ((decreased >> k) & 1 ? EdgeDirtyState::CostDecreased : EdgeDirtyState::CleanState);
+	}
+	#endif
+	for (; i < b.Count; ++i) states[i] = CostChange(b.Cost[i], b.CleanCost[i]);
+}
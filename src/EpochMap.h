@@ -0,0 +1,156 @@
+// ===============================================================================================
+// Evacuation Solver: Epoch-stamped dense maps
+// Description: Membership sets over a dense slot index that are cleared by taking a new stamp
+// instead of walking the table. The edge closed lists of the searches are built on these.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "CoreTypes.h"
+
+// A slot belongs to the map when it holds the map's current stamp, so clearing the map is a counter change. Every
+// stamped item is also appended once to a log so that the map can still enumerate its members. 'SlotOf' gives the
+// dense slot of an item and two different items must never share a slot.
+template <class T, class SlotOf> class EpochMap
+{
+private:
+	std::vector<unsigned int> stamp;
+	std::vector<unsigned int> logStamp;
+	std::vector<T>            log;
+	unsigned int              epoch;
+	unsigned int              logEpoch;
+	unsigned int              current;
+	size_t                    count;
+
+	// running out of stamps takes four billion clears; if it ever happens all slots are reset which is what a clear does anyway
+	void NewEpoch()
+	{
+		if (epoch >= UINT_MAX - 1)
+		{
+			std::fill(stamp.begin(), stamp.end(), 0);
+			epoch = 0;
+		}
+		current = ++epoch;
+	}
+
+protected:
+	inline bool IsMember(size_t slot) const { return slot < stamp.size() && stamp[slot] == current; }
+
+public:
+	EpochMap(void) : epoch(0), logEpoch(1), current(0), count(0) { NewEpoch(); }
+	virtual ~EpochMap(void) { }
+
+	EpochMap(const EpochMap & that) = delete;
+	EpochMap & operator=(const EpochMap &) = delete;
+
+	inline size_t Size()              const { return count; }
+	inline bool   Contains(size_t slot) const { return IsMember(slot); }
+
+	// false if the item is already a member
+	bool Add(T item)
+	{
+		size_t slot = SlotOf()(item);
+		if (IsMember(slot)) return false;
+		if (slot >= stamp.size())
+		{
+			size_t newSize = std::max(slot + 1, stamp.size() + stamp.size() / 2);
+			stamp.resize(newSize, 0);
+			logStamp.resize(newSize, 0);
+		}
+		stamp[slot] = current;
+		if (logStamp[slot] != logEpoch)
+		{
+			logStamp[slot] = logEpoch;
+			log.push_back(item);
+		}
+		++count;
+		return true;
+	}
+
+	// false if the slot was not a member
+	bool Remove(size_t slot)
+	{
+		if (!IsMember(slot)) return false;
+		stamp[slot] = 0;
+		--count;
+		return true;
+	}
+
+	void Reset()
+	{
+		NewEpoch();
+		log.clear();
+		++logEpoch;
+		count = 0;
+	}
+
+	// only walks the items that were added since the last reset
+	template <class Visitor> void ForEachMember(Visitor visit) const
+	{
+		for (const auto & item : log) if (IsMember(SlotOf()(item))) visit(item);
+	}
+
+	void Add(const EpochMap & that)
+	{
+		that.ForEachMember([this](const T & item) { Add(item); });
+	}
+};
+
+// Two generations of a closed list. Each generation keeps its own stamps so an item can be a member of both of them
+// at the same time and clearing one generation never touches the other one. 'Map' is an EpochMap or derives from one.
+template <class Map> class EpochMapTwoGen
+{
+public:
+	Map * oldGen;
+	Map * newGen;
+
+	EpochMapTwoGen(void) : oldGen(new Map()), newGen(new Map()) { }
+	virtual ~EpochMapTwoGen(void)
+	{
+		delete oldGen;
+		delete newGen;
+	}
+
+	EpochMapTwoGen(const EpochMapTwoGen & that) = delete;
+	EpochMapTwoGen & operator=(const EpochMapTwoGen &) = delete;
+
+	// the new generation is walked through its own log so the cost is the size of the new generation and not of the table
+	void MarkAllAsOldGen()
+	{
+		oldGen->Add(*newGen);
+		newGen->Reset();
+	}
+
+	// stops at the first generation that already has the item and returns false, just like inserting into a set would
+	template <class T> bool Add(T item, NAEdgeMapGeneration gen)
+	{
+		if (CheckFlag(gen, NAEdgeMapGeneration::OldGen) && !oldGen->Add(item)) return false;
+		if (CheckFlag(gen, NAEdgeMapGeneration::NewGen) && !newGen->Add(item)) return false;
+		return true;
+	}
+
+	bool Contains(size_t slot, NAEdgeMapGeneration gen) const
+	{
+		return (CheckFlag(gen, NAEdgeMapGeneration::OldGen) && oldGen->Contains(slot)) || (CheckFlag(gen, NAEdgeMapGeneration::NewGen) && newGen->Contains(slot));
+	}
+
+	void Remove(size_t slot, NAEdgeMapGeneration gen)
+	{
+		if (CheckFlag(gen, NAEdgeMapGeneration::OldGen)) oldGen->Remove(slot);
+		if (CheckFlag(gen, NAEdgeMapGeneration::NewGen)) newGen->Remove(slot);
+	}
+
+	size_t Size(NAEdgeMapGeneration gen) const
+	{
+		size_t t = 0;
+		if (CheckFlag(gen, NAEdgeMapGeneration::OldGen)) t += oldGen->Size();
+		if (CheckFlag(gen, NAEdgeMapGeneration::NewGen)) t += newGen->Size();
+		return t;
+	}
+};
@@ -16,6 +16,9 @@
 #include "NAEdge.h"
 #include "Dynamic.h"
 
+std::atomic<unsigned long long> ReservationClock::now(0);
+
+
 HRESULT PathSegment::GetGeometry(INetworkDatasetPtr ipNetworkDataset, IFeatureClassContainerPtr ipFeatureClassContainer, bool & sourceNotFoundFlag, IGeometryPtr & geometry)
 {
 	HRESULT hr = S_OK;
@@ -40,6 +43,7 @@ EvcPath::EvcPath(double initDelayCostPerPop, double routedPop, int order, Evacue
 	OrginalCost = RoutedPop * initDelayCostPerPop + PathStartCost;
 	Order = order;
 	myEvc = evc;
+	costCommitted = false;
 }
 
 EvcPath::EvcPath(const EvcPath & that) : baselist(), MySafeZone(that.MySafeZone), RoutedPop(that.RoutedPop), Status(that.Status)
@@ -50,9 +54,21 @@ EvcPath::EvcPath(const EvcPath & that) : baselist(), MySafeZone(that.MySafeZone)
 	OrginalCost = that.OrginalCost;
 	Order = that.Order;
 	myEvc = that.myEvc;
+	costCommitted = that.costCommitted;
+}
+
+double PathSegment::GetCurrentCost(EvcSolverMethod method) const
+{
+	unsigned long long stamp = Edge->GetChangeStamp();
+	if (stamp != cachedStamp || method != cachedMethod)
+	{
+		cachedCost = Edge->GetCurrentCost(method) * abs(GetEdgePortion());
+		cachedStamp = stamp;
+		cachedMethod = method;
+	}
+	return cachedCost;
 }
 
-double PathSegment::GetCurrentCost(EvcSolverMethod method) const { return Edge->GetCurrentCost(method) * abs(GetEdgePortion()); }
 bool EvcPath::MoreThanPathOrder1(const Evacuee * e1, const Evacuee * e2) { return e1->Paths->front()->Order > e2->Paths->front()->Order; }
 bool EvcPath::LessThanPathOrder1(const Evacuee * e1, const Evacuee * e2) { return e1->Paths->front()->Order < e2->Paths->front()->Order; }
 
@@ -111,7 +127,7 @@ size_t EvcPath::DynamicStep_MoveOnPath(const std::unordered_set<EvcPath *, EvcPa
 					for (size_t i = path->size() - 1; i > segment; --i)
 					{
 						RemoveReservations.push_back(std::pair<NAEdgePtr, EvcPathPtr>(path->at(i)->Edge, path));
-						delete path->at(i);
+						path->DeleteSegment(path->at(i));
 					}
 
 					// we also remove this reservation because the next path will start here and we don't want the evacuee to overlap itself
@@ -141,7 +157,7 @@ size_t EvcPath::DynamicStep_MoveOnPath(const std::unordered_set<EvcPath *, EvcPa
 					}
 
 					// we also remove this reservation because the next path will start here and we don't want the evacuee to overlap itself
-					PathSegmentPtr dupSegment = new DEBUG_NEW_PLACEMENT PathSegment(path->at(segment)->Edge, edgeRatio);
+					PathSegmentPtr dupSegment = newPath->NewSegment(path->at(segment)->Edge, edgeRatio);
 					path->at(segment)->Edge->SwapReservation(path, newPath);
 					newPath->push_front(dupSegment);
 					newPath->myEvc->Paths->push_front(newPath);
@@ -220,7 +236,7 @@ void EvcPath::DynamicStep_MergePaths(std::shared_ptr<EvacueeList> AllEvacuees)
 
 				mainPath->front()->SetFromRatio(fp->back()->GetFromRatio());
 				for (auto seg = fp->rbegin() + 1; seg != fp->rend(); ++seg) mainPath->push_front(*seg);
-				delete fp->back();
+				fp->DeleteSegment(fp->back());
 				fp->clear();
 				delete fp;
 			}
@@ -293,45 +309,69 @@ double EvcPath::GetAvgCostRatio(double MaxEvacuationCost) const
 }
 
 void EvcPath::DoesItNeedASecondChance(double ThreasholdForCost, double ThreasholdForPathOverlap, std::vector<EvacueePtr> & AffectingList, double ThisIterationMaxCost, EvcSolverMethod method)
+{
+	if (!NeedsSecondChance(ThreasholdForCost, ThisIterationMaxCost)) return;
+	PathOverlapCounter counter;
+	std::vector<EvcPathPtr> overlaps;
+	CollectOverlaps(counter, ThreasholdForPathOverlap, overlaps, method);
+	ApplySecondChance(overlaps, AffectingList);
+}
+
+bool EvcPath::NeedsSecondChance(double ThreasholdForCost, double ThisIterationMaxCost) const
 {
 	double PredictionCostRatio = (ReserveEvacuationCost - myEvc-> PredictedCost) / ThisIterationMaxCost;
 	double EvacuationCostRatio = (FinalEvacuationCost   - ReserveEvacuationCost) / ThisIterationMaxCost;
+	return this->Status == PathStatus::ActiveComplete && (PredictionCostRatio >= ThreasholdForCost || EvacuationCostRatio >= ThreasholdForCost);
+}
 
-	if (this->Status == PathStatus::ActiveComplete && (PredictionCostRatio >= ThreasholdForCost || EvacuationCostRatio >= ThreasholdForCost))
-	{
-		if (myEvc->Status == EvacueeStatus::Processed)
-		{
-			// since the prediction was bad it probably means the evacuee has more than average vehicles so it should be processed sooner
-			AffectingList.push_back(myEvc);
-			myEvc->Status = EvacueeStatus::Unprocessed;
-		}
+// We have to add the affecting list to be re-routed as well. We do this by selecting the paths that have some overlap.
+void EvcPath::CollectOverlaps(PathOverlapCounter & counter, double ThreasholdForPathOverlap, std::vector<EvcPathPtr> & overlaps, EvcSolverMethod method) const
+{
+	counter.Collect(*this, method);
+	counter.ExtractAbove(ThreasholdForPathOverlap, overlaps);
+}
 
-		// We have to add the affecting list to be re-routed as well
-		// We do this by selecting the paths that have some overlap
-		std::vector<EvcPathPtr> crossing;
-		Histogram<EvcPathPtr> FreqOfOverlaps;
-		crossing.reserve(50);
+void EvcPath::ApplySecondChance(const std::vector<EvcPathPtr> & overlaps, std::vector<EvacueePtr> & AffectingList)
+{
+	if (myEvc->Status == EvacueeStatus::Processed)
+	{
+		// since the prediction was bad it probably means the evacuee has more than average vehicles so it should be processed sooner
+		AffectingList.push_back(myEvc);
+		myEvc->Status = EvacueeStatus::Unprocessed;
+	}
 
-		for (const auto & seg : *this)
+	// the status is checked here and not while collecting since an earlier path of this iteration may have already picked the evacuee
+	for (const auto & path : overlaps)
+	{
+		if (path->Status == PathStatus::ActiveComplete && path->myEvc->Status == EvacueeStatus::Processed)
 		{
-			seg->Edge->GetUniqeCrossingPaths(crossing, true);
-			FreqOfOverlaps.WeightedAdd(crossing, seg->GetCurrentCost(method));
+			AffectingList.push_back(path->myEvc);
+			path->myEvc->Status = EvacueeStatus::Unprocessed;
 		}
+	}
+}
 
-		double cutOffWeight = ThreasholdForPathOverlap * FreqOfOverlaps.maxWeight;
-		for (const auto & pair : FreqOfOverlaps)
-		{
-			if (pair.first->Status == PathStatus::ActiveComplete && pair.first->myEvc->Status == EvacueeStatus::Processed && pair.second > cutOffWeight)
-			{
-				AffectingList.push_back(pair.first->myEvc);
-				pair.first->myEvc->Status = EvacueeStatus::Unprocessed;
-			}
-		}
+void PathOverlapCounter::Collect(const EvcPath & path, EvcSolverMethod method)
+{
+	for (auto seg = path.cbegin(); seg != path.cend(); ++seg)
+	{
+		double cost = (*seg)->GetCurrentCost(method);
+		(*seg)->Edge->ForEachCrossingPath([&](EvcPathPtr crossing) { Add(crossing, cost); });
 	}
 }
 
-void EvcPath::AddSegment(EvcSolverMethod method, PathSegmentPtr segment)
+EvcPath::~EvcPath(void)
 {
+	for (const auto & s : *this) DeleteSegment(s);
+	clear();
+}
+
+PathSegmentPtr EvcPath::NewSegment(NAEdge * edge, double fromRatio, double toRatio) { return myEvc->SegmentPool->New(edge, fromRatio, toRatio); }
+void EvcPath::DeleteSegment(PathSegmentPtr segment) { myEvc->SegmentPool->Delete(segment); }
+
+void EvcPath::AddSegment(EvcSolverMethod method, NAEdge * edge, double fromRatio, double toRatio)
+{
+	PathSegmentPtr segment = NewSegment(edge, fromRatio, toRatio);
 	this->push_front(segment);
 	segment->Edge->AddReservation(this, method);
 	double p = abs(segment->GetEdgePortion());
@@ -339,6 +379,17 @@ void EvcPath::AddSegment(EvcSolverMethod method, PathSegmentPtr segment)
 	OrginalCost += segment->Edge->OriginalCost * p;
 }
 
+// The reserve cost keeps growing while segments are added so the edges only learn about it once the path is complete.
+// From here on every reservation change of this path also updates the max reserved cost of the edge.
+void EvcPath::CommitReserveCost()
+{
+	_ASSERT_EXPR(!costCommitted, L"Path reserve cost is already committed");
+	if (costCommitted) return;
+	costCommitted = true;
+	for (const auto & s : *this) s->Edge->CommitReservedCost(ReserveEvacuationCost);
+}
+
+// segments only go back to the traffic model if their edge changed since the last time so this is mostly a plain sum
 void EvcPath::CalculateFinalEvacuationCost(double initDelayCostPerPop, EvcSolverMethod method)
 {
 	FinalEvacuationCost = RoutedPop * initDelayCostPerPop + this->PathStartCost;
@@ -455,6 +506,7 @@ Evacuee::Evacuee(VARIANT name, double pop, UINT32 objectID)
 	ProcessOrder = -1;
 	FinalCost = CASPER_INFINITY;
 	DiscoveryLeaf = nullptr;
+	SegmentPool = nullptr;
 }
 
 Evacuee::~Evacuee(void)
@@ -470,12 +522,15 @@ Evacuee::~Evacuee(void)
 void Evacuee::DynamicMove(NAEdgePtr edge, double toRatio, INetworkQueryPtr ipNetworkQuery, double startTime)
 {
 	INetworkElementPtr ipElement = nullptr;
+	INetworkEdgePtr netEdge = edge->GetNetEdge();
 	for (auto v : *VerticesAndRatio) delete v;
 	VerticesAndRatio->clear();
 
+	// an edge that only lives in the graph snapshot has no network element to move along
+	if (!netEdge) return;
 	if (FAILED(ipNetworkQuery->CreateNetworkElement(esriNETJunction, &ipElement))) return;
 	INetworkJunctionPtr toJunction(ipElement);
-	if (FAILED(edge->NetEdge->QueryJunctions(nullptr, toJunction))) return;
+	if (FAILED(netEdge->QueryJunctions(nullptr, toJunction))) return;
 
 	NAVertexPtr myVertex = new DEBUG_NEW_PLACEMENT NAVertex(toJunction, edge);
 	myVertex->GVal = 1.0 - toRatio;
@@ -673,6 +728,7 @@ SafeZone::SafeZone(INetworkJunctionPtr _junction, NAEdge * _behindEdge, double p
 	: junction(_junction), behindEdge(_behindEdge), positionAlong(posAlong), capacity(0.0), Name(name.dblVal)
 {
 	reservedPop = 0.0;
+	changeStamp = 0;
 	VertexAndRatio = new DEBUG_NEW_PLACEMENT NAVertex(junction, behindEdge);
 	VertexAndRatio->GVal = posAlong;
 	if (cap.vt == VT_R8) capacity = cap.dblVal;
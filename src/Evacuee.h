@@ -13,6 +13,7 @@
 
 #include "StdAfx.h"
 #include "utils.h"
+#include "OverlapCounter.h"
 
 class NAVertex;
 class NAVertexCache;
@@ -24,14 +25,36 @@ class EvacueeList;
 struct NAEdgePtrHasher;
 struct NAEdgePtrEqual;
 class SafeZone;
+class PathOverlapCounter;
 struct EdgeOriginalData;
 typedef NAVertex * NAVertexPtr;
 
+// A global counter that moves forward every time an edge or a safe zone reservation changes. Each of them remembers
+// the tick of its last change so a search can later tell if anything it looked at has changed since a given tick.
+// The counter is atomic so every tick stays unique once worker threads touch reservations too.
+class ReservationClock
+{
+private:
+	static std::atomic<unsigned long long> now;
+
+public:
+	static inline unsigned long long Tick() { return ++now; }
+	static inline unsigned long long Now()  { return now.load(); }
+};
+
+// path segments are created and thrown away in very large numbers during the solve so they come from the slab pool of
+// the evacuee list they belong to and are only created and deleted through their path.
+// the current cost of a segment is remembered along with the change stamp of its edge: as long as the edge reservations
+// did not change the traffic model does not have to be asked again.
 class PathSegment
 {
 private:
 	double fromRatio;
 	double toRatio;
+	mutable double             cachedCost;
+	mutable unsigned long long cachedStamp;
+	mutable EvcSolverMethod    cachedMethod;
+	static const unsigned long long NoStamp = ~0ull;
 
 public:
     NAEdge     * Edge;
@@ -45,12 +68,14 @@ public:
     {
 	    fromRatio = FromRatio;
 	    if (fromRatio == toRatio) fromRatio = toRatio - 0.001;
+		cachedStamp = NoStamp;
 	}
 
 	void SetToRatio(double ToRatio)
 	{
 		toRatio = ToRatio;
 		if (fromRatio == toRatio) toRatio = fromRatio + 0.001;
+		cachedStamp = NoStamp;
 	}
 
 	double GetFromRatio() const { return fromRatio; }
@@ -63,6 +88,9 @@ public:
 		_ASSERT(FromRatio < ToRatio);
 	    Edge = edge;
 	    pline = nullptr;
+		cachedCost = 0.0;
+		cachedStamp = NoStamp;
+		cachedMethod = EvcSolverMethod::CASPERSolver;
     }
 };
 
@@ -81,6 +109,7 @@ private:
 	double     PathStartCost;
 	double     FinalEvacuationCost;
 	double     OrginalCost;
+	bool       costCommitted;
 	typedef    std::deque<PathSegmentPtr> baselist;
 
 public:
@@ -97,27 +126,32 @@ public:
 	inline double GetFinalEvacuationCost()   const { return FinalEvacuationCost; }
 	inline bool   IsActive()                 const { return Status == PathStatus::ActiveComplete; }
 	inline bool   IsComplete()               const { return Status == PathStatus::ActiveComplete || Status == PathStatus::FrozenComplete; }
+	inline bool   IsCostCommitted()          const { return costCommitted; }
 	void CalculateFinalEvacuationCost(double initDelayCostPerPop, EvcSolverMethod method);
 
 	EvcPath(double initDelayCostPerPop, double routedPop, int order, Evacuee * evc, SafeZone * mySafeZone);
 
-	virtual ~EvcPath(void)
-	{
-		for(const_iterator it = begin(); it != end(); it++) delete (*it);
-		clear();
-	}
+	virtual ~EvcPath(void);
 	EvcPath(const EvcPath & that);
 	EvcPath & operator=(const EvcPath &) = delete;
 
 	double GetMinCostRatio(double MaxEvacuationCost = 0.0) const;
 	double GetAvgCostRatio(double MaxEvacuationCost = 0.0) const;
-	void AddSegment(EvcSolverMethod method, PathSegmentPtr segment);
+	void AddSegment(EvcSolverMethod method, NAEdge * edge, double fromRatio = 0.0, double toRatio = 1.0);
+	PathSegmentPtr NewSegment(NAEdge * edge, double fromRatio = 0.0, double toRatio = 1.0);
+	void DeleteSegment(PathSegmentPtr segment);
+	void CommitReserveCost();
 	HRESULT AddPathToFeatureBuffers(ITrackCancel *, INetworkDatasetPtr, IFeatureClassContainerPtr, bool &,
 		IStepProgressorPtr, double &, IFeatureBufferPtr, IFeatureCursorPtr, long, long, long, long, long);
 	void ReattachToEvacuee(EvcSolverMethod method, std::unordered_set<NAEdge *, NAEdgePtrHasher, NAEdgePtrEqual> & touchedEdges);
 	inline void CleanYourEvacueePaths(EvcSolverMethod method, std::unordered_set<NAEdge *, NAEdgePtrHasher, NAEdgePtrEqual> & touchedEdges) { EvcPath::DetachPathsFromEvacuee(myEvc, method, touchedEdges); }
 	void DoesItNeedASecondChance(double ThreasholdForCost, double ThreasholdForPathOverlap, std::vector<Evacuee *> & AffectingList, double ThisIterationMaxCost, EvcSolverMethod method);
 
+	// the three steps of 'DoesItNeedASecondChance'. the first two only read so they can run for many paths in parallel.
+	bool NeedsSecondChance(double ThreasholdForCost, double ThisIterationMaxCost) const;
+	void CollectOverlaps(PathOverlapCounter & counter, double ThreasholdForPathOverlap, std::vector<EvcPath *> & overlaps, EvcSolverMethod method) const;
+	void ApplySecondChance(const std::vector<EvcPath *> & overlaps, std::vector<Evacuee *> & AffectingList);
+
 	inline const int & GetKey()  const { return Order; }
 	friend bool operator==(const EvcPath & lhs, const EvcPath & rhs) { return lhs.Order == rhs.Order; }
 	friend bool operator!=(const EvcPath & lhs, const EvcPath & rhs) { return lhs.Order != rhs.Order; }
@@ -129,6 +163,7 @@ public:
 	static size_t DynamicStep_UnreachableEvacuees(std::shared_ptr<EvacueeList> AllEvacuees, double StartCost);
 	
 	static bool MoreThanFinalCost (const EvcPath * p1, const EvcPath * p2) { return p1->FinalEvacuationCost > p2->FinalEvacuationCost; }
+	static bool LessThanFinalCost (const EvcPath * p1, const EvcPath * p2) { return p1->FinalEvacuationCost < p2->FinalEvacuationCost; }
 	static bool MoreThanPathOrder1(const Evacuee * e1, const Evacuee * e2);
 	static bool LessThanPathOrder1(const Evacuee * e1, const Evacuee * e2);
 	static bool MoreThanPathOrder2(const EvcPath * p1, const EvcPath * p2) { return p1->Order > p2->Order; }
@@ -152,6 +187,14 @@ public:
 
 typedef EvcPath * EvcPathPtr;
 
+// Sums how much of a path is shared with every other path
+class PathOverlapCounter : public OverlapCounter<EvcPathPtr, EvcPath::PtrHasher>
+{
+public:
+	// adds all paths that cross the segments of 'path' weighted by the current cost of each segment
+	void Collect(const EvcPath & path, EvcSolverMethod method);
+};
+
 class Evacuee
 {
 public:
@@ -166,6 +209,7 @@ public:
 	UINT32                   ObjectID;
 	EvacueeStatus            Status;
 	int                      ProcessOrder;
+	SlabPool<PathSegment>    * SegmentPool;
 
 	Evacuee(VARIANT name, double pop, UINT32 objectID);
 	virtual ~Evacuee(void);
@@ -200,6 +244,9 @@ private:
 	EvacueeGrouping groupingOption;
 	bool SeperationDisabledForDynamicCASPER;
 
+	// the path segments of all evacuees of this solve. the evacuees are deleted first so the slabs go with the list.
+	SlabPool<PathSegment> segmentPool;
+
 public:
 	using DoubleGrowingArrayList<EvacueePtr, size_t>::empty;
 	using DoubleGrowingArrayList<EvacueePtr, size_t>::size;
@@ -215,7 +262,11 @@ public:
 
 	bool IsSeperable() const { return CheckFlag(groupingOption, EvacueeGrouping::Separate); }
 	bool IsSeperationDisabledForDynamicCASPER() const { return SeperationDisabledForDynamicCASPER; }
-	void Insert(const EvacueePtr & item) { push_back(item); }
+	void Insert(const EvacueePtr & item) { item->SegmentPool = &segmentPool; push_back(item); }
+
+	size_t SegmentAllocationCount() const { return segmentPool.AllocationCount(); }
+	size_t SegmentPeakLiveCount()   const { return segmentPool.PeakLiveCount();   }
+	size_t SegmentSlabBytes()       const { return segmentPool.SlabBytes();       }
 };
 
 class NAEvacueeVertexTable : protected std::unordered_map<long, std::vector<EvacueePtr>>
@@ -236,12 +287,14 @@ private:
 	double   positionAlong;
 	double   capacity;
 	double   reservedPop;
+	unsigned long long changeStamp;
 
 public:
 	NAVertex * VertexAndRatio;
 	double     Name;
 
-	inline void   Reserve(double pop)      { reservedPop += pop;   }
+	inline void   Reserve(double pop)      { reservedPop += pop; changeStamp = ReservationClock::Tick(); }
+	inline unsigned long long GetChangeStamp() const { return changeStamp; }
 	inline double getPositionAlong() const { return positionAlong; }
 	inline NAEdge * getBehindEdge()        { return behindEdge;    }
 
@@ -241,6 +241,84 @@ STDMETHODIMP EvcSolver::put_TwoWayShareCapacity(VARIANT_BOOL value)
 	return S_OK;
 }
 
+STDMETHODIMP EvcSolver::put_LifelongCARMA(VARIANT_BOOL value)
+{
+	lifelongCARMA = value;
+	m_bPersistDirty = true;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::get_LifelongCARMA(VARIANT_BOOL * value)
+{
+	*value = lifelongCARMA;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::put_ALTLandmarks(VARIANT_BOOL value)
+{
+	altLandmarks = value;
+	m_bPersistDirty = true;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::get_ALTLandmarks(VARIANT_BOOL * value)
+{
+	*value = altLandmarks;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::put_HierarchySP(VARIANT_BOOL value)
+{
+	hierarchySP = value;
+	m_bPersistDirty = true;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::get_HierarchySP(VARIANT_BOOL * value)
+{
+	*value = hierarchySP;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::put_CellOverlay(VARIANT_BOOL value)
+{
+	cellOverlay = value;
+	m_bPersistDirty = true;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::get_CellOverlay(VARIANT_BOOL * value)
+{
+	*value = cellOverlay;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::put_BidirectionalSearch(VARIANT_BOOL value)
+{
+	bidirectionalSearch = value;
+	m_bPersistDirty = true;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::get_BidirectionalSearch(VARIANT_BOOL * value)
+{
+	*value = bidirectionalSearch;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::put_IncrementalChunkSearch(VARIANT_BOOL value)
+{
+	incrementalChunkSearch = value;
+	m_bPersistDirty = true;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::get_IncrementalChunkSearch(VARIANT_BOOL * value)
+{
+	*value = incrementalChunkSearch;
+	return S_OK;
+}
+
 STDMETHODIMP EvcSolver::get_ExportEdgeStat(VARIANT_BOOL * value)
 {
 	*value = VarExportEdgeStat;
@@ -306,6 +384,24 @@ STDMETHODIMP EvcSolver::put_TrafficModel(EvcTrafficModel value)
 	return S_OK;
 }
 
+STDMETHODIMP EvcSolver::get_SpeedDensityCurves(BSTR * value)
+{
+	if (value)
+	{
+		const std::wstring & text = speedDensityTable.GetText();
+		*value = new DEBUG_NEW_PLACEMENT WCHAR[text.size() + 1];
+		wcscpy_s(*value, text.size() + 1, text.c_str());
+	}
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::put_SpeedDensityCurves(BSTR value)
+{
+	if (!speedDensityTable.Parse(value ? value : L"")) return E_INVALIDARG;
+	m_bPersistDirty = true;
+	return S_OK;
+}
+
 STDMETHODIMP EvcSolver::get_FlockingProfile(FLOCK_PROFILE * value)
 {
 	*value = flockingProfile;
@@ -355,6 +451,42 @@ STDMETHODIMP EvcSolver::put_IterativeRatio(BSTR value)
 	return S_OK;
 }
 
+STDMETHODIMP EvcSolver::get_CARMAThreadCount(BSTR * value)
+{
+	if (value)
+	{
+		*value = new DEBUG_NEW_PLACEMENT WCHAR[100];
+		swprintf_s(*value, 100, L"%d", carmaThreadCount);
+	}
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::put_CARMAThreadCount(BSTR value)
+{
+	swscanf_s(value, L"%d", &carmaThreadCount);
+	carmaThreadCount = min(max(carmaThreadCount, 0L), 256L);
+	m_bPersistDirty = true;
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::get_SpeculationWindow(BSTR * value)
+{
+	if (value)
+	{
+		*value = new DEBUG_NEW_PLACEMENT WCHAR[100];
+		swprintf_s(*value, 100, L"%d", speculationWindow);
+	}
+	return S_OK;
+}
+
+STDMETHODIMP EvcSolver::put_SpeculationWindow(BSTR value)
+{
+	swscanf_s(value, L"%d", &speculationWindow);
+	speculationWindow = min(max(speculationWindow, 1L), 4096L);
+	m_bPersistDirty = true;
+	return S_OK;
+}
+
 STDMETHODIMP EvcSolver::get_SelfishRatio(BSTR * value)
 {
 	if (value)
@@ -13,25 +13,51 @@
 #include "NameConstants.h"
 #include "EvcSolver.h"
 #include "FibonacciHeap.h"
+#include "IndexedHeap.h"
+#include "SpeculationWindow.h"
+#include "CARMARepair.h"
+#include "SecondChance.h"
 
+// picks the search loops that are compiled for the traffic model of this solve
+template <template <class> class EdgeHeap>
 HRESULT EvcSolver::SolveMethod(INetworkQueryPtr ipNetworkQuery, IGPMessages* pMessages, ITrackCancel* pTrackCancel, IStepProgressorPtr ipStepProgressor, std::shared_ptr<EvacueeList> AllEvacuees,
 	std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, std::shared_ptr<SafeZoneTable> safeZoneList, double & carmaSec, std::vector<unsigned int> & CARMAExtractCounts,
-	INetworkDatasetPtr ipNetworkDataset, unsigned int & EvacueesWithRestrictedSafezone, std::vector<double> & GlobalEvcCostAtIteration,
+	std::vector<unsigned int> & CARMARepairCounts, INetworkDatasetPtr ipNetworkDataset, unsigned int & EvacueesWithRestrictedSafezone, std::vector<double> & GlobalEvcCostAtIteration,
+	std::vector<size_t> & EffectiveIterationCount, std::shared_ptr<DynamicDisaster> dynamicDisasters)
+{
+	#define SOLVEMETHOD_WITH_MODEL(TrafficPolicy) SolveMethodWithModel<EdgeHeap, TrafficPolicy>(ipNetworkQuery, pMessages, pTrackCancel, ipStepProgressor, AllEvacuees, vcache, ecache, \
+		safeZoneList, carmaSec, CARMAExtractCounts, CARMARepairCounts, ipNetworkDataset, EvacueesWithRestrictedSafezone, GlobalEvcCostAtIteration, EffectiveIterationCount, dynamicDisasters)
+
+	switch (this->trafficModel)
+	{
+	case EvcTrafficModel::STEPModel:   return SOLVEMETHOD_WITH_MODEL(STEPModelPolicy);
+	case EvcTrafficModel::LINEARModel: return SOLVEMETHOD_WITH_MODEL(LINEARModelPolicy);
+	case EvcTrafficModel::POWERModel:  return SOLVEMETHOD_WITH_MODEL(POWERModelPolicy);
+	case EvcTrafficModel::EXPModel:    return SOLVEMETHOD_WITH_MODEL(EXPModelPolicy);
+	case EvcTrafficModel::TABLEModel:  return SOLVEMETHOD_WITH_MODEL(TABLEModelPolicy);
+	default:                           return SOLVEMETHOD_WITH_MODEL(FLATModelPolicy);
+	}
+	#undef SOLVEMETHOD_WITH_MODEL
+}
+
+template <template <class> class EdgeHeap, class TrafficPolicy>
+HRESULT EvcSolver::SolveMethodWithModel(INetworkQueryPtr ipNetworkQuery, IGPMessages* pMessages, ITrackCancel* pTrackCancel, IStepProgressorPtr ipStepProgressor, std::shared_ptr<EvacueeList> AllEvacuees,
+	std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, std::shared_ptr<SafeZoneTable> safeZoneList, double & carmaSec, std::vector<unsigned int> & CARMAExtractCounts,
+	std::vector<unsigned int> & CARMARepairCounts, INetworkDatasetPtr ipNetworkDataset, unsigned int & EvacueesWithRestrictedSafezone, std::vector<double> & GlobalEvcCostAtIteration,
 	std::vector<size_t> & EffectiveIterationCount, std::shared_ptr<DynamicDisaster> dynamicDisasters)
 {
 	// creating the heap for the Dijkstra search
-	MyFibonacciHeap<NAEdgePtr, NAEdgePtrHasher, NAEdgePtrEqual> heap(NAEdge::GetHeapKeyHur);
+	EdgeHeap<NAEdge::HeapKeyHur> heap;
 	NAEdgeMap closedList;
 	auto carmaClosedList = std::shared_ptr<NAEdgeMapTwoGen>(new DEBUG_NEW_PLACEMENT NAEdgeMapTwoGen());
-	NAVertexPtr neighbor = nullptr, finalVertex = nullptr, myVertex = nullptr;
+	NAVertexPtr neighbor = nullptr, finalVertex = nullptr;
 	SafeZonePtr BetterSafeZone = nullptr;
 	NAEdgePtr myEdge = nullptr;
 	HRESULT hr = S_OK;
 	VARIANT_BOOL keepGoing;
 	double populationLeft, population2Route, TimeToBeat = 0.0f, newCost, globalMinPop2Route = 0.0, minPop2Route = -1.0, globalDeltaCost = 0.0, MaxPathCostSoFar = 0.0, addedCostAsPenalty = 0.0, EvcStartTime = 0.0;
 	std::vector<NAVertexPtr>::const_iterator vit;
-	INetworkJunctionPtr ipCurrentJunction = nullptr;
-	INetworkElementPtr ipJunctionElement = nullptr;
+	long junctionEID = -1;
 	bool separationRequired, foundRestrictedSafezone;
 	auto sortedEvacuees = std::shared_ptr<std::vector<EvacueePtr>>(new DEBUG_NEW_PLACEMENT std::vector<EvacueePtr>());
 	unsigned int countEvacueesInOneBucket = 0, countCASPERLoops = 0, sumVisitedDirtyEdge = 0;
@@ -47,7 +73,79 @@ HRESULT EvcSolver::SolveMethod(INetworkQueryPtr ipNetworkQuery, IGPMessages* pMe
 	ATL::CString statusMsg, AlgName;
 	CARMASort RevisedCarmaSortCriteria = this->CarmaSortCriteria;
 	auto detachedPaths = std::shared_ptr<std::vector<EvcPathPtr>>(new DEBUG_NEW_PLACEMENT std::vector<EvcPathPtr>());
+	bool reuseSearch = false, stale = false;
+	unsigned long long searchStamp = 0;
+	double searchPop2Route = 0.0, searchMaxPathCost = 0.0;
+	std::vector<NAEdgePtr> searchMembers, searchChain;
+	NAEdgeMap checkedEdges, staleEdges;
+	SPTWorkerPool iterationPool(carmaThreadCount > 0 ? (unsigned int)carmaThreadCount : 0);
+	NACellOverlayPtr overlay = ecache->GetCellOverlay();
+	NABidirectionalSearchPtr bidirectional = ecache->GetBidirectionalSearch();
+	NAGraphSnapshotPtr graph = ecache->GetGraphSnapshot();
+	std::vector<NAHierarchySeed> snapshotSources, snapshotTargets;
+	std::vector<SafeZonePtr> snapshotZones;
+	NAHierarchyRoute snapshotRoute;
+	std::unordered_set<NAEdgePtr, NAEdgePtrHasher, NAEdgePtrEqual> touchedEdges;
+	bool snapshotFound = false;
+	size_t sortedIndex = 0, speculativeScanned = 0;
+
+	// the bidirectional search can route a window of evacuees at once and commit them one by one
+	SpeculationWindowPtr speculation = nullptr;
+	if (bidirectional && this->speculationWindow > 1) speculation = SpeculationWindowPtr(new DEBUG_NEW_PLACEMENT SpeculationWindow(graph, (size_t)this->speculationWindow));
+
+	// the population of the next chunk of an evacuee. splitting an evacuee is a distinctive feature by CASPER that CCRP does
+	// not have and can actually improve routes even with a STEP traffic model.
+	auto ChunkPopulation = [&](double left) -> double
+	{
+		if (this->solverMethod == EvcSolverMethod::CCRPSolver) return 1.0;
+		if (this->solverMethod == EvcSolverMethod::CASPERSolver && separationRequired) return left - globalMinPop2Route < globalMinPop2Route ? left : globalMinPop2Route;
+		return left;
+	};
+
+	// an evacuee in the middle of an edge starts at the end of that edge with the portion of its cost that is left
+	auto SnapshotSources = [&](EvacueePtr evc, double pop, std::vector<NAHierarchySeed> & sources)
+	{
+		sources.clear();
+		for (size_t i = 0; i < evc->VerticesAndRatio->size(); ++i)
+		{
+			NAVertexPtr v = evc->VerticesAndRatio->at(i);
+			double offset = v->GetBehindEdge() ? v->GetBehindEdge()->GetCost<TrafficPolicy>(pop, this->solverMethod) : 0.0;
+			if (offset < CASPER_INFINITY) sources.push_back(NAHierarchySeed(v->EID, v->GVal * offset, i));
+		}
+	};
+
+	// a safe zone in the middle of an edge can only be reached if that edge made it into the snapshot. the safe zone
+	// costs are the edges from the safe zones into the super-sink of the bidirectional search.
+	auto SnapshotTargets = [&](double pop, std::vector<NAHierarchySeed> & targets, std::vector<SafeZonePtr> & zones) -> bool
+	{
+		bool restricted = false;
+		targets.clear();
+		zones.clear();
+		for (const auto & z : *safeZoneList)
+		{
+			NAEdgePtr behind = z.second->getBehindEdge();
+			double offset = behind && graph->Find(behind->EID, (EdgeDirection)behind->Direction) == NAGraphSnapshot::NoEdge ? CASPER_INFINITY :
+				z.second->SafeZoneCost(pop, this->solverMethod, costPerDensity);
+			if (offset >= CASPER_INFINITY) { restricted = true; continue; }
+			targets.push_back(NAHierarchySeed(z.first, offset, zones.size()));
+			zones.push_back(z.second);
+		}
+		return restricted;
+	};
+
+	// the cost of a snapshot edge for the current chunk on the current reservations
+	auto SnapshotCost = [&](NAGraphEdgeIndex e) { return ecache->GetSnapshotCost<TrafficPolicy>(e, population2Route, this->solverMethod); };
+	auto SpeculativeCost = [&](double pop, NAGraphEdgeIndex e) { return ecache->GetSnapshotCost<TrafficPolicy>(e, pop, this->solverMethod); };
+
+	// The overlay keeps its own copy of the edge costs. The cost table of the edge cache knows which of its entries moved since
+	// the overlay last looked, be it for a new chunk size, a reserved path, a detach or a dynamic change, so only those are copied.
+	auto RefreshOverlayCosts = [&]()
+	{
+		const std::vector<double> & cost = ecache->GetSnapshotCosts(population2Route, this->solverMethod);
+		ecache->DrainSnapshotCostChanges([&](NAGraphEdgeIndex e) { overlay->SetCost(e, cost[e]); });
+	};
 	CARMAExtractCounts.clear();
+	CARMARepairCounts.clear();
 
 	switch (solverMethod)
 	{
@@ -79,8 +177,6 @@ HRESULT EvcSolver::SolveMethod(INetworkQueryPtr ipNetworkQuery, IGPMessages* pMe
 
 	sortedEvacuees->reserve(AllEvacuees->size());
 	EvacueesWithRestrictedSafezone = 0;
-	if (FAILED(hr = ipNetworkQuery->CreateNetworkElement(esriNETJunction, &ipJunctionElement))) goto END_OF_FUNC;
-	ipCurrentJunction = ipJunctionElement;
 
 	if (FAILED(hr = DeterminMinimumPop2Route(AllEvacuees, ipNetworkDataset, globalMinPop2Route, separationRequired))) goto END_OF_FUNC;
 
@@ -103,8 +199,8 @@ HRESULT EvcSolver::SolveMethod(INetworkQueryPtr ipNetworkQuery, IGPMessages* pMe
 			{
 				// Indexing all the population by their surrounding vertices this will be used to sort them by network distance to safe zone. Also time the carma loops.
 				dummy = GetProcessTimes(proc, &createTime, &exitTime, &sysTimeS, &cpuTimeS);
-				if (FAILED(hr = CARMALoop(ipNetworkQuery, ipStepProgressor, pMessages, pTrackCancel, AllEvacuees, RevisedCarmaSortCriteria, sortedEvacuees, vcache, ecache, safeZoneList, CARMAClosedSize,
-					carmaClosedList, leafs, CARMAExtractCounts, globalMinPop2Route, minPop2Route, separationRequired))) goto END_OF_FUNC;
+				if (FAILED(hr = CARMALoop<EdgeHeap, TrafficPolicy>(ipNetworkQuery, ipStepProgressor, pMessages, pTrackCancel, AllEvacuees, RevisedCarmaSortCriteria, sortedEvacuees, vcache, ecache, safeZoneList, CARMAClosedSize,
+					carmaClosedList, leafs, CARMAExtractCounts, CARMARepairCounts, globalMinPop2Route, minPop2Route, separationRequired))) goto END_OF_FUNC;
 				dummy = GetProcessTimes(proc, &createTime, &exitTime, &sysTimeE, &cpuTimeE);
 				carmaSec += (*((__int64 *)&cpuTimeE)) - (*((__int64 *)&cpuTimeS)) + (*((__int64 *)&sysTimeE)) - (*((__int64 *)&sysTimeS));
 
@@ -112,9 +208,12 @@ HRESULT EvcSolver::SolveMethod(INetworkQueryPtr ipNetworkQuery, IGPMessages* pMe
 				countEvacueesInOneBucket = 0;
 				sumVisitedDirtyEdge      = 0;
 				sumVisitedEdge           = 0;
+				if (speculation) speculation->Clear();
 
-				for (const auto currentEvacuee : *sortedEvacuees)
+				for (sortedIndex = 0; sortedIndex < sortedEvacuees->size(); ++sortedIndex)
 				{
+					const auto currentEvacuee = sortedEvacuees->at(sortedIndex);
+
 					// Check to see if the user wishes to continue or cancel the solve (i.e., check whether or not the user has hit the ESC key to stop processing)
 					if (pTrackCancel)
 					{
@@ -131,6 +230,25 @@ HRESULT EvcSolver::SolveMethod(INetworkQueryPtr ipNetworkQuery, IGPMessages* pMe
 					// Step the progress bar before continuing to the next Evacuee point
 					if (ipStepProgressor) ipStepProgressor->Step();
 					currentEvacuee->ProcessOrder = ++EvacueeProcessOrder;
+
+					// Route the first chunk of this and the next unprocessed evacuees concurrently on the reservations of now.
+					// Each of them is committed in its turn and searched again only if an earlier commit got in its way.
+					if (speculation && !speculation->Holds(sortedIndex))
+					{
+						speculation->Clear();
+						for (size_t next = sortedIndex; next < sortedEvacuees->size(); ++next)
+						{
+							EvacueePtr evc = sortedEvacuees->at(next);
+							if (evc->Status != EvacueeStatus::Unprocessed) continue;
+							population2Route = ChunkPopulation(evc->Population);
+							SnapshotSources(evc, population2Route, snapshotSources);
+							SnapshotTargets(population2Route, snapshotTargets, snapshotZones);
+							if (!speculation->Add(next, population2Route, snapshotSources, snapshotTargets)) break;
+						}
+						speculation->Route(iterationPool, SpeculativeCost);
+						UpdatePeakMemoryUsage();
+					}
+
 					MaxPathCostSoFar = max(MaxPathCostSoFar, currentEvacuee->PredictedCost);
 					countEvacueesInOneBucket++;
 					countCASPERLoops++;
@@ -138,96 +256,195 @@ HRESULT EvcSolver::SolveMethod(INetworkQueryPtr ipNetworkQuery, IGPMessages* pMe
 
 					while (populationLeft > 0.0)
 					{
-						// It's now safe to collect-n-clean on the graph (ecache & vcache).
-						// clean used-up vertices from GC
-						vcache->CollectAndRelease();
-
-						// the next 'if' is a distinctive feature by CASPER that CCRP does not have
-						// and can actually improve routes even with a STEP traffic model
-						if (this->solverMethod == EvcSolverMethod::CCRPSolver) population2Route = 1.0;
-						else if (this->solverMethod == EvcSolverMethod::CASPERSolver && separationRequired)
+						population2Route = ChunkPopulation(populationLeft);
+
+						// The overlay or the bidirectional search replaces the edge by edge search. The overlay copies the costs that moved
+						// since the last chunk while the bidirectional search asks for the cost of each edge it scans.
+						if (overlay || bidirectional)
 						{
-							if (populationLeft - globalMinPop2Route < globalMinPop2Route) population2Route = populationLeft;
-							else population2Route = globalMinPop2Route;
+							if (overlay)
+							{
+								RefreshOverlayCosts();
+								overlay->Customize();
+							}
+							SnapshotSources(currentEvacuee, population2Route, snapshotSources);
+							foundRestrictedSafezone = SnapshotTargets(population2Route, snapshotTargets, snapshotZones);
+
+							if (overlay) snapshotFound = overlay->Nearest(snapshotSources, snapshotTargets, snapshotRoute);
+							else if (!speculation || !speculation->Take(sortedIndex, population2Route, snapshotSources, snapshotTargets, SpeculativeCost, snapshotRoute, snapshotFound, speculativeScanned))
+								snapshotFound = bidirectional->Nearest(snapshotSources, snapshotTargets, SnapshotCost, snapshotRoute);
+
+							// These searches do not settle the edges of the network one by one so the dirty edge ratio is taken over the
+							// edges of the route instead. An edge that was never created was not seen by CARMA either so it counts as dirty,
+							// just like a new edge the edge by edge search settles.
+							sumVisitedDirtyEdge = (unsigned int)(sumVisitedDirtyEdge * 0.9);
+							sumVisitedEdge = (size_t)(sumVisitedEdge * 0.9);
+							if (snapshotFound)
+							{
+								sumVisitedEdge += snapshotRoute.Edges.size();
+								for (const auto e : snapshotRoute.Edges)
+								{
+									NAEdgePtr routeEdge = ecache->GetSnapshotEdge(e);
+									if (!routeEdge || routeEdge->GetDirtyState() != EdgeDirtyState::CleanState) sumVisitedDirtyEdge++;
+								}
+							}
+
+							if (snapshotFound && GenerateRoutePath(snapshotRoute, snapshotZones[snapshotRoute.TargetTag], currentEvacuee->VerticesAndRatio->at(snapshotRoute.SourceTag),
+								graph, ecache, populationLeft, pathGenerationCount, currentEvacuee, population2Route))
+							{
+								MaxPathCostSoFar = max(MaxPathCostSoFar, currentEvacuee->Paths->front()->GetReserveEvacuationCost());
+
+								if (speculation) for (auto seg = currentEvacuee->Paths->front()->cbegin(); seg != currentEvacuee->Paths->front()->cend(); ++seg) speculation->Commit((*seg)->Edge->EID);
+							}
+							else
+							{
+								if (foundRestrictedSafezone) ++EvacueesWithRestrictedSafezone;
+								currentEvacuee->Status = EvacueeStatus::Unreachable;
+								populationLeft = 0.0;
+							}
+							continue;
 						}
-						else population2Route = populationLeft;
 
-						// populate the heap with vertices associated with the current evacuee
-						readyEdges.clear();
-						for (auto const & v : *(currentEvacuee->VerticesAndRatio))
-							if (FAILED(hr = PrepareVerticesForHeap(v, vcache, ecache, &closedList, readyEdges, population2Route, solverMethod, selfishRatio, MaxPathCostSoFar, QueryDirection::Backward))) goto END_OF_FUNC;
-						for (const auto & e : readyEdges) heap.Insert(e);
+						// The previous chunk of this evacuee left its search behind. It can only be repaired if every edge cost
+						// and penalty is computed the same way as before, otherwise we start over.
+						reuseSearch = reuseSearch && population2Route == searchPop2Route && (this->selfishRatio <= 0.0 || MaxPathCostSoFar == searchMaxPathCost);
+						if (!reuseSearch)
+						{
+							heap.Clear();
+							closedList.Clear();
+
+							// It's now safe to collect-n-clean on the graph (ecache & vcache).
+							// start a new label generation so the vertex pool can be written over
+							vcache->CollectAndRelease();
+						}
 
 						TimeToBeat = CASPER_INFINITY;
 						BetterSafeZone = nullptr;
 						finalVertex = nullptr;
 						foundRestrictedSafezone = false;
 
-						// reduce the effect of previous CASPER loop heap extract for the purpose of dirty edge ratio. This will encourage more CARMA loops.
-						sumVisitedDirtyEdge = (unsigned int)(sumVisitedDirtyEdge * 0.9);
-						sumVisitedEdge = (size_t)(sumVisitedEdge * 0.9);
-
-						// Continue traversing the network while the heap has remaining junctions in it
-						// this is the actual Dijkstra code with the Fibonacci Heap
-						while (!heap.empty())
+						// relaxes all edges leaving a settled edge and checks if it has reached a safe zone
+						auto ExpandEdge = [&](NAEdgePtr settledEdge) -> HRESULT
 						{
-							// Remove the next junction EID from the top of the stack
-							myEdge = heap.DeleteMin();
-							myVertex = myEdge->ToVertex;
-							_ASSERT_EXPR(!closedList.Exist(myEdge), L"closedList violation happened");
-							if (FAILED(hr = closedList.Insert(myEdge)))
-							{
-								// closedList violation happened
-								pMessages->AddError(-myEdge->EID, ATL::CComBSTR(L"ClosedList Violation Error."));
-								hr = ATL::AtlReportError(this->GetObjectCLSID(), _T("ClosedList Violation Error."), IID_INASolver);
-								goto END_OF_FUNC;
-							}
-
-							if (myEdge->GetDirtyState() != EdgeDirtyState::CleanState) sumVisitedDirtyEdge++;
+							NAVertexPtr settledVertex = settledEdge->ToVertex;
+							HRESULT ehr = S_OK;
+							_ASSERT_EXPR(vcache->IsCurrent(settledVertex), L"settled edge has a label from an older search");
 
 							// Check for destinations. If a new destination has been found then we should
 							// first flag this so later we can use to generate route. Also we should
 							// update the new TimeToBeat value for proper termination.
-							if (safeZoneList->CheckDiscoveredSafePoint(ecache, myVertex, myEdge, finalVertex, TimeToBeat, BetterSafeZone, costPerDensity,
+							if (safeZoneList->CheckDiscoveredSafePoint(ecache, settledVertex, settledEdge, finalVertex, TimeToBeat, BetterSafeZone, costPerDensity,
 								population2Route, solverMethod, globalDeltaCost, foundRestrictedSafezone)) UpdatePeakMemoryUsage();
 
-							if (FAILED(hr = ecache->QueryAdjacencies(myVertex, myEdge, QueryDirection::Forward, &adj))) goto END_OF_FUNC;
+							if (FAILED(ehr = ecache->QueryAdjacencies(settledVertex, settledEdge, QueryDirection::Forward, &adj))) return ehr;
 
 							for (const auto & currentEdge : *adj)
 							{
 								// if edge has already been discovered then no need to heap it
 								if (closedList.Exist(currentEdge)) continue;
 
-								newCost = myVertex->GVal + currentEdge->GetCost(population2Route, this->solverMethod, &globalDeltaCost);
+								newCost = settledVertex->GVal + currentEdge->GetCost<TrafficPolicy>(population2Route, this->solverMethod, &globalDeltaCost);
 								if (newCost >= CASPER_INFINITY) continue;
 
 								if (heap.IsVisited(currentEdge)) // edge has been visited before. update edge and decrease key.
 								{
 									neighbor = currentEdge->ToVertex;
-									addedCostAsPenalty = currentEdge->MaxAddedCostOnReservedPathsWithNewFlow(globalDeltaCost, MaxPathCostSoFar, newCost + neighbor->GetMinHOrZero(), this->selfishRatio);
-									if (neighbor->GVal + neighbor->GlobalPenaltyCost > newCost + addedCostAsPenalty + myVertex->GlobalPenaltyCost)
+									addedCostAsPenalty = currentEdge->MaxAddedCostOnReservedPathsWithNewFlow(globalDeltaCost, MaxPathCostSoFar, newCost + neighbor->GetCARMAHOrZero(), this->selfishRatio);
+									if (neighbor->GVal + neighbor->GlobalPenaltyCost > newCost + addedCostAsPenalty + settledVertex->GlobalPenaltyCost)
 									{
 										neighbor->SetBehindEdge(currentEdge);
 										neighbor->GVal = newCost;
-										neighbor->GlobalPenaltyCost = myVertex->GlobalPenaltyCost + addedCostAsPenalty;
-										neighbor->Previous = myVertex;
+										neighbor->GlobalPenaltyCost = settledVertex->GlobalPenaltyCost + addedCostAsPenalty;
+										neighbor->Previous = settledVertex;
 										heap.UpdateKey(currentEdge);
 									}
 								}
 								else // unvisited edge. create new and insert in heap
 								{
-									if (FAILED(hr = currentEdge->NetEdge->QueryJunctions(nullptr, ipCurrentJunction))) goto END_OF_FUNC;
-									neighbor = vcache->New(ipCurrentJunction, ipNetworkQuery);
+									if (FAILED(ehr = ecache->QueryJunction(currentEdge, QueryDirection::Forward, junctionEID))) return ehr;
+									if (!(neighbor = vcache->New(junctionEID, ecache->GetJunctionQuery()))) return E_FAIL;
 									neighbor->SetBehindEdge(currentEdge);
-									addedCostAsPenalty = currentEdge->MaxAddedCostOnReservedPathsWithNewFlow(globalDeltaCost, MaxPathCostSoFar, newCost + neighbor->GetMinHOrZero(), this->selfishRatio);
-									neighbor->GlobalPenaltyCost = myVertex->GlobalPenaltyCost + addedCostAsPenalty;
+									addedCostAsPenalty = currentEdge->MaxAddedCostOnReservedPathsWithNewFlow(globalDeltaCost, MaxPathCostSoFar, newCost + neighbor->GetCARMAHOrZero(), this->selfishRatio);
+									neighbor->GlobalPenaltyCost = settledVertex->GlobalPenaltyCost + addedCostAsPenalty;
 									neighbor->GVal = newCost;
-									neighbor->Previous = myVertex;
+									neighbor->Previous = settledVertex;
 
 									// Termination Condition: If the new vertex does have a chance to beat the already discovered safe node then add it to the heap.
 									if (NAEdge::GetHeapKeyHur(currentEdge) <= TimeToBeat) heap.Insert(currentEdge);
 								}
 							}
+							return ehr;
+						};
+
+						if (reuseSearch)
+						{
+							// Reservations only increase edge costs so a settled edge keeps its label unless the tree path to it goes through an edge
+							// that changed since the previous search started. Those stale edges are opened again and everything else stays settled.
+							searchMembers.clear();
+							closedList.GetMembers(searchMembers);
+							checkedEdges.Clear();
+							staleEdges.Clear();
+							for (const auto e : searchMembers)
+							{
+								searchChain.clear();
+								stale = false;
+								for (myEdge = e; myEdge && !checkedEdges.Exist(myEdge); myEdge = myEdge->ToVertex->Previous ? myEdge->ToVertex->Previous->GetBehindEdge() : nullptr)
+								{
+									searchChain.push_back(myEdge);
+									if (!closedList.Exist(myEdge)) { stale = true; break; }
+								}
+								if (myEdge && staleEdges.Exist(myEdge)) stale = true;
+								for (auto c = searchChain.rbegin(); c != searchChain.rend(); ++c)
+								{
+									stale = stale || (*c)->GetChangeStamp() > searchStamp;
+									checkedEdges.Insert(*c);
+									if (stale) staleEdges.Insert(*c);
+								}
+							}
+							for (const auto e : searchMembers) if (staleEdges.Exist(e)) closedList.Erase(e);
+						}
+
+						// populate the heap with vertices associated with the current evacuee
+						readyEdges.clear();
+						for (auto const & v : *(currentEvacuee->VerticesAndRatio))
+						{
+							if (reuseSearch && v->GetBehindEdge() && closedList.Exist(v->GetBehindEdge())) continue;
+							if (FAILED(hr = PrepareVerticesForHeap(v, vcache, ecache, &closedList, readyEdges, population2Route, solverMethod, selfishRatio, MaxPathCostSoFar, QueryDirection::Backward))) goto END_OF_FUNC;
+						}
+						for (const auto & e : readyEdges) heap.Insert(e);
+
+						// the frontier of the repaired search is whatever the remaining settled edges can reach
+						if (reuseSearch)
+						{
+							for (const auto e : searchMembers)
+								if (!staleEdges.Exist(e) && FAILED(hr = ExpandEdge(e))) goto END_OF_FUNC;
+						}
+
+						searchStamp = ReservationClock::Now();
+						searchPop2Route = population2Route;
+						searchMaxPathCost = MaxPathCostSoFar;
+
+						// reduce the effect of previous CASPER loop heap extract for the purpose of dirty edge ratio. This will encourage more CARMA loops.
+						sumVisitedDirtyEdge = (unsigned int)(sumVisitedDirtyEdge * 0.9);
+						sumVisitedEdge = (size_t)(sumVisitedEdge * 0.9);
+
+						// Continue traversing the network while the heap has remaining junctions in it
+						// this is the actual Dijkstra code with the search heap
+						while (!heap.empty())
+						{
+							// Remove the next junction EID from the top of the stack
+							myEdge = heap.DeleteMin();
+							_ASSERT_EXPR(!closedList.Exist(myEdge), L"closedList violation happened");
+							if (FAILED(hr = closedList.Insert(myEdge)))
+							{
+								// closedList violation happened
+								pMessages->AddError(-myEdge->EID, ATL::CComBSTR(L"ClosedList Violation Error."));
+								hr = ATL::AtlReportError(this->GetObjectCLSID(), _T("ClosedList Violation Error."), IID_INASolver);
+								goto END_OF_FUNC;
+							}
+
+							if (myEdge->GetDirtyState() != EdgeDirtyState::CleanState) sumVisitedDirtyEdge++;
+							if (FAILED(hr = ExpandEdge(myEdge))) goto END_OF_FUNC;
 						}
 
 						// collect info for Carma
@@ -256,10 +473,15 @@ HRESULT EvcSolver::SolveMethod(INetworkQueryPtr ipNetworkQuery, IGPMessages* pMe
 						f.close();
 						#endif
 
-						// cleanup search heap and closed-list
+						// keep the search for the next chunk of this evacuee if the incremental mode is on, otherwise cleanup search heap and closed-list
 						UpdatePeakMemoryUsage();
-						heap.Clear();
-						closedList.Clear();
+						reuseSearch = TrafficPolicy::Monotone && this->incrementalChunkSearch == VARIANT_TRUE && BetterSafeZone && populationLeft > 0.0 &&
+							currentEvacuee->Status == EvacueeStatus::Unprocessed;
+						if (!reuseSearch)
+						{
+							heap.Clear();
+							closedList.Clear();
+						}
 					} // end of while loop for multiple routes single evacuee
 
 					if (currentEvacuee->Status == EvacueeStatus::Unprocessed) currentEvacuee->Status = EvacueeStatus::Processed;
@@ -273,7 +495,15 @@ HRESULT EvcSolver::SolveMethod(INetworkQueryPtr ipNetworkQuery, IGPMessages* pMe
 			UpdatePeakMemoryUsage();
 
 			// figure out how may of paths need to be detached and process again
-			NumberOfEvacueesInIteration = FindPathsThatNeedToBeProcessedInIteration(AllEvacuees, detachedPaths, GlobalEvcCostAtIteration, LocalIteration);
+			NumberOfEvacueesInIteration = FindPathsThatNeedToBeProcessedInIteration(AllEvacuees, detachedPaths, GlobalEvcCostAtIteration, LocalIteration, iterationPool, touchedEdges);
+
+			// a detached path gives its flow back so edge costs drop and no label of an older search can be trusted anymore
+			if (reuseSearch || !touchedEdges.empty())
+			{
+				reuseSearch = false;
+				heap.Clear();
+				closedList.Clear();
+			}
 			if (NumberOfEvacueesInIteration > 0)
 			{
 				RevisedCarmaSortCriteria = CARMASort::ReverseFinalCost;
@@ -286,6 +516,12 @@ HRESULT EvcSolver::SolveMethod(INetworkQueryPtr ipNetworkQuery, IGPMessages* pMe
 END_OF_FUNC:
 
 	_ASSERT_EXPR(hr >= 0 || hr == E_ABORT, L"SolveMethod function exit with error");
+	if (speculation && SUCCEEDED(hr) && pMessages)
+	{
+		statusMsg.Format(_T("Speculative window of %d: %d out of %d evacuee routes were searched again after %d windows"), (int)speculation->WindowSize(),
+			(int)speculation->ConflictCount(), (int)speculation->EvacueeCount(), (int)speculation->WindowCount());
+		pMessages->AddMessage(ATL::CComBSTR(statusMsg));
+	}
 	#ifdef TRACE
 	std::ofstream f;
 	f.open("c:\\evcsolver.log", std::ios_base::out | std::ios_base::app);
@@ -296,28 +532,152 @@ END_OF_FUNC:
 	return hr;
 }
 
-size_t EvcSolver::FindPathsThatNeedToBeProcessedInIteration(std::shared_ptr<EvacueeList> AllEvacuees, std::shared_ptr<std::vector<EvcPathPtr>> detachedPaths,
-	std::vector<double> & GlobalEvcCostAtIteration, size_t & LocalIteration) const
+// The SP solver does not care about capacity so the route of an evacuee is just its shortest path to the closest safe zone.
+// All safe zones go into one downward search of the hierarchy and then every evacuee is a small upward search from its own
+// vertices.
+HRESULT EvcSolver::HierarchySolveMethod(IStepProgressorPtr ipStepProgressor, ITrackCancel* pTrackCancel, std::shared_ptr<EvacueeList> AllEvacuees, std::shared_ptr<SafeZoneTable> safeZoneList,
+	NAGraphSnapshotPtr graph, std::shared_ptr<NAEdgeCache> ecache, NAContractionHierarchyPtr hierarchy, unsigned int & EvacueesWithRestrictedSafezone, std::vector<double> & GlobalEvcCostAtIteration)
 {
-	std::vector<EvcPathPtr> allPaths;
-	std::vector<EvacueePtr> EvacueesForNextIteration;
-	std::unordered_set<NAEdgePtr, NAEdgePtrHasher, NAEdgePtrEqual> touchededges;
+	HRESULT hr = S_OK;
+	VARIANT_BOOL keepGoing;
+	NAHierarchyQuery query(*hierarchy);
+	NAHierarchyRoute route;
+	std::vector<NAHierarchySeed> targets, sources;
+	std::vector<SafeZonePtr> zones;
+	NAEdgePtr behindEdge = nullptr;
+	NAVertexPtr start = nullptr;
+	size_t restrictedZones = 0;
+	int pathGenerationCount = -1, EvacueeProcessOrder = -1;
+	double offset = 0.0, populationLeft = 0.0, maxCost = 0.0;
+	bool found = false;
 
-	// Recalculate all path costs and then list them in a sorted manner by descending final cost
-	for (const auto & evc : *AllEvacuees)
-		if (evc->Status != EvacueeStatus::Unreachable)
+	EvacueesWithRestrictedSafezone = 0;
+	if (ipStepProgressor && !AllEvacuees->empty())
+	{
+		if (FAILED(hr = ipStepProgressor->put_MinRange(0))) return hr;
+		if (FAILED(hr = ipStepProgressor->put_MaxRange((long)AllEvacuees->size()))) return hr;
+		if (FAILED(hr = ipStepProgressor->put_StepValue(1))) return hr;
+		if (FAILED(hr = ipStepProgressor->put_Message(ATL::CComBSTR(L"Performing SP search on the contraction hierarchy")))) return hr;
+	}
+
+	// a safe zone in the middle of an edge can only be reached if that edge made it into the snapshot
+	zones.reserve(safeZoneList->size());
+	targets.reserve(safeZoneList->size());
+	for (const auto & z : *safeZoneList)
+	{
+		behindEdge = z.second->getBehindEdge();
+		if (behindEdge && graph->Find(behindEdge->EID, (EdgeDirection)behindEdge->Direction) == NAGraphSnapshot::NoEdge) offset = CASPER_INFINITY;
+		else offset = z.second->SafeZoneCost(1.0, solverMethod, costPerDensity);
+		if (offset >= CASPER_INFINITY) { ++restrictedZones; continue; }
+		targets.push_back(NAHierarchySeed(z.first, offset, zones.size()));
+		zones.push_back(z.second);
+	}
+	query.SetTargets(targets);
+
+	for (const auto currentEvacuee : *AllEvacuees)
+	{
+		if (pTrackCancel)
 		{
-			evc->FinalCost = 0.0;
-			for (const auto & path : *evc->Paths)
-				if (path->IsActive())
-				{
-					path->CalculateFinalEvacuationCost(initDelayCostPerPop, EvcSolverMethod::CASPERSolver);
-					allPaths.push_back(path);
-				}
+			if (FAILED(hr = pTrackCancel->Continue(&keepGoing))) return hr;
+			if (keepGoing == VARIANT_FALSE) return E_ABORT;
+		}
+		if (currentEvacuee->Status != EvacueeStatus::Unprocessed) continue;
+		if (ipStepProgressor) ipStepProgressor->Step();
+		currentEvacuee->ProcessOrder = ++EvacueeProcessOrder;
+
+		// an evacuee in the middle of an edge starts at the end of that edge with the portion of its cost that is left
+		sources.clear();
+		for (size_t i = 0; i < currentEvacuee->VerticesAndRatio->size(); ++i)
+		{
+			start = currentEvacuee->VerticesAndRatio->at(i);
+			behindEdge = start->GetBehindEdge();
+			offset = behindEdge ? behindEdge->GetCost(currentEvacuee->Population, solverMethod) : 0.0;
+			if (offset < CASPER_INFINITY) sources.push_back(NAHierarchySeed(start->EID, start->GVal * offset, i));
+		}
+
+		populationLeft = currentEvacuee->Population;
+		found = query.Nearest(sources, route);
+		if (found)
+		{
+			currentEvacuee->PredictedCost = route.Cost;
+			found = GenerateRoutePath(route, zones[route.TargetTag], currentEvacuee->VerticesAndRatio->at(route.SourceTag), graph, ecache, populationLeft, pathGenerationCount,
+				currentEvacuee, populationLeft);
 		}
+		else if (restrictedZones > 0) ++EvacueesWithRestrictedSafezone;
+
+		currentEvacuee->Status = found ? EvacueeStatus::Processed : EvacueeStatus::Unreachable;
+	}
+
+	// there is nothing to iterate on since no route depends on another one. the evacuation cost is still reported for the single pass.
+	for (const auto & evc : *AllEvacuees)
+	{
+		if (evc->Status == EvacueeStatus::Unreachable) continue;
+		evc->FinalCost = 0.0;
+		for (const auto & p : *evc->Paths) if (p->IsActive()) p->CalculateFinalEvacuationCost(initDelayCostPerPop, EvcSolverMethod::CASPERSolver);
+		maxCost = max(maxCost, evc->FinalCost);
+	}
+	GlobalEvcCostAtIteration.push_back(maxCost);
+	UpdatePeakMemoryUsage();
+	return hr;
+}
+
+// the paths of the second chance selection (see SecondChance.h) with the thresholds of this iteration
+class EvcPathSecondChance
+{
+public:
+	typedef EvcPathPtr         Path;
+	typedef EvacueePtr         Pick;
+	typedef PathOverlapCounter Counter;
+
+	const double          ThreasholdForCost;
+	const double          ThreasholdForPathOverlap;
+	const double          ThisIterationMaxCost;
+	const EvcSolverMethod Method;
+
+	EvcPathSecondChance(double costThreashold, double overlapThreashold, double maxCost, EvcSolverMethod method) :
+		ThreasholdForCost(costThreashold), ThreasholdForPathOverlap(overlapThreashold), ThisIterationMaxCost(maxCost), Method(method) { }
+
+	static inline bool Less(EvcPathPtr p1, EvcPathPtr p2) { return EvcPath::LessThanFinalCost(p1, p2); }
+	inline bool NeedsSecondChance(EvcPathPtr path) const { return path->NeedsSecondChance(ThreasholdForCost, ThisIterationMaxCost); }
+	inline void CollectOverlaps(EvcPathPtr path, PathOverlapCounter & counter, std::vector<EvcPathPtr> & overlaps) const
+	{
+		path->CollectOverlaps(counter, ThreasholdForPathOverlap, overlaps, Method);
+	}
+	inline void ApplySecondChance(EvcPathPtr path, const std::vector<EvcPathPtr> & overlaps, std::vector<EvacueePtr> & picked) const { path->ApplySecondChance(overlaps, picked); }
+};
+
+// 'touchededges' comes back with every edge whose reservations were given back or taken again
+size_t EvcSolver::FindPathsThatNeedToBeProcessedInIteration(std::shared_ptr<EvacueeList> AllEvacuees, std::shared_ptr<std::vector<EvcPathPtr>> detachedPaths,
+	std::vector<double> & GlobalEvcCostAtIteration, size_t & LocalIteration, SPTWorkerPool & pool, std::unordered_set<NAEdgePtr, NAEdgePtrHasher, NAEdgePtrEqual> & touchededges) const
+{
+	std::vector<EvcPathPtr> allPaths;
+	std::vector<EvacueePtr> EvacueesForNextIteration, evacuees;
+	std::atomic<size_t> next;
+	const size_t chunk = 64;
+	touchededges.clear();
+
+	// Recalculate all path costs. Every evacuee only touches its own paths and segments so the evacuees are spread over the pool.
+	for (const auto & evc : *AllEvacuees) if (evc->Status != EvacueeStatus::Unreachable) evacuees.push_back(evc);
+	next = 0;
+	pool.Run([&](unsigned int)
+	{
+		for (size_t first = next.fetch_add(chunk); first < evacuees.size(); first = next.fetch_add(chunk))
+			for (size_t i = first; i < min(first + chunk, evacuees.size()); ++i)
+			{
+				evacuees[i]->FinalCost = 0.0;
+				for (const auto & path : *evacuees[i]->Paths) if (path->IsActive()) path->CalculateFinalEvacuationCost(initDelayCostPerPop, EvcSolverMethod::CASPERSolver);
+			}
+	});
+
+	// and then list them in the same order as before so that the heap below breaks ties the same way for any thread count
+	for (const auto & evc : evacuees)
+		for (const auto & path : *evc->Paths) if (path->IsActive()) allPaths.push_back(path);
 
 	if (allPaths.empty()) return 0;
-	std::sort(allPaths.begin(), allPaths.end(), EvcPath::MoreThanFinalCost);
+
+	// only the most expensive paths get a second chance so there is no need to sort all of them. a heap is built in linear
+	// time and then popped from the most expensive path down only as far as the second chance loop below actually goes.
+	std::make_heap(allPaths.begin(), allPaths.end(), EvcPath::LessThanFinalCost);
 
 	// setting up the best ratios
 	const double minRatioOfLongestPath = allPaths.front()->GetMinCostRatio();
@@ -355,11 +715,12 @@ size_t EvcSolver::FindPathsThatNeedToBeProcessedInIteration(std::shared_ptr<Evac
 
 	// And the next step is to find 'bad' paths and detach them so that the next iteration can find new paths for these evacuees.
 	// If no `bad` paths where found then we leave `EvacueesForNextIteration` empty so that the solver terminates and returns.
-	for (const auto & path : allPaths)
-	{
-		if (EvacueesForNextIteration.size() >= MaxEvacueesInIteration) break;
-		path->DoesItNeedASecondChance(ThreasholdForCost, ThreasholdForPathOverlap, EvacueesForNextIteration, GlobalEvcCostAtIteration[GolbalIteration - 1], solverMethod);
-	}
+	// The paths are taken from the heap in small batches. The overlaps of a batch only read the reservations so they are
+	// collected in parallel, each worker with its own reusable counter, and then applied one path at a time in heap order,
+	// exactly like the serial loop would have done.
+	EvcPathSecondChance paths(ThreasholdForCost, ThreasholdForPathOverlap, GlobalEvcCostAtIteration[GolbalIteration - 1], solverMethod);
+	SecondChance<EvcPathSecondChance> secondChance(paths, pool);
+	secondChance.Run(allPaths, MaxEvacueesInIteration, EvacueesForNextIteration);
 
 	// Now that we know which evacuees are going to be processed again, let's reset their values and detach their paths.
 	std::sort(EvacueesForNextIteration.begin(), EvacueesForNextIteration.end(), EvcPath::MoreThanPathOrder1);
@@ -369,31 +730,32 @@ size_t EvcSolver::FindPathsThatNeedToBeProcessedInIteration(std::shared_ptr<Evac
 	return EvacueesForNextIteration.size();
 }
 
+template <template <class> class EdgeHeap, class TrafficPolicy>
 HRESULT EvcSolver::CARMALoop(INetworkQueryPtr ipNetworkQuery, IStepProgressorPtr ipStepProgressor, IGPMessages* pMessages, ITrackCancel* pTrackCancel, std::shared_ptr<EvacueeList> Evacuees, CARMASort RevisedCarmaSortCriteria,
 	std::shared_ptr<std::vector<EvacueePtr>> SortedEvacuees, std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, std::shared_ptr<SafeZoneTable> safeZoneList, size_t & closedSize,
-	std::shared_ptr<NAEdgeMapTwoGen> closedList, std::shared_ptr<NAEdgeContainer> leafs, std::vector<unsigned int> & CARMAExtractCounts, double globalMinPop2Route, double & minPop2Route, bool separationRequired)
+	std::shared_ptr<NAEdgeMapTwoGen> closedList, std::shared_ptr<NAEdgeContainer> leafs, std::vector<unsigned int> & CARMAExtractCounts, std::vector<unsigned int> & CARMARepairCounts,
+	double globalMinPop2Route, double & minPop2Route, bool separationRequired)
 {
 	HRESULT hr = S_OK;
 
 	// performing pre-process: Here we will mark each vertex/junction with a heuristic value indicating
 	// true distance to closest safe zone using backward traversal and Dijkstra
-	MyFibonacciHeap<NAEdgePtr, NAEdgePtrHasher, NAEdgePtrEqual> heap(NAEdge::GetHeapKeyNonHur);	// creating the heap for the dijkstra search
+	EdgeHeap<NAEdge::HeapKeyNonHur> heap;	// creating the heap for the dijkstra search
 	NAVertexPtr neighbor = nullptr;
 	INetworkElementPtr ipElementEdge = nullptr;
 	VARIANT val;
 	val.vt = VT_R8; // double variant value
 	NAVertexPtr myVertex = nullptr;
 	NAEdgePtr myEdge = nullptr;
-	INetworkElementPtr ipJunctionElement = nullptr;
-	double newCost, SearchRadius, prevMinPop2Route = minPop2Route;
+	long junctionEID = -1;
+	double newCost, SearchRadius, prevMinPop2Route = minPop2Route, prevSearchRadius = CASPER_INFINITY;
 	VARIANT_BOOL keepGoing;
-	INetworkJunctionPtr ipCurrentJunction = nullptr;
 	std::vector<NAEdgePtr> readyEdges;
 	readyEdges.reserve(safeZoneList->size());
-	unsigned int CARMAExtractCount = 0;
+	unsigned int CARMAExtractCount = 0, CARMARepairCount = 0;
 	ArrayList<NAEdgePtr> * adj = nullptr;
 	ATL::CString statusMsg;
-	bool ShouldCARMACheckForDecreasedCost = false, FullSPTSelected = false;
+	bool ShouldCARMACheckForDecreasedCost = false, FullSPTSelected = false, ParallelSPTSelected = false, LifelongSPTSelected = false;
 	std::vector<NAEdgePtr> removedDirty; removedDirty.reserve(10000);
 	const std::function<bool(EvacueePtr, EvacueePtr)> SortFunctions[7] =
 		{ Evacuee::LessThanObjectID, Evacuee::LessThan, Evacuee::LessThan, Evacuee::MoreThan, Evacuee::MoreThan, Evacuee::ReverseFinalCost, Evacuee::ReverseEvacuationCost };
@@ -404,6 +766,8 @@ HRESULT EvcSolver::CARMALoop(INetworkQueryPtr ipNetworkQuery, IStepProgressorPtr
 	/// TODO what heppens here is that some evacuee may change location (DynamicCASPER) and hence the previous leafs
 	/// may not be the same edges to discover them again. In case of a DSPT this may mislead CARMA.
 	/// Also this is even more interesting when the evacuee is stuck
+	// the leafs that the last loop left behind mark how far its tree went. the discovery leafs added below do not.
+	if (lifelongCARMA == VARIANT_TRUE) prevSearchRadius = CARMATreeRepair::FrontierRadius(ecache, leafs);
 	NAEvacueeVertexTable EvacueePairs;
 	EvacueePairs.InsertReachable(Evacuees, CarmaSortCriteria, leafs); // this is very important to be 'CarmaSortCriteria' with capital 'C'
 	SortedEvacuees->clear();
@@ -412,9 +776,6 @@ HRESULT EvcSolver::CARMALoop(INetworkQueryPtr ipNetworkQuery, IStepProgressorPtr
 	std::ofstream f;
 	#endif
 
-	if (FAILED(hr = ipNetworkQuery->CreateNetworkElement(esriNETJunction, &ipJunctionElement))) return hr;
-	ipCurrentJunction = ipJunctionElement;
-
 	// if this list is not empty, it means we are going to have another CARMA loop
 	if (!EvacueePairs.empty())
 	{
@@ -448,11 +809,22 @@ HRESULT EvcSolver::CARMALoop(INetworkQueryPtr ipNetworkQuery, IStepProgressorPtr
 
 		// This is where the new dynamic CARMA starts. At this point you have to clear the dirty section of the carma tree.
 		// also keep the previous leafs only if they are still in closedList. They help re-discover EvacueePairs
-		MarkDirtyEdgesAsUnVisited(closedList->oldGen, leafs, removedDirty, ShouldCARMACheckForDecreasedCost);
+		// The lifelong option repairs the labels of the old tree instead and only removes what the repair could not vouch for.
+		LifelongSPTSelected = !FullSPTSelected && lifelongCARMA == VARIANT_TRUE;
+		if (LifelongSPTSelected)
+		{
+			if (FAILED(hr = RepairDirtyEdges(vcache, ecache, closedList->oldGen, leafs, removedDirty, prevSearchRadius, minPop2Route, CARMARepairCount))) return hr;
+		}
+		else MarkDirtyEdgesAsUnVisited(closedList->oldGen, leafs, removedDirty, ShouldCARMACheckForDecreasedCost);
+
+		// the parallel tree can only replace a full SPT: the dynamic one has to grow from the leafs of the previous tree
+		ParallelSPTSelected = FullSPTSelected && ecache->GetParallelSPT() && leafs->IsEmpty();
 
 		if (ipStepProgressor)
 		{
-			if (FullSPTSelected) statusMsg.Format(_T("CARMA Loop %d: Full SPT"), CARMAExtractCounts.size() + 1);
+			if (ParallelSPTSelected) statusMsg.Format(_T("CARMA Loop %d: Parallel Full SPT"), CARMAExtractCounts.size() + 1);
+			else if (FullSPTSelected) statusMsg.Format(_T("CARMA Loop %d: Full SPT"), CARMAExtractCounts.size() + 1);
+			else if (LifelongSPTSelected) statusMsg.Format(_T("CARMA Loop %d: Lifelong SPT (%d repairs)"), CARMAExtractCounts.size() + 1, CARMARepairCount);
 			else if (ShouldCARMACheckForDecreasedCost) statusMsg.Format(_T("CARMA Loop %d: Fully-Dynamic SPT"), CARMAExtractCounts.size() + 1);
 			else statusMsg.Format(_T("CARMA Loop %d: Semi-Dynamic SPT"), CARMAExtractCounts.size() + 1);
 			if (FAILED(hr = ipStepProgressor->put_Message(ATL::CComBSTR(statusMsg)))) return hr;
@@ -465,7 +837,7 @@ HRESULT EvcSolver::CARMALoop(INetworkQueryPtr ipNetworkQuery, IStepProgressorPtr
 		#endif
 
 		// pre-add dirty edges to heap with their old clean parents instead of checking it during loop
-		if (FAILED(hr = FindDirtyEdgesWithACleanParent(ecache, vcache, ipNetworkQuery, closedList, leafs, removedDirty))) return hr;
+		if (FAILED(hr = FindDirtyEdgesWithACleanParent(ecache, vcache, closedList, leafs, removedDirty))) return hr;
 
 		// prepare and insert safe zone vertices into the heap
 		for (const auto & z : *safeZoneList)
@@ -481,12 +853,21 @@ HRESULT EvcSolver::CARMALoop(INetworkQueryPtr ipNetworkQuery, IStepProgressorPtr
 
 		// Now insert leaf edges in heap like the destination edges
 		// do I have to insert leafs even if DSPT is off? It does not matter cause closedList is cleaned and hence all leafs will be removed anyway.
-		if (FAILED(hr = InsertLeafEdgesToHeap(ipNetworkQuery, vcache, ecache, heap, leafs))) return hr;
+		if (FAILED(hr = InsertLeafEdgesToHeap(vcache, ecache, heap, leafs))) return hr;
 
 		// we're done with all these leafs. let's clean up and collect new ones for the next round.
 		leafs->Clear();
 		SearchRadius = CASPER_INFINITY;
 
+		// The parallel tree settles every edge itself so on success the heap is emptied and the serial loop below has nothing to do.
+		// S_FALSE means the snapshot could not cover this search and we just continue with the serial loop.
+		if (ParallelSPTSelected)
+		{
+			if (FAILED(hr = ParallelCARMALoop(ipNetworkQuery, pTrackCancel, pMessages, readyEdges, EvacueePairs, SortedEvacuees, vcache, ecache, closedList, leafs, CARMAExtractCount, SearchRadius, minPop2Route))) return hr;
+			if (hr == S_OK) heap.Clear();
+			hr = S_OK;
+		}
+
 		// Continue traversing the network while the heap has remaining junctions in it
 		// this is the actual Dijkstra code with backward network traversal. it will only update h value.
 		while (!heap.empty())
@@ -543,16 +924,16 @@ HRESULT EvcSolver::CARMALoop(INetworkQueryPtr ipNetworkQuery, IStepProgressorPtr
 
 			for (const auto & currentEdge : *adj)
 			{
-				if (FAILED(hr = currentEdge->NetEdge->QueryJunctions(ipCurrentJunction, nullptr))) return hr;
-				newCost = myVertex->GVal + currentEdge->GetCost(minPop2Route, solverMethod);
+				if (FAILED(hr = ecache->QueryJunction(currentEdge, QueryDirection::Backward, junctionEID))) return hr;
+				newCost = myVertex->GVal + currentEdge->GetCost<TrafficPolicy>(minPop2Route, solverMethod);
 				if (newCost >= CASPER_INFINITY) continue;
 
 				if (closedList->Exist(currentEdge, NAEdgeMapGeneration::OldGen))
 				{
 					if (ShouldCARMACheckForDecreasedCost)
 					{
-						neighbor = vcache->New(ipCurrentJunction, ipNetworkQuery);
-						if (newCost < neighbor->GetH(currentEdge->EID))
+						if (!(neighbor = vcache->New(junctionEID, ecache->GetJunctionQuery()))) return E_FAIL;
+						if (newCost < neighbor->GetH(currentEdge))
 						{
 							neighbor->SetBehindEdge(currentEdge);
 							neighbor->GVal = newCost;
@@ -579,7 +960,7 @@ HRESULT EvcSolver::CARMALoop(INetworkQueryPtr ipNetworkQuery, IStepProgressorPtr
 						}
 						else // unvisited vertex. create new and insert into heap
 						{
-							neighbor = vcache->New(ipCurrentJunction, ipNetworkQuery);
+							if (!(neighbor = vcache->New(junctionEID, ecache->GetJunctionQuery()))) return E_FAIL;
 							neighbor->SetBehindEdge(currentEdge);
 							neighbor->GVal = newCost;
 							neighbor->Previous = myVertex;
@@ -598,8 +979,9 @@ HRESULT EvcSolver::CARMALoop(INetworkQueryPtr ipNetworkQuery, IStepProgressorPtr
 		_ASSERT_EXPR(EvacueePairs.empty(), L"Carma loop ended after scanning all the graph");
 
 		// set new default heuristic value
-		vcache->UpdateHeuristicForOutsideVertices(SearchRadius, CARMAExtractCounts.empty());
+		vcache->UpdateHeuristicForOutsideVertices(SearchRadius);
 		CARMAExtractCounts.push_back(CARMAExtractCount);
+		CARMARepairCounts.push_back(CARMARepairCount);
 	}
 
 	// load discovered evacuees into sorted list
@@ -618,10 +1000,118 @@ HRESULT EvcSolver::CARMALoop(INetworkQueryPtr ipNetworkQuery, IStepProgressorPtr
 	return hr;
 }
 
+// Builds the same CARMA tree as the heap loop in 'CARMALoop' but the distances and tree parents come from 'ParallelBackwardSPT'.
+// All network, vertex and reservation objects are only touched on this thread: edge costs come from the cost table of the edge
+// cache and then the settle order is replayed to do exactly what the heap loop does when it pops an edge. The tree and its
+// worker threads live as long as the solve, and an NAEdge is only made for the edges the replay closes.
+HRESULT EvcSolver::ParallelCARMALoop(INetworkQueryPtr ipNetworkQuery, ITrackCancel* pTrackCancel, IGPMessages* pMessages, const std::vector<NAEdgePtr> & readyEdges, NAEvacueeVertexTable & EvacueePairs,
+	std::shared_ptr<std::vector<EvacueePtr>> SortedEvacuees, std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, std::shared_ptr<NAEdgeMapTwoGen> closedList,
+	std::shared_ptr<NAEdgeContainer> leafs, unsigned int & CARMAExtractCount, double & SearchRadius, double minPop2Route)
+{
+	HRESULT hr = S_OK;
+	NAGraphSnapshotPtr graph = ecache->GetGraphSnapshot();
+	ParallelBackwardSPTPtr spt = ecache->GetParallelSPT();
+	std::vector<std::pair<NAGraphEdgeIndex, double>> seeds;
+	std::vector<SPTFrontierEdge> frontier;
+	NAGraphEdgeIndex e = NAGraphSnapshot::NoEdge;
+	NAEdgePtr myEdge = nullptr;
+	NAVertexPtr myVertex = nullptr;
+	VARIANT_BOOL keepGoing;
+	size_t expandedCount = 0;
+
+	// a safe zone edge that is not in the snapshot cannot be seeded so this search is left to the serial loop
+	seeds.reserve(readyEdges.size());
+	for (const auto & h : readyEdges)
+	{
+		e = graph->Find(h->EID, (EdgeDirection)h->Direction);
+		if (e == NAGraphSnapshot::NoEdge) return S_FALSE;
+		seeds.push_back(std::pair<NAGraphEdgeIndex, double>(e, h->ToVertex->GVal));
+	}
+
+	// edge costs depend on the reservations so the table is brought up to date here before any worker starts
+	const std::vector<double> & cost = ecache->GetSnapshotCosts(minPop2Route, solverMethod);
+	spt->Run(cost, seeds);
+	const std::vector<NAGraphEdgeIndex> & order = spt->SettleOrder();
+
+	#ifdef DEBUG
+	std::wostringstream os_;
+	os_ << "Parallel CARMA: " << spt->ThreadCount() << " threads, " << spt->PhaseCount() << " phases, " << order.size() << " reached edges" << std::endl;
+	OutputDebugStringW(os_.str().c_str());
+	#endif
+
+	// does what the heap loop does to a popped edge except for expanding it
+	auto CloseEdge = [&](NAGraphEdgeIndex edge, double label, NAGraphEdgeIndex parent)->HRESULT
+	{
+		myEdge = ecache->GetSnapshotEdge(edge);
+		if (!myEdge) myEdge = ecache->New(graph->GetEID(edge), (esriNetworkEdgeDirection)graph->GetDirection(edge));
+		if (!myEdge) return E_FAIL;
+		_ASSERT_EXPR(!closedList->Exist(myEdge), L"CARMA closedList violation");
+		if (FAILED(hr = closedList->Insert(myEdge)))
+		{
+			// closedList violation happened
+			pMessages->AddError(-myEdge->EID, ATL::CComBSTR(L"CARMA ClosedList Violation."));
+			return ATL::AtlReportError(this->GetObjectCLSID(), _T("CARMA ClosedList Violation."), IID_INASolver);
+		}
+
+		// Check to see if the user wishes to continue or cancel the solve
+		if (pTrackCancel)
+		{
+			if (FAILED(hr = pTrackCancel->Continue(&keepGoing))) return hr;
+			if (keepGoing == VARIANT_FALSE) return E_ABORT;
+		}
+		CARMAExtractCount++;
+
+		// a seed without a parent keeps the vertex prepared for it. an improved seed reuses that vertex just like a decrease-key would.
+		myVertex = myEdge->ToVertex;
+		if (parent != NAGraphSnapshot::NoEdge)
+		{
+			if (!spt->IsSeed(edge))
+			{
+				myVertex = vcache->New(graph->GetFromJunction(edge));
+			}
+			myVertex->SetBehindEdge(myEdge);
+			myVertex->GVal = label;
+			myVertex->Previous = ecache->GetSnapshotEdge(parent)->ToVertex;
+		}
+
+		// Code to build the CARMA Tree
+		if (myVertex->Previous)
+		{
+			if (myEdge->TreePrevious) myEdge->TreePrevious->TreeNext.unordered_erase(myEdge, NAEdge::IsEqualNAEdgePtr);
+			myEdge->TreePrevious = myVertex->Previous->GetBehindEdge();
+			myEdge->TreePrevious->TreeNext.push_back(myEdge);
+		}
+		myVertex->UpdateYourHeuristic();
+		myEdge->SetClean(this->solverMethod, minPop2Route);
+		return S_OK;
+	};
+
+	// expanded part of the tree: everything the heap loop pops before all evacuees are discovered
+	for (expandedCount = 0; expandedCount < order.size() && !EvacueePairs.empty(); ++expandedCount)
+	{
+		e = order[expandedCount];
+		if (FAILED(hr = CloseEdge(e, spt->GetDistance(e), spt->GetParent(e)))) return hr;
+		EvacueePairs.RemoveDiscoveredEvacuees(myVertex, myEdge, SortedEvacuees, minPop2Route, solverMethod);
+	}
+
+	// whatever is still queued at that point becomes a leaf for the next CARMA loop
+	if (EvacueePairs.empty())
+	{
+		spt->Frontier(expandedCount, cost, frontier);
+		for (const auto & f : frontier)
+		{
+			if (FAILED(hr = CloseEdge(f.Edge, f.Label, f.Parent))) return hr;
+			leafs->Insert(myEdge);
+			SearchRadius = min(SearchRadius, myVertex->GVal);
+		}
+		UpdatePeakMemoryUsage();
+	}
+	return S_OK;
+}
+
 void EvcSolver::MarkDirtyEdgesAsUnVisited(NAEdgeMap * closedList, std::shared_ptr<NAEdgeContainer> oldLeafs, std::vector<NAEdgePtr> & removedDirty, bool & ShouldCARMACheckForDecreasedCost) const
 {
 	std::vector<NAEdgePtr> dirtyVisited;
-	NAEdgeIterator j;
 	NAEdgePtr leaf = nullptr;
 	dirtyVisited.reserve(closedList->Size() / 2);
 	auto tempLeafs = std::shared_ptr<NAEdgeContainer>(new DEBUG_NEW_PLACEMENT NAEdgeContainer(1000));
@@ -647,7 +1137,31 @@ void EvcSolver::MarkDirtyEdgesAsUnVisited(NAEdgeMap * closedList, std::shared_pt
 		}
 	}
 
-	// removing previously identified leafs from closedList
+	ReopenOldLeafs(closedList, oldLeafs, tempLeafs);
+}
+
+// Runs the lifelong repair on the old tree. The edges it evicts are reported in 'removedDirty' just like the removed
+// subtrees of 'MarkDirtyEdgesAsUnVisited' so 'FindDirtyEdgesWithACleanParent' can grow them back from their clean parents.
+HRESULT EvcSolver::RepairDirtyEdges(std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, NAEdgeMap * closedList,
+	std::shared_ptr<NAEdgeContainer> oldLeafs, std::vector<NAEdgePtr> & removedDirty, double radius, double minPop2Route, unsigned int & repairCount) const
+{
+	HRESULT hr = S_OK;
+	std::vector<NAEdgePtr> dirtyVisited;
+	auto tempLeafs = std::shared_ptr<NAEdgeContainer>(new DEBUG_NEW_PLACEMENT NAEdgeContainer(1000));
+	CARMATreeRepair repair(closedList, vcache, ecache, solverMethod, minPop2Route);
+	removedDirty.clear();
+
+	closedList->GetDirtyEdges(dirtyVisited);
+	if (FAILED(hr = repair.Repair(dirtyVisited, radius, removedDirty))) return hr;
+	repairCount = repair.GetRepairCount();
+	ReopenOldLeafs(closedList, oldLeafs, tempLeafs);
+	return hr;
+}
+
+// removing previously identified leafs from closedList. they are going to be leafs again along with the new ones.
+void EvcSolver::ReopenOldLeafs(NAEdgeMap * closedList, std::shared_ptr<NAEdgeContainer> oldLeafs, std::shared_ptr<NAEdgeContainer> tempLeafs) const
+{
+	NAEdgeIterator j;
 	for (j = oldLeafs->begin(); j != oldLeafs->end(); j++)
 	{
 		if ((j->second & 1) && closedList->Exist(j->first, esriNEDAlongDigitized))
@@ -685,11 +1199,11 @@ void EvcSolver::NonRecursiveMarkAndRemove(NAEdgePtr head, NAEdgeMap * closedList
 	}
 }
 
-HRESULT InsertLeafEdgeToHeap(INetworkQueryPtr ipNetworkQuery, std::shared_ptr<NAVertexCache> vcache, MyFibonacciHeap<NAEdgePtr, NAEdgePtrHasher, NAEdgePtrEqual> & heap, NAEdge * leaf)
+template <class EdgeHeap>
+HRESULT InsertLeafEdgeToHeap(std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, EdgeHeap & heap, NAEdge * leaf)
 {
 	HRESULT hr = S_OK;
-	INetworkElementPtr fe, te;
-	INetworkJunctionPtr f, t;
+	long f = -1, t = -1;
 
 	// if it does not have a previous, then it's not a leaf ... it's a destination edge and it will be added to the heap at 'PrepareVerticesForHeap'
 	if (leaf->TreePrevious)
@@ -698,15 +1212,14 @@ HRESULT InsertLeafEdgeToHeap(INetworkQueryPtr ipNetworkQuery, std::shared_ptr<NA
 		_ASSERT(leaf->GetCleanCost() > 0.0);
 		_ASSERT(leaf->GetDirtyState() == EdgeDirtyState::CleanState);
 
-		if (FAILED(hr = ipNetworkQuery->CreateNetworkElement(esriNETJunction, &fe))) return hr;
-		if (FAILED(hr = ipNetworkQuery->CreateNetworkElement(esriNETJunction, &te))) return hr;
-		f = fe; t = te;
-		if (FAILED(hr = leaf->NetEdge->QueryJunctions(f, t))) return hr;
-		NAVertexPtr fPtr = vcache->New(f);
+		if (FAILED(hr = ecache->QueryJunction(leaf, QueryDirection::Backward, f))) return hr;
+		if (FAILED(hr = ecache->QueryJunction(leaf, QueryDirection::Forward, t))) return hr;
+		NAVertexPtr fPtr = vcache->New(f, ecache->GetJunctionQuery());
 		NAVertexPtr tPtr = vcache->Get(t);
+		if (!fPtr || !tPtr) return E_FAIL;
 
 		fPtr->SetBehindEdge(leaf);
-		fPtr->GVal = tPtr->GetH(leaf->TreePrevious->EID) + leaf->GetCleanCost();
+		fPtr->GVal = tPtr->GetH(leaf->TreePrevious) + leaf->GetCleanCost();
 		fPtr->Previous = nullptr;
 		_ASSERT(fPtr->GVal < CASPER_INFINITY);
 		heap.Insert(leaf);
@@ -714,7 +1227,8 @@ HRESULT InsertLeafEdgeToHeap(INetworkQueryPtr ipNetworkQuery, std::shared_ptr<NA
 	return hr;
 }
 
-HRESULT InsertLeafEdgesToHeap(INetworkQueryPtr ipNetworkQuery, std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, MyFibonacciHeap<NAEdgePtr, NAEdgePtrHasher, NAEdgePtrEqual> & heap,
+template <class EdgeHeap>
+HRESULT InsertLeafEdgesToHeap(std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, EdgeHeap & heap,
 								std::shared_ptr<NAEdgeContainer> leafs)
 {
 	HRESULT hr = S_OK;
@@ -725,37 +1239,34 @@ HRESULT InsertLeafEdgesToHeap(INetworkQueryPtr ipNetworkQuery, std::shared_ptr<N
 		if (i->second & 1)
 		{
 			leaf = ecache->Get(i->first, esriNEDAlongDigitized);
-			if (FAILED(hr = InsertLeafEdgeToHeap(ipNetworkQuery, vcache, heap, leaf))) return hr;
+			if (FAILED(hr = InsertLeafEdgeToHeap(vcache, ecache, heap, leaf))) return hr;
 		}
 		if (i->second & 2)
 		{
 			leaf = ecache->Get(i->first, esriNEDAgainstDigitized);
-			if (FAILED(hr = InsertLeafEdgeToHeap(ipNetworkQuery, vcache, heap, leaf))) return hr;
+			if (FAILED(hr = InsertLeafEdgeToHeap(vcache, ecache, heap, leaf))) return hr;
 		}
 	}
 	return hr;
 }
 
-HRESULT FindDirtyEdgesWithACleanParent(std::shared_ptr<NAEdgeCache> ecache, std::shared_ptr<NAVertexCache> vcache, INetworkQueryPtr ipNetworkQuery, std::shared_ptr<NAEdgeMapTwoGen> closedList,
+HRESULT FindDirtyEdgesWithACleanParent(std::shared_ptr<NAEdgeCache> ecache, std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeMapTwoGen> closedList,
 	std::shared_ptr<NAEdgeContainer> Leafs, std::vector<NAEdgePtr> & removedDirty)
 {
 	HRESULT hr = S_OK;
 	NAVertexPtr toVertex = nullptr;
 	ArrayList<NAEdgePtr> * adj = nullptr;
 	double betterH, tempH;
-	INetworkElementPtr te;
 	NAEdgePtr betterParent = nullptr;
-
-	if (FAILED(hr = ipNetworkQuery->CreateNetworkElement(esriNETJunction, &te))) return hr;
-	INetworkJunctionPtr t = te;
+	long t = -1;
 
 	for (const auto e : removedDirty)
 	{
 		betterParent = nullptr;
 		betterH = CASPER_INFINITY;
 
-		if (FAILED(hr = e->NetEdge->QueryJunctions(nullptr, t))) return hr;
-		toVertex = vcache->New(t, ipNetworkQuery);
+		if (FAILED(hr = ecache->QueryJunction(e, QueryDirection::Forward, t))) return hr;
+		if (!(toVertex = vcache->New(t, ecache->GetJunctionQuery()))) return E_FAIL;
 		if (FAILED(hr = ecache->QueryAdjacencies(toVertex, e, QueryDirection::Forward, &adj))) return hr;
 
 		// Loop through all adjacent edges and update their cost value
@@ -765,7 +1276,7 @@ HRESULT FindDirtyEdgesWithACleanParent(std::shared_ptr<NAEdgeCache> ecache, std:
 			// it has to have a previous otherwise it cannot be a leaf
 			if (tempEdge->TreePrevious && closedList->Exist(tempEdge, NAEdgeMapGeneration::OldGen))
 			{
-				tempH = toVertex->GetH(tempEdge->EID);
+				tempH = toVertex->GetH(tempEdge);
 				if (!betterParent || tempH < betterH) { betterParent = tempEdge; betterH = tempH; }
 			}
 		}
@@ -805,7 +1316,7 @@ HRESULT PrepareVerticesForHeap(NAVertexPtr point, std::shared_ptr<NAVertexCache>
 			edgeCost = edge->GetCost(pop, solverMethod, &globalDeltaPenalty) /* / edge->OriginalCost*/;
 			if (edgeCost >= CASPER_INFINITY) temp->GVal = CASPER_INFINITY;
 			else temp->GVal = point->GVal * edgeCost;
-			temp->GlobalPenaltyCost = edge->MaxAddedCostOnReservedPathsWithNewFlow(globalDeltaPenalty, MaxEvacueeCostSoFar, temp->GVal + temp->GetMinHOrZero(), selfishRatio);
+			temp->GlobalPenaltyCost = edge->MaxAddedCostOnReservedPathsWithNewFlow(globalDeltaPenalty, MaxEvacueeCostSoFar, temp->GVal + temp->GetCARMAHOrZero(), selfishRatio);
 			readyEdges.push_back(edge);
 		}
 		else _ASSERT(false);
@@ -823,7 +1334,7 @@ HRESULT PrepareVerticesForHeap(NAVertexPtr point, std::shared_ptr<NAVertexCache>
 			edgeCost = edge->GetCost(pop, solverMethod, &globalDeltaPenalty) /* / edge->OriginalCost*/;
 			if (edgeCost >= CASPER_INFINITY) temp->GVal = CASPER_INFINITY;
 			else temp->GVal = point->GVal * edgeCost;
-			temp->GlobalPenaltyCost = edge->MaxAddedCostOnReservedPathsWithNewFlow(globalDeltaPenalty, MaxEvacueeCostSoFar, temp->GVal + temp->GetMinHOrZero(), selfishRatio);
+			temp->GlobalPenaltyCost = edge->MaxAddedCostOnReservedPathsWithNewFlow(globalDeltaPenalty, MaxEvacueeCostSoFar, temp->GVal + temp->GetCARMAHOrZero(), selfishRatio);
 			readyEdges.push_back(edge);
 		}
 	}
@@ -866,12 +1377,12 @@ bool EvcSolver::GeneratePath(SafeZonePtr BetterSafeZone, NAVertexPtr finalVertex
 		if (BetterSafeZone->getBehindEdge())
 		{
 			edgePortion = BetterSafeZone->getPositionAlong();
-			if (edgePortion > 0.0) path->AddSegment(solverMethod, new DEBUG_NEW_PLACEMENT PathSegment(BetterSafeZone->getBehindEdge(), 0.0, edgePortion));
+			if (edgePortion > 0.0) path->AddSegment(solverMethod, BetterSafeZone->getBehindEdge(), 0.0, edgePortion);
 		}
 
 		while (finalVertex->Previous)
 		{
-			if (finalVertex->GetBehindEdge()) path->AddSegment(solverMethod, new DEBUG_NEW_PLACEMENT PathSegment(finalVertex->GetBehindEdge()));
+			if (finalVertex->GetBehindEdge()) path->AddSegment(solverMethod, finalVertex->GetBehindEdge());
 			finalVertex = finalVertex->Previous;
 		}
 
@@ -895,7 +1406,7 @@ bool EvcSolver::GeneratePath(SafeZonePtr BetterSafeZone, NAVertexPtr finalVertex
 			}
 			else if (edgePortion > 0.0)
 			{
-				path->AddSegment(solverMethod, new DEBUG_NEW_PLACEMENT PathSegment(finalVertex->GetBehindEdge(), 1.0 - edgePortion, 1.0));
+				path->AddSegment(solverMethod, finalVertex->GetBehindEdge(), 1.0 - edgePortion, 1.0);
 			}
 		}
 		if (path->empty())
@@ -906,6 +1417,7 @@ bool EvcSolver::GeneratePath(SafeZonePtr BetterSafeZone, NAVertexPtr finalVertex
 		else
 		{
 			path->shrink_to_fit();
+			path->CommitReserveCost();
 			currentEvacuee->Paths->push_front(path);
 			BetterSafeZone->Reserve(path->GetRoutedPop());
 		}
@@ -917,6 +1429,50 @@ bool EvcSolver::GeneratePath(SafeZonePtr BetterSafeZone, NAVertexPtr finalVertex
 	return path != nullptr;
 }
 
+// Same as 'GeneratePath' but the route is a list of snapshot edges from one of the evacuee vertices to the safe zone
+// junction instead of a chain of search labels. Segments are still added from the safe zone back to the evacuee.
+bool EvcSolver::GenerateRoutePath(const NAHierarchyRoute & route, SafeZonePtr BetterSafeZone, NAVertexPtr startVertex, NAGraphSnapshotPtr graph, std::shared_ptr<NAEdgeCache> ecache,
+	double & populationLeft, int & pathGenerationCount, EvacueePtr currentEvacuee, double population2Route) const
+{
+	double edgePortion;
+	EvcPath * path = nullptr;
+	PathSegmentPtr lastAdded = nullptr;
+
+	// the capacity check of 'GeneratePath' always ends up routing everything that is left for CCRP
+	if (this->solverMethod == EvcSolverMethod::CCRPSolver) population2Route = populationLeft;
+	populationLeft -= population2Route;
+	path = new DEBUG_NEW_PLACEMENT EvcPath(initDelayCostPerPop, population2Route, ++pathGenerationCount, currentEvacuee, BetterSafeZone);
+
+	if (BetterSafeZone->getBehindEdge())
+	{
+		edgePortion = BetterSafeZone->getPositionAlong();
+		if (edgePortion > 0.0) path->AddSegment(solverMethod, BetterSafeZone->getBehindEdge(), 0.0, edgePortion);
+	}
+	for (auto e = route.Edges.rbegin(); e != route.Edges.rend(); ++e)
+		path->AddSegment(solverMethod, ecache->New(graph->GetEID(*e), (esriNetworkEdgeDirection)graph->GetDirection(*e)));
+	if (startVertex->GetBehindEdge())
+	{
+		edgePortion = startVertex->GVal;
+		lastAdded = path->empty() ? nullptr : path->front();
+		if (lastAdded && NAEdge::IsEqualNAEdgePtr(lastAdded->Edge, startVertex->GetBehindEdge())) lastAdded->SetFromRatio(1.0 - edgePortion);
+		else if (edgePortion > 0.0) path->AddSegment(solverMethod, startVertex->GetBehindEdge(), 1.0 - edgePortion, 1.0);
+	}
+
+	if (path->empty())
+	{
+		delete path;
+		path = nullptr;
+	}
+	else
+	{
+		path->shrink_to_fit();
+		path->CommitReserveCost();
+		currentEvacuee->Paths->push_front(path);
+		BetterSafeZone->Reserve(path->GetRoutedPop());
+	}
+	return path != nullptr;
+}
+
 // This is where i figure out what is the smallest population that I should route (or try to route)
 // at each CASPER loop. Obviously this globalMinPop2Route has to be less than the population of any evacuee point.
 // Also CASPER and CARMA should be in sync at this number otherwise all the h values are useless.
@@ -1004,7 +1560,7 @@ HRESULT PrepareUnvisitedVertexForHeap(INetworkJunctionPtr junction, NAEdgePtr ed
 
 			// at this point if the new tempEdge satisfied all restrictions and conditions it means it might be a good pick
 			// as a previous edge depending on the cost which we shall obtain from vertices heuristic table
-			tempH = tempVertex->GetH(tempEdge->EID);
+			tempH = tempVertex->GetH(tempEdge);
 			if (tempH < betterH) { betterEdge = tempEdge; betterH = tempH; }
 		}
 	}
@@ -1013,12 +1569,12 @@ HRESULT PrepareUnvisitedVertexForHeap(INetworkJunctionPtr junction, NAEdgePtr ed
 		#ifdef DEBUG
 		if (!checkOldClosedlist)
 		{
-			double CostToBeat = edge->ToVertex->GetH(edge->EID);
+			double CostToBeat = edge->ToVertex->GetH(edge);
 			_ASSERT(CostToBeat - betterH - edgeCost < FLT_EPSILON);
 		}
 		#endif
 
-		betterMyVertex = vcache->New(myVertex->Junction, ipNetworkQuery);
+		betterMyVertex = vcache->New(myVertex->EID, ecache->GetJunctionQuery());
 		betterMyVertex->SetBehindEdge(betterEdge);
 		betterMyVertex->Previous = nullptr;
 		betterMyVertex->GVal = betterH;
@@ -1032,3 +1588,18 @@ HRESULT PrepareUnvisitedVertexForHeap(INetworkJunctionPtr junction, NAEdgePtr ed
 
 	return hr;
 }
+
+// SolveMethod is called from the Solve translation unit so every heap it can be driven by has to be instantiated here.
+// Each one brings along the search loops of all the traffic models.
+#define INSTANTIATE_SOLVEMETHOD(EdgeHeap) \
+	template HRESULT EvcSolver::SolveMethod<EdgeHeap>(INetworkQueryPtr, IGPMessages *, ITrackCancel *, IStepProgressorPtr, std::shared_ptr<EvacueeList>, std::shared_ptr<NAVertexCache>, \
+		std::shared_ptr<NAEdgeCache>, std::shared_ptr<SafeZoneTable>, double &, std::vector<unsigned int> &, INetworkDatasetPtr, unsigned int &, std::vector<double> &, std::vector<size_t> &, \
+		std::shared_ptr<DynamicDisaster>);
+
+INSTANTIATE_SOLVEMETHOD(NAEdgeBinaryHeap)
+INSTANTIATE_SOLVEMETHOD(NAEdgeQuadHeap)
+INSTANTIATE_SOLVEMETHOD(NAEdgePairingHeap)
+INSTANTIATE_SOLVEMETHOD(NAEdgeFibonacciHeap)
+#ifdef HEAPTRACE
+INSTANTIATE_SOLVEMETHOD(NAEdgeTracedHeap)
+#endif
@@ -53,42 +53,6 @@ STDMETHODIMP EvcSolver::Solve(INAContext* pNAContext, IGPMessages* pMessages, IT
 	OutputDebugStringW(emptyPtr1 == emptyPtr2 && emptyPtr2 == emptyPtr1 ? L"c++11 pointer test pass\n" : L"c++11 pointer test fail\n");
 	_ASSERT_EXPR(emptyPtr1 == emptyPtr2 && emptyPtr2 == emptyPtr1, L"c++11 pointer test fail");
 
-	// heap validity test case
-	{
-		struct HeapNode
-		{
-			size_t value;
-			double key;
-			HeapNode(size_t _value = 0, double _key = 0.0) : value(_value), key(_key) { }
-			operator double() const { return key; }
-			bool operator==(const HeapNode & right) const { return value == right.value; }
-			struct HeapNodeHasher : public std::unary_function<HeapNode, size_t> { size_t operator()(const HeapNode & e) const { return e.value; } };
-		};
-
-		MyFibonacciHeap<HeapNode, HeapNode::HeapNodeHasher> testHeap;
-		srand(unsigned int(time(0)));
-		HeapNode data[10000];
-		HeapNode min1, min2;
-
-		for (size_t i = 0; i < 10000; ++i) data[i] = HeapNode(i, rand());
-		for (size_t i = 0; i < 5000; ++i) testHeap.Insert(data[i]);
-		for (size_t i = 0; i < 5000; i += 20)
-		{
-			data[i].key -= 100;
-			testHeap.UpdateKey(data[i]);
-		}
-		for (size_t i = 5000; i < 10000; ++i) testHeap.Insert(data[i]);
-		min1 = testHeap.DeleteMin();
-		bool minHeapTestPass = true;
-		while (!testHeap.empty())
-		{
-			min2 = testHeap.DeleteMin();
-			_ASSERT_EXPR(min1.key <= min2.key, L"Heap property violation");
-			minHeapTestPass &= min1.key <= min2.key;
-			min1 = min2;
-		}
-		OutputDebugStringW(minHeapTestPass ? L"heap property test pass\n" : L"heap property test fail\n");
-	}
 	#endif
 
 	HRESULT hr = S_OK;
@@ -124,6 +88,8 @@ STDMETHODIMP EvcSolver::Solve(INAContext* pNAContext, IGPMessages* pMessages, IT
 	if (!ipNetworkDataset) return ATL::AtlReportError(this->GetObjectCLSID(), _T("Context does not have a valid network dataset."), IID_INASolver);
 	if (FAILED(hr = ipNetworkDataset->get_State(&dnState))) return hr;
 	if (dnState != esriNetworkDatasetState::esriNDSBuilt)  return ATL::AtlReportError(this->GetObjectCLSID(), _T("Network dataset is not built or it's empty."), IID_INASolver);
+	if (trafficModel == EvcTrafficModel::TABLEModel && speedDensityTable.IsEmpty())
+		return ATL::AtlReportError(this->GetObjectCLSID(), _T("The TABLE traffic model needs a speed-density table."), IID_INASolver);
 
 	// NOTE: this is also a good place to perform any additional necessary validation, such as
 	// synchronizing the attribute names set on your solver with those of the context's network dataset
@@ -232,6 +198,30 @@ STDMETHODIMP EvcSolver::Solve(INAContext* pNAContext, IGPMessages* pMessages, IT
 		}
 	}
 
+	// A read-only CSR snapshot of the network lets the edge cache answer adjacency queries without COM calls.
+	// The snapshot has no notion of turns, partial edge barriers, or backtrack policies so we only build it when none of them are in play.
+	long barrierCount = 0, sourceCount = 0;
+	bool hasTurnSource = false;
+	NAGraphSnapshotPtr graph = nullptr;
+	INetworkDataset2Ptr ipNetworkDataset2(ipNetworkDataset);
+	INetworkSourcePtr ipNetworkSource = nullptr;
+	esriNetworkElementType sourceElementType;
+
+	if (ipBarriersTable) { if (FAILED(hr = ipBarriersTable->RowCount(nullptr, &barrierCount))) return hr; }
+	if (FAILED(hr = ipNetworkDataset2->get_SourceCount(&sourceCount))) return hr;
+	for (long i = 0; i < sourceCount && !hasTurnSource; ++i)
+	{
+		if (FAILED(hr = ipNetworkDataset2->get_Source(i, &ipNetworkSource))) return hr;
+		if (FAILED(hr = ipNetworkSource->get_ElementType(&sourceElementType))) return hr;
+		hasTurnSource = sourceElementType == esriNETTurn;
+	}
+	if (backtrack == esriNFSBAllowBacktrack && barrierCount == 0 && !hasTurnSource)
+	{
+		if (ipStepProgressor) ipStepProgressor->put_Message(ATL::CComBSTR(L"Building network snapshot"));
+		graph = NAGraphSnapshotPtr(new DEBUG_NEW_PLACEMENT NAGraphSnapshot());
+		if (FAILED(hr = BuildGraphSnapshot(*graph, ipNetworkQuery, ipForwardStar, capAttributeID, costAttributeID))) return hr;
+	}
+
 	// Get the "Evacuee Points" NAClass table (we need the NALocation objects from
 	// this NAClass as the starting points for Forward Star traversals)
 	ITablePtr ipEvacueePointsTable;
@@ -261,8 +251,9 @@ STDMETHODIMP EvcSolver::Solve(INAContext* pNAContext, IGPMessages* pMessages, IT
 	// can maintain one-to-one relationship between network junctions and vertices.
 	// This will particularly be helpful with the heuristic calculator part of the algorithm.
 	auto ecache = std::shared_ptr<NAEdgeCache>(new DEBUG_NEW_PLACEMENT NAEdgeCache(capAttributeID, costAttributeID, SaturationPerCap, CriticalDensPerCap, twoWayShareCapacity == VARIANT_TRUE,
-		                                                                           initDelayCostPerPop, trafficModel, ipForwardStar, ipBackwardStar, ipNetworkQuery, hr));
+		                                                                           initDelayCostPerPop, trafficModel, speedDensityTable, ipForwardStar, ipBackwardStar, ipNetworkQuery, hr));
 	if (FAILED(hr)) return hr;
+	ecache->SetGraphSnapshot(graph);
 
 	// since some vertices inside the cache will point to edges, it's safer to create this object last so that it gets destroyed (pop out of function stack) before ecache
 	auto vcache = std::shared_ptr<NAVertexCache>(new DEBUG_NEW_PLACEMENT NAVertexCache());
@@ -556,6 +547,52 @@ STDMETHODIMP EvcSolver::Solve(INAContext* pNAContext, IGPMessages* pMessages, IT
 
 	Evacuees->FinilizeGroupings(5.0 * costPerSec, disasterTable->GetDynamicMode()); // five seconds diameter for clustering
 
+	// The landmark lower bounds come from free-flow searches on the snapshot. Dynamic changes can make an edge cheaper
+	// than its free-flow cost so the bounds are only used on a static network.
+	NALandmarkTablePtr landmarks = nullptr;
+	bool landmarksLoaded = false;
+	if (altLandmarks == VARIANT_TRUE && graph && disasterTable->GetDynamicMode() == DynamicMode::Disabled)
+	{
+		if (ipStepProgressor) ipStepProgressor->put_Message(ATL::CComBSTR(L"Loading landmarks"));
+		if (FAILED(hr = LoadLandmarks(ipNetworkDataset, costAttrib, graph, landmarks, landmarksLoaded))) return hr;
+		std::vector<long> zoneJunctions;
+		zoneJunctions.reserve(safeZoneList->size());
+		for (const auto & z : *safeZoneList) zoneJunctions.push_back(z.first);
+		landmarks->SetTargets(zoneJunctions);
+		vcache->SetLandmarks(landmarks);
+	}
+
+	// The hierarchy answers the SP solver as long as every route cost is a plain sum of free-flow snapshot costs. Safe zone
+	// density costs and dynamic changes both depend on what happened earlier in the solve so they need the regular search.
+	NAContractionHierarchyPtr hierarchy = nullptr;
+	bool hierarchyLoaded = false;
+	if (hierarchySP == VARIANT_TRUE && solverMethod == EvcSolverMethod::SPSolver && graph && disasterTable->GetDynamicMode() == DynamicMode::Disabled && costPerDensity <= 0.0)
+	{
+		if (ipStepProgressor) ipStepProgressor->put_Message(ATL::CComBSTR(L"Loading contraction hierarchy"));
+		if (FAILED(hr = LoadHierarchy(ipNetworkDataset, costAttrib, graph, hierarchy, hierarchyLoaded))) return hr;
+	}
+
+	// The overlay cliques hold plain sums of edge costs. The selfish penalty of an edge depends on the path that reached it
+	// and dynamic changes swap edges in and out of the snapshot so both of them need the regular search.
+	NACellOverlayPtr overlay = nullptr;
+	if (cellOverlay == VARIANT_TRUE && !hierarchy && graph && disasterTable->GetDynamicMode() == DynamicMode::Disabled && selfishRatio <= 0.0)
+	{
+		if (ipStepProgressor) ipStepProgressor->put_Message(ATL::CComBSTR(L"Building partition overlay"));
+		overlay = NACellOverlayPtr(new DEBUG_NEW_PLACEMENT NACellOverlay(graph));
+		ecache->SetCellOverlay(overlay);
+	}
+
+	// The bidirectional search needs the same conditions as the overlay and the overlay wins if both are enabled
+	NABidirectionalSearchPtr bidirectional = nullptr;
+	if (bidirectionalSearch == VARIANT_TRUE && !hierarchy && !overlay && graph && disasterTable->GetDynamicMode() == DynamicMode::Disabled && selfishRatio <= 0.0)
+	{
+		bidirectional = NABidirectionalSearchPtr(new DEBUG_NEW_PLACEMENT NABidirectionalSearch(graph));
+		ecache->SetBidirectionalSearch(bidirectional);
+	}
+
+	// the parallel CARMA tree keeps its worker threads for the whole solve
+	if (carmaThreadCount != 1 && ecache->HasGraphSnapshot()) ecache->SetParallelSPT(ParallelBackwardSPTPtr(new DEBUG_NEW_PLACEMENT ParallelBackwardSPT(graph, (unsigned int)carmaThreadCount)));
+
 	// timing
 	c = GetProcessTimes(GetCurrentProcess(), &createTime, &exitTime, &sysTimeE, &cpuTimeE);
 	tenNanoSec64 = (*((__int64 *) &sysTimeE)) - (*((__int64 *) &sysTimeS));
@@ -565,14 +602,29 @@ STDMETHODIMP EvcSolver::Solve(INAContext* pNAContext, IGPMessages* pMessages, IT
 	c = GetProcessTimes(GetCurrentProcess(), &createTime, &exitTime, &sysTimeS, &cpuTimeS);
 
 	if (ipStepProgressor) if (FAILED(hr = ipStepProgressor->Show())) return hr;
-	std::vector<unsigned int> CARMAExtractCounts;
+	std::vector<unsigned int> CARMAExtractCounts, CARMARepairCounts;
 
 	//******************************************************************************************/
 	// this will call the core part of the algorithm.
 	hr = S_OK;
 	UpdatePeakMemoryUsage();
-	if (FAILED(hr = SolveMethod(ipNetworkQuery, pMessages, pTrackCancel, ipStepProgressor, Evacuees, vcache, ecache, safeZoneList, carmaSec, CARMAExtractCounts,
-		ipNetworkDataset, EvacueesWithRestrictedSafezone, GlobalEvcCostAtIteration, EffectiveIterationCount, disasterTable))) return hr;
+	// the 4-ary indexed heap is the default queue for both the CASPER search and CARMA
+	if (hierarchy)
+	{
+		if (FAILED(hr = HierarchySolveMethod(ipStepProgressor, pTrackCancel, Evacuees, safeZoneList, graph, ecache, hierarchy, EvacueesWithRestrictedSafezone, GlobalEvcCostAtIteration))) return hr;
+	}
+	else
+	{
+		#ifdef HEAPTRACE
+		HeapTraceRecorder heapTrace("c:\\evcsolver.heap");
+		HeapTraceRecorder::Active() = &heapTrace;
+		if (FAILED(hr = SolveMethod<NAEdgeTracedHeap>(ipNetworkQuery, pMessages, pTrackCancel, ipStepProgressor, Evacuees, vcache, ecache, safeZoneList, carmaSec, CARMAExtractCounts,
+			CARMARepairCounts, ipNetworkDataset, EvacueesWithRestrictedSafezone, GlobalEvcCostAtIteration, EffectiveIterationCount, disasterTable))) return hr;
+		#else
+		if (FAILED(hr = SolveMethod<NAEdgeQuadHeap>(ipNetworkQuery, pMessages, pTrackCancel, ipStepProgressor, Evacuees, vcache, ecache, safeZoneList, carmaSec, CARMAExtractCounts,
+			CARMARepairCounts, ipNetworkDataset, EvacueesWithRestrictedSafezone, GlobalEvcCostAtIteration, EffectiveIterationCount, disasterTable))) return hr;
+		#endif
+	}
 
 	// timing
 	c = GetProcessTimes(GetCurrentProcess(), &createTime, &exitTime, &sysTimeE, &cpuTimeE);
@@ -967,12 +1019,15 @@ STDMETHODIMP EvcSolver::Solve(INAContext* pNAContext, IGPMessages* pMessages, IT
 
 	//******************************************************************************************/
 	// Close it and clean it
-	ATL::CString performanceMsg, CARMALoopMsg, ZeroHurMsg, CARMAExtractsMsg, CacheHitMsg, initMsg, iterationMsg1, iterationMsg2;
+	ATL::CString performanceMsg, CARMALoopMsg, ZeroHurMsg, CARMAExtractsMsg, CARMARepairsMsg, CacheHitMsg, initMsg, iterationMsg1, iterationMsg2, allocationMsg, landmarksMsg, hierarchyMsg, overlayMsg, bidirectionalMsg;
 	size_t mem = (peakMemoryUsage - baseMemoryUsage) / 1048576;
 
 	initMsg.Format(_T("%s(%s) version %s. %d routes are generated from the evacuee points. %d evacuee(s) were unreachable."), PROJ_NAME, PROJ_ARCH, _T(GIT_DESCRIBE), tempPathList.size(), StuckEvacuee);
 	CARMALoopMsg.Format(_T("The algorithm performed %d CARMA loop(s) in %.2f seconds. Peak memory usage (exclude flocking) was %d MB."), CARMAExtractCounts.size(), carmaSec, max(0, mem));
 	CacheHitMsg.Format(_T("Traffic model calculation had %.2f%% cache hit."), ecache->GetCacheHitPercentage());
+	allocationMsg.Format(_T("Slab allocations: %d edges, %d edge reservations, %d neighbor lists, and %d path segments (at most %d alive). Slabs took %d KB."),
+		ecache->EdgeAllocationCount(), ecache->ReservationAllocationCount(), ecache->NeighborAllocationCount(), Evacuees->SegmentAllocationCount(), Evacuees->SegmentPeakLiveCount(),
+		(ecache->SlabBytes() + Evacuees->SegmentSlabBytes()) / 1024);
 
 	performanceMsg.Format(_T("Timing: Input = %.2f (kernel), %.2f (user); Calculation = %.2f (kernel), %.2f (user); Output = %.2f (kernel), %.2f (user); Flocking = %.2f (kernel), %.2f (user); Total = %.2f"),
 		inputSecSys, inputSecCpu, calcSecSys, calcSecCpu, outputSecSys, outputSecCpu, flockSecSys, flockSecCpu,
@@ -990,6 +1045,39 @@ STDMETHODIMP EvcSolver::Solve(INAContext* pNAContext, IGPMessages* pMessages, IT
 		}
 		CARMAExtractsMsg.Append(ATL::CString(ss.str().c_str()));
 	}
+	if (lifelongCARMA == VARIANT_TRUE && CARMARepairCounts.size() > 0)
+	{
+		ss.str("");
+		CARMARepairsMsg.Format(_T("The following is the number of lifelong CARMA tree repairs in each loop: "));
+		for (std::vector<unsigned int>::size_type i = 0; i < CARMARepairCounts.size(); ++i)
+		{
+			if (i == 0) ss << CARMARepairCounts[0];
+			else        ss << " | " << CARMARepairCounts[i];
+		}
+		CARMARepairsMsg.Append(ATL::CString(ss.str().c_str()));
+	}
+	if (landmarks && !landmarks->IsEmpty())
+	{
+		landmarksMsg.Format(_T("The ALT heuristic used %d landmarks (%s). Landmark tables took %d KB."), landmarks->GetLandmarkCount(),
+			landmarksLoaded ? _T("loaded from the disk cache") : _T("computed for this network"), landmarks->MemoryUsage() / 1024);
+	}
+	if (hierarchy && !hierarchy->IsEmpty())
+	{
+		hierarchyMsg.Format(_T("The SP routes came from a contraction hierarchy with %d shortcuts (%s). The hierarchy took %d KB."), hierarchy->GetShortcutCount(),
+			hierarchyLoaded ? _T("loaded from the disk cache") : _T("computed for this network"), hierarchy->MemoryUsage() / 1024);
+	}
+	if (overlay && overlay->GetQueryCount() > 0)
+	{
+		overlayMsg.Format(_T("The partition overlay has %d cells and %d boundary junctions. It answered %d searches with %.1f settled junctions on average and customized %d cells. The overlay took %d KB."),
+			overlay->CellCount(), overlay->BoundaryCount(), overlay->GetQueryCount(), overlay->GetSettledCount() / (double)overlay->GetQueryCount(), overlay->GetCustomizedCells(),
+			overlay->MemoryUsage() / 1024);
+	}
+	if (bidirectional && bidirectional->GetQueryCount() > 0)
+	{
+		bidirectionalMsg.Format(_T("The bidirectional search answered %d searches. On average it scanned %.1f edges from the evacuees and %.1f edges from the safe zones. The search labels took %d KB."),
+			bidirectional->GetQueryCount(), bidirectional->GetForwardScanned() / (double)bidirectional->GetQueryCount(), bidirectional->GetBackwardScanned() / (double)bidirectional->GetQueryCount(),
+			bidirectional->MemoryUsage() / 1024);
+	}
 	if (GlobalEvcCostAtIteration.size() == 1)
 	{
 		iterationMsg1.Format(_T("The program ran for 1 pass. Evacuation cost at the end is: %.2f"), GlobalEvcCostAtIteration[0]);
@@ -1008,6 +1096,12 @@ STDMETHODIMP EvcSolver::Solve(INAContext* pNAContext, IGPMessages* pMessages, IT
 	pMessages->AddMessage(ATL::CComBSTR(performanceMsg));
 	pMessages->AddMessage(ATL::CComBSTR(CARMALoopMsg));
 	if (!CARMAExtractsMsg.IsEmpty()) pMessages->AddMessage(ATL::CComBSTR(CARMAExtractsMsg));
+	if (!CARMARepairsMsg.IsEmpty()) pMessages->AddMessage(ATL::CComBSTR(CARMARepairsMsg));
+	if (!landmarksMsg.IsEmpty()) pMessages->AddMessage(ATL::CComBSTR(landmarksMsg));
+	if (!hierarchyMsg.IsEmpty()) pMessages->AddMessage(ATL::CComBSTR(hierarchyMsg));
+	if (!overlayMsg.IsEmpty()) pMessages->AddMessage(ATL::CComBSTR(overlayMsg));
+	if (!bidirectionalMsg.IsEmpty()) pMessages->AddMessage(ATL::CComBSTR(bidirectionalMsg));
+	pMessages->AddMessage(ATL::CComBSTR(allocationMsg));
 	pMessages->AddMessage(ATL::CComBSTR(iterationMsg1));
 	if (!iterationMsg2.IsEmpty()) pMessages->AddMessage(ATL::CComBSTR(iterationMsg2));
 	if (ecache->GetCacheHitPercentage() < 80.0) pMessages->AddMessage(ATL::CComBSTR(CacheHitMsg));
@@ -1044,12 +1138,30 @@ STDMETHODIMP EvcSolver::Solve(INAContext* pNAContext, IGPMessages* pMessages, IT
 	if (Evacuees->IsSeperationDisabledForDynamicCASPER())
 		pMessages->AddWarning(ATL::CComBSTR(_T("You have enabled the dynamic CASPER mode and evacuee seperation feature. They are not compatible so evacuee seperation has been temporarily disabled.")));
 	
+	if (altLandmarks == VARIANT_TRUE && !landmarks)
+		pMessages->AddWarning(ATL::CComBSTR(_T("You have enabled the ALT landmark heuristic but it needs a network without barriers, turns, U-turn restrictions, or dynamic changes. It has been ignored.")));
+
+	if (hierarchySP == VARIANT_TRUE && solverMethod == EvcSolverMethod::SPSolver && !hierarchy)
+		pMessages->AddWarning(ATL::CComBSTR(_T("You have enabled the contraction hierarchy but it needs a network without barriers, turns, U-turn restrictions, dynamic changes, or safe zone density cost. It has been ignored.")));
+
+	if (cellOverlay == VARIANT_TRUE && !overlay && !hierarchy)
+		pMessages->AddWarning(ATL::CComBSTR(_T("You have enabled the partition overlay but it needs a network without barriers, turns, U-turn restrictions, dynamic changes, or a selfishness ratio. It has been ignored.")));
+
+	if (bidirectionalSearch == VARIANT_TRUE && !bidirectional && !overlay && !hierarchy)
+		pMessages->AddWarning(ATL::CComBSTR(_T("You have enabled the bidirectional search but it needs a network without barriers, turns, U-turn restrictions, dynamic changes, or a selfishness ratio. It has been ignored.")));
+
+	if (speculationWindow > 1 && !bidirectional)
+		pMessages->AddWarning(ATL::CComBSTR(_T("You have set a speculative window but only the bidirectional search routes evacuees concurrently. The evacuees have been routed one by one.")));
+
 	if (flagBadDynamicChangeSnapping)
 		pMessages->AddWarning(ATL::CComBSTR(_T("You have snapped some or all of DynamicChange polygons to vertices instead of edges and hence I cannot apply them properly. They have been ignored.")));
 
 	// since vertices inside the cache are still pointing to some edges it's safer to clean them first
 	vcache = nullptr;
 	ecache = nullptr;
+
+	// all path segments die with the evacuees and their slabs go back to the heap with the list
+	Evacuees = nullptr;
 	
 	return hr;
 }
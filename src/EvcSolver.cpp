@@ -223,6 +223,7 @@ STDMETHODIMP EvcSolver::CreateContext(IDENetworkDataset* pNetwork, BSTR contextN
 	CriticalDensPerCap = 10.0;
 	solverMethod = EvcSolverMethod::CASPERSolver;
 	trafficModel = EvcTrafficModel::POWERModel;
+	speedDensityTable.Parse(L"");
 	flockingProfile = FLOCK_PROFILE_CAR;
 
 	m_CreateTraversalResult = VARIANT_TRUE;
@@ -237,6 +238,12 @@ STDMETHODIMP EvcSolver::CreateContext(IDENetworkDataset* pNetwork, BSTR contextN
 	flockingEnabled = VARIANT_FALSE;
 	twoWayShareCapacity = VARIANT_TRUE;
 	ThreeGenCARMA = VARIANT_TRUE;
+	lifelongCARMA = VARIANT_FALSE;
+	altLandmarks = VARIANT_FALSE;
+	hierarchySP = VARIANT_FALSE;
+	cellOverlay = VARIANT_FALSE;
+	bidirectionalSearch = VARIANT_FALSE;
+	incrementalChunkSearch = VARIANT_FALSE;
 
 	flockingSnapInterval = 0.1f;
 	flockingSimulationInterval = 0.01;
@@ -244,6 +251,8 @@ STDMETHODIMP EvcSolver::CreateContext(IDENetworkDataset* pNetwork, BSTR contextN
 	CARMAPerformanceRatio = 0.1f;
 	selfishRatio = 0.0f;
 	iterateRatio = 0.6f;
+	carmaThreadCount = 1;
+	speculationWindow = 1;
 
 	backtrack = esriNFSBAllowBacktrack;
 	CarmaSortCriteria = CARMASort::BWCont;
@@ -375,10 +384,115 @@ STDMETHODIMP EvcSolver::Load(IStream* pStm)
 		CASPERDynamicMode = DynamicMode::Disabled;
 		savedVersion = 8;
 	}
+
+	//version 9
+	if (savedVersion >= 9)
+	{
+		if (FAILED(hr = pStm->Read(&carmaThreadCount, sizeof(carmaThreadCount), &numBytes))) return hr;
+	}
+	else
+	{
+		carmaThreadCount = 1;
+		savedVersion = 9;
+	}
+
+	//version 10
+	if (savedVersion >= 10)
+	{
+		if (FAILED(hr = pStm->Read(&incrementalChunkSearch, sizeof(incrementalChunkSearch), &numBytes))) return hr;
+	}
+	else
+	{
+		incrementalChunkSearch = VARIANT_FALSE;
+		savedVersion = 10;
+	}
+
+	//version 11
+	if (savedVersion >= 11)
+	{
+		unsigned long tableLength = 0;
+		if (FAILED(hr = pStm->Read(&tableLength, sizeof(tableLength), &numBytes))) return hr;
+		std::wstring tableText(tableLength, L'\0');
+		if (tableLength > 0 && FAILED(hr = pStm->Read(&tableText[0], tableLength * sizeof(wchar_t), &numBytes))) return hr;
+		if (!speedDensityTable.Parse(tableText)) speedDensityTable.Parse(L"");
+	}
+	else
+	{
+		speedDensityTable.Parse(L"");
+		savedVersion = 11;
+	}
+
+	//version 12
+	if (savedVersion >= 12)
+	{
+		if (FAILED(hr = pStm->Read(&lifelongCARMA, sizeof(lifelongCARMA), &numBytes))) return hr;
+	}
+	else
+	{
+		lifelongCARMA = VARIANT_FALSE;
+		savedVersion = 12;
+	}
+
+	//version 13
+	if (savedVersion >= 13)
+	{
+		if (FAILED(hr = pStm->Read(&altLandmarks, sizeof(altLandmarks), &numBytes))) return hr;
+	}
+	else
+	{
+		altLandmarks = VARIANT_FALSE;
+		savedVersion = 13;
+	}
+
+	//version 14
+	if (savedVersion >= 14)
+	{
+		if (FAILED(hr = pStm->Read(&hierarchySP, sizeof(hierarchySP), &numBytes))) return hr;
+	}
+	else
+	{
+		hierarchySP = VARIANT_FALSE;
+		savedVersion = 14;
+	}
+
+	//version 15
+	if (savedVersion >= 15)
+	{
+		if (FAILED(hr = pStm->Read(&cellOverlay, sizeof(cellOverlay), &numBytes))) return hr;
+	}
+	else
+	{
+		cellOverlay = VARIANT_FALSE;
+		savedVersion = 15;
+	}
+
+	//version 16
+	if (savedVersion >= 16)
+	{
+		if (FAILED(hr = pStm->Read(&bidirectionalSearch, sizeof(bidirectionalSearch), &numBytes))) return hr;
+	}
+	else
+	{
+		bidirectionalSearch = VARIANT_FALSE;
+		savedVersion = 16;
+	}
+
+	//version 17
+	if (savedVersion >= 17)
+	{
+		if (FAILED(hr = pStm->Read(&speculationWindow, sizeof(speculationWindow), &numBytes))) return hr;
+	}
+	else
+	{
+		speculationWindow = 1;
+		savedVersion = 17;
+	}
 	
 	CARMAPerformanceRatio = min(max(CARMAPerformanceRatio, 0.0f), 1.0f);
 	selfishRatio = min(max(selfishRatio, 0.0f), 1.0f);
 	iterateRatio = min(max(iterateRatio, 0.0f), 1.0f);
+	carmaThreadCount = min(max(carmaThreadCount, 0L), 256L);
+	speculationWindow = min(max(speculationWindow, 1L), 4096L);
 	m_bPersistDirty = false;
 
 	return S_OK;
@@ -423,6 +537,20 @@ STDMETHODIMP EvcSolver::Save(IStream* pStm, BOOL fClearDirty)
 	if (FAILED(hr = pStm->Write(&CarmaSortCriteria, sizeof(CarmaSortCriteria), &numBytes))) return hr;
 	if (FAILED(hr = pStm->Write(&iterateRatio, sizeof(iterateRatio), &numBytes))) return hr;
 	if (FAILED(hr = pStm->Write(&CASPERDynamicMode, sizeof(CASPERDynamicMode), &numBytes))) return hr;
+	if (FAILED(hr = pStm->Write(&carmaThreadCount, sizeof(carmaThreadCount), &numBytes))) return hr;
+	if (FAILED(hr = pStm->Write(&incrementalChunkSearch, sizeof(incrementalChunkSearch), &numBytes))) return hr;
+
+	// version 11: the speed-density table is saved as its text
+	const std::wstring & tableText = speedDensityTable.GetText();
+	unsigned long tableLength = (unsigned long)tableText.size();
+	if (FAILED(hr = pStm->Write(&tableLength, sizeof(tableLength), &numBytes))) return hr;
+	if (tableLength > 0 && FAILED(hr = pStm->Write(tableText.c_str(), tableLength * sizeof(wchar_t), &numBytes))) return hr;
+	if (FAILED(hr = pStm->Write(&lifelongCARMA, sizeof(lifelongCARMA), &numBytes))) return hr;
+	if (FAILED(hr = pStm->Write(&altLandmarks, sizeof(altLandmarks), &numBytes))) return hr;
+	if (FAILED(hr = pStm->Write(&hierarchySP, sizeof(hierarchySP), &numBytes))) return hr;
+	if (FAILED(hr = pStm->Write(&cellOverlay, sizeof(cellOverlay), &numBytes))) return hr;
+	if (FAILED(hr = pStm->Write(&bidirectionalSearch, sizeof(bidirectionalSearch), &numBytes))) return hr;
+	if (FAILED(hr = pStm->Write(&speculationWindow, sizeof(speculationWindow), &numBytes))) return hr;
 
 	return S_OK;
 }
@@ -1224,6 +1352,85 @@ HRESULT EvcSolver::LoadBarriers(ITable* pTable, INetworkQuery* pNetworkQuery, IN
 	return S_OK;
 }
 
+// Identifies the network and the cost attribute of the disk caches in the temp folder. The snapshot fingerprint is
+// checked on top of it to protect against a rebuilt network or a different set of restrictions under the same name.
+HRESULT EvcSolver::NetworkCacheKey(INetworkDatasetPtr ipNetworkDataset, INetworkAttributePtr costAttrib, std::wstring & cacheKey) const
+{
+	HRESULT hr = S_OK;
+	ATL::CComBSTR datasetName, workspacePath, costName;
+	IWorkspacePtr ipWorkspace;
+	IDatasetPtr ipDataset(ipNetworkDataset);
+	std::wstringstream key;
+
+	if (FAILED(hr = ipDataset->get_Name(&datasetName))) return hr;
+	if (FAILED(hr = ipDataset->get_Workspace(&ipWorkspace))) return hr;
+	if (FAILED(hr = ipWorkspace->get_PathName(&workspacePath))) return hr;
+	if (FAILED(hr = costAttrib->get_Name(&costName))) return hr;
+
+	if (workspacePath.Length() > 0) key << workspacePath.m_str;
+	key << L'|';
+	if (datasetName.Length() > 0) key << datasetName.m_str;
+	key << L'|';
+	if (costName.Length() > 0) key << costName.m_str;
+	cacheKey = key.str();
+	return hr;
+}
+
+// The landmark table only depends on the network and the cost attribute so it is kept in the temp folder between solves.
+// Not being able to write the cache file is not an error; the table is simply computed again next time.
+HRESULT EvcSolver::LoadLandmarks(INetworkDatasetPtr ipNetworkDataset, INetworkAttributePtr costAttrib, NAGraphSnapshotPtr graph, NALandmarkTablePtr & landmarks, bool & loaded) const
+{
+	HRESULT hr = S_OK;
+	wchar_t tempPath[MAX_PATH + 1];
+	std::wstring networkKey;
+	std::wstringstream key, file;
+	unsigned long long fingerprint = graph->Fingerprint();
+
+	if (FAILED(hr = NetworkCacheKey(ipNetworkDataset, costAttrib, networkKey))) return hr;
+	key << networkKey << L'|' << NALandmarkTable::DefaultLandmarkCount;
+
+	landmarks = NALandmarkTablePtr(new DEBUG_NEW_PLACEMENT NALandmarkTable());
+	loaded = false;
+	if (GetTempPathW(MAX_PATH + 1, tempPath) > 0)
+	{
+		file << tempPath << L"CASPER_ALT_" << std::hex << std::hash<std::wstring>()(key.str()) << L".bin";
+		loaded = landmarks->Load(file.str(), key.str(), fingerprint);
+	}
+	if (!loaded)
+	{
+		landmarks->Build(*graph, NALandmarkTable::DefaultLandmarkCount);
+		if (!file.str().empty()) landmarks->Save(file.str(), key.str(), fingerprint);
+	}
+	return hr;
+}
+
+// Same disk cache as the landmarks. The contraction takes much longer than a single SP solve so repeated scenarios
+// on the same network are meant to always hit the cache.
+HRESULT EvcSolver::LoadHierarchy(INetworkDatasetPtr ipNetworkDataset, INetworkAttributePtr costAttrib, NAGraphSnapshotPtr graph, NAContractionHierarchyPtr & hierarchy, bool & loaded) const
+{
+	HRESULT hr = S_OK;
+	wchar_t tempPath[MAX_PATH + 1];
+	std::wstring key;
+	std::wstringstream file;
+	unsigned long long fingerprint = graph->Fingerprint();
+
+	if (FAILED(hr = NetworkCacheKey(ipNetworkDataset, costAttrib, key))) return hr;
+
+	hierarchy = NAContractionHierarchyPtr(new DEBUG_NEW_PLACEMENT NAContractionHierarchy());
+	loaded = false;
+	if (GetTempPathW(MAX_PATH + 1, tempPath) > 0)
+	{
+		file << tempPath << L"CASPER_CH_" << std::hex << std::hash<std::wstring>()(key) << L".bin";
+		loaded = hierarchy->Load(file.str(), key, fingerprint);
+	}
+	if (!loaded)
+	{
+		hierarchy->Build(*graph);
+		if (!file.str().empty()) hierarchy->Save(file.str(), key, fingerprint);
+	}
+	return hr;
+}
+
 HRESULT EvcSolver::AddLocationFields(IFieldsEdit* pFieldsEdit, IDENetworkDataset* pDENDS)
 {
 	if (!pFieldsEdit) return E_POINTER;
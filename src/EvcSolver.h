@@ -28,7 +28,24 @@
 #include "NAVertex.h"
 #include "Flocking.h"
 #include "FibonacciHeap.h"
+#include "IndexedHeap.h"
+#include "HeapTrace.h"
+#include "ParallelSPT.h"
 #include "Dynamic.h"
+#include "ContractionHierarchy.h"
+
+// Priority queues that can drive SolveMethod and CARMALoop. The key functor is picked by each search.
+// The indexed heaps keep their handle in NAEdge::HeapHandle so an edge can only sit in one of them at a time.
+template <class Key> using NAEdgeBinaryHeap    = IndexedDAryHeap<NAEdgePtr, 2, Key, NAEdge::HeapHandleOf>;
+template <class Key> using NAEdgeQuadHeap      = IndexedDAryHeap<NAEdgePtr, 4, Key, NAEdge::HeapHandleOf>;
+template <class Key> using NAEdgePairingHeap   = IndexedPairingHeap<NAEdgePtr, Key, NAEdge::HeapHandleOf>;
+template <class Key> using NAEdgeFibonacciHeap = MyFibonacciHeap<NAEdgePtr, NAEdgePtrHasher, NAEdgePtrEqual, Key>;
+
+#ifdef HEAPTRACE
+// records the heap operations of every search to a binary file that can later be replayed with 'ReplayHeapTrace'
+struct NAEdgeTraceID { unsigned int operator()(const NAEdge * e) const { return (unsigned int)(e->EID * 2 + (e->Direction == esriNEDAgainstDigitized ? 1 : 0)); } };
+template <class Key> using NAEdgeTracedHeap = TracedHeap<NAEdgeQuadHeap<Key>, NAEdgePtr, Key, NAEdgeTraceID>;
+#endif
 
 #if defined(_WIN32_WCE) && !defined(_CE_DCOM) && !defined(_CE_ALLOW_SINGLE_THREADED_OBJECTS_IN_MTA)
 #error "Single-threaded COM objects are not properly supported on Windows CE platform, such as the Windows Mobile platforms that do not include full DCOM support. Define _CE_ALLOW_SINGLE_THREADED_OBJECTS_IN_MTA to force ATL to support creating single-thread COM object's and allow use of it's single-threaded COM object implementations. The threading model in your rgs file was set to 'Free' as that is the only threading model supported in non DCOM Windows CE platforms."
@@ -133,6 +150,44 @@ __interface IEvcSolver : IUnknown
 		HRESULT CostAttribute([out, retval] unsigned __int3264 * index);
 	[propget, helpstring("Lists impedance attributes from the network dataset")]
 		HRESULT CostAttributes([out] unsigned __int3264 & count, [out, retval] BSTR ** names);
+
+	/// new properties are only appended below this line so that the vtable slots of the older ones never move
+	[propput, helpstring("Sets the number of CARMA and iteration threads (1 is serial and 0 picks the core count)")]
+		HRESULT CARMAThreadCount([in] BSTR value);
+	[propget, helpstring("Gets the number of CARMA threads")]
+		HRESULT CARMAThreadCount([out, retval] BSTR * value);
+	[propput, helpstring("Sets the incremental search flag for population chunks of the same evacuee")]
+		HRESULT IncrementalChunkSearch([in] VARIANT_BOOL value);
+	[propget, helpstring("Gets the incremental search flag for population chunks of the same evacuee")]
+		HRESULT IncrementalChunkSearch([out, retval] VARIANT_BOOL * value);
+	[propput, helpstring("Sets the speed-density table of the TABLE traffic model")]
+		HRESULT SpeedDensityCurves([in] BSTR value);
+	[propget, helpstring("Gets the speed-density table of the TABLE traffic model")]
+		HRESULT SpeedDensityCurves([out, retval] BSTR * value);
+	[propput, helpstring("Sets the flag to repair the dynamic carma tree incrementally instead of removing its dirty branches")]
+		HRESULT LifelongCARMA([in] VARIANT_BOOL value);
+	[propget, helpstring("Gets the flag to repair the dynamic carma tree incrementally instead of removing its dirty branches")]
+		HRESULT LifelongCARMA([out, retval] VARIANT_BOOL * value);
+	[propput, helpstring("Sets the flag to tighten the search heuristic with precomputed ALT landmark lower bounds")]
+		HRESULT ALTLandmarks([in] VARIANT_BOOL value);
+	[propget, helpstring("Gets the flag to tighten the search heuristic with precomputed ALT landmark lower bounds")]
+		HRESULT ALTLandmarks([out, retval] VARIANT_BOOL * value);
+	[propput, helpstring("Sets the flag to answer the SP solver with a precomputed contraction hierarchy")]
+		HRESULT HierarchySP([in] VARIANT_BOOL value);
+	[propget, helpstring("Gets the flag to answer the SP solver with a precomputed contraction hierarchy")]
+		HRESULT HierarchySP([out, retval] VARIANT_BOOL * value);
+	[propput, helpstring("Sets the flag to run the per-evacuee search on a customizable partition overlay")]
+		HRESULT CellOverlay([in] VARIANT_BOOL value);
+	[propget, helpstring("Gets the flag to run the per-evacuee search on a customizable partition overlay")]
+		HRESULT CellOverlay([out, retval] VARIANT_BOOL * value);
+	[propput, helpstring("Sets the flag to run the per-evacuee search from both ends with a super-sink behind the safe zones")]
+		HRESULT BidirectionalSearch([in] VARIANT_BOOL value);
+	[propget, helpstring("Gets the flag to run the per-evacuee search from both ends with a super-sink behind the safe zones")]
+		HRESULT BidirectionalSearch([out, retval] VARIANT_BOOL * value);
+	[propput, helpstring("Sets the number of evacuees the bidirectional search routes concurrently before committing them in order (1 routes them one by one)")]
+		HRESULT SpeculationWindow([in] BSTR value);
+	[propget, helpstring("Gets the number of evacuees the bidirectional search routes concurrently")]
+		HRESULT SpeculationWindow([out, retval] BSTR * value);
 };
 
 // EvcSolver
@@ -157,7 +212,7 @@ public:
 	EvcSolver() :
 		  m_outputLineType(esriNAOutputLineTrueShape),
 		  m_bPersistDirty(false),
-		  c_version(8),
+		  c_version(17),
 		  c_featureRetrievalInterval(500)
 	  {
 	  }
@@ -188,6 +243,16 @@ public:
 	// IEvcSolver
 	STDMETHOD(put_ThreeGenCARMA)(VARIANT_BOOL threeGenCARMA);
 	STDMETHOD(get_ThreeGenCARMA)(VARIANT_BOOL* threeGenCARMA);
+	STDMETHOD(put_LifelongCARMA)(VARIANT_BOOL   value);
+	STDMETHOD(get_LifelongCARMA)(VARIANT_BOOL * value);
+	STDMETHOD(put_ALTLandmarks)(VARIANT_BOOL   value);
+	STDMETHOD(get_ALTLandmarks)(VARIANT_BOOL * value);
+	STDMETHOD(put_HierarchySP)(VARIANT_BOOL   value);
+	STDMETHOD(get_HierarchySP)(VARIANT_BOOL * value);
+	STDMETHOD(put_CellOverlay)(VARIANT_BOOL   value);
+	STDMETHOD(get_CellOverlay)(VARIANT_BOOL * value);
+	STDMETHOD(put_BidirectionalSearch)(VARIANT_BOOL   value);
+	STDMETHOD(get_BidirectionalSearch)(VARIANT_BOOL * value);
 	STDMETHOD(put_ExportEdgeStat)(VARIANT_BOOL   value);
 	STDMETHOD(get_ExportEdgeStat)(VARIANT_BOOL * value);
 	STDMETHOD(put_EvacueeGroupingOption)(EvacueeGrouping   value);
@@ -200,6 +265,8 @@ public:
 	STDMETHOD(get_CARMASortSetting)(CARMASort * value);
 	STDMETHOD(put_TrafficModel)(EvcTrafficModel   value);
 	STDMETHOD(get_TrafficModel)(EvcTrafficModel * value);
+	STDMETHOD(put_SpeedDensityCurves)(BSTR   value);
+	STDMETHOD(get_SpeedDensityCurves)(BSTR * value);
 	STDMETHOD(put_SaturationPerCap)(BSTR   value);
 	STDMETHOD(get_SaturationPerCap)(BSTR * value);
 	STDMETHOD(put_CriticalDensPerCap)(BSTR   value);
@@ -227,6 +294,12 @@ public:
 	STDMETHOD(get_SelfishRatio)(BSTR * value); 
 	STDMETHOD(put_IterativeRatio)(BSTR   value);
 	STDMETHOD(get_IterativeRatio)(BSTR * value);
+	STDMETHOD(put_CARMAThreadCount)(BSTR   value);
+	STDMETHOD(get_CARMAThreadCount)(BSTR * value);
+	STDMETHOD(put_SpeculationWindow)(BSTR   value);
+	STDMETHOD(get_SpeculationWindow)(BSTR * value);
+	STDMETHOD(put_IncrementalChunkSearch)(VARIANT_BOOL   value);
+	STDMETHOD(get_IncrementalChunkSearch)(VARIANT_BOOL * value);
 
 	/// replacement for ISolverSetting2 functionality until I found that bug
 	STDMETHOD(put_CostAttribute)(unsigned __int3264 index);
@@ -300,11 +373,24 @@ public:
 
 private:
 
+	template <template <class> class EdgeHeap>
 	HRESULT SolveMethod(INetworkQueryPtr, IGPMessages *, ITrackCancel *, IStepProgressorPtr, std::shared_ptr<EvacueeList>, std::shared_ptr<NAVertexCache>, std::shared_ptr<NAEdgeCache>,
-		    std::shared_ptr<SafeZoneTable>, double &, std::vector<unsigned int> &, INetworkDatasetPtr, unsigned int &, std::vector<double> &, std::vector<size_t> &, std::shared_ptr<DynamicDisaster>);
+		    std::shared_ptr<SafeZoneTable>, double &, std::vector<unsigned int> &, std::vector<unsigned int> &, INetworkDatasetPtr, unsigned int &, std::vector<double> &, std::vector<size_t> &,
+		    std::shared_ptr<DynamicDisaster>);
+	template <template <class> class EdgeHeap, class TrafficPolicy>
+	HRESULT SolveMethodWithModel(INetworkQueryPtr, IGPMessages *, ITrackCancel *, IStepProgressorPtr, std::shared_ptr<EvacueeList>, std::shared_ptr<NAVertexCache>, std::shared_ptr<NAEdgeCache>,
+		    std::shared_ptr<SafeZoneTable>, double &, std::vector<unsigned int> &, std::vector<unsigned int> &, INetworkDatasetPtr, unsigned int &, std::vector<double> &, std::vector<size_t> &,
+		    std::shared_ptr<DynamicDisaster>);
+	HRESULT HierarchySolveMethod(IStepProgressorPtr, ITrackCancel *, std::shared_ptr<EvacueeList>, std::shared_ptr<SafeZoneTable>, NAGraphSnapshotPtr, std::shared_ptr<NAEdgeCache>,
+		    NAContractionHierarchyPtr, unsigned int &, std::vector<double> &);
+	template <template <class> class EdgeHeap, class TrafficPolicy>
 	HRESULT CARMALoop(INetworkQueryPtr ipNetworkQuery, IStepProgressorPtr ipStepProgressor, IGPMessages* pMessages, ITrackCancel* pTrackCancel, std::shared_ptr<EvacueeList> Evacuees, CARMASort RevisedCarmaSortCriteria,
 		    std::shared_ptr<std::vector<EvacueePtr>> SortedEvacuees, std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, std::shared_ptr<SafeZoneTable> safeZoneList, size_t & closedSize,
-		    std::shared_ptr<NAEdgeMapTwoGen> closedList, std::shared_ptr<NAEdgeContainer> leafs, std::vector<unsigned int> & CARMAExtractCounts, double globalMinPop2Route, double & minPop2Route, bool separationRequired);
+		    std::shared_ptr<NAEdgeMapTwoGen> closedList, std::shared_ptr<NAEdgeContainer> leafs, std::vector<unsigned int> & CARMAExtractCounts, std::vector<unsigned int> & CARMARepairCounts,
+		    double globalMinPop2Route, double & minPop2Route, bool separationRequired);
+	HRESULT ParallelCARMALoop(INetworkQueryPtr ipNetworkQuery, ITrackCancel* pTrackCancel, IGPMessages* pMessages, const std::vector<NAEdgePtr> & readyEdges, NAEvacueeVertexTable & EvacueePairs,
+			std::shared_ptr<std::vector<EvacueePtr>> SortedEvacuees, std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, std::shared_ptr<NAEdgeMapTwoGen> closedList,
+			std::shared_ptr<NAEdgeContainer> leafs, unsigned int & CARMAExtractCount, double & SearchRadius, double minPop2Route);
 	HRESULT BuildClassDefinitions(ISpatialReference* pSpatialRef, INamedSet** ppDefinitions, IDENetworkDataset* pDENDS);
 	HRESULT CreateSideOfEdgeDomain(IDomain** ppDomain);
 	HRESULT CreateCurbApproachDomain(IDomain** ppDomain);
@@ -316,11 +402,19 @@ private:
 	HRESULT AddLocationFieldTypes(INAClassDefinitionEdit* pClassDef);
 	HRESULT GetNAClassTable(INAContext* pContext, BSTR className, ITable** ppTable, bool throwError = true);
 	HRESULT LoadBarriers(ITable* pTable, INetworkQuery* pNetworkQuery, INetworkForwardStarEx* pNetworkForwardStarEx);
+	HRESULT NetworkCacheKey(INetworkDatasetPtr, INetworkAttributePtr, std::wstring &) const;
+	HRESULT LoadLandmarks(INetworkDatasetPtr, INetworkAttributePtr, NAGraphSnapshotPtr, NALandmarkTablePtr &, bool &) const;
+	HRESULT LoadHierarchy(INetworkDatasetPtr, INetworkAttributePtr, NAGraphSnapshotPtr, NAContractionHierarchyPtr &, bool &) const;
 	HRESULT DeterminMinimumPop2Route(std::shared_ptr<EvacueeList>, INetworkDatasetPtr, double &, bool &) const;
-	size_t  FindPathsThatNeedToBeProcessedInIteration(std::shared_ptr<EvacueeList>, std::shared_ptr<std::vector<EvcPathPtr>>, std::vector<double> &, size_t &) const;
+	size_t  FindPathsThatNeedToBeProcessedInIteration(std::shared_ptr<EvacueeList>, std::shared_ptr<std::vector<EvcPathPtr>>, std::vector<double> &, size_t &, SPTWorkerPool &,
+		std::unordered_set<NAEdgePtr, NAEdgePtrHasher, NAEdgePtrEqual> &) const;
 	void    MarkDirtyEdgesAsUnVisited(NAEdgeMap *, std::shared_ptr<NAEdgeContainer>, std::vector<NAEdgePtr> &, bool &) const;
+	HRESULT RepairDirtyEdges(std::shared_ptr<NAVertexCache>, std::shared_ptr<NAEdgeCache>, NAEdgeMap *, std::shared_ptr<NAEdgeContainer>, std::vector<NAEdgePtr> &,
+		    double, double, unsigned int &) const;
+	void    ReopenOldLeafs(NAEdgeMap *, std::shared_ptr<NAEdgeContainer>, std::shared_ptr<NAEdgeContainer>) const;
 	void    NonRecursiveMarkAndRemove(NAEdgePtr, NAEdgeMap *, std::vector<NAEdgePtr> &) const;
 	bool    GeneratePath(SafeZonePtr, NAVertexPtr, double &, int &, EvacueePtr, double, bool) const;
+	bool    GenerateRoutePath(const NAHierarchyRoute &, SafeZonePtr, NAVertexPtr, NAGraphSnapshotPtr, std::shared_ptr<NAEdgeCache>, double &, int &, EvacueePtr, double) const;
 	void    UpdatePeakMemoryUsage();
 
 	esriNAOutputLineType	m_outputLineType;
@@ -332,6 +426,7 @@ private:
 	float					CriticalDensPerCap;
 	EvcSolverMethod		    solverMethod;
 	EvcTrafficModel		    trafficModel;
+	SpeedDensityTable       speedDensityTable;
 	float					costPerDensity;
 	VARIANT_BOOL			flockingEnabled;
 	float					flockingSnapInterval;
@@ -341,6 +436,8 @@ private:
 	float                   CARMAPerformanceRatio;
 	float                   selfishRatio;
 	float                   iterateRatio;
+	long                    carmaThreadCount;
+	long                    speculationWindow;
 	SIZE_T					peakMemoryUsage;
 	HANDLE					hProcessPeakMemoryUsage;
 	CARMASort               CarmaSortCriteria;
@@ -349,6 +446,12 @@ private:
 
 	VARIANT_BOOL twoWayShareCapacity;
 	VARIANT_BOOL ThreeGenCARMA;
+	VARIANT_BOOL lifelongCARMA;
+	VARIANT_BOOL altLandmarks;
+	VARIANT_BOOL hierarchySP;
+	VARIANT_BOOL cellOverlay;
+	VARIANT_BOOL bidirectionalSearch;
+	VARIANT_BOOL incrementalChunkSearch;
 	VARIANT_BOOL VarExportEdgeStat;
 	VARIANT_BOOL m_CreateTraversalResult;
 	VARIANT_BOOL m_FindBestSequence;
@@ -401,7 +504,7 @@ private:
 
 // Utility functions
 HRESULT PrepareUnvisitedVertexForHeap(INetworkJunctionPtr, NAEdgePtr edge, NAEdgePtr prevEdge, double, NAVertexPtr, std::shared_ptr<NAEdgeCache>, std::shared_ptr<NAEdgeMapTwoGen>, std::shared_ptr<NAVertexCache>, INetworkQueryPtr, bool checkOldClosedlist = true);
-HRESULT FindDirtyEdgesWithACleanParent(std::shared_ptr<NAEdgeCache>, std::shared_ptr<NAVertexCache>, INetworkQueryPtr, std::shared_ptr<NAEdgeMapTwoGen>, std::shared_ptr<NAEdgeContainer> Leafs, std::vector<NAEdgePtr> & removedDirty);
+HRESULT FindDirtyEdgesWithACleanParent(std::shared_ptr<NAEdgeCache>, std::shared_ptr<NAVertexCache>, std::shared_ptr<NAEdgeMapTwoGen>, std::shared_ptr<NAEdgeContainer> Leafs, std::vector<NAEdgePtr> & removedDirty);
 double  GetUnitPerDay(esriNetworkAttributeUnits unit, double assumedSpeed);
 HRESULT PrepareVerticesForHeap(NAVertexPtr point, std::shared_ptr<NAVertexCache>, std::shared_ptr<NAEdgeCache>, NAEdgeMap *, std::vector<NAEdgePtr> &, double pop, EvcSolverMethod, double selfishRatio, double MaxEvacueeCostSoFar, QueryDirection);
-HRESULT InsertLeafEdgesToHeap(INetworkQueryPtr ipNetworkQuery, std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, MyFibonacciHeap<NAEdgePtr, NAEdgePtrHasher, NAEdgePtrEqual> & heap, std::shared_ptr<NAEdgeContainer> leafs);
+template <class EdgeHeap> HRESULT InsertLeafEdgesToHeap(std::shared_ptr<NAVertexCache> vcache, std::shared_ptr<NAEdgeCache> ecache, EdgeHeap & heap, std::shared_ptr<NAEdgeContainer> leafs);
@@ -118,6 +118,24 @@ STDMETHODIMP EvcSolverPropPage::Show(UINT nCmdShow)
 		m_ipEvcSolver->get_ThreeGenCARMA(&val);
 		if (val == VARIANT_TRUE) ::SendMessage(m_hThreeGenCARMA, BM_SETCHECK, (WPARAM)BST_CHECKED, NULL);
 		else  ::SendMessage(m_hThreeGenCARMA, BM_SETCHECK, (WPARAM)BST_UNCHECKED, NULL);
+		m_ipEvcSolver->get_IncrementalChunkSearch(&val);
+		if (val == VARIANT_TRUE) ::SendMessage(m_hIncrementalChunks, BM_SETCHECK, (WPARAM)BST_CHECKED, NULL);
+		else  ::SendMessage(m_hIncrementalChunks, BM_SETCHECK, (WPARAM)BST_UNCHECKED, NULL);
+		m_ipEvcSolver->get_LifelongCARMA(&val);
+		if (val == VARIANT_TRUE) ::SendMessage(m_hLifelongCARMA, BM_SETCHECK, (WPARAM)BST_CHECKED, NULL);
+		else  ::SendMessage(m_hLifelongCARMA, BM_SETCHECK, (WPARAM)BST_UNCHECKED, NULL);
+		m_ipEvcSolver->get_ALTLandmarks(&val);
+		if (val == VARIANT_TRUE) ::SendMessage(m_hALTLandmarks, BM_SETCHECK, (WPARAM)BST_CHECKED, NULL);
+		else  ::SendMessage(m_hALTLandmarks, BM_SETCHECK, (WPARAM)BST_UNCHECKED, NULL);
+		m_ipEvcSolver->get_HierarchySP(&val);
+		if (val == VARIANT_TRUE) ::SendMessage(m_hHierarchySP, BM_SETCHECK, (WPARAM)BST_CHECKED, NULL);
+		else  ::SendMessage(m_hHierarchySP, BM_SETCHECK, (WPARAM)BST_UNCHECKED, NULL);
+		m_ipEvcSolver->get_CellOverlay(&val);
+		if (val == VARIANT_TRUE) ::SendMessage(m_hCellOverlay, BM_SETCHECK, (WPARAM)BST_CHECKED, NULL);
+		else  ::SendMessage(m_hCellOverlay, BM_SETCHECK, (WPARAM)BST_UNCHECKED, NULL);
+		m_ipEvcSolver->get_BidirectionalSearch(&val);
+		if (val == VARIANT_TRUE) ::SendMessage(m_hBidirectional, BM_SETCHECK, (WPARAM)BST_CHECKED, NULL);
+		else  ::SendMessage(m_hBidirectional, BM_SETCHECK, (WPARAM)BST_UNCHECKED, NULL);
 
 		// set the solver traffic model names
 		EvcTrafficModel model;
@@ -128,6 +146,7 @@ STDMETHODIMP EvcSolverPropPage::Show(UINT nCmdShow)
 		::SendMessage(m_hComboTrafficModel, CB_ADDSTRING, NULL, (LPARAM)(TRAFFIC_MODEL_LINEAR));
 		::SendMessage(m_hComboTrafficModel, CB_ADDSTRING, NULL, (LPARAM)(TRAFFIC_MODEL_POWER));
 		::SendMessage(m_hComboTrafficModel, CB_ADDSTRING, NULL, (LPARAM)(TRAFFIC_MODEL_EXP));
+		::SendMessage(m_hComboTrafficModel, CB_ADDSTRING, NULL, (LPARAM)(TRAFFIC_MODEL_TABLE));
 		::SendMessage(m_hComboTrafficModel, CB_SETCURSEL, (WPARAM)model, NULL);
 
 		// set the loaded network descriptive attribs
@@ -194,6 +213,24 @@ STDMETHODIMP EvcSolverPropPage::Show(UINT nCmdShow)
 		::SendMessage(m_heditIterative, WM_SETTEXT, NULL, (LPARAM)iterative);
 		delete[] iterative;
 
+		// set CARMA thread count
+		BSTR threads;
+		m_ipEvcSolver->get_CARMAThreadCount(&threads);
+		::SendMessage(m_heditCARMAThreads, WM_SETTEXT, NULL, (LPARAM)threads);
+		delete[] threads;
+
+		// set speculative window size
+		BSTR window;
+		m_ipEvcSolver->get_SpeculationWindow(&window);
+		::SendMessage(m_heditSpeculationWindow, WM_SETTEXT, NULL, (LPARAM)window);
+		delete[] window;
+
+		// set speed-density table
+		BSTR speedTable;
+		m_ipEvcSolver->get_SpeedDensityCurves(&speedTable);
+		::SendMessage(m_heditSpeedTable, WM_SETTEXT, NULL, (LPARAM)speedTable);
+		delete[] speedTable;
+
 		// set selfish ratio
 		BSTR selfish;
 		m_ipEvcSolver->get_SelfishRatio(&selfish);
@@ -201,6 +238,7 @@ STDMETHODIMP EvcSolverPropPage::Show(UINT nCmdShow)
 		delete [] selfish;
 
 		SetFlockingEnabled();
+		SetSpeedTableEnabled();
 		SetDirty(FALSE);
 	}
 
@@ -382,6 +420,30 @@ STDMETHODIMP EvcSolverPropPage::QueryObject(VARIANT theObject)
 		if (selectedIndex == BST_CHECKED) ipSolver->put_ThreeGenCARMA(VARIANT_TRUE);
 		else ipSolver->put_ThreeGenCARMA(VARIANT_FALSE);
 
+		selectedIndex = ::SendMessage(m_hIncrementalChunks, BM_GETCHECK, NULL, NULL);
+		if (selectedIndex == BST_CHECKED) ipSolver->put_IncrementalChunkSearch(VARIANT_TRUE);
+		else ipSolver->put_IncrementalChunkSearch(VARIANT_FALSE);
+
+		selectedIndex = ::SendMessage(m_hLifelongCARMA, BM_GETCHECK, NULL, NULL);
+		if (selectedIndex == BST_CHECKED) ipSolver->put_LifelongCARMA(VARIANT_TRUE);
+		else ipSolver->put_LifelongCARMA(VARIANT_FALSE);
+
+		selectedIndex = ::SendMessage(m_hALTLandmarks, BM_GETCHECK, NULL, NULL);
+		if (selectedIndex == BST_CHECKED) ipSolver->put_ALTLandmarks(VARIANT_TRUE);
+		else ipSolver->put_ALTLandmarks(VARIANT_FALSE);
+
+		selectedIndex = ::SendMessage(m_hHierarchySP, BM_GETCHECK, NULL, NULL);
+		if (selectedIndex == BST_CHECKED) ipSolver->put_HierarchySP(VARIANT_TRUE);
+		else ipSolver->put_HierarchySP(VARIANT_FALSE);
+
+		selectedIndex = ::SendMessage(m_hCellOverlay, BM_GETCHECK, NULL, NULL);
+		if (selectedIndex == BST_CHECKED) ipSolver->put_CellOverlay(VARIANT_TRUE);
+		else ipSolver->put_CellOverlay(VARIANT_FALSE);
+
+		selectedIndex = ::SendMessage(m_hBidirectional, BM_GETCHECK, NULL, NULL);
+		if (selectedIndex == BST_CHECKED) ipSolver->put_BidirectionalSearch(VARIANT_TRUE);
+		else ipSolver->put_BidirectionalSearch(VARIANT_FALSE);
+
 		selectedIndex = ::SendMessage(m_hEdgeStat, BM_GETCHECK, NULL, NULL);
 		if (selectedIndex == BST_CHECKED) ipSolver->put_ExportEdgeStat(VARIANT_TRUE);
 		else ipSolver->put_ExportEdgeStat(VARIANT_FALSE);
@@ -426,6 +488,30 @@ STDMETHODIMP EvcSolverPropPage::QueryObject(VARIANT theObject)
 		ipSolver->put_IterativeRatio(iterative);
 		delete[] iterative;
 
+		// CARMA thread count
+		BSTR threads;
+		size = ::SendMessage(m_heditCARMAThreads, WM_GETTEXTLENGTH, NULL, NULL);
+		threads = new DEBUG_NEW_PLACEMENT WCHAR[size + 1];
+		::SendMessage(m_heditCARMAThreads, WM_GETTEXT, size + 1, (LPARAM)threads);
+		ipSolver->put_CARMAThreadCount(threads);
+		delete[] threads;
+
+		// speculative window size
+		BSTR window;
+		size = ::SendMessage(m_heditSpeculationWindow, WM_GETTEXTLENGTH, NULL, NULL);
+		window = new DEBUG_NEW_PLACEMENT WCHAR[size + 1];
+		::SendMessage(m_heditSpeculationWindow, WM_GETTEXT, size + 1, (LPARAM)window);
+		ipSolver->put_SpeculationWindow(window);
+		delete[] window;
+
+		// speed-density table
+		BSTR speedTable;
+		size = ::SendMessage(m_heditSpeedTable, WM_GETTEXTLENGTH, NULL, NULL);
+		speedTable = new DEBUG_NEW_PLACEMENT WCHAR[size + 1];
+		::SendMessage(m_heditSpeedTable, WM_GETTEXT, size + 1, (LPARAM)speedTable);
+		ipSolver->put_SpeedDensityCurves(speedTable);
+		delete[] speedTable;
+
 		// selfish ratio
 		BSTR selfish;
 		size = ::SendMessage(m_heditSelfish, WM_GETTEXTLENGTH, NULL, NULL);
@@ -524,8 +610,17 @@ LRESULT EvcSolverPropPage::OnInitDialog(UINT uMsg, WPARAM wParam, LPARAM lParam,
 	m_hCmbFlockProfile = GetDlgItem(IDC_COMBO_PROFILE);
 	m_heditCARMA = GetDlgItem(IDC_EDIT_CARMA);
 	m_hThreeGenCARMA = GetDlgItem(IDL_CHECK_CARMAGEN);
+	m_hIncrementalChunks = GetDlgItem(IDC_CHECK_IncrementalChunks);
+	m_hLifelongCARMA = GetDlgItem(IDC_CHECK_LifelongCARMA);
+	m_hALTLandmarks = GetDlgItem(IDC_CHECK_ALTLandmarks);
+	m_hHierarchySP = GetDlgItem(IDC_CHECK_HierarchySP);
+	m_hCellOverlay = GetDlgItem(IDC_CHECK_CellOverlay);
+	m_hBidirectional = GetDlgItem(IDC_CHECK_Bidirectional);
 	m_heditSelfish = GetDlgItem(IDC_EDIT_SELFISH);
 	m_heditIterative = GetDlgItem(IDC_EDIT_Iterative);
+	m_heditCARMAThreads = GetDlgItem(IDC_EDIT_CARMAThreads);
+	m_heditSpeculationWindow = GetDlgItem(IDC_EDIT_SpeculationWindow);
+	m_heditSpeedTable = GetDlgItem(IDC_EDIT_SpeedTable);
 	m_hCmbCarmaSort = GetDlgItem(IDC_COMBO_CarmaSort);
 	m_hcmbEvcOptions = GetDlgItem(IDC_CMB_GroupOption);
 	m_hUTurnCombo = GetDlgItem(IDC_COMBO_UTurn);
@@ -567,6 +662,14 @@ void EvcSolverPropPage::SetFlockingEnabled()
 	cwCmbFlockProfile.EnableWindow(bFlag);
 }
 
+void EvcSolverPropPage::SetSpeedTableEnabled()
+{
+	LRESULT selectedIndex = ::SendMessage(m_hComboTrafficModel, CB_GETCURSEL, NULL, NULL);
+	CWindow cwEditSpeedTable;
+	cwEditSpeedTable.Attach(m_heditSpeedTable);
+	cwEditSpeedTable.EnableWindow(selectedIndex == (LRESULT)EvcTrafficModel::TABLEModel ? TRUE : FALSE);
+}
+
 LRESULT EvcSolverPropPage::OnEnChangeEditSat(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
 {
 	SetDirty(TRUE);
@@ -593,6 +696,7 @@ LRESULT EvcSolverPropPage::OnCbnSelchangeComboMethod(WORD /*wNotifyCode*/, WORD
 
 LRESULT EvcSolverPropPage::OnCbnSelchangeComboCostmethod(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
 {
+	SetSpeedTableEnabled();
 	SetDirty(TRUE);
 	//refresh property sheet
 	//m_pPageSite->OnStatusChange(PROPPAGESTATUS_DIRTY);
@@ -712,6 +816,54 @@ LRESULT EvcSolverPropPage::OnBnClickedCheckCarmagen(WORD /*wNotifyCode*/, WORD /
 	return S_OK;
 }
 
+LRESULT EvcSolverPropPage::OnBnClickedCheckIncrementalChunks(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
+{
+	SetDirty(TRUE);
+	//refresh property sheet
+	//m_pPageSite->OnStatusChange(PROPPAGESTATUS_DIRTY);
+	return S_OK;
+}
+
+LRESULT EvcSolverPropPage::OnBnClickedCheckLifelongCARMA(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
+{
+	SetDirty(TRUE);
+	//refresh property sheet
+	//m_pPageSite->OnStatusChange(PROPPAGESTATUS_DIRTY);
+	return S_OK;
+}
+
+LRESULT EvcSolverPropPage::OnBnClickedCheckALTLandmarks(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
+{
+	SetDirty(TRUE);
+	//refresh property sheet
+	//m_pPageSite->OnStatusChange(PROPPAGESTATUS_DIRTY);
+	return S_OK;
+}
+
+LRESULT EvcSolverPropPage::OnBnClickedCheckHierarchySP(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
+{
+	SetDirty(TRUE);
+	//refresh property sheet
+	//m_pPageSite->OnStatusChange(PROPPAGESTATUS_DIRTY);
+	return S_OK;
+}
+
+LRESULT EvcSolverPropPage::OnBnClickedCheckCellOverlay(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
+{
+	SetDirty(TRUE);
+	//refresh property sheet
+	//m_pPageSite->OnStatusChange(PROPPAGESTATUS_DIRTY);
+	return S_OK;
+}
+
+LRESULT EvcSolverPropPage::OnBnClickedCheckBidirectional(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
+{
+	SetDirty(TRUE);
+	//refresh property sheet
+	//m_pPageSite->OnStatusChange(PROPPAGESTATUS_DIRTY);
+	return S_OK;
+}
+
 LRESULT EvcSolverPropPage::OnEnChangeEditSelfish(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
 {
 	SetDirty(TRUE);
@@ -728,6 +880,30 @@ LRESULT EvcSolverPropPage::OnEnChangeEditIterative(WORD /*wNotifyCode*/, WORD /*
 	return S_OK;
 }
 
+LRESULT EvcSolverPropPage::OnEnChangeEditCARMAThreads(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
+{
+	SetDirty(TRUE);
+	//refresh property sheet
+	//m_pPageSite->OnStatusChange(PROPPAGESTATUS_DIRTY);
+	return S_OK;
+}
+
+LRESULT EvcSolverPropPage::OnEnChangeEditSpeculationWindow(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
+{
+	SetDirty(TRUE);
+	//refresh property sheet
+	//m_pPageSite->OnStatusChange(PROPPAGESTATUS_DIRTY);
+	return S_OK;
+}
+
+LRESULT EvcSolverPropPage::OnEnChangeEditSpeedTable(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
+{
+	SetDirty(TRUE);
+	//refresh property sheet
+	//m_pPageSite->OnStatusChange(PROPPAGESTATUS_DIRTY);
+	return S_OK;
+}
+
 LRESULT EvcSolverPropPage::OnCbnSelchangeComboCARMASort(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
 {
 	SetDirty(TRUE);
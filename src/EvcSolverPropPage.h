@@ -101,8 +101,17 @@ public:
 	COMMAND_HANDLER(IDC_CHECK_EDGESTAT, BN_CLICKED, OnBnClickedCheckEdgestat)
 	NOTIFY_HANDLER(IDC_RELEASE, NM_CLICK, OnNMClickRelease)
 	COMMAND_HANDLER(IDL_CHECK_CARMAGEN, BN_CLICKED, OnBnClickedCheckCarmagen)
+	COMMAND_HANDLER(IDC_CHECK_IncrementalChunks, BN_CLICKED, OnBnClickedCheckIncrementalChunks)
+	COMMAND_HANDLER(IDC_CHECK_LifelongCARMA, BN_CLICKED, OnBnClickedCheckLifelongCARMA)
+	COMMAND_HANDLER(IDC_CHECK_ALTLandmarks, BN_CLICKED, OnBnClickedCheckALTLandmarks)
+	COMMAND_HANDLER(IDC_CHECK_HierarchySP, BN_CLICKED, OnBnClickedCheckHierarchySP)
+	COMMAND_HANDLER(IDC_CHECK_CellOverlay, BN_CLICKED, OnBnClickedCheckCellOverlay)
+	COMMAND_HANDLER(IDC_CHECK_Bidirectional, BN_CLICKED, OnBnClickedCheckBidirectional)
 	COMMAND_HANDLER(IDC_EDIT_SELFISH, EN_CHANGE, OnEnChangeEditSelfish)
 	COMMAND_HANDLER(IDC_EDIT_Iterative, EN_CHANGE, OnEnChangeEditIterative)
+	COMMAND_HANDLER(IDC_EDIT_CARMAThreads, EN_CHANGE, OnEnChangeEditCARMAThreads)
+	COMMAND_HANDLER(IDC_EDIT_SpeculationWindow, EN_CHANGE, OnEnChangeEditSpeculationWindow)
+	COMMAND_HANDLER(IDC_EDIT_SpeedTable, EN_CHANGE, OnEnChangeEditSpeedTable)
 	COMMAND_HANDLER(IDC_CMB_GroupOption, CBN_SELCHANGE, OnCbnSelchangeComboEvcOption)
 	COMMAND_HANDLER(IDC_COMBO_DYNMODE, CBN_SELCHANGE, OnCbnSelchangeComboDynMode)
   END_MSG_MAP()
@@ -152,14 +161,24 @@ private:
   HWND					  m_hCmbCarmaSort;
   HWND					  m_heditCARMA;
   HWND					  m_hThreeGenCARMA;
+  HWND					  m_hIncrementalChunks;
+  HWND					  m_hLifelongCARMA;
+  HWND					  m_hALTLandmarks;
+  HWND					  m_hHierarchySP;
+  HWND					  m_hCellOverlay;
+  HWND					  m_hBidirectional;
   HWND					  m_heditSelfish;
   HWND					  m_heditIterative;
+  HWND					  m_heditCARMAThreads;
+  HWND					  m_heditSpeculationWindow;
+  HWND					  m_heditSpeedTable;
   HWND					  m_hcmbEvcOptions;
 
   HFONT                   boldFont;
   HFONT                   bigFont;
 
   void SetFlockingEnabled();
+  void SetSpeedTableEnabled();
 
 public:
 	LRESULT OnLbnDblclkRestrictionlist(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
@@ -187,9 +206,18 @@ public:
 	LRESULT OnEnChangeEditCARMA(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
 	LRESULT OnNMClickRelease(int /*idCtrl*/, LPNMHDR pNMHDR, BOOL& /*bHandled*/);
 	LRESULT OnBnClickedCheckCarmagen(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
+	LRESULT OnBnClickedCheckIncrementalChunks(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
+	LRESULT OnBnClickedCheckLifelongCARMA(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
+	LRESULT OnBnClickedCheckALTLandmarks(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
+	LRESULT OnBnClickedCheckHierarchySP(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
+	LRESULT OnBnClickedCheckCellOverlay(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
+	LRESULT OnBnClickedCheckBidirectional(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
 	LRESULT OnStnClickedLablecarma2(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
 	LRESULT OnEnChangeEditSelfish(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
 	LRESULT OnEnChangeEditIterative(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
+	LRESULT OnEnChangeEditCARMAThreads(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
+	LRESULT OnEnChangeEditSpeculationWindow(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
+	LRESULT OnEnChangeEditSpeedTable(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
 	LRESULT OnCbnSelchangeComboEvcOption(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
 	LRESULT OnCbnSelchangeComboDynMode(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
 };
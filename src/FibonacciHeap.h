@@ -33,21 +33,24 @@ struct FibNode
 	}
 };
 
-template <class T> double DefaultGetHeapKey(const T & value) { return (double)value; }
+template <class T> struct DefaultHeapKey
+{
+	double operator()(const T & value) const { return (double)value; }
+};
 
-template<class T, typename Hasher = std::hash<T>, typename TEq = std::equal_to<T>>
+template<class T, typename Hasher = std::hash<T>, typename TEq = std::equal_to<T>, typename GetKey = DefaultHeapKey<T>>
 class MyFibonacciHeap : protected boost::heap::fibonacci_heap<FibNode<T>>
 {
 private:
 	typedef boost::heap::fibonacci_heap<FibNode<T>> baseheap;
 	std::unordered_map<T, typename baseheap::handle_type, Hasher, TEq> nodeTable;
-	std::function<double(const T &)> GetHeapKey;
+	GetKey GetHeapKey;
 
 public:
 	using baseheap::size;
 	using baseheap::empty;
 
-	MyFibonacciHeap(const std::function<double(const T &)> & _getHeapKey = DefaultGetHeapKey<T>) : GetHeapKey(_getHeapKey) { nodeTable.max_load_factor(0.5); }
+	MyFibonacciHeap(void) { nodeTable.max_load_factor(0.5); }
 	bool IsVisited(const T & node) const { return nodeTable.find(node) != nodeTable.end(); }
 	void Clear() { baseheap::clear(); nodeTable.clear(); }
 
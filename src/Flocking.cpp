@@ -195,7 +195,9 @@ HRESULT FlockingObject::loadNewEdge(void)
 		if (FAILED(hr = (*pathSegIt)->pline->get_Length(&speedLimit))) return hr;
 		speedLimit = speedLimit / (*pathSegIt)->Edge->OriginalCost;
 
-		if (FAILED(hr = (*pathSegIt)->Edge->NetEdge->QueryJunctions(nullptr, nextVertex))) return hr;
+		INetworkEdgePtr netEdge = (*pathSegIt)->Edge->GetNetEdge();
+		if (!netEdge) return E_POINTER;
+		if (FAILED(hr = netEdge->QueryJunctions(nullptr, nextVertex))) return hr;
 
 		// load new edge points into the steer library
 		myVehiclePath.initialize(pointCount, libpoints, (*pathSegIt)->Edge->OriginalCapacity() * myProfile->Radius * 1.2, false);
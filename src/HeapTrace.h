@@ -0,0 +1,232 @@
+// ===============================================================================================
+// Evacuation Solver: Heap trace recording and replay
+// Description: Records every insert / decrease-key / delete-min of the search heaps to a compact
+// binary file and replays such a trace against any heap with the MyFibonacciHeap interface
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "CoreTypes.h"
+#include "IndexedHeap.h"
+#include <chrono>
+#include <fstream>
+
+enum class HeapTraceOp : unsigned char { NewHeap = 0x0, DeleteHeap = 0x1, Insert = 0x2, UpdateKey = 0x3, DeleteMin = 0x4, Clear = 0x5 };
+
+// 15 bytes per record on disk
+#pragma pack(push, 1)
+struct HeapTraceRecord
+{
+	HeapTraceOp    Op;
+	unsigned short Heap;
+	unsigned int   Item;
+	double         Key;
+};
+#pragma pack(pop)
+
+// Only one recorder is active at a time. Solve creates it when built with HEAPTRACE.
+class HeapTraceRecorder
+{
+private:
+	std::ofstream  file;
+	unsigned short heapCount;
+
+public:
+	HeapTraceRecorder(const char * path) : heapCount(0)
+	{
+		file.open(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	}
+
+	virtual ~HeapTraceRecorder(void)
+	{
+		if (Active() == this) Active() = nullptr;
+		file.close();
+	}
+
+	HeapTraceRecorder(const HeapTraceRecorder & that) = delete;
+	HeapTraceRecorder & operator=(const HeapTraceRecorder &) = delete;
+
+	static HeapTraceRecorder * & Active()
+	{
+		static HeapTraceRecorder * active = nullptr;
+		return active;
+	}
+
+	unsigned short NewHeap()
+	{
+		Write(HeapTraceOp::NewHeap, heapCount, 0, 0.0);
+		return heapCount++;
+	}
+
+	void Write(HeapTraceOp op, unsigned short heap, unsigned int item, double key)
+	{
+		HeapTraceRecord r;
+		r.Op = op;
+		r.Heap = heap;
+		r.Item = item;
+		r.Key = key;
+		file.write(reinterpret_cast<const char *>(&r), sizeof(HeapTraceRecord));
+	}
+};
+
+// Decorates a heap and records all of its operations into the active recorder. GetTraceID maps an element to a stable integer.
+template<class Heap, class T, typename GetKey, typename GetTraceID>
+class TracedHeap
+{
+private:
+	Heap           heap;
+	GetKey         key;
+	GetTraceID     id;
+	unsigned short heapID;
+
+	inline void Record(HeapTraceOp op, unsigned int item, double k) const
+	{
+		HeapTraceRecorder * recorder = HeapTraceRecorder::Active();
+		if (recorder) recorder->Write(op, heapID, item, k);
+	}
+
+public:
+	TracedHeap(void)
+	{
+		HeapTraceRecorder * recorder = HeapTraceRecorder::Active();
+		heapID = recorder ? recorder->NewHeap() : 0;
+	}
+
+	virtual ~TracedHeap(void) { Record(HeapTraceOp::DeleteHeap, 0, 0.0); }
+	TracedHeap(const TracedHeap & that) = delete;
+	TracedHeap & operator=(const TracedHeap &) = delete;
+
+	inline size_t size()  const { return heap.size();  }
+	inline bool   empty() const { return heap.empty(); }
+	bool IsVisited(const T & node) const { return heap.IsVisited(node); }
+
+	void Clear()
+	{
+		Record(HeapTraceOp::Clear, 0, 0.0);
+		heap.Clear();
+	}
+
+	void Insert(const T & value)
+	{
+		Record(HeapTraceOp::Insert, id(value), key(value));
+		heap.Insert(value);
+	}
+
+	void UpdateKey(const T & value)
+	{
+		Record(HeapTraceOp::UpdateKey, id(value), key(value));
+		heap.UpdateKey(value);
+	}
+
+	T DeleteMin()
+	{
+		T value = heap.DeleteMin();
+		Record(HeapTraceOp::DeleteMin, id(value), key(value));
+		return value;
+	}
+};
+
+inline bool LoadHeapTrace(const char * path, std::vector<HeapTraceRecord> & trace)
+{
+	HeapTraceRecord r;
+	std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+	trace.clear();
+	if (!file.is_open()) return false;
+	while (file.read(reinterpret_cast<char *>(&r), sizeof(HeapTraceRecord))) trace.push_back(r);
+	return true;
+}
+
+// the replay element: a key and a handle slot for the indexed heaps
+struct HeapReplayItem
+{
+	double Key;
+	size_t Handle;
+	HeapReplayItem(void) : Key(0.0), Handle(HeapNullHandle) { }
+
+	struct KeyOf    { double   operator()(const HeapReplayItem * i) const { return i->Key;    } };
+	struct HandleOf { size_t & operator()(HeapReplayItem * i)       const { return i->Handle; } };
+};
+
+struct HeapReplayStats
+{
+	size_t Operations;
+	size_t PeakSize;
+	double Seconds;
+	HeapReplayStats(void) : Operations(0), PeakSize(0), Seconds(0.0) { }
+	double NanoSecPerOp() const { return Operations > 0 ? 1e9 * Seconds / Operations : 0.0; }
+};
+
+// Replays a recorded trace against 'Heap' (instantiated on HeapReplayItem pointers with HeapReplayItem::KeyOf as its key).
+// Different heaps break ties differently, so an update for an element that was already extracted becomes an insert and an
+// insert for an element that is still queued becomes an update. PeakSize is the largest number of elements queued at once.
+template<class Heap>
+HeapReplayStats ReplayHeapTrace(const std::vector<HeapTraceRecord> & trace)
+{
+	HeapReplayStats stats;
+	unsigned int maxItem = 0;
+	unsigned short maxHeap = 0;
+	size_t queued = 0;
+
+	for (const auto & r : trace)
+	{
+		maxItem = std::max(maxItem, r.Item);
+		maxHeap = std::max(maxHeap, r.Heap);
+	}
+	std::vector<HeapReplayItem> items(trace.empty() ? 0 : (size_t)maxItem + 1);
+	std::vector<std::unique_ptr<Heap>> heaps(trace.empty() ? 0 : (size_t)maxHeap + 1);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (const auto & r : trace)
+	{
+		std::unique_ptr<Heap> & heap = heaps[r.Heap];
+		if (r.Op == HeapTraceOp::NewHeap)
+		{
+			heap.reset(new DEBUG_NEW_PLACEMENT Heap());
+			continue;
+		}
+		if (!heap) continue;
+		HeapReplayItem * item = &(items[r.Item]);
+
+		switch (r.Op)
+		{
+		case HeapTraceOp::DeleteHeap:
+			queued -= heap->size();
+			heap.reset();
+			break;
+		case HeapTraceOp::Clear:
+			queued -= heap->size();
+			heap->Clear();
+			break;
+		case HeapTraceOp::Insert:
+		case HeapTraceOp::UpdateKey:
+			item->Key = r.Key;
+			if (heap->IsVisited(item)) heap->UpdateKey(item);
+			else
+			{
+				heap->Insert(item);
+				++queued;
+				stats.PeakSize = std::max(stats.PeakSize, queued);
+			}
+			break;
+		case HeapTraceOp::DeleteMin:
+			if (!heap->empty())
+			{
+				heap->DeleteMin();
+				--queued;
+			}
+			break;
+		default:
+			break;
+		}
+		++stats.Operations;
+	}
+	for (auto & heap : heaps) heap.reset();
+	stats.Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	return stats;
+}
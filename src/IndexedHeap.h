@@ -0,0 +1,272 @@
+// ===============================================================================================
+// Evacuation Solver: Indexed heaps
+// Description: Addressable priority queues that keep each element's handle inside the element
+// itself (through a handle functor) so that IsVisited and UpdateKey need no lookup table
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "CoreTypes.h"
+
+// handle value of an element that is not in any heap
+const size_t HeapNullHandle = SIZE_MAX;
+
+// Both heaps share the MyFibonacciHeap interface. GetKey is a functor returning the (double) priority of an element
+// and GetHandle is a functor returning a reference to the element's handle slot. An element can only be in one heap at a time.
+// Keys are read once at Insert / UpdateKey time just like the Fibonacci heap.
+
+// Implicit d-ary heap. The handle is the element's position in the array.
+template<class T, size_t Arity, typename GetKey, typename GetHandle>
+class IndexedDAryHeap
+{
+private:
+	struct HeapEntry
+	{
+		double key;
+		T      data;
+		HeapEntry(const T & _data, double _key) : key(_key), data(_data) { }
+	};
+
+	std::vector<HeapEntry> nodes;
+	GetKey                 key;
+	GetHandle              handle;
+
+	inline void Place(size_t i, const HeapEntry & e)
+	{
+		nodes[i] = e;
+		handle(nodes[i].data) = i;
+	}
+
+	void SiftUp(size_t i)
+	{
+		HeapEntry e = nodes[i];
+		while (i > 0)
+		{
+			size_t parent = (i - 1) / Arity;
+			if (!(e.key < nodes[parent].key)) break;
+			Place(i, nodes[parent]);
+			i = parent;
+		}
+		Place(i, e);
+	}
+
+	void SiftDown(size_t i)
+	{
+		HeapEntry e = nodes[i];
+		const size_t n = nodes.size();
+		for (size_t first = i * Arity + 1; first < n; first = i * Arity + 1)
+		{
+			size_t best = first, last = std::min(first + Arity, n);
+			for (size_t c = first + 1; c < last; ++c) if (nodes[c].key < nodes[best].key) best = c;
+			if (!(nodes[best].key < e.key)) break;
+			Place(i, nodes[best]);
+			i = best;
+		}
+		Place(i, e);
+	}
+
+public:
+	IndexedDAryHeap(void) { }
+	virtual ~IndexedDAryHeap(void) { Clear(); }
+	IndexedDAryHeap(const IndexedDAryHeap & that) = delete;
+	IndexedDAryHeap & operator=(const IndexedDAryHeap &) = delete;
+
+	inline size_t size()  const { return nodes.size();  }
+	inline bool   empty() const { return nodes.empty(); }
+	bool IsVisited(const T & node) const { return handle(node) != HeapNullHandle; }
+
+	void Clear()
+	{
+		for (const auto & n : nodes) handle(n.data) = HeapNullHandle;
+		nodes.clear();
+	}
+
+	void Insert(const T & value)
+	{
+		if (IsVisited(value)) throw std::logic_error("node already exists in heap");
+		nodes.push_back(HeapEntry(value, key(value)));
+		SiftUp(nodes.size() - 1);
+	}
+
+	void UpdateKey(const T & value)
+	{
+		size_t i = handle(value);
+		if (i == HeapNullHandle) throw std::logic_error("node does not exist in heap");
+		double oldKey = nodes[i].key;
+		nodes[i].key = key(value);
+		if (nodes[i].key < oldKey) SiftUp(i);
+		else SiftDown(i);
+	}
+
+	T DeleteMin()
+	{
+		if (nodes.empty()) throw std::logic_error("heap is empty");
+		T ret = nodes.front().data;
+		handle(ret) = HeapNullHandle;
+		if (nodes.size() > 1)
+		{
+			nodes.front() = nodes.back();
+			nodes.pop_back();
+			SiftDown(0);
+		}
+		else nodes.pop_back();
+		return ret;
+	}
+};
+
+// Two-pass pairing heap on top of a node pool. The handle is the element's index in the pool.
+// A node's 'prev' is its parent when it is the leftmost child and its left sibling otherwise.
+template<class T, typename GetKey, typename GetHandle>
+class IndexedPairingHeap
+{
+private:
+	struct PairingNode
+	{
+		T      data;
+		double key;
+		size_t child;
+		size_t next;
+		size_t prev;
+		PairingNode(const T & _data, double _key) : data(_data), key(_key), child(HeapNullHandle), next(HeapNullHandle), prev(HeapNullHandle) { }
+	};
+
+	std::vector<PairingNode> pool;
+	std::vector<size_t>      freeNodes;
+	std::vector<size_t>      pairs;
+	size_t                   root;
+	size_t                   count;
+	GetKey                   key;
+	GetHandle                handle;
+
+	// both a and b have to be roots. returns the new root.
+	size_t Link(size_t a, size_t b)
+	{
+		if (a == HeapNullHandle) return b;
+		if (b == HeapNullHandle) return a;
+		if (pool[b].key < pool[a].key) std::swap(a, b);
+		pool[b].prev = a;
+		pool[b].next = pool[a].child;
+		if (pool[a].child != HeapNullHandle) pool[pool[a].child].prev = b;
+		pool[a].child = b;
+		return a;
+	}
+
+	// detach a non-root node (and its subtree) from its parent and siblings
+	void Cut(size_t i)
+	{
+		size_t prev = pool[i].prev, next = pool[i].next;
+		if (pool[prev].child == i) pool[prev].child = next;
+		else pool[prev].next = next;
+		if (next != HeapNullHandle) pool[next].prev = prev;
+		pool[i].prev = pool[i].next = HeapNullHandle;
+	}
+
+	// the classic two-pass merge: pair up siblings left to right, then fold the pairs right to left
+	size_t MergeSiblings(size_t first)
+	{
+		if (first == HeapNullHandle) return HeapNullHandle;
+		pairs.clear();
+		while (first != HeapNullHandle)
+		{
+			size_t a = first, b = pool[a].next;
+			first = b == HeapNullHandle ? HeapNullHandle : pool[b].next;
+			pool[a].next = pool[a].prev = HeapNullHandle;
+			if (b != HeapNullHandle) pool[b].next = pool[b].prev = HeapNullHandle;
+			pairs.push_back(Link(a, b));
+		}
+		size_t r = pairs.back();
+		for (size_t k = pairs.size() - 1; k > 0; --k) r = Link(pairs[k - 1], r);
+		return r;
+	}
+
+public:
+	IndexedPairingHeap(void) : root(HeapNullHandle), count(0) { }
+	virtual ~IndexedPairingHeap(void) { Clear(); }
+	IndexedPairingHeap(const IndexedPairingHeap & that) = delete;
+	IndexedPairingHeap & operator=(const IndexedPairingHeap &) = delete;
+
+	inline size_t size()  const { return count;      }
+	inline bool   empty() const { return count == 0; }
+	bool IsVisited(const T & node) const { return handle(node) != HeapNullHandle; }
+
+	void Clear()
+	{
+		// only nodes reachable from the root are still in the heap
+		pairs.clear();
+		if (root != HeapNullHandle) pairs.push_back(root);
+		while (!pairs.empty())
+		{
+			size_t n = pairs.back();
+			pairs.pop_back();
+			handle(pool[n].data) = HeapNullHandle;
+			for (size_t c = pool[n].child; c != HeapNullHandle; c = pool[c].next) pairs.push_back(c);
+		}
+		pool.clear();
+		freeNodes.clear();
+		root = HeapNullHandle;
+		count = 0;
+	}
+
+	void Insert(const T & value)
+	{
+		if (IsVisited(value)) throw std::logic_error("node already exists in heap");
+		size_t n = pool.size();
+		if (freeNodes.empty()) pool.push_back(PairingNode(value, key(value)));
+		else
+		{
+			n = freeNodes.back();
+			freeNodes.pop_back();
+			pool[n] = PairingNode(value, key(value));
+		}
+		handle(value) = n;
+		root = Link(root, n);
+		++count;
+	}
+
+	void UpdateKey(const T & value)
+	{
+		size_t i = handle(value);
+		if (i == HeapNullHandle) throw std::logic_error("node does not exist in heap");
+		double newKey = key(value);
+
+		if (newKey < pool[i].key)
+		{
+			pool[i].key = newKey;
+			if (i != root)
+			{
+				Cut(i);
+				root = Link(root, i);
+			}
+		}
+		else
+		{
+			// an increase: pull the node out, merge its children back in and then reinsert it on its own
+			if (i != root) Cut(i);
+			else root = HeapNullHandle;
+			size_t children = pool[i].child;
+			pool[i].child = HeapNullHandle;
+			pool[i].key = newKey;
+			root = Link(root, MergeSiblings(children));
+			root = Link(root, i);
+		}
+	}
+
+	T DeleteMin()
+	{
+		if (root == HeapNullHandle) throw std::logic_error("heap is empty");
+		size_t r = root;
+		T ret = pool[r].data;
+		handle(ret) = HeapNullHandle;
+		root = MergeSiblings(pool[r].child);
+		pool[r].child = HeapNullHandle;
+		freeNodes.push_back(r);
+		--count;
+		return ret;
+	}
+};
@@ -0,0 +1,28 @@
+// ===============================================================================================
+// Evacuation Solver: Landmark (ALT) disk cache
+// Description: Opens the landmark cache file next to the network dataset. Kept apart from the
+// table itself since the wide file names only open with the MSVC streams.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "StdAfx.h"
+#include "Landmarks.h"
+
+bool NALandmarkTable::Save(const std::wstring & path, const std::wstring & key, unsigned long long fingerprint) const
+{
+	std::ofstream file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!file.is_open()) return false;
+	return Write(file, key, fingerprint);
+}
+
+bool NALandmarkTable::Load(const std::wstring & path, const std::wstring & key, unsigned long long fingerprint)
+{
+	std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+	if (!file.is_open()) return false;
+	return Read(file, key, fingerprint);
+}
@@ -0,0 +1,213 @@
+// ===============================================================================================
+// Evacuation Solver: Landmark (ALT) lower bounds implementation
+// Description: Landmark selection, the free-flow searches, and the disk cache of the landmark table
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "Landmarks.h"
+
+const unsigned int NALandmarkTable::DefaultLandmarkCount;
+
+// bump this whenever the file layout changes so that old cache files are simply rebuilt
+static const unsigned int LandmarkFileMagic = 0x544C4143; // "CALT"
+static const unsigned int LandmarkFileVersion = 2;
+
+// plain junction based Dijkstra on the snapshot. forward gives d(source, v) and backward gives d(v, source).
+void NALandmarkTable::Dijkstra(const NAGraphSnapshot & graph, long source, bool forward, std::vector<double> & dist)
+{
+	typedef std::pair<double, long> Label;
+	std::vector<Label> heap;
+	NAGraphStarItr begin, end;
+	long next = -1;
+	double d = 0.0;
+
+	dist.assign(graph.JunctionCount(), CASPER_INFINITY);
+	if (source < 0 || (size_t)source >= dist.size()) return;
+	dist[source] = 0.0;
+	heap.push_back(Label(0.0, source));
+
+	while (!heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end(), std::greater<Label>());
+		Label top = heap.back();
+		heap.pop_back();
+		if (top.first > dist[top.second]) continue;
+
+		if (forward) graph.ForwardStar(top.second, begin, end);
+		else graph.BackwardStar(top.second, begin, end);
+		for (NAGraphStarItr i = begin; i != end; ++i)
+		{
+			next = forward ? graph.GetToJunction(*i) : graph.GetFromJunction(*i);
+			d = top.first + graph.GetCost(*i);
+			if (d < dist[next])
+			{
+				dist[next] = d;
+				heap.push_back(Label(d, next));
+				std::push_heap(heap.begin(), heap.end(), std::greater<Label>());
+			}
+		}
+	}
+}
+
+// floats are enough for a heuristic but an unreachable junction has to stay unreachable. the bound subtracts one table
+// from the other so the rounding must never make it larger: distances to a landmark are rounded down and distances from
+// a landmark are rounded up, and SetTargets moves the safe zone terms one more step the safe way.
+void NALandmarkTable::StoreDistances(unsigned int landmark, const std::vector<double> & dist, std::vector<float> & table, bool roundUp) const
+{
+	float f = 0.0f;
+	for (size_t j = 0; j < junctionCount; ++j)
+	{
+		f = FLT_MAX;
+		if (dist[j] < CASPER_INFINITY)
+		{
+			f = (float)dist[j];
+			if (!roundUp && (double)f > dist[j]) f = std::nextafter(f, 0.0f);
+			if ( roundUp && (double)f < dist[j]) f = std::nextafter(f, FLT_MAX);
+		}
+		table[j * landmarkCount + landmark] = f;
+	}
+}
+
+// Farthest-point selection: the first landmark is the junction farthest from a start junction and each next one is the
+// junction that is farthest from all the landmarks picked so far. Junctions the searches could not reach are never picked
+// so the start is the busiest junction which is almost surely part of the main component of a road network.
+void NALandmarkTable::Build(const NAGraphSnapshot & graph, unsigned int count)
+{
+	std::vector<double> dist, closest;
+	long start = -1, farthest = -1;
+	double best = 0.0;
+	NAGraphStarItr begin, end;
+	ptrdiff_t degree = 0;
+
+	landmarks.clear();
+	toLandmark.clear();
+	fromLandmark.clear();
+	targetToLandmark.clear();
+	targetFromLandmark.clear();
+	hasTargets = false;
+	junctionCount = graph.JunctionCount();
+	landmarkCount = 0;
+	if (count == 0 || junctionCount == 0) return;
+
+	for (long j = 0; j < (long)junctionCount; ++j)
+	{
+		graph.ForwardStar(j, begin, end);
+		if (end - begin > degree)
+		{
+			degree = end - begin;
+			start = j;
+		}
+	}
+	if (start < 0) return;
+
+	Dijkstra(graph, start, true, dist);
+	closest = dist;
+	for (unsigned int l = 0; l < count; ++l)
+	{
+		farthest = -1;
+		best = 0.0;
+		for (long j = 0; j < (long)junctionCount; ++j)
+			if (closest[j] < CASPER_INFINITY && closest[j] > best)
+			{
+				best = closest[j];
+				farthest = j;
+			}
+		if (farthest < 0) break;
+		landmarks.push_back(farthest);
+
+		// the forward search of this landmark is also what pushes the next pick away from it
+		Dijkstra(graph, farthest, true, dist);
+		for (size_t j = 0; j < junctionCount; ++j) if (dist[j] < closest[j]) closest[j] = dist[j];
+		closest[farthest] = 0.0;
+	}
+
+	landmarkCount = (unsigned int)landmarks.size();
+	toLandmark.assign(junctionCount * landmarkCount, FLT_MAX);
+	fromLandmark.assign(junctionCount * landmarkCount, FLT_MAX);
+	for (unsigned int l = 0; l < landmarkCount; ++l)
+	{
+		Dijkstra(graph, landmarks[l], true, dist);
+		StoreDistances(l, dist, fromLandmark, true);
+		Dijkstra(graph, landmarks[l], false, dist);
+		StoreDistances(l, dist, toLandmark, false);
+	}
+}
+
+void NALandmarkTable::SetTargets(const std::vector<long> & junctions)
+{
+	float to = 0.0f, from = 0.0f;
+	targetToLandmark.assign(landmarkCount, 0.0);
+	targetFromLandmark.assign(landmarkCount, CASPER_INFINITY);
+	hasTargets = false;
+
+	for (const auto & z : junctions)
+	{
+		if (z < 0 || (size_t)z >= junctionCount) continue;
+		hasTargets = true;
+		for (unsigned int l = 0; l < landmarkCount; ++l)
+		{
+			to = toLandmark[(size_t)z * landmarkCount + l];
+			from = fromLandmark[(size_t)z * landmarkCount + l];
+			// these two are on the other side of the subtraction so their stored rounding is undone by one more step
+			targetToLandmark[l] = to < FLT_MAX ? std::max(targetToLandmark[l], (double)std::nextafter(to, FLT_MAX)) : CASPER_INFINITY;
+			targetFromLandmark[l] = std::min(targetFromLandmark[l], (double)(from < FLT_MAX ? std::nextafter(from, 0.0f) : from));
+		}
+	}
+}
+
+bool NALandmarkTable::Write(std::ostream & file, const std::wstring & key, unsigned long long fingerprint) const
+{
+	unsigned int header[3] = { LandmarkFileMagic, LandmarkFileVersion, landmarkCount };
+	unsigned long long sizes[3] = { fingerprint, (unsigned long long)junctionCount, (unsigned long long)key.size() };
+	if (IsEmpty()) return false;
+
+	file.write(reinterpret_cast<const char *>(header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+	file.write(reinterpret_cast<const char *>(key.c_str()), key.size() * sizeof(wchar_t));
+	file.write(reinterpret_cast<const char *>(landmarks.data()), landmarks.size() * sizeof(long));
+	file.write(reinterpret_cast<const char *>(toLandmark.data()), toLandmark.size() * sizeof(float));
+	file.write(reinterpret_cast<const char *>(fromLandmark.data()), fromLandmark.size() * sizeof(float));
+	return file.good();
+}
+
+bool NALandmarkTable::Read(std::istream & file, const std::wstring & key, unsigned long long fingerprint)
+{
+	unsigned int header[3] = { 0, 0, 0 };
+	unsigned long long sizes[3] = { 0, 0, 0 };
+	std::wstring savedKey;
+
+	if (!file.read(reinterpret_cast<char *>(header), sizeof(header))) return false;
+	if (header[0] != LandmarkFileMagic || header[1] != LandmarkFileVersion || header[2] == 0) return false;
+	if (!file.read(reinterpret_cast<char *>(sizes), sizeof(sizes))) return false;
+	if (sizes[0] != fingerprint || sizes[2] != key.size()) return false;
+	savedKey.resize(key.size());
+	if (!savedKey.empty() && !file.read(reinterpret_cast<char *>(&(savedKey[0])), savedKey.size() * sizeof(wchar_t))) return false;
+	if (savedKey != key) return false;
+
+	landmarkCount = header[2];
+	junctionCount = (size_t)sizes[1];
+	landmarks.resize(landmarkCount);
+	toLandmark.resize(junctionCount * landmarkCount);
+	fromLandmark.resize(junctionCount * landmarkCount);
+	file.read(reinterpret_cast<char *>(landmarks.data()), landmarks.size() * sizeof(long));
+	file.read(reinterpret_cast<char *>(toLandmark.data()), toLandmark.size() * sizeof(float));
+	file.read(reinterpret_cast<char *>(fromLandmark.data()), fromLandmark.size() * sizeof(float));
+	hasTargets = false;
+
+	// a truncated file is as good as no file
+	if (!file)
+	{
+		landmarks.clear();
+		toLandmark.clear();
+		fromLandmark.clear();
+		landmarkCount = 0;
+		junctionCount = 0;
+		return false;
+	}
+	return true;
+}
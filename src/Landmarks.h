@@ -0,0 +1,90 @@
+// ===============================================================================================
+// Evacuation Solver: Landmark (ALT) lower bounds
+// Description: Free-flow distances to and from a handful of landmark junctions of the graph
+// snapshot. Along with the triangle inequality they give a lower bound on the cost from any junction
+// to the closest safe zone which tightens the CARMA heuristic outside of the explored area.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "NAGraph.h"
+#include <istream>
+#include <ostream>
+
+// For every landmark L and every junction v the table keeps d(v, L) and d(L, v) on free-flow costs. Congestion only
+// makes an edge slower so for any safe zone z: d(v, z) >= d(v, L) - d(z, L) and d(v, z) >= d(L, z) - d(L, v).
+// With more than one safe zone the worst one is used for each term which keeps the bound valid for the closest one.
+// The distances of a junction sit next to each other so that one bound only touches a couple of cache lines.
+class NALandmarkTable
+{
+private:
+	unsigned int        landmarkCount;
+	size_t              junctionCount;
+	std::vector<long>   landmarks;
+	std::vector<float>  toLandmark;
+	std::vector<float>  fromLandmark;
+	std::vector<double> targetToLandmark;
+	std::vector<double> targetFromLandmark;
+	bool                hasTargets;
+
+	static void Dijkstra(const NAGraphSnapshot & graph, long source, bool forward, std::vector<double> & dist);
+	void StoreDistances(unsigned int landmark, const std::vector<double> & dist, std::vector<float> & table, bool roundUp) const;
+
+public:
+	static const unsigned int DefaultLandmarkCount = 8;
+
+	NALandmarkTable(void) : landmarkCount(0), junctionCount(0), hasTargets(false) { }
+	virtual ~NALandmarkTable(void) { }
+
+	NALandmarkTable(const NALandmarkTable & that) = delete;
+	NALandmarkTable & operator=(const NALandmarkTable &) = delete;
+
+	// picks the landmarks by farthest-point selection and runs one forward and one backward search from each of them
+	void Build(const NAGraphSnapshot & graph, unsigned int count);
+
+	// the disk cache is only accepted if the key (network identity and cost attribute) and the snapshot fingerprint both match
+	bool Load(const std::wstring & path, const std::wstring & key, unsigned long long fingerprint);
+	bool Save(const std::wstring & path, const std::wstring & key, unsigned long long fingerprint) const;
+
+	// the cache layout itself on any binary stream. a file that is cut short is rejected.
+	bool Read(std::istream & file, const std::wstring & key, unsigned long long fingerprint);
+	bool Write(std::ostream & file, const std::wstring & key, unsigned long long fingerprint) const;
+
+	// the safe zone junctions of the current solve. no bound is given before this is called.
+	void SetTargets(const std::vector<long> & junctions);
+
+	bool   IsEmpty()          const { return landmarks.empty(); }
+	size_t GetLandmarkCount() const { return landmarks.size(); }
+	size_t MemoryUsage()      const { return sizeof(float) * (toLandmark.capacity() + fromLandmark.capacity()) + sizeof(long) * landmarks.capacity(); }
+
+	inline double LowerBound(long junction) const
+	{
+		double bound = 0.0, b = 0.0;
+		if (!hasTargets || landmarkCount == 0 || junction < 0 || (size_t)junction >= junctionCount) return bound;
+		const float * to = &(toLandmark[(size_t)junction * landmarkCount]);
+		const float * from = &(fromLandmark[(size_t)junction * landmarkCount]);
+
+		for (unsigned int l = 0; l < landmarkCount; ++l)
+		{
+			if (to[l] < FLT_MAX && targetToLandmark[l] < CASPER_INFINITY)
+			{
+				b = to[l] - targetToLandmark[l];
+				if (b > bound) bound = b;
+			}
+			if (from[l] < FLT_MAX)
+			{
+				b = targetFromLandmark[l] - from[l];
+				if (b > bound) bound = b;
+			}
+		}
+		return bound;
+	}
+};
+
+typedef std::shared_ptr<NALandmarkTable> NALandmarkTablePtr;
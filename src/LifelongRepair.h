@@ -0,0 +1,288 @@
+// ===============================================================================================
+// Evacuation Solver: Lifelong shortest path tree repair
+// Description: The LPA* / D* Lite core of the lifelong CARMA tree repair. It only knows edges,
+// their old labels, costs and closed neighbors through a graph adapter so the same code repairs the
+// CARMA tree of the solver and the trees of the snapshot tests.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "CoreTypes.h"
+#include <unordered_map>
+#include <unordered_set>
+
+// The adapter 'Graph' defines the edge type 'Edge' and the following members:
+//   static Edge None()                           the edge that stands for no tree parent
+//   bool   InTree(Edge e)                        the edge is closed and labeled
+//   double OldLabel(Edge e)                      the label of the edge before the repair
+//   double OldCost(Edge e)                       the cost the edge was labeled with
+//   Edge   OldParent(Edge e)                     the tree parent of the edge before the repair
+//   double Cost(Edge e)                          the cost to label the edge with now
+//   double Seed(Edge e, double cost)             the label a safe zone gives the edge at that cost, or infinity
+//   bool   ForEachNext(Edge e, Visit visit)      visits the edges that leave the to-junction of the edge
+//   bool   ForEachPrevious(Edge e, Visit visit)  visits the edges that enter the from-junction of the edge
+//   size_t Slot(Edge e)                          a unique number per edge that breaks ties
+// The two adjacency queries return false if they fail and the repair stops right there.
+//
+// Labels are compared by value and then by tie level like the parallel tree: the level counts the zero-cost edges in a
+// row at the start of the path. Without it a zero-cost loop lets an edge take its own descendant as a parent with the
+// exact same label and LPA* never notices. With it every edge is strictly more than the edge it continues through.
+template <class Graph> class LifelongRepair
+{
+public:
+	typedef typename Graph::Edge Edge;
+
+	struct EdgeState
+	{
+		double       OldG;
+		double       G;
+		double       RHS;
+		double       Cost;
+		double       Seed;
+		unsigned int Level;
+		unsigned int RHSLevel;
+		Edge         BestNext;
+		bool         Evicted;
+	};
+
+private:
+	struct QueueItem
+	{
+		double       Key;
+		unsigned int Level;
+		size_t       Slot;
+		Edge         Item;
+		QueueItem(double key, unsigned int level, size_t slot, Edge item) : Key(key), Level(level), Slot(slot), Item(item) { }
+	};
+
+	// min-heap order for std::push_heap. ties are broken by edge slot so the repair does not depend on memory layout.
+	struct QueueOrder
+	{
+		bool operator()(const QueueItem & a, const QueueItem & b) const
+		{
+			if (a.Key != b.Key) return a.Key > b.Key;
+			if (a.Level != b.Level) return a.Level > b.Level;
+			return a.Slot > b.Slot;
+		}
+	};
+
+	Graph                                 & graph;
+	std::vector<QueueItem>                queue;
+	std::unordered_map<Edge, EdgeState>   states;
+	std::vector<Edge>                     decided;
+	unsigned int                          repairCount;
+
+	static inline bool Less(double a, unsigned int aLevel, double b, unsigned int bLevel) { return a < b || (a == b && aLevel < bLevel); }
+	static inline bool Consistent(const EdgeState & s) { return s.G == s.RHS && s.Level == s.RHSLevel; }
+
+	inline void Push(Edge e, const EdgeState & s)
+	{
+		if (Less(s.RHS, s.RHSLevel, s.G, s.Level)) queue.push_back(QueueItem(s.RHS, s.RHSLevel, graph.Slot(e), e));
+		else queue.push_back(QueueItem(s.G, s.Level, graph.Slot(e), e));
+		std::push_heap(queue.begin(), queue.end(), QueueOrder());
+	}
+
+	inline bool IsKey(const QueueItem & item, const EdgeState & s) const
+	{
+		return Less(s.RHS, s.RHSLevel, s.G, s.Level) ? item.Key == s.RHS && item.Level == s.RHSLevel : item.Key == s.G && item.Level == s.Level;
+	}
+
+	// the old tie level of an edge follows its old tree path as long as the edges on it cost nothing
+	unsigned int OldLevel(Edge e) const
+	{
+		unsigned int level = 0;
+		for (Edge p = graph.OldParent(e); p != Graph::None() && graph.OldCost(e) == 0.0; e = p, p = graph.OldParent(e)) ++level;
+		return level;
+	}
+
+	void GetG(Edge e, double & g, unsigned int & level) const
+	{
+		auto s = states.find(e);
+		if (s == states.end())
+		{
+			g = graph.OldLabel(e);
+			level = OldLevel(e);
+		}
+		else
+		{
+			g = s->second.G;
+			level = s->second.Level;
+		}
+	}
+
+	// The first time an edge is touched its old label becomes both g and rhs
+	EdgeState & Touch(Edge e)
+	{
+		auto found = states.find(e);
+		if (found != states.end()) return found->second;
+
+		EdgeState & s = states[e];
+		s.OldG = s.G = s.RHS = graph.OldLabel(e);
+		s.Level = s.RHSLevel = OldLevel(e);
+		s.Cost = graph.Cost(e);
+		s.Seed = graph.Seed(e, s.Cost);
+		s.BestNext = graph.OldParent(e);
+		s.Evicted = false;
+		return s;
+	}
+
+	bool UpdateRHS(Edge e)
+	{
+		EdgeState & s = Touch(e);
+		double best = s.Seed, g = 0.0;
+		unsigned int bestLevel = 0, level = 0;
+		Edge bestNext = Graph::None();
+
+		if (s.Cost < CASPER_INFINITY && !graph.ForEachNext(e, [&](Edge next)
+		{
+			if (!graph.InTree(next)) return;
+			GetG(next, g, level);
+			if (g >= CASPER_INFINITY) return;
+			if (s.Cost == 0.0) ++level;
+			else level = 0;
+
+			// on a tie the current parent wins so that a repair does not move branches around for nothing
+			if (Less(s.Cost + g, level, best, bestLevel) || (s.Cost + g == best && level == bestLevel && next == s.BestNext))
+			{
+				best = s.Cost + g;
+				bestLevel = level;
+				bestNext = next;
+			}
+		})) return false;
+
+		s.RHS = std::min(best, CASPER_INFINITY);
+		s.RHSLevel = s.RHS < CASPER_INFINITY ? bestLevel : 0;
+		s.BestNext = bestNext;
+		if (!Consistent(s)) Push(e, s);
+		return true;
+	}
+
+	inline bool OwnEviction(const EdgeState & s, double radius) const { return s.G >= CASPER_INFINITY || (s.G != s.OldG && s.G > radius); }
+
+	void Decide(double radius)
+	{
+		std::unordered_map<Edge, std::vector<Edge>> children;
+		std::vector<Edge> roots, walk;
+		auto order = [&](Edge a, Edge b)
+		{
+			const EdgeState & sa = states.find(a)->second, & sb = states.find(b)->second;
+			if (sa.G != sb.G || sa.Level != sb.Level) return Less(sa.G, sa.Level, sb.G, sb.Level);
+			return graph.Slot(a) < graph.Slot(b);
+		};
+
+		// A root hangs from a safe zone or from an edge that kept its old label. Everything else hangs from another
+		// repaired edge and is only decided after it: with zero-cost edges a child can have the exact same label.
+		for (const auto & s : states)
+		{
+			if (s.second.BestNext != Graph::None() && states.find(s.second.BestNext) != states.end()) children[s.second.BestNext].push_back(s.first);
+			else roots.push_back(s.first);
+		}
+
+		// the roots go by label and the walk pops the cheapest child first so the result does not depend on hashing
+		decided.clear();
+		decided.reserve(states.size());
+		std::sort(roots.begin(), roots.end(), order);
+		for (const auto & r : roots)
+		{
+			EdgeState & s = states.find(r)->second;
+			s.Evicted = OwnEviction(s, radius);
+			walk.push_back(r);
+			while (!walk.empty())
+			{
+				Edge e = walk.back();
+				walk.pop_back();
+				decided.push_back(e);
+				bool evicted = states.find(e)->second.Evicted;
+
+				auto c = children.find(e);
+				if (c == children.end()) continue;
+				std::sort(c->second.begin(), c->second.end(), order);
+				for (auto child = c->second.rbegin(); child != c->second.rend(); ++child)
+				{
+					EdgeState & cs = states.find(*child)->second;
+					cs.Evicted = evicted || OwnEviction(cs, radius);
+					walk.push_back(*child);
+				}
+			}
+		}
+
+		// Every edge is strictly more than its parent so nothing is left over unless the old tree itself was broken.
+		// Whatever hangs on such a loop does not lead to a safe zone and has to go.
+		if (decided.size() < states.size())
+		{
+			std::unordered_set<Edge> seen(decided.begin(), decided.end());
+			for (auto & s : states) if (seen.find(s.first) == seen.end())
+			{
+				s.second.Evicted = true;
+				decided.push_back(s.first);
+			}
+		}
+	}
+
+public:
+	LifelongRepair(Graph & _graph) : graph(_graph), repairCount(0) { }
+
+	LifelongRepair(const LifelongRepair & that) = delete;
+	LifelongRepair & operator=(const LifelongRepair &) = delete;
+
+	// Repairs the labels after the cost changes of the given closed dirty edges and decides which of the touched edges
+	// stay in the tree. An edge is evicted if it ends up unreachable, above the radius with a new label or below an
+	// evicted edge. Returns false if one of the adjacency queries failed.
+	bool Repair(const std::vector<Edge> & dirty, double radius)
+	{
+		repairCount = 0;
+		queue.clear();
+		states.clear();
+		decided.clear();
+
+		// the dirty edges are the only ones whose own cost changed so they are the first ones to look at
+		for (const auto & d : dirty) if (graph.InTree(d) && !UpdateRHS(d)) return false;
+
+		while (!queue.empty())
+		{
+			std::pop_heap(queue.begin(), queue.end(), QueueOrder());
+			QueueItem top = queue.back();
+			queue.pop_back();
+
+			// skip the stale entries of edges that were updated again after they were queued
+			EdgeState & s = states.find(top.Item)->second;
+			if (Consistent(s) || !IsKey(top, s)) continue;
+			++repairCount;
+
+			// over-consistent: the edge got cheaper
+			if (Less(s.RHS, s.RHSLevel, s.G, s.Level))
+			{
+				s.G = s.RHS;
+				s.Level = s.RHSLevel;
+			}
+			else
+			{
+				// under-consistent: forget the old label and let the edge pick the best of what is left
+				s.G = CASPER_INFINITY;
+				s.Level = 0;
+				if (!UpdateRHS(top.Item)) return false;
+			}
+
+			// every closed edge that can continue through this one has to look at its options again
+			bool failed = false;
+			if (!graph.ForEachPrevious(top.Item, [&](Edge prev) { if (!failed && graph.InTree(prev) && !UpdateRHS(prev)) failed = true; }) || failed) return false;
+		}
+
+		Decide(radius);
+		return true;
+	}
+
+	// every touched edge, parents before their children
+	inline const std::vector<Edge> & Decided() const { return decided; }
+	inline bool Touched(Edge e) const { return states.find(e) != states.end(); }
+	inline const EdgeState & State(Edge e) const { return states.find(e)->second; }
+
+	// number of inconsistent edges that were processed by the last repair
+	inline unsigned int GetRepairCount() const { return repairCount; }
+};
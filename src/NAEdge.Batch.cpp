@@ -0,0 +1,82 @@
+// ===============================================================================================
+// Evacuation Solver: Batch edge re-costing
+// Description: Re-costs and classifies the dirty state of many edges at once. The hot edge fields
+// are gathered into flat arrays, the kernels of EdgeCost.h run as tight loops over them (AVX2
+// when the build targets it) and the results are written back to the edges.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "StdAfx.h"
+#include "NAEdge.h"
+
+// One buffer per thread for the lifetime of the thread. A batch is about 56KB which is too much for a stack frame and too
+// much to allocate again for every batch of every CARMA loop. Neither batch call can reach the other one while it runs.
+static EdgeCostBatch & ThreadBatch()
+{
+	static thread_local EdgeCostBatch batch;
+	return batch;
+}
+
+static void ComputeBatchCost(EdgeCostBatch & b, const TrafficModel * model, EvcSolverMethod method, double newPop)
+{
+	switch (model->GetModel())
+	{
+	case EvcTrafficModel::STEPModel:   CostKernel<STEPModelPolicy>  (b, model, method, newPop); break;
+	case EvcTrafficModel::LINEARModel: CostKernel<LINEARModelPolicy>(b, model, method, newPop); break;
+	case EvcTrafficModel::POWERModel:  CostKernel<POWERModelPolicy> (b, model, method, newPop); break;
+	case EvcTrafficModel::EXPModel:    CostKernel<EXPModelPolicy>   (b, model, method, newPop); break;
+	case EvcTrafficModel::TABLEModel:  CostKernel<TABLEModelPolicy> (b, model, method, newPop); break;
+	default:                           CostKernel<FLATModelPolicy>  (b, model, method, newPop); break;
+	}
+}
+
+void NAEdge::HowDirtyBatch(NAEdge * const * edges, size_t count, EvcSolverMethod method, double minPop2Route)
+{
+	if (count == 0) return;
+	_ASSERT(count <= BatchSize);
+	EdgeCostBatch & b = ThreadBatch();
+	EdgeDirtyState states[BatchSize];
+	size_t i = 0;
+
+	b.Count = count;
+	for (i = 0; i < count; ++i)
+	{
+		b.OriginalCost[i] = edges[i]->OriginalCost;
+		b.Capacity[i]     = edges[i]->reservations->Capacity;
+		b.ReservedPop[i]  = edges[i]->reservations->ReservedPop;
+		b.CleanCost[i]    = edges[i]->CleanCost;
+	}
+	ComputeBatchCost(b, edges[0]->reservations->myTrafficModel, method, minPop2Route);
+	CostChangeBatch(b, states);
+
+	// two way roads may share one reservation object so the order of write back matters just like before
+	for (i = 0; i < count; ++i) edges[i]->reservations->dirtyState = states[i];
+}
+
+void NAEdge::SetCleanBatch(NAEdge * const * edges, size_t count, EvcSolverMethod method, double minPop2Route)
+{
+	if (count == 0) return;
+	_ASSERT(count <= BatchSize);
+	EdgeCostBatch & b = ThreadBatch();
+	size_t i = 0;
+
+	b.Count = count;
+	for (i = 0; i < count; ++i)
+	{
+		b.OriginalCost[i] = edges[i]->OriginalCost;
+		b.Capacity[i]     = edges[i]->reservations->Capacity;
+		b.ReservedPop[i]  = edges[i]->reservations->ReservedPop;
+	}
+	ComputeBatchCost(b, edges[0]->reservations->myTrafficModel, method, minPop2Route);
+
+	for (i = 0; i < count; ++i)
+	{
+		edges[i]->CleanCost = b.Cost[i];
+		edges[i]->reservations->dirtyState = EdgeDirtyState::CleanState;
+	}
+}
@@ -17,12 +17,13 @@
 //******************************************************************************************/
 // EdgeReservations Methods
 
-EdgeReservations::EdgeReservations(float capacity, TrafficModel * trafficModel)
+EdgeReservations::EdgeReservations(float capacity, const TrafficModel * trafficModel)
 {
 	ReservedPop = 0.0;
 	Capacity = capacity;
 	myTrafficModel = trafficModel;
 	dirtyState = EdgeDirtyState::CostIncreased;
+	changeStamp = 0;
 }
 
 EdgeReservations::EdgeReservations(const EdgeReservations& cpy)
@@ -31,33 +32,38 @@ EdgeReservations::EdgeReservations(const EdgeReservations& cpy)
 	Capacity = cpy.Capacity;
 	myTrafficModel = cpy.myTrafficModel;
 	dirtyState = cpy.dirtyState;
+	changeStamp = cpy.changeStamp;
 }
 
 void EdgeReservations::AddReservation(double newFlow, EvcPathPtr path)
 {
-	push_back(path);
+	paths.Add(path);
 	ReservedPop += newFlow;
+	if (path->IsCostCommitted()) reservedCosts.Add(path->GetReserveEvacuationCost());
+	changeStamp = ReservationClock::Tick();
 }
 
 void EdgeReservations::RemoveReservation(double flow, EvcPathPtr path)
-{	
-	size_t orgSize = size();
-	erase(std::remove_if(begin(), end(), [&path](const EvcPathPtr & myPath)->bool { return *path == *myPath; }), end());
-	size_t removedCount = orgSize - size();
+{
+	// all reservations of this path on this edge go away at once
+	unsigned int removedCount = paths.Remove(path);
+	if (removedCount == 0) return;
+
 	ReservedPop -= flow * removedCount;
 	ReservedPop = max(0.0, ReservedPop);
+	if (path->IsCostCommitted()) reservedCosts.Remove(path->GetReserveEvacuationCost(), removedCount);
+	changeStamp = ReservationClock::Tick();
 }
 
 void EdgeReservations::SwapReservation(const EvcPathPtr oldPath, const EvcPathPtr newPath)
 {
-	int last = (int)size() - 1;
-	bool found = false;
-	for (int i = last; i >= 0; --i) if (*oldPath == *at(i))
-	{
-		// this->operator[](i) = newPath;
-		at(i) = newPath;
-		found = true;
-	}
+	// the new path takes the place of the old one in the reservation order unless it is already there
+	unsigned int found = paths.Swap(oldPath, newPath);
+	if (found == 0) return;
+
+	if (oldPath->IsCostCommitted()) reservedCosts.Remove(oldPath->GetReserveEvacuationCost(), found);
+	if (newPath->IsCostCommitted()) reservedCosts.Add(newPath->GetReserveEvacuationCost(), found);
+	changeStamp = ReservationClock::Tick();
 }
 
 //******************************************************************************************/
@@ -66,7 +72,8 @@ void EdgeReservations::SwapReservation(const EvcPathPtr oldPath, const EvcPathPt
 NAEdge::NAEdge(const NAEdge& cpy) : TreeNext(cpy.TreeNext), AdjacentForward(cpy.AdjacentForward), AdjacentBackward(cpy.AdjacentBackward)
 {
 	reservations = cpy.reservations;
-	NetEdge = cpy.NetEdge;
+	netEdge = cpy.netEdge;
+	networkQuery = cpy.networkQuery;
 	OriginalCost = cpy.OriginalCost;
 	Direction = cpy.Direction;
 	EID = cpy.EID;
@@ -74,15 +81,24 @@ NAEdge::NAEdge(const NAEdge& cpy) : TreeNext(cpy.TreeNext), AdjacentForward(cpy.
 	CleanCost = cpy.CleanCost;
 	TreePrevious = cpy.TreePrevious;
 	myGeometry = cpy.myGeometry;
+	HeapHandle = HeapNullHandle;
+	carmaH = -1.0;
+	nextHEdge = nullptr;
+	hJunction = -1;
 }
 
-NAEdge::NAEdge(INetworkEdgePtr edge, long capacityAttribID, long costAttribID, const NAEdge * otherEdge, bool twoWayRoadsShareCap, std::list<EdgeReservationsPtr> & ResTable, TrafficModel * model)
+NAEdge::NAEdge(INetworkEdgePtr edge, long capacityAttribID, long costAttribID, const NAEdge * otherEdge, bool twoWayRoadsShareCap, SlabPool<EdgeReservations> & reservationPool, const TrafficModel * model)
 {
 	myGeometry = nullptr;
 	TreePrevious = nullptr;
+	HeapHandle = HeapNullHandle;
 	CleanCost = -1.0;
 	ToVertex = nullptr;
-	this->NetEdge = edge;
+	carmaH = -1.0;
+	nextHEdge = nullptr;
+	hJunction = -1;
+	netEdge = edge;
+	networkQuery = nullptr;
 	VARIANT vcost, vcap;
 	float capacity = 1.0;
 	HRESULT hr = S_OK;
@@ -101,7 +117,7 @@ NAEdge::NAEdge(INetworkEdgePtr edge, long capacityAttribID, long costAttribID, c
 	if (FAILED(hr = edge->get_EID(&EID)) ||	FAILED(hr = edge->get_Direction(&Direction)))
 	{
 		_ASSERT(hr == S_OK);
-		NetEdge = nullptr;
+		netEdge = nullptr;
 		reservations = nullptr;
 		EID = -1;
 		throw std::exception("Something bad happened while looking up a network edge");
@@ -117,18 +133,58 @@ NAEdge::NAEdge(INetworkEdgePtr edge, long capacityAttribID, long costAttribID, c
 		if (twoWayRoadsShareCap && otherEdge) reservations = otherEdge->reservations;
 		else
 		{
-			reservations = new DEBUG_NEW_PLACEMENT EdgeReservations(capacity, model);
-			ResTable.push_back(reservations);
+			reservations = reservationPool.New(capacity, model);
 		}
 	}
 }
 
+// This constructor takes cost and capacity from the graph snapshot so the network edge is not even looked up until it is needed
+NAEdge::NAEdge(INetworkQuery * query, long eid, esriNetworkEdgeDirection dir, double cost, float capacity, const NAEdge * otherEdge, bool twoWayRoadsShareCap, SlabPool<EdgeReservations> & reservationPool, const TrafficModel * model)
+{
+	myGeometry = nullptr;
+	TreePrevious = nullptr;
+	HeapHandle = HeapNullHandle;
+	CleanCost = -1.0;
+	ToVertex = nullptr;
+	carmaH = -1.0;
+	nextHEdge = nullptr;
+	hJunction = -1;
+	netEdge = nullptr;
+	networkQuery = query;
+	EID = eid;
+	Direction = dir;
+	_ASSERT(cost >= 0.0);
+	OriginalCost = max(FLT_MIN, cost);
+
+	// now deal with reservation list
+	if (twoWayRoadsShareCap && otherEdge) reservations = otherEdge->reservations;
+	else
+	{
+		reservations = reservationPool.New(max(1.0f, capacity), model);
+	}
+}
+
+INetworkEdgePtr NAEdge::GetNetEdge() const
+{
+	if (!netEdge && networkQuery)
+	{
+		INetworkElementPtr ipEdgeElement;
+		if (FAILED(networkQuery->CreateNetworkElement(esriNETEdge, &ipEdgeElement))) return nullptr;
+		INetworkEdgePtr edge(ipEdgeElement);
+		if (FAILED(networkQuery->QueryEdge(EID, Direction, edge))) return nullptr;
+		netEdge = edge;
+	}
+	return netEdge;
+}
+
 HRESULT NAEdge::QuerySourceStuff(long * sourceOID, long * sourceID, double * fromPosition, double * toPosition) const
 {
 	HRESULT hr = S_OK;
-	if (FAILED(hr = NetEdge->get_OID(sourceOID))) return hr;
-	if (FAILED(hr = NetEdge->get_SourceID(sourceID))) return hr;
-	if (FAILED(hr = NetEdge->QueryPositions(fromPosition, toPosition))) return hr;
+	INetworkEdgePtr edge = GetNetEdge();
+	if (!edge) return E_POINTER;
+	if (FAILED(hr = edge->get_OID(sourceOID))) return hr;
+	if (FAILED(hr = edge->get_SourceID(sourceID))) return hr;
+	if (FAILED(hr = edge->QueryPositions(fromPosition, toPosition))) return hr;
 	return hr;
 }
 
@@ -215,42 +271,25 @@ bool NAEdge::ApplyNewOriginalCostAndCapacity(double NewOriginalCost, double NewO
 	bool changed = OriginalCost != NewOriginalCost || reservations->Capacity != NewOriginalCapacity;
 	OriginalCost = NewOriginalCost;
 	reservations->Capacity = NewOriginalCapacity;
+	if (changed) reservations->changeStamp = ReservationClock::Tick();
 	if (changed && !DelayHowDirty) HowDirty(method, 1.0, true);
 	return changed;
 }
 
 double NAEdge::GetCurrentCost(EvcSolverMethod method) const { return GetCost(0.0, method); }
 
-// This is where the actual capacity aware part is happening:
-// We take the original values of the edge and recalculate the
-// new travel cost based on number of reserved spots by previous evacuees.
-double NAEdge::GetTrafficSpeedRatio(double allPop, EvcSolverMethod method) const
-{
-	double speedPercent = 1.0;
-	if      (method == EvcSolverMethod::CASPERSolver) speedPercent = reservations->myTrafficModel->GetCongestionPercentage(reservations->Capacity, allPop);
-	else if (method == EvcSolverMethod::CCRPSolver  ) speedPercent = allPop > reservations->myTrafficModel->CriticalDensPerCap * reservations->Capacity ? 0.0 : 1.0;
-	speedPercent = min(1.0, max(0.0001, speedPercent));
-	return speedPercent;
-}
-
+// the search loops call the policy version directly. everybody else goes through this switch.
 double NAEdge::GetCost(double newPop, EvcSolverMethod method, double * globalDeltaCost) const
 {
-	if (reservations->Capacity <= 0.0 || OriginalCost >= CASPER_INFINITY) return CASPER_INFINITY;
-	double speedPercent = 1.0;
-	if (reservations->myTrafficModel->InitDelayCostPerPop > 0.0) newPop = min(newPop, OriginalCost / reservations->myTrafficModel->InitDelayCostPerPop);
-	newPop += reservations->ReservedPop;
-
-	speedPercent = GetTrafficSpeedRatio(newPop, method);
-
-	// this extra output tells CASPER how much will this edge reservation affects the cost according to the traffic model
-	if (globalDeltaCost)
+	switch (reservations->myTrafficModel->GetModel())
 	{
-		double globalDeltaCostPercentage = 0.0;
-		globalDeltaCostPercentage = GetTrafficSpeedRatio(reservations->ReservedPop, method) - speedPercent;
-		_ASSERT(globalDeltaCostPercentage >= 0.0);
-		*globalDeltaCost = OriginalCost * globalDeltaCostPercentage;
+	case EvcTrafficModel::STEPModel:   return GetCost<STEPModelPolicy>  (newPop, method, globalDeltaCost);
+	case EvcTrafficModel::LINEARModel: return GetCost<LINEARModelPolicy>(newPop, method, globalDeltaCost);
+	case EvcTrafficModel::POWERModel:  return GetCost<POWERModelPolicy> (newPop, method, globalDeltaCost);
+	case EvcTrafficModel::EXPModel:    return GetCost<EXPModelPolicy>   (newPop, method, globalDeltaCost);
+	case EvcTrafficModel::TABLEModel:  return GetCost<TABLEModelPolicy> (newPop, method, globalDeltaCost);
+	default:                           return GetCost<FLATModelPolicy>  (newPop, method, globalDeltaCost);
 	}
-	return OriginalCost / speedPercent;
 }
 
 double NAEdge::MaxAddedCostOnReservedPathsWithNewFlow(double deltaCostOfNewFlow, double longestPathSoFar, double currentPathSoFar, double selfishRatio) const
@@ -258,8 +297,9 @@ double NAEdge::MaxAddedCostOnReservedPathsWithNewFlow(double deltaCostOfNewFlow,
 	double AddedGlobalCost = 0.0;
 	double cutoffCost = max(longestPathSoFar, currentPathSoFar);
 
-	if (deltaCostOfNewFlow > 0.0 && selfishRatio > 0.0)
-		for(const auto & p: *reservations) AddedGlobalCost = max(AddedGlobalCost, p->GetReserveEvacuationCost() + deltaCostOfNewFlow - cutoffCost);		
+	// only the most expensive path on this edge matters and the reservations keep track of it
+	if (deltaCostOfNewFlow > 0.0 && selfishRatio > 0.0 && !reservations->reservedCosts.empty())
+		AddedGlobalCost = max(0.0, reservations->MaxReservedCost() + deltaCostOfNewFlow - cutoffCost);
 	else return 0.0;
 
 	return selfishRatio * min(AddedGlobalCost, deltaCostOfNewFlow);
@@ -269,16 +309,7 @@ double NAEdge::MaxAddedCostOnReservedPathsWithNewFlow(double deltaCostOfNewFlow,
 EdgeDirtyState NAEdge::HowDirty(EvcSolverMethod method, double minPop2Route, bool exhaustive)
 {
 	if (CleanCost <= 0.0) reservations->dirtyState = EdgeDirtyState::CostIncreased;
-	else
-	{
-		if (exhaustive || reservations->dirtyState == EdgeDirtyState::CleanState)
-		{
-			reservations->dirtyState = EdgeDirtyState::CleanState;
-			double costchange = (GetCost(minPop2Route, method) / CleanCost) - 1.0;
-			if (costchange >  FLT_EPSILON) reservations->dirtyState = EdgeDirtyState::CostIncreased;
-			if (costchange < -FLT_EPSILON) reservations->dirtyState = EdgeDirtyState::CostDecreased;
-		}
-	}
+	else if (exhaustive || reservations->dirtyState == EdgeDirtyState::CleanState) reservations->dirtyState = CostChange(GetCost(minPop2Route, method), CleanCost);
 	return reservations->dirtyState;
 }
 
@@ -310,14 +341,15 @@ void NAEdge::RemoveReservation(EvcPathPtr path, EvcSolverMethod method, bool del
 	if (!delayedDirtyState) HowDirty(method);
 }
 
-void NAEdge::GetUniqeCrossingPaths(std::vector<EvcPathPtr> & crossings, bool cleanVectorFirst)
+void NAEdge::GetUniqeCrossingPaths(std::vector<EvcPathPtr> & crossings, bool cleanVectorFirst) const
 {
+	EvcPathPtr previous = nullptr;
 	if (cleanVectorFirst) crossings.clear();
-	crossings.push_back(reservations->front());
 	for (const auto & p : *reservations)
 	{
-		if (*p != *crossings.back()) crossings.push_back(p);
-		_ASSERT_EXPR(!EvcPath::LessThanPathOrder2(p, crossings.back()), L"Path reservations are not in increasing order");
+		_ASSERT_EXPR(!previous || !EvcPath::LessThanPathOrder2(p, previous), L"Path reservations are not in increasing order");
+		crossings.push_back(p);
+		previous = p;
 	}
 }
 
@@ -361,11 +393,21 @@ NAEdgePtr NAEdgeCache::New(long EID, esriNetworkEdgeDirection dir)
 
 	if (it == cache->end())
 	{
-		if (FAILED(ipNetworkQuery->CreateNetworkElement(esriNETEdge, &ipEdgeElement))) return nullptr;
-		edgeClone = ipEdgeElement;
-		if (FAILED(ipNetworkQuery->QueryEdge(EID, dir, edgeClone))) return nullptr;
-
-		n = new DEBUG_NEW_PLACEMENT NAEdge(edgeClone, capacityAttribID, costAttribID, Get(EID, otherDir), twoWayRoadsShareCap, ResTable, myTrafficModel);
+		// the snapshot already has everything the edge needs so its network element is left for later
+		NAGraphEdgeIndex g = graph ? graph->Find(EID, (EdgeDirection)dir) : NAGraphSnapshot::NoEdge;
+		if (g != NAGraphSnapshot::NoEdge)
+		{
+			n = edgePool.New(ipNetworkQuery.GetInterfacePtr(), EID, dir, graph->GetCost(g), GetSnapshotCapacity(g), Get(EID, otherDir), twoWayRoadsShareCap, reservationPool, myTrafficModel);
+			snapshotEdges[g] = n;
+			createdSnapshotEdges.push_back(g);
+		}
+		else
+		{
+			if (FAILED(ipNetworkQuery->CreateNetworkElement(esriNETEdge, &ipEdgeElement))) return nullptr;
+			edgeClone = ipEdgeElement;
+			if (FAILED(ipNetworkQuery->QueryEdge(EID, dir, edgeClone))) return nullptr;
+			n = edgePool.New(edgeClone, capacityAttribID, costAttribID, Get(EID, otherDir), twoWayRoadsShareCap, reservationPool, myTrafficModel);
+		}
 		cache->insert(NAEdgeTablePair(n));
 	}
 	else
@@ -388,29 +430,113 @@ NAEdgePtr NAEdgeCache::New(INetworkEdgePtr edge)
 
 void NAEdgeCache::CleanAllEdgesAndRelease(double minPop2Route, EvcSolverMethod solver)
 {
-	for (NAEdgeTableItr cit = cacheAlong->begin();   cit != cacheAlong->end();   cit++) cit->second->SetClean(solver, minPop2Route);
-	for (NAEdgeTableItr cit = cacheAgainst->begin(); cit != cacheAgainst->end(); cit++) cit->second->SetClean(solver, minPop2Route);
+	NAEdgePtr batch[NAEdge::BatchSize];
+	size_t count = 0;
+	for (NAEdgeTable * cache : { cacheAlong, cacheAgainst })
+		for (NAEdgeTableItr cit = cache->begin(); cit != cache->end(); cit++)
+		{
+			batch[count++] = cit->second;
+			if (count == NAEdge::BatchSize) { NAEdge::SetCleanBatch(batch, count, solver, minPop2Route); count = 0; }
+		}
+	if (count > 0) NAEdge::SetCleanBatch(batch, count, solver, minPop2Route);
 }
 
-void NAEdgeCache::Clear()
+double NAEdgeCache::GetSnapshotCost(NAGraphEdgeIndex e, double newPop, EvcSolverMethod method) const
 {
-	for(NAEdgeTableItr cit = cacheAlong->begin(); cit != cacheAlong->end(); cit++)
+	switch (myTrafficModel->GetModel())
 	{
-		NAEdgePtr e = (*cit).second;
-		delete e;
+	case EvcTrafficModel::STEPModel:   return GetSnapshotCost<STEPModelPolicy>  (e, newPop, method);
+	case EvcTrafficModel::LINEARModel: return GetSnapshotCost<LINEARModelPolicy>(e, newPop, method);
+	case EvcTrafficModel::POWERModel:  return GetSnapshotCost<POWERModelPolicy> (e, newPop, method);
+	case EvcTrafficModel::EXPModel:    return GetSnapshotCost<EXPModelPolicy>   (e, newPop, method);
+	case EvcTrafficModel::TABLEModel:  return GetSnapshotCost<TABLEModelPolicy> (e, newPop, method);
+	default:                           return GetSnapshotCost<FLATModelPolicy>  (e, newPop, method);
 	}
-	for(NAEdgeTableItr cit = cacheAgainst->begin(); cit != cacheAgainst->end(); cit++)
+}
+
+// an entry whose value moves is remembered until 'DrainSnapshotCostChanges' picks it up
+void NAEdgeCache::SetCostTableEntry(NAGraphEdgeIndex e, double c)
+{
+	if (costTable[e] == c) return;
+	costTable[e] = c;
+	if (costTableRebuilt || costTableIsChanged[e]) return;
+	costTableIsChanged[e] = 1;
+	costTableChanged.push_back(e);
+}
+
+// a tracked edge is costed again with every new population since its place in the slack order is out of date
+void NAEdgeCache::TrackCostTableEdge(NAGraphEdgeIndex e)
+{
+	SetCostTableEntry(e, GetSnapshotCost(e, costTablePop, costTableMethod));
+	if (costTableIsTracked[e]) return;
+	costTableIsTracked[e] = 1;
+	costTableTracked.push_back(e);
+}
+
+const std::vector<double> & NAEdgeCache::GetSnapshotCosts(double newPop, EvcSolverMethod method)
+{
+	const NAGraphEdgeIndex edgeCount = (NAGraphEdgeIndex)graph->EdgeCount();
+	const double oldPop = costTablePop;
+	NAGraphEdgeIndex other = NAGraphSnapshot::NoEdge;
+
+	// the first call costs everything and orders the edges by their slack
+	if (costTable.size() != edgeCount || costTablePop < 0.0 || method != costTableMethod)
+	{
+		costTable.resize(edgeCount);
+		costTableSlack.resize(edgeCount);
+		costTableBySlack.resize(edgeCount);
+		costTableIsTracked.assign(edgeCount, 0);
+		costTableTracked.clear();
+		costTableIsChanged.assign(edgeCount, 0);
+		costTableChanged.clear();
+		costTableRebuilt = true;
+		for (NAGraphEdgeIndex e = 0; e < edgeCount; ++e)
+		{
+			costTable[e] = GetSnapshotCost(e, newPop, method);
+			costTableSlack[e] = GetSnapshotSlack(e);
+			costTableBySlack[e] = e;
+		}
+		std::sort(costTableBySlack.begin(), costTableBySlack.end(), [&](NAGraphEdgeIndex a, NAGraphEdgeIndex b) { return costTableSlack[a] < costTableSlack[b]; });
+		costTablePop = newPop;
+		costTableMethod = method;
+		costTableStamp = ReservationClock::Now();
+		return costTable;
+	}
+
+	// An edge that nobody created has no reservations of its own so only the created ones can have changed. Two directions
+	// that share their capacity share the change stamp too but only one of them may have been created.
+	costTablePop = newPop;
+	for (const auto e : createdSnapshotEdges)
 	{
-		NAEdgePtr e = (*cit).second;
-		delete e;
+		if (snapshotEdges[e]->GetChangeStamp() <= costTableStamp) continue;
+		TrackCostTableEdge(e);
+		if (!twoWayRoadsShareCap) continue;
+		other = graph->Find(graph->GetEID(e), graph->GetDirection(e) == EdgeDirection::Along ? EdgeDirection::Against : EdgeDirection::Along);
+		if (other != NAGraphSnapshot::NoEdge) TrackCostTableEdge(other);
 	}
-	for (auto r : ResTable) delete r;
-	for (auto n : GarbageNeighborList) delete n;
 
-	GarbageNeighborList.clear();
+	// an edge costs the same for any population that fits in its slack. the margin keeps a rounding of the slack from hiding an edge that just starts to congest.
+	if (newPop != oldPop)
+	{
+		const double top = max(newPop, oldPop) * (1.0 + 1e-9) + 1e-9;
+		for (auto i = costTableBySlack.cbegin(); i != costTableBySlack.cend() && costTableSlack[*i] < top; ++i) SetCostTableEntry(*i, GetSnapshotCost(*i, newPop, method));
+		for (const auto e : costTableTracked) SetCostTableEntry(e, GetSnapshotCost(e, newPop, method));
+	}
+	costTableStamp = ReservationClock::Now();
+	return costTable;
+}
+
+void NAEdgeCache::Clear()
+{
+	// edges, reservations, and neighbor lists all live in slabs so there is no need to chase the cache pointers
 	cacheAlong->clear();
 	cacheAgainst->clear();
-	ResTable.clear();
+	std::fill(snapshotEdges.begin(), snapshotEdges.end(), nullptr);
+	createdSnapshotEdges.clear();
+	costTable.clear();
+	edgePool.DestroyAll();
+	reservationPool.DestroyAll();
+	neighborPool.DestroyAll();
 }
 
 NAEdgePtr NAEdgeCache::Get(long eid, esriNetworkEdgeDirection dir) const
@@ -431,19 +557,29 @@ HRESULT NAEdgeCache::QueryAdjacencies(NAVertexPtr ToVertex, NAEdgePtr Edge, Quer
 	ArrayList<NAEdgePtr> * neighbors = nullptr;
 	INetworkEdgePtr netEdge = nullptr;
 
-	if (Edge)
-	{
-		neighbors = dir == QueryDirection::Forward ? &Edge->AdjacentForward : &Edge->AdjacentBackward;
-		netEdge = Edge->NetEdge;
-	}
-	else
+	if (Edge) neighbors = dir == QueryDirection::Forward ? &Edge->AdjacentForward : &Edge->AdjacentBackward;
+	else neighbors = neighborPool.New();
+
+	if (neighbors->empty() && HasGraphSnapshot())
 	{
-		neighbors = new DEBUG_NEW_PLACEMENT ArrayList<NAEdgePtr>();
-		GarbageNeighborList.push_back(neighbors);
+		// the snapshot already knows the star of this junction so we only have to map each entry to its NAEdge
+		NAGraphStarItr begin, end;
+		if (dir == QueryDirection::Forward) graph->ForwardStar(ToVertex->EID, begin, end);
+		else graph->BackwardStar(ToVertex->EID, begin, end);
+
+		neighbors->Init((UINT8)(end - begin));
+		for (UINT8 i = 0; begin != end; ++begin, ++i)
+		{
+			NAEdgePtr adj = this->New(graph->GetEID(*begin), (esriNetworkEdgeDirection)graph->GetDirection(*begin));
+			if (!adj) return E_FAIL;
+			neighbors->at(i, adj);
+		}
 	}
-	if (neighbors->empty())
+	else if (neighbors->empty())
 	{
 		star = dir == QueryDirection::Forward ? ipForwardStar: ipBackwardStar;
+		if (Edge && !(netEdge = Edge->GetNetEdge())) return E_POINTER;
+		if (!ToVertex->Junction) return E_POINTER;
 
 		if (FAILED(hr = star->QueryAdjacencies(ToVertex->Junction, netEdge, nullptr, ipAdjacencies))) return hr;
 		if (FAILED(hr = ipAdjacencies->get_Count(&adjacentEdgeCount))) return hr;
@@ -458,128 +594,52 @@ HRESULT NAEdgeCache::QueryAdjacencies(NAVertexPtr ToVertex, NAEdgePtr Edge, Quer
 	return hr;
 }
 
-//******************************************************************************************/
-// NAEdgeMap Methods
-
-bool NAEdgeMap::Exist(long eid, esriNetworkEdgeDirection dir)
+HRESULT NAEdgeCache::QueryJunction(NAEdgePtr edge, QueryDirection dir, long & junctionEID)
 {
-	NAEdgeTable * cache = nullptr;
-
-	if (dir == esriNEDAlongDigitized) cache = cacheAlong;
-	else cache = cacheAgainst;
+	HRESULT hr = S_OK;
+	NAGraphEdgeIndex e = HasGraphSnapshot() ? graph->Find(edge->EID, (EdgeDirection)edge->Direction) : NAGraphSnapshot::NoEdge;
+	if (e != NAGraphSnapshot::NoEdge)
+	{
+		junctionEID = dir == QueryDirection::Forward ? graph->GetToJunction(e) : graph->GetFromJunction(e);
+		return hr;
+	}
 
-	return cache->find(eid) != cache->end();
+	INetworkEdgePtr netEdge = edge->GetNetEdge();
+	if (!netEdge) return E_POINTER;
+	if (dir == QueryDirection::Forward) hr = netEdge->QueryJunctions(nullptr, ipCurrentJunction);
+	else hr = netEdge->QueryJunctions(ipCurrentJunction, nullptr);
+	if (FAILED(hr)) return hr;
+	return ipCurrentJunction->get_EID(&junctionEID);
 }
 
-const NAEdgePtr NAEdgeMap::Find(const NAEdgePtr edge) const
-{
-	std::unordered_map<long, NAEdgePtr> * cache = nullptr;
-	if (edge->Direction == esriNEDAlongDigitized) cache = cacheAlong;
-	else cache = cacheAgainst;
-
-	std::unordered_map<long, NAEdgePtr>::const_iterator it = cache->find(edge->EID);
-	NAEdgePtr o = nullptr;
-	if (it != cache->end()) o = it->second;
-	return o;
-}
+//******************************************************************************************/
+// NAEdgeMap Methods
 
 void NAEdgeMap::GetDirtyEdges(std::vector<NAEdgePtr> & dirty) const
 {
-	for (const auto i : *cacheAlong)   if (i.second->GetDirtyState() != EdgeDirtyState::CleanState) dirty.push_back(i.second);
-	for (const auto i : *cacheAgainst) if (i.second->GetDirtyState() != EdgeDirtyState::CleanState) dirty.push_back(i.second);
+	ForEachMember([&dirty](NAEdgePtr e) { if (e->GetDirtyState() != EdgeDirtyState::CleanState) dirty.push_back(e); });
 }
 
-void NAEdgeMap::Erase(long eid, esriNetworkEdgeDirection dir)
+void NAEdgeMap::GetMembers(std::vector<NAEdgePtr> & members) const
 {
-	NAEdgeTable * cache = nullptr;
-	if (dir == esriNEDAlongDigitized) cache = cacheAlong;
-	else cache = cacheAgainst;
-
-	NAEdgeTableItr i = cache->find(eid);
-	if (i != cache->end()) cache->erase(i);
-}
-
-HRESULT NAEdgeMap::Insert(NAEdgePtr edge)
-{
-	NAEdgeTable * cache = nullptr;
-
-	if (edge->Direction == esriNEDAlongDigitized) cache = cacheAlong;
-	else cache = cacheAgainst;
-
-	if (cache->find(edge->EID) != cache->end()) return E_FAIL;
-	cache->insert(NAEdgeTablePair(edge));
-
-	return S_OK;
-}
-
-HRESULT NAEdgeMap::Insert(NAEdgeMap * edges)
-{
-	cacheAlong->rehash(cacheAlong->size() + edges->cacheAlong->size());
-	cacheAgainst->rehash(cacheAgainst->size() + edges->cacheAgainst->size());
-	NAEdgeTableItr i;
-	for(i = edges->cacheAlong->begin(); i != edges->cacheAlong->end(); i++)
-		if (cacheAlong->find(i->first) == cacheAlong->end()) cacheAlong->insert(NAEdgeTablePair(i->second));
-	for(i = edges->cacheAgainst->begin(); i != edges->cacheAgainst->end(); i++)
-		if (cacheAgainst->find(i->first) == cacheAgainst->end()) cacheAgainst->insert(NAEdgeTablePair(i->second));
-	return S_OK;
+	ForEachMember([&members](NAEdgePtr e) { members.push_back(e); });
 }
 
 void NAEdgeMap::Clear(bool destroyTreePrevious)
 {
-	if (destroyTreePrevious)
-	{
-		for (auto e : *cacheAlong)   e.second->TreePrevious = nullptr;
-		for (auto e : *cacheAgainst) e.second->TreePrevious = nullptr;
-	}
-	cacheAlong->clear();
-	cacheAgainst->clear();
+	if (destroyTreePrevious) ForEachMember([](NAEdgePtr e) { e->TreePrevious = nullptr; });
+	Reset();
 }
 
 //******************************************************************************************/
 // NAEdgeMapTwoGen Methods
 
-void NAEdgeMapTwoGen::MarkAllAsOldGen()
-{
-	oldGen->Insert(newGen);
-	newGen->Clear();
-}
-
 void NAEdgeMapTwoGen::Clear(NAEdgeMapGeneration gen, bool destroyTreePrevious)
 {
 	if (CheckFlag(gen, NAEdgeMapGeneration::OldGen)) oldGen->Clear(destroyTreePrevious);
 	if (CheckFlag(gen, NAEdgeMapGeneration::NewGen)) newGen->Clear(destroyTreePrevious);
 }
 
-size_t NAEdgeMapTwoGen::Size(NAEdgeMapGeneration gen)
-{
-	size_t t = 0;
-	if (CheckFlag(gen, NAEdgeMapGeneration::OldGen)) t += oldGen->Size();
-	if (CheckFlag(gen, NAEdgeMapGeneration::NewGen)) t += newGen->Size();
-	return t;
-}
-
-HRESULT NAEdgeMapTwoGen::Insert(NAEdgePtr edge, NAEdgeMapGeneration gen)
-{
-	HRESULT hr = S_OK;
-	if (CheckFlag(gen, NAEdgeMapGeneration::OldGen)) if (FAILED(hr = oldGen->Insert(edge))) return hr;
-	if (CheckFlag(gen, NAEdgeMapGeneration::NewGen)) if (FAILED(hr = newGen->Insert(edge))) return hr;
-	return hr;
-}
-
-bool NAEdgeMapTwoGen::Exist(long eid, esriNetworkEdgeDirection dir, NAEdgeMapGeneration gen)
-{
-	bool e = false;
-	if (CheckFlag(gen, NAEdgeMapGeneration::OldGen)) e |= oldGen->Exist(eid, dir);
-	if (CheckFlag(gen, NAEdgeMapGeneration::NewGen)) e |= newGen->Exist(eid, dir);
-	return e;
-}
-
-void NAEdgeMapTwoGen::Erase(NAEdgePtr edge, NAEdgeMapGeneration gen)
-{
-	if (CheckFlag(gen, NAEdgeMapGeneration::OldGen)) oldGen->Erase(edge);
-	if (CheckFlag(gen, NAEdgeMapGeneration::NewGen)) newGen->Erase(edge);
-}
-
 //******************************************************************************************/
 // NAEdgeContainer Methods
 
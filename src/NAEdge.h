@@ -15,23 +15,43 @@
 #include "StdAfx.h"
 #include "Evacuee.h"
 #include "TrafficModel.h"
+#include "EdgeCost.h"
+#include "NAGraph.h"
+#include "CellOverlay.h"
+#include "BidirectionalSearch.h"
+#include "ParallelSPT.h"
+#include "IndexedHeap.h"
+#include "EpochMap.h"
+#include "Reservations.h"
 #include "utils.h"
 
-class EdgeReservations : private std::vector<EvcPathPtr>
+// The paths that reserved an edge in the order they first reserved it along with the evacuation costs of the complete ones
+class EdgeReservations
 {
 private:
+	ReservationOrder<EvcPathPtr, EvcPath::PtrHasher, EvcPath::PtrEqual> paths;
 	double         ReservedPop;
 	double         Capacity;
 	EdgeDirtyState dirtyState;
-	TrafficModel   * myTrafficModel;
+	const TrafficModel * myTrafficModel;
+	unsigned long long changeStamp;
+	ReservedCostSet reservedCosts;
 
 public:
-	EdgeReservations(float capacity, TrafficModel * trafficModel);
+	typedef ReservationOrder<EvcPathPtr, EvcPath::PtrHasher, EvcPath::PtrEqual>::const_iterator const_iterator;
+
+	// distinct reserved paths in the order they first reserved this edge
+	const_iterator begin() const { return paths.begin(); }
+	const_iterator end()   const { return paths.end(); }
+	inline bool    empty() const { return paths.empty(); }
+
+	EdgeReservations(float capacity, const TrafficModel * trafficModel);
 	EdgeReservations(const EdgeReservations& cpy);
 	EdgeReservations & operator=(const EdgeReservations &) = delete;
 	void AddReservation(double newFlow, EvcPathPtr path);
 	void RemoveReservation(double flow, EvcPathPtr path);
 	void SwapReservation(const EvcPathPtr oldPath, const EvcPathPtr newPath);
+	inline double MaxReservedCost() const { return reservedCosts.Max(); }
 
 	friend class NAEdge;
 };
@@ -49,7 +69,16 @@ private:
 	IGeometryPtr myGeometry;
 	EdgeReservations * reservations;
 	double CleanCost;
-	double GetTrafficSpeedRatio(double allPop, EvcSolverMethod method) const;
+
+	// CARMA heuristic of the junction this edge leaves through this edge and the next edge of the same junction
+	double   carmaH;
+	NAEdge * nextHEdge;
+	long     hJunction;
+	friend class NAHeuristicTable;
+
+	// an edge made from the graph snapshot asks the network for its element only the first time somebody needs it
+	mutable INetworkEdgePtr netEdge;
+	INetworkQuery         * networkQuery;
 
 public:
 	double OriginalCost;
@@ -57,13 +86,14 @@ public:
 	NAVertex * ToVertex;
 	NAEdge * TreePrevious;
 	GrowingArrayList<NAEdge *> TreeNext;
-	INetworkEdgePtr NetEdge;
 	long EID;
 	ArrayList<NAEdge *> AdjacentForward;
 	ArrayList<NAEdge *> AdjacentBackward;
+	size_t HeapHandle;
 
 	EdgeDirtyState HowDirty(EvcSolverMethod method, double minPop2Route = 1.0, bool exhaustive = false);
 	double GetCost(double newPop, EvcSolverMethod method, double * globalDeltaCost = nullptr) const;
+	template <class TrafficPolicy> double GetCost(double newPop, EvcSolverMethod method, double * globalDeltaCost = nullptr) const;
 	double GetCurrentCost(EvcSolverMethod method = EvcSolverMethod::CASPERSolver) const;
 	double LeftCapacity() const;
 	bool ApplyNewOriginalCostAndCapacity(double NewOriginalCost, double NewOriginalCapacity, bool DelayHowDirty, EvcSolverMethod method);
@@ -72,21 +102,33 @@ public:
 	// Special function for Flocking: to check how much capacity the edge had originally
 	double OriginalCapacity() const { return reservations->Capacity; }
 
+	INetworkEdgePtr GetNetEdge() const;
 	HRESULT QuerySourceStuff(long * sourceOID, long * sourceID, double * fromPosition, double * toPosition) const;
 	void AddReservation(EvcPath * path, EvcSolverMethod method, bool delayedDirtyState = false);
-	NAEdge(INetworkEdgePtr, long capacityAttribID, long costAttribID, const NAEdge * otherEdge, bool twoWayRoadsShareCap, std::list<EdgeReservationsPtr> & ResTable, TrafficModel * model);
+	NAEdge(INetworkEdgePtr, long capacityAttribID, long costAttribID, const NAEdge * otherEdge, bool twoWayRoadsShareCap, SlabPool<EdgeReservations> & reservationPool, const TrafficModel * model);
+	NAEdge(INetworkQuery * query, long eid, esriNetworkEdgeDirection dir, double cost, float capacity, const NAEdge * otherEdge, bool twoWayRoadsShareCap, SlabPool<EdgeReservations> & reservationPool, const TrafficModel * model);
 	NAEdge(const NAEdge & cpy);
 	NAEdge & operator=(const NAEdge &) = delete;
 
 	inline EdgeDirtyState GetDirtyState() const { return reservations->dirtyState; }
+	inline unsigned long long GetChangeStamp() const { return reservations->changeStamp; }
 	inline void SetClean(EvcSolverMethod method, double minPop2Route);
 	inline double GetCleanCost() const { return CleanCost; }
+	inline double GetCarmaH()    const { return carmaH;    }
+	inline long   GetHJunction() const { return hJunction; }
 	double GetReservedPop() const { return reservations->ReservedPop; }
 	HRESULT GetGeometry(INetworkDatasetPtr ipNetworkDataset, IFeatureClassContainerPtr ipFeatureClassContainer, bool & sourceNotFoundFlag, IGeometryPtr & geometry);
 	void RemoveReservation(EvcPathPtr path, EvcSolverMethod method, bool delayedDirtyState = false);
 	void SwapReservation(const EvcPathPtr oldPath, const EvcPathPtr newPath) { reservations->SwapReservation(oldPath, newPath); }
-	void GetUniqeCrossingPaths(std::vector<EvcPathPtr> & crossings, bool cleanVectorFirst = false);
+	void CommitReservedCost(double cost) { reservations->reservedCosts.Add(cost); }
+	void GetUniqeCrossingPaths(std::vector<EvcPathPtr> & crossings, bool cleanVectorFirst = false) const;
+	template <class Visitor> inline void ForEachCrossingPath(Visitor visit) const { for (const auto & p : *reservations) visit(p); }
 	double MaxAddedCostOnReservedPathsWithNewFlow(double deltaCostOfNewFlow, double longestPathSoFar, double currentPathSoFar, double selfishRatio) const;
+
+	// the cost of an edge with these attributes that already carries 'reservedPop' once 'newPop' more people are routed on it.
+	// 'GetCost' is this on the edge's own attributes; the snapshot searches use it for the edges nobody has created yet.
+	template <class TrafficPolicy> static double CapacityAwareCost(const TrafficModel * model, double originalCost, double capacity, double reservedPop, double newPop,
+		EvcSolverMethod method, double * globalDeltaCost = nullptr);
 	HRESULT InsertEdgeToFeatureCursor(INetworkDatasetPtr ipNetworkDataset, IFeatureClassContainerPtr ipFeatureClassContainer, IFeatureBufferPtr ipFeatureBuffer, IFeatureCursorPtr ipFeatureCursor,
 									  long eidFieldIndex, long sourceIDFieldIndex, long sourceOIDFieldIndex, long dirFieldIndex, long resPopFieldIndex, long travCostFieldIndex,
 									  long orgCostFieldIndex, long congestionFieldIndex, bool & sourceNotFoundFlag);
@@ -100,25 +142,44 @@ public:
 	static double GetHeapKeyHur(const NAEdge * e);
 	static double GetHeapKeyNonHur(const NAEdge * e);
 	static bool   IsEqualNAEdgePtr(const NAEdge * n1, const NAEdge * n2);
+
+	// compile-time key extractors and handle accessor for the indexed search heaps
+	struct HeapKeyHur    { double   operator()(const NAEdge * e) const { return GetHeapKeyHur(e);    } };
+	struct HeapKeyNonHur { double   operator()(const NAEdge * e) const { return GetHeapKeyNonHur(e); } };
+	struct HeapHandleOf  { size_t & operator()(NAEdge * e)       const { return e->HeapHandle;       } };
 	
+	// edges are re-costed in batches: see NAEdge.Batch.cpp
+	static const size_t BatchSize = EdgeCostBatch::Size;
+	static void HowDirtyBatch(NAEdge * const * edges, size_t count, EvcSolverMethod method, double minPop2Route);
+	static void SetCleanBatch(NAEdge * const * edges, size_t count, EvcSolverMethod method, double minPop2Route);
+
 	template<class iterator_type> static void HowDirtyExhaustive(iterator_type begin, iterator_type end, EvcSolverMethod method, double minPop2Route)
 	{
-		NAEdgePtr edge = nullptr;
+		NAEdgePtr batch[BatchSize];
+		size_t count = 0;
 		for (iterator_type i = begin; i != end; ++i)
 		{
-			edge = *i;
-			if (edge->CleanCost <= 0.0) edge->reservations->dirtyState = EdgeDirtyState::CostIncreased;
-			else
-			{
-				edge->reservations->dirtyState = EdgeDirtyState::CleanState;
-				double costchange = (edge->GetCost(minPop2Route, method) / edge->CleanCost) - 1.0;
-				if (costchange > FLT_EPSILON) edge->reservations->dirtyState = EdgeDirtyState::CostIncreased;
-				if (costchange < -FLT_EPSILON) edge->reservations->dirtyState = EdgeDirtyState::CostDecreased;
-			}
+			batch[count++] = *i;
+			if (count == BatchSize) { HowDirtyBatch(batch, count, method, minPop2Route); count = 0; }
 		}
+		if (count > 0) HowDirtyBatch(batch, count, method, minPop2Route);
 	}
 };
 
+// the math lives in EdgeCost.h so that the batch kernel can be tested against it
+template <class TrafficPolicy> inline double NAEdge::CapacityAwareCost(const TrafficModel * model, double originalCost, double capacity, double reservedPop, double newPop,
+	EvcSolverMethod method, double * globalDeltaCost)
+{
+	double cost = ::CapacityAwareCost<TrafficPolicy>(model, originalCost, capacity, reservedPop, newPop, method, globalDeltaCost);
+	_ASSERT(!globalDeltaCost || cost >= CASPER_INFINITY || *globalDeltaCost >= 0.0);
+	return cost;
+}
+
+template <class TrafficPolicy> inline double NAEdge::GetCost(double newPop, EvcSolverMethod method, double * globalDeltaCost) const
+{
+	return CapacityAwareCost<TrafficPolicy>(reservations->myTrafficModel, OriginalCost, reservations->Capacity, reservations->ReservedPop, newPop, method, globalDeltaCost);
+}
+
 typedef NAEdge * NAEdgePtr;
 
 // hash functor for NAEdgePtr
@@ -151,70 +212,52 @@ typedef std::unordered_map<long, NAEdgePtr>::const_iterator NAEdgeTableItr;
 typedef std::pair<long, NAEdgePtr> _NAEdgeTablePair;
 #define NAEdgeTablePair(a) _NAEdgeTablePair(a->EID, a)
 
-class NAEdgeMap
+// dense slot of a directed edge for the epoch maps: the EID and the direction bit
+struct NAEdgeSlot
 {
-private:
-	NAEdgeTable * cacheAlong;
-	NAEdgeTable * cacheAgainst;
+	static inline size_t Of(long eid, esriNetworkEdgeDirection dir) { return (size_t)eid * 2 + (dir == esriNEDAgainstDigitized ? 1 : 0); }
+	static inline size_t Of(const NAEdge * edge) { return Of(edge->EID, edge->Direction); }
+	inline size_t operator()(const NAEdge * edge) const { return Of(edge); }
+};
 
+// The edge cache keeps exactly one NAEdge per EID and direction so an epoch map over the edge slots is all a closed list needs.
+class NAEdgeMap : public EpochMap<NAEdgePtr, NAEdgeSlot>
+{
 public:
+	NAEdgeMap(void) { }
+	virtual ~NAEdgeMap(void) { }
+
 	NAEdgeMap(const NAEdgeMap & that) = delete;
 	NAEdgeMap & operator=(const NAEdgeMap &) = delete;
 
-	NAEdgeMap(void)
-	{
-		cacheAlong = new DEBUG_NEW_PLACEMENT std::unordered_map<long, NAEdgePtr>();
-		cacheAgainst = new DEBUG_NEW_PLACEMENT std::unordered_map<long, NAEdgePtr>();
-	}
-
-	virtual ~NAEdgeMap(void)
-	{
-		Clear();
-		delete cacheAlong;
-		delete cacheAgainst;
-	}
-	
 	void GetDirtyEdges(std::vector<NAEdgePtr> & dirty) const;
+	void GetMembers(std::vector<NAEdgePtr> & members) const;
 	void Erase(NAEdgePtr edge) {        Erase(edge->EID, edge->Direction)  ; }
 	bool Exist(NAEdgePtr edge) { return Exist(edge->EID, edge->Direction)  ; }
 	void Clear(bool destroyTreePrevious = false);
-	size_t Size()              { return cacheAlong->size() + cacheAgainst->size(); }
-	HRESULT Insert(NAEdgePtr   edge );
-	HRESULT Insert(NAEdgeMap * edges);
-	bool Exist(long eid, esriNetworkEdgeDirection dir);
-	void Erase(long eid, esriNetworkEdgeDirection dir);
-	const NAEdgePtr Find(const NAEdgePtr edge) const;
+	size_t Size()              { return EpochMap::Size(); }
+	HRESULT Insert(NAEdgePtr   edge ) { return Add(edge) ? S_OK : E_FAIL; }
+	HRESULT Insert(NAEdgeMap * edges) { Add(*edges); return S_OK; }
+	bool Exist(long eid, esriNetworkEdgeDirection dir) { return Contains(NAEdgeSlot::Of(eid, dir)); }
+	void Erase(long eid, esriNetworkEdgeDirection dir) { Remove(NAEdgeSlot::Of(eid, dir)); }
+	const NAEdgePtr Find(const NAEdgePtr edge) const   { return Contains(NAEdgeSlot::Of(edge)) ? edge : nullptr; }
 };
 
-class NAEdgeMapTwoGen
+class NAEdgeMapTwoGen : public EpochMapTwoGen<NAEdgeMap>
 {
 public:
-	NAEdgeMap * oldGen;
-	NAEdgeMap * newGen;
+	NAEdgeMapTwoGen(void) { }
+	virtual ~NAEdgeMapTwoGen(void) { }
 
 	NAEdgeMapTwoGen(const NAEdgeMapTwoGen & that) = delete;
 	NAEdgeMapTwoGen & operator=(const NAEdgeMapTwoGen &) = delete;
 
-	NAEdgeMapTwoGen(void)
-	{
-		oldGen = new DEBUG_NEW_PLACEMENT NAEdgeMap();
-		newGen = new DEBUG_NEW_PLACEMENT NAEdgeMap();
-	}
-
-	virtual ~NAEdgeMapTwoGen(void)
-	{
-		Clear(NAEdgeMapGeneration::AllGens);
-		delete oldGen;
-		delete newGen;
-	}
-
-	void MarkAllAsOldGen();
 	bool Exist(NAEdgePtr edge, NAEdgeMapGeneration gen = NAEdgeMapGeneration::AllGens) { return Exist(edge->EID, edge->Direction, gen); }
-	void Erase(NAEdgePtr edge, NAEdgeMapGeneration gen = NAEdgeMapGeneration::AllGens);
+	void Erase(NAEdgePtr edge, NAEdgeMapGeneration gen = NAEdgeMapGeneration::AllGens) { Remove(NAEdgeSlot::Of(edge), gen); }
 	void Clear(NAEdgeMapGeneration gen, bool destroyTreePrevious = false);
-	size_t Size(NAEdgeMapGeneration gen = NAEdgeMapGeneration::NewGen);
-	HRESULT Insert(NAEdgePtr edge, NAEdgeMapGeneration gen = NAEdgeMapGeneration::NewGen);
-	bool Exist(long eid, esriNetworkEdgeDirection dir, NAEdgeMapGeneration gen = NAEdgeMapGeneration::AllGens);
+	size_t Size(NAEdgeMapGeneration gen = NAEdgeMapGeneration::NewGen) { return EpochMapTwoGen::Size(gen); }
+	HRESULT Insert(NAEdgePtr edge, NAEdgeMapGeneration gen = NAEdgeMapGeneration::NewGen) { return Add(edge, gen) ? S_OK : E_FAIL; }
+	bool Exist(long eid, esriNetworkEdgeDirection dir, NAEdgeMapGeneration gen = NAEdgeMapGeneration::AllGens) { return Contains(NAEdgeSlot::Of(eid, dir), gen); }
 };
 
 typedef std::pair<long, unsigned char> NAEdgeContainerPair;
@@ -257,12 +300,15 @@ public:
 	bool IsEmpty() const { return cache->empty(); }
 };
 
+// walks the network dataset once and fills the snapshot with every edge the forward star does not restrict: see NAGraph.Build.cpp
+HRESULT BuildGraphSnapshot(NAGraphSnapshot & graph, INetworkQueryPtr ipNetworkQuery, INetworkForwardStarExPtr ipForwardStar, long capacityAttribID, long costAttribID);
+
 // This collection object has two jobs:
 // it makes sure that there exist only one copy of an edge in it that is connected to each INetworkEdge.
 // this will be helpful to avoid duplicate copies pointing to the same edge structure. So data attached
 // to edge will be always fresh and there will be no inconsistency. Care has to be taken not to overwrite
-// important edges with new ones. The second job is just a GC. since all edges are being new-ed here,
-// it can all be deleted at the end here as well.
+// important edges with new ones. The second job is just a GC. since all edges are being allocated here from
+// the slab pools, they can all be destroyed at the end here as well in one sweep.
 class NAEdgeCache
 {
 private:
@@ -272,26 +318,85 @@ private:
 	mutable bool	IsSourceCache;
 	NAEdgeTable		* cacheAlong;
 	NAEdgeTable		* cacheAgainst;
-	std::list<ArrayList<NAEdgePtr> *> GarbageNeighborList;
-	std::list<EdgeReservationsPtr> ResTable;
+	SlabPool<NAEdge>                edgePool;
+	SlabPool<EdgeReservations>      reservationPool;
+	SlabPool<ArrayList<NAEdgePtr>>  neighborPool;
 	TrafficModel    * myTrafficModel;
 	INetworkEdgePtr ipCurrentEdge;
+	INetworkJunctionPtr ipCurrentJunction;
 	INetworkQueryPtr                  ipNetworkQuery;
 	INetworkForwardStarExPtr          ipForwardStar;
 	INetworkForwardStarExPtr          ipBackwardStar;
 	INetworkForwardStarAdjacenciesPtr ipAdjacencies;
+	NAGraphSnapshotPtr                graph;
+	NACellOverlayPtr                  overlay;
+	NABidirectionalSearchPtr          bidirectional;
+	ParallelBackwardSPTPtr            parallelSPT;
+	std::vector<NAEdgePtr>            snapshotEdges;
+	std::vector<NAGraphEdgeIndex>     createdSnapshotEdges;
+
+	// the cost table of 'GetSnapshotCosts' and what it takes to bring it up to date
+	std::vector<double>               costTable;
+	std::vector<double>               costTableSlack;
+	std::vector<NAGraphEdgeIndex>     costTableBySlack;
+	std::vector<NAGraphEdgeIndex>     costTableTracked;
+	std::vector<char>                 costTableIsTracked;
+	std::vector<NAGraphEdgeIndex>     costTableChanged;
+	std::vector<char>                 costTableIsChanged;
+	bool                              costTableRebuilt;
+	double                            costTablePop;
+	EvcSolverMethod                   costTableMethod;
+	unsigned long long                costTableStamp;
+	void TrackCostTableEdge(NAGraphEdgeIndex e);
+	void SetCostTableEntry(NAGraphEdgeIndex e, double c);
+
+	// Two directions that share their capacity take the one of the along direction no matter which of them is made first.
+	// This is the capacity 'New' gives a snapshot edge.
+	inline float GetSnapshotCapacity(NAGraphEdgeIndex e) const
+	{
+		NAGraphEdgeIndex along = twoWayRoadsShareCap ? graph->Find(graph->GetEID(e), EdgeDirection::Along) : NAGraphSnapshot::NoEdge;
+		return graph->GetCapacity(along != NAGraphSnapshot::NoEdge ? along : e);
+	}
+
+	// what the edge of a snapshot index would be made of: the edge itself if it exists, otherwise the snapshot attributes
+	// with the reservations of the other direction of the road if the two share their capacity
+	inline void GetSnapshotAttributes(NAGraphEdgeIndex e, double & originalCost, double & capacity, double & reservedPop) const
+	{
+		NAEdgePtr edge = snapshotEdges[e];
+		if (edge)
+		{
+			originalCost = edge->OriginalCost;
+			capacity = edge->OriginalCapacity();
+			reservedPop = edge->GetReservedPop();
+			return;
+		}
+		NAGraphEdgeIndex other = twoWayRoadsShareCap ? graph->Find(graph->GetEID(e), graph->GetDirection(e) == EdgeDirection::Along ? EdgeDirection::Against : EdgeDirection::Along)
+			: NAGraphSnapshot::NoEdge;
+		edge = other != NAGraphSnapshot::NoEdge ? snapshotEdges[other] : nullptr;
+		originalCost = max(FLT_MIN, graph->GetCost(e));
+		capacity = edge ? edge->OriginalCapacity() : max(1.0f, GetSnapshotCapacity(e));
+		reservedPop = edge ? edge->GetReservedPop() : 0.0;
+	}
 
 public:
 
 	NAEdgeCache(long CapacityAttribID, long CostAttribID, double SaturationPerCap, double CriticalDensPerCap, bool TwoWayRoadsShareCap, double InitDelayCostPerPop,
-		EvcTrafficModel model, INetworkForwardStarExPtr _ipForwardStar, INetworkForwardStarExPtr _ipBackwardStar, INetworkQueryPtr _ipNetworkQuery, HRESULT & hr)
+		EvcTrafficModel model, const SpeedDensityTable & speedTable, INetworkForwardStarExPtr _ipForwardStar, INetworkForwardStarExPtr _ipBackwardStar, INetworkQueryPtr _ipNetworkQuery, HRESULT & hr)
 	{
 		IsSourceCache = false;
+		graph = nullptr;
+		overlay = nullptr;
+		bidirectional = nullptr;
+		parallelSPT = nullptr;
+		costTablePop = -1.0;
+		costTableRebuilt = false;
+		costTableMethod = EvcSolverMethod::CASPERSolver;
+		costTableStamp = 0;
 		capacityAttribID = CapacityAttribID;
 		costAttribID = CostAttribID;
 		cacheAlong = new DEBUG_NEW_PLACEMENT std::unordered_map<long, NAEdgePtr>();
 		cacheAgainst = new DEBUG_NEW_PLACEMENT std::unordered_map<long, NAEdgePtr>();
-		myTrafficModel = new DEBUG_NEW_PLACEMENT TrafficModel(model, CriticalDensPerCap, SaturationPerCap, InitDelayCostPerPop);
+		myTrafficModel = new DEBUG_NEW_PLACEMENT TrafficModel(model, CriticalDensPerCap, SaturationPerCap, InitDelayCostPerPop, speedTable);
 		twoWayRoadsShareCap = TwoWayRoadsShareCap;
 
 		// network variables init
@@ -302,6 +407,8 @@ public:
 		if (FAILED(hr = ipNetworkQuery->CreateForwardStarAdjacencies(&ipAdjacencies))) return;
 		if (FAILED(hr = ipNetworkQuery->CreateNetworkElement(esriNETEdge, &ipEdgeElement))) return;
 		ipCurrentEdge = ipEdgeElement;
+		if (FAILED(hr = ipNetworkQuery->CreateNetworkElement(esriNETJunction, &ipEdgeElement))) return;
+		ipCurrentJunction = ipEdgeElement;
 	}
 
 	void InitSourceCache() const
@@ -340,15 +447,71 @@ public:
 	NAEdgePtr New(INetworkEdgePtr edge);
 
 	INetworkQueryPtr GetNetworkQuery()  { return ipNetworkQuery;        }
+	void SetGraphSnapshot(NAGraphSnapshotPtr snapshot)
+	{
+		graph = snapshot;
+		snapshotEdges.assign(graph ? graph->EdgeCount() : 0, nullptr);
+	}
+	bool HasGraphSnapshot()       const { return graph && !graph->IsEmpty(); }
+	NAGraphSnapshotPtr GetGraphSnapshot() const { return graph; }
+	void SetCellOverlay(NACellOverlayPtr _overlay) { overlay = _overlay; }
+	NACellOverlayPtr GetCellOverlay() const { return overlay; }
+	void SetBidirectionalSearch(NABidirectionalSearchPtr search) { bidirectional = search; }
+	NABidirectionalSearchPtr GetBidirectionalSearch() const { return bidirectional; }
+	void SetParallelSPT(ParallelBackwardSPTPtr spt) { parallelSPT = spt; }
+	ParallelBackwardSPTPtr GetParallelSPT() const { return parallelSPT; }
 	NAEdgeTableItr AlongBegin()   const { return cacheAlong->begin();   }
 	NAEdgeTableItr AlongEnd()     const { return cacheAlong->end();     }
 	NAEdgeTableItr AgainstBegin() const { return cacheAgainst->begin(); }
 	NAEdgeTableItr AgainstEnd()   const { return cacheAgainst->end();   }
 	double GetInitDelayPerPop()   const { return myTrafficModel->InitDelayCostPerPop;  }
 	NAEdgePtr Get(long eid, esriNetworkEdgeDirection dir) const;
+
+	// The snapshot searches cost every edge they scan but only the edges of a committed path need an NAEdge. These give the
+	// cost and the room left before congestion of a snapshot edge without creating it; both match the NAEdge that 'New' would make.
+	NAEdgePtr GetSnapshotEdge(NAGraphEdgeIndex e) const { return snapshotEdges[e]; }
+	template <class TrafficPolicy> double GetSnapshotCost(NAGraphEdgeIndex e, double newPop, EvcSolverMethod method) const
+	{
+		double originalCost, capacity, reservedPop;
+		GetSnapshotAttributes(e, originalCost, capacity, reservedPop);
+		return NAEdge::CapacityAwareCost<TrafficPolicy>(myTrafficModel, originalCost, capacity, reservedPop, newPop, method);
+	}
+	double GetSnapshotSlack(NAGraphEdgeIndex e) const
+	{
+		double originalCost, capacity, reservedPop;
+		GetSnapshotAttributes(e, originalCost, capacity, reservedPop);
+		return myTrafficModel->CriticalDensPerCap * capacity - reservedPop;
+	}
+	double GetSnapshotCost(NAGraphEdgeIndex e, double newPop, EvcSolverMethod method) const;
+
+	// The cost of every snapshot edge for 'newPop' on the current reservations, kept from one call to the next. Only the edges
+	// whose change stamp moved since the last call and, for a new 'newPop', the edges whose slack is below the larger of the two
+	// populations are costed again. The table is only valid until the next reservation change.
+	const std::vector<double> & GetSnapshotCosts(double newPop, EvcSolverMethod method);
+
+	// Calls 'changed(e)' for every entry of the cost table whose value moved since the last drain, or for every entry if the
+	// table was built again, and forgets them. A copy of the table such as the cell overlay stays in sync this way.
+	template <class Changed> void DrainSnapshotCostChanges(Changed changed)
+	{
+		if (costTableRebuilt) for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)costTable.size(); ++e) changed(e);
+		else for (const auto e : costTableChanged) changed(e);
+		for (const auto e : costTableChanged) costTableIsChanged[e] = 0;
+		costTableChanged.clear();
+		costTableRebuilt = false;
+	}
 	size_t Size() const { return cacheAlong->size() + cacheAgainst->size(); }
 	void Clear();
 	void CleanAllEdgesAndRelease(double minPop2Route, EvcSolverMethod solver);
 	double GetCacheHitPercentage() const { return myTrafficModel->GetCacheHitPercentage(); }
+	size_t EdgeAllocationCount()        const { return edgePool.AllocationCount();        }
+	size_t ReservationAllocationCount() const { return reservationPool.AllocationCount(); }
+	size_t NeighborAllocationCount()    const { return neighborPool.AllocationCount();    }
+	size_t SlabBytes() const { return edgePool.SlabBytes() + reservationPool.SlabBytes() + neighborPool.SlabBytes(); }
 	HRESULT QueryAdjacencies(NAVertexPtr ToVertex, NAEdgePtr Edge, QueryDirection dir, ArrayList<NAEdgePtr> ** neighbors);
+
+	// EID of the junction the edge goes to (forward) or comes from (backward). The snapshot knows it without asking the network dataset.
+	HRESULT QueryJunction(NAEdgePtr edge, QueryDirection dir, long & junctionEID);
+
+	// the network query a new vertex needs to look up its network junction. adjacency queries on the snapshot never use that junction.
+	INetworkQueryPtr GetJunctionQuery() const { return HasGraphSnapshot() ? nullptr : ipNetworkQuery; }
 };
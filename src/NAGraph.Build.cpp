@@ -0,0 +1,69 @@
+// ===============================================================================================
+// Evacuation Solver: Graph snapshot from a network dataset
+// Description: Builds the CSR copy of the network by walking all edges of the network dataset
+// once. This is the only part of the snapshot that talks to ArcObjects.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "StdAfx.h"
+#include "NAEdge.h"
+
+// Walks every edge element of the network dataset in both directions and records the ones that are not restricted
+// by the (already setup) forward star. Restricted junctions drop all edges touching them just like the forward star does.
+HRESULT BuildGraphSnapshot(NAGraphSnapshot & graph, INetworkQueryPtr ipNetworkQuery, INetworkForwardStarExPtr ipForwardStar, long capacityAttribID, long costAttribID)
+{
+	HRESULT hr = S_OK;
+	long edgeCount = 0, fromEID = -1, toEID = -1;
+	VARIANT_BOOL isRestricted = VARIANT_FALSE;
+	VARIANT vcost, vcap;
+	float capacity = 1.0;
+	double cost = 1.0;
+	INetworkElementPtr ipElement;
+	std::vector<NAGraphEdge> edges;
+	const esriNetworkEdgeDirection dirs[] = { esriNEDAlongDigitized, esriNEDAgainstDigitized };
+
+	graph.Clear();
+	if (FAILED(hr = ipNetworkQuery->get_ElementCount(esriNETEdge, &edgeCount))) return hr;
+	if (FAILED(hr = ipNetworkQuery->CreateNetworkElement(esriNETEdge, &ipElement))) return hr;
+	INetworkEdgePtr ipEdge(ipElement);
+	if (FAILED(hr = ipNetworkQuery->CreateNetworkElement(esriNETJunction, &ipElement))) return hr;
+	INetworkJunctionPtr ipFromJunction(ipElement);
+	if (FAILED(hr = ipNetworkQuery->CreateNetworkElement(esriNETJunction, &ipElement))) return hr;
+	INetworkJunctionPtr ipToJunction(ipElement);
+
+	edges.reserve((size_t)edgeCount * 2);
+	for (long eid = 1; eid <= edgeCount; ++eid) for (const auto dir : dirs)
+	{
+		// EIDs of a built network dataset are contiguous but we still tolerate gaps
+		if (FAILED(ipNetworkQuery->QueryEdge(eid, dir, ipEdge))) continue;
+		if (FAILED(hr = ipForwardStar->get_IsRestricted(ipEdge, &isRestricted))) return hr;
+		if (isRestricted) continue;
+
+		if (FAILED(hr = ipEdge->QueryJunctions(ipFromJunction, ipToJunction))) return hr;
+		if (FAILED(hr = ipForwardStar->get_IsRestricted(ipFromJunction, &isRestricted))) return hr;
+		if (isRestricted) continue;
+		if (FAILED(hr = ipForwardStar->get_IsRestricted(ipToJunction, &isRestricted))) return hr;
+		if (isRestricted) continue;
+		if (FAILED(hr = ipFromJunction->get_EID(&fromEID))) return hr;
+		if (FAILED(hr = ipToJunction->get_EID(&toEID))) return hr;
+
+		// same attribute defaults as the NAEdge constructor
+		cost = 1.0;
+		capacity = 1.0;
+		if (SUCCEEDED(ipEdge->get_AttributeValue(costAttribID, &vcost))) cost = vcost.dblVal;
+		if (SUCCEEDED(ipEdge->get_AttributeValue(capacityAttribID, &vcap)))
+		{
+			if (vcap.vt == VT_R8) capacity = max(1.0f, (float)(vcap.dblVal));
+			else if (vcap.vt == VT_I4) capacity = max(1.0f, (float)(vcap.intVal));
+		}
+		edges.push_back(NAGraphEdge(eid, (EdgeDirection)dir, fromEID, toEID, max(FLT_MIN, cost), capacity));
+	}
+
+	graph.Build(edges);
+	return hr;
+}
@@ -0,0 +1,129 @@
+// ===============================================================================================
+// Evacuation Solver: Graph snapshot implementation
+// Description: Builds the CSR copy of the network from a plain edge list
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "NAGraph.h"
+
+const NAGraphEdgeIndex NAGraphSnapshot::NoEdge;
+
+void NAGraphSnapshot::Clear()
+{
+	forwardOffset.clear();
+	forwardEdges.clear();
+	backwardOffset.clear();
+	backwardEdges.clear();
+	edgeEID.clear();
+	edgeDirection.clear();
+	edgeFrom.clear();
+	edgeTo.clear();
+	edgeCost.clear();
+	edgeCapacity.clear();
+	edgeLookup.clear();
+}
+
+size_t NAGraphSnapshot::MemoryUsage() const
+{
+	return sizeof(NAGraphEdgeIndex) * (forwardOffset.capacity() + forwardEdges.capacity() + backwardOffset.capacity() + backwardEdges.capacity() + edgeLookup.capacity()) +
+		sizeof(long) * (edgeEID.capacity() + edgeFrom.capacity() + edgeTo.capacity()) + sizeof(EdgeDirection) * edgeDirection.capacity() +
+		sizeof(double) * edgeCost.capacity() + sizeof(float) * edgeCapacity.capacity();
+}
+
+// FNV-1a over the topology and the costs of the snapshot. A rebuilt network or a change in restrictions gives a new value.
+unsigned long long NAGraphSnapshot::Fingerprint() const
+{
+	unsigned long long hash = 14695981039346656037ull;
+	long values[2];
+	double cost = 0.0;
+
+	auto Mix = [&hash](const void * data, size_t size)
+	{
+		const unsigned char * bytes = static_cast<const unsigned char *>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	};
+
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)EdgeCount(); ++e)
+	{
+		values[0] = edgeFrom[e];
+		values[1] = edgeTo[e];
+		cost = edgeCost[e];
+		Mix(values, sizeof(values));
+		Mix(&cost, sizeof(cost));
+	}
+	return hash;
+}
+
+// Two counting-sort passes over the edge list: one keyed by the from junction (forward star) and one keyed by
+// the to junction (backward star). Edges keep their input order within each star so the snapshot is deterministic.
+void NAGraphSnapshot::Build(const std::vector<NAGraphEdge> & edges)
+{
+	long maxJunction = -1, maxEID = -1;
+	NAGraphEdgeIndex i = 0;
+	Clear();
+
+	for (const auto & e : edges)
+	{
+		maxJunction = std::max(maxJunction, std::max(e.FromJunction, e.ToJunction));
+		maxEID = std::max(maxEID, e.EID);
+	}
+	if (edges.empty() || maxJunction < 0 || maxEID < 0) return;
+
+	size_t junctionCount = (size_t)maxJunction + 1;
+	edgeEID.reserve(edges.size());
+	edgeDirection.reserve(edges.size());
+	edgeFrom.reserve(edges.size());
+	edgeTo.reserve(edges.size());
+	edgeCost.reserve(edges.size());
+	edgeCapacity.reserve(edges.size());
+	edgeLookup.assign(LookupSlot(maxEID, EdgeDirection::Against) + 1, NoEdge);
+	forwardOffset.assign(junctionCount + 1, 0);
+	backwardOffset.assign(junctionCount + 1, 0);
+
+	for (const auto & e : edges)
+	{
+		if (e.FromJunction < 0 || e.ToJunction < 0 || edgeLookup[LookupSlot(e.EID, e.Direction)] != NoEdge) continue;
+		edgeLookup[LookupSlot(e.EID, e.Direction)] = (NAGraphEdgeIndex)edgeEID.size();
+		edgeEID.push_back(e.EID);
+		edgeDirection.push_back(e.Direction);
+		edgeFrom.push_back(e.FromJunction);
+		edgeTo.push_back(e.ToJunction);
+		edgeCost.push_back(e.Cost);
+		edgeCapacity.push_back(e.Capacity);
+		++forwardOffset[e.FromJunction + 1];
+		++backwardOffset[e.ToJunction + 1];
+	}
+
+	for (size_t j = 1; j <= junctionCount; ++j)
+	{
+		forwardOffset[j] += forwardOffset[j - 1];
+		backwardOffset[j] += backwardOffset[j - 1];
+	}
+
+	std::vector<NAGraphEdgeIndex> forwardNext(forwardOffset.begin(), forwardOffset.end() - 1), backwardNext(backwardOffset.begin(), backwardOffset.end() - 1);
+	forwardEdges.resize(edgeEID.size());
+	backwardEdges.resize(edgeEID.size());
+
+	for (i = 0; i < (NAGraphEdgeIndex)edgeEID.size(); ++i)
+	{
+		forwardEdges[forwardNext[edgeFrom[i]]++] = i;
+		backwardEdges[backwardNext[edgeTo[i]]++] = i;
+	}
+}
+
+void NAGraphSnapshot::GetEdges(std::vector<NAGraphEdge> & edges) const
+{
+	edges.clear();
+	edges.reserve(EdgeCount());
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)EdgeCount(); ++e)
+		edges.push_back(NAGraphEdge(edgeEID[e], edgeDirection[e], edgeFrom[e], edgeTo[e], edgeCost[e], edgeCapacity[e]));
+}
@@ -0,0 +1,115 @@
+// ===============================================================================================
+// Evacuation Solver: Graph snapshot definition
+// Description: A read-only compressed sparse row (CSR) copy of the network topology along with
+// the initial cost and capacity of each directed edge. The snapshot is built once per solve so that
+// the edge cache can answer adjacency queries without going through the network dataset. It does not
+// know about the network dataset itself: see NAGraph.Build.cpp for the part that reads it.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "CoreTypes.h"
+
+// dense index of a directed edge inside the snapshot
+typedef unsigned int NAGraphEdgeIndex;
+typedef std::vector<NAGraphEdgeIndex>::const_iterator NAGraphStarItr;
+
+// One directed edge record used to build the snapshot. Junction and edge EIDs of a network
+// dataset are already dense (1..n) so they are used as-is to index the CSR arrays.
+struct NAGraphEdge
+{
+	long          EID;
+	EdgeDirection Direction;
+	long          FromJunction;
+	long          ToJunction;
+	double        Cost;
+	float         Capacity;
+
+	NAGraphEdge(long eid, EdgeDirection dir, long fromJunction, long toJunction, double cost, float capacity) :
+		EID(eid), Direction(dir), FromJunction(fromJunction), ToJunction(toJunction), Cost(cost), Capacity(capacity) { }
+};
+
+// The forward star of junction j is forwardEdges[forwardOffset[j] .. forwardOffset[j + 1]) which are the edges leaving j.
+// The backward star of junction j is backwardEdges[backwardOffset[j] .. backwardOffset[j + 1]) which are the edges entering j.
+// Every other array is indexed by the dense edge index.
+class NAGraphSnapshot
+{
+private:
+	std::vector<NAGraphEdgeIndex> forwardOffset;
+	std::vector<NAGraphEdgeIndex> forwardEdges;
+	std::vector<NAGraphEdgeIndex> backwardOffset;
+	std::vector<NAGraphEdgeIndex> backwardEdges;
+	std::vector<long>             edgeEID;
+	std::vector<EdgeDirection>    edgeDirection;
+	std::vector<long>             edgeFrom;
+	std::vector<long>             edgeTo;
+	std::vector<double>           edgeCost;
+	std::vector<float>            edgeCapacity;
+	std::vector<NAGraphEdgeIndex> edgeLookup;
+
+	static inline size_t LookupSlot(long eid, EdgeDirection dir) { return (size_t)eid * 2 + (dir == EdgeDirection::Against ? 1 : 0); }
+
+public:
+	static const NAGraphEdgeIndex NoEdge = UINT_MAX;
+
+	NAGraphSnapshot(void) { }
+	NAGraphSnapshot(const NAGraphSnapshot & that) = delete;
+	NAGraphSnapshot & operator=(const NAGraphSnapshot &) = delete;
+
+	void Build(const std::vector<NAGraphEdge> & edges);
+	void Clear();
+
+	bool   IsEmpty()       const { return edgeEID.empty(); }
+	size_t EdgeCount()     const { return edgeEID.size(); }
+	size_t JunctionCount() const { return forwardOffset.empty() ? 0 : forwardOffset.size() - 1; }
+	size_t MemoryUsage()   const;
+
+	// hash of the topology and the costs. disk caches of anything derived from the snapshot are checked against it.
+	unsigned long long Fingerprint() const;
+
+	// the edge list the snapshot was built from (without the duplicates Build dropped) in dense edge order
+	void GetEdges(std::vector<NAGraphEdge> & edges) const;
+
+	NAGraphEdgeIndex Find(long eid, EdgeDirection dir) const
+	{
+		size_t slot = LookupSlot(eid, dir);
+		return slot < edgeLookup.size() ? edgeLookup[slot] : NoEdge;
+	}
+
+	// edges leaving the junction (used for forward traversal)
+	void ForwardStar(long junction, NAGraphStarItr & begin, NAGraphStarItr & end) const
+	{
+		if (junction < 0 || (size_t)junction >= JunctionCount()) begin = end = forwardEdges.end();
+		else
+		{
+			begin = forwardEdges.begin() + forwardOffset[junction];
+			end   = forwardEdges.begin() + forwardOffset[junction + 1];
+		}
+	}
+
+	// edges entering the junction (used for backward traversal)
+	void BackwardStar(long junction, NAGraphStarItr & begin, NAGraphStarItr & end) const
+	{
+		if (junction < 0 || (size_t)junction >= JunctionCount()) begin = end = backwardEdges.end();
+		else
+		{
+			begin = backwardEdges.begin() + backwardOffset[junction];
+			end   = backwardEdges.begin() + backwardOffset[junction + 1];
+		}
+	}
+
+	inline long          GetEID(NAGraphEdgeIndex e)          const { return edgeEID[e];       }
+	inline EdgeDirection GetDirection(NAGraphEdgeIndex e)    const { return edgeDirection[e]; }
+	inline long          GetFromJunction(NAGraphEdgeIndex e) const { return edgeFrom[e];      }
+	inline long          GetToJunction(NAGraphEdgeIndex e)   const { return edgeTo[e];        }
+	inline double        GetCost(NAGraphEdgeIndex e)         const { return edgeCost[e];      }
+	inline float         GetCapacity(NAGraphEdgeIndex e)     const { return edgeCapacity[e];  }
+};
+
+typedef std::shared_ptr<NAGraphSnapshot> NAGraphSnapshotPtr;
@@ -14,19 +14,113 @@
 #include "NAEdge.h"
 #include "Evacuee.h"
 
+//******************************************************************************************/
+// NAHeuristicTable methods
+
+void NAHeuristicTable::Update(long junction, NAEdge * edge, double h)
+{
+	// an edge belongs to the junction it leaves. if it is labeled from its other end then it moves over.
+	if (edge && edge->hJunction >= 0 && edge->hJunction != junction) Unlink(junctions[edge->hJunction], edge);
+
+	JunctionH & j = At(junction);
+	if (!edge)
+	{
+		j.OwnH = h;
+		j.OwnStamp = ++stamp;
+		return;
+	}
+
+	bool valueIncreased = false;
+	if (edge->hJunction != junction)
+	{
+		edge->hJunction = junction;
+		edge->nextHEdge = j.FirstEdge;
+		j.FirstEdge = edge;
+	}
+	else valueIncreased = edge->carmaH < h;
+	edge->carmaH = h;
+
+	// update the junction min
+	if (!j.MinEdge || h < j.EdgeMinH)
+	{
+		j.EdgeMinH = h;
+		j.MinEdge = edge;
+	}
+	else if (valueIncreased && j.MinEdge == edge) RescanMin(j);
+}
+
+double NAHeuristicTable::Get(long junction, const NAEdge * edge) const
+{
+	if (!edge)
+	{
+		if (junction < 0 || (size_t)junction >= junctions.size()) return outsideH;
+		return OwnOrOutsideH(junctions[junction]);
+	}
+	if (edge->hJunction != junction) throw std::out_of_range("edge has no heuristic at this junction");
+	return edge->carmaH;
+}
+
+size_t NAHeuristicTable::Count(long junction) const
+{
+	if (junction < 0 || (size_t)junction >= junctions.size()) return 0;
+	size_t count = 1; // the outside value is always there
+	for (const NAEdge * e = junctions[junction].FirstEdge; e; e = e->nextHEdge) ++count;
+	return count;
+}
+
+void NAHeuristicTable::Unlink(JunctionH & j, NAEdge * edge)
+{
+	NAEdge ** link = &(j.FirstEdge);
+	while (*link && *link != edge) link = &((*link)->nextHEdge);
+	if (*link) *link = edge->nextHEdge;
+	edge->nextHEdge = nullptr;
+	edge->hJunction = -1;
+	edge->carmaH = -1.0;
+	if (j.MinEdge == edge) RescanMin(j);
+}
+
+void NAHeuristicTable::RescanMin(JunctionH & j)
+{
+	j.EdgeMinH = CASPER_INFINITY;
+	j.MinEdge = nullptr;
+	for (NAEdge * e = j.FirstEdge; e; e = e->nextHEdge)
+		if (!j.MinEdge || e->carmaH < j.EdgeMinH)
+		{
+			j.EdgeMinH = e->carmaH;
+			j.MinEdge = e;
+		}
+}
+
+// the edges outlive this table so they have to forget their heuristic
+void NAHeuristicTable::Clear()
+{
+	NAEdge * next = nullptr;
+	for (auto & j : junctions)
+		for (NAEdge * e = j.FirstEdge; e; e = next)
+		{
+			next = e->nextHEdge;
+			e->nextHEdge = nullptr;
+			e->hJunction = -1;
+			e->carmaH = -1.0;
+		}
+	junctions.clear();
+	outsideH = 0.0;
+	outsideStamp = stamp = 0;
+}
+
 //******************************************************************************************/
 // NAVertex methods
 
-void NAVertex::Clone(NAVertex * cpy)
+void NAVertex::Clone(NAVertex * cpy, unsigned int gen)
 {
 	GVal = cpy->GVal;
 	GlobalPenaltyCost = cpy->GlobalPenaltyCost;
-	h = cpy->h;
+	hTable = cpy->hTable;
 	Junction = cpy->Junction;
 	BehindEdge = nullptr; // cpy->BehindEdge;
 	Previous = cpy->Previous;
 	EID = cpy->EID;
-	isShadowCopy = true;
+	generation = gen;
 }
 
 NAVertex::NAVertex(void)
@@ -37,17 +131,17 @@ NAVertex::NAVertex(void)
 	Previous = nullptr;
 	GVal = 0.0;
 	GlobalPenaltyCost = 0.0;
-	h = nullptr;
-	isShadowCopy = true;
+	hTable = nullptr;
+	generation = 0;
 }
 
-NAVertex::NAVertex(INetworkJunctionPtr junction, NAEdge * behindEdge)
+NAVertex::NAVertex(INetworkJunctionPtr junction, NAEdge * behindEdge, NAHeuristicTable * table)
 {
 	Previous = nullptr;
-	isShadowCopy = false;
+	generation = 0;
 	GVal = 0.0;
 	GlobalPenaltyCost = 0.0;
-	h = new DEBUG_NEW_PLACEMENT MinimumArrayList<long, double>();
+	hTable = table;
 	BehindEdge = behindEdge;
 
 	if (!FAILED(junction->get_EID(&EID)))
@@ -61,6 +155,19 @@ NAVertex::NAVertex(INetworkJunctionPtr junction, NAEdge * behindEdge)
 	}
 }
 
+// a vertex of the graph snapshot only needs its junction EID. it gets no network junction since it never takes part in a network dataset query.
+NAVertex::NAVertex(long junctionEID, NAEdge * behindEdge, NAHeuristicTable * table)
+{
+	Previous = nullptr;
+	generation = 0;
+	GVal = 0.0;
+	GlobalPenaltyCost = 0.0;
+	hTable = table;
+	BehindEdge = behindEdge;
+	EID = junctionEID;
+	Junction = nullptr;
+}
+
 inline void NAVertex::SetBehindEdge(NAEdge * behindEdge)
 {
 	if (!behindEdge && BehindEdge) BehindEdge->ToVertex = nullptr;
@@ -68,16 +175,9 @@ inline void NAVertex::SetBehindEdge(NAEdge * behindEdge)
 	if (BehindEdge) BehindEdge->ToVertex = this;
 }
 
-void NAVertex::UpdateYourHeuristic() { UpdateHeuristic(BehindEdge ? BehindEdge->EID : -1, GVal); }
-void NAVertex::UpdateHeuristic(long edgeid, double hur) { h->InsertOrUpdate(edgeid, hur); }
-
-void NAVertexCache::UpdateHeuristicForOutsideVertices(double hur, bool goDeep)
+void NAVertexCache::UpdateHeuristicForOutsideVertices(double hur)
 {
-	if (heuristicForOutsideVertices < hur)
-	{
-		heuristicForOutsideVertices = hur;
-		if (goDeep) for(NAVertexTableItr it = cache->begin(); it != cache->end(); it++) it->second->UpdateHeuristic(-1, hur);
-	}
+	if (hTable->GetOutsideH() < hur) hTable->SetOutsideH(hur);
 }
 
 NAVertexPtr NAVertexCache::New(INetworkJunctionPtr junction, INetworkQueryPtr ipNetworkQuery)
@@ -101,8 +201,8 @@ NAVertexPtr NAVertexCache::New(INetworkJunctionPtr junction, INetworkQueryPtr ip
 		{
 			junctionClone = junction;
 		}
-		n = new DEBUG_NEW_PLACEMENT NAVertex(junctionClone, nullptr);
-		n->UpdateHeuristic(-1, heuristicForOutsideVertices);
+		n = new DEBUG_NEW_PLACEMENT NAVertex(junctionClone, nullptr, hTable);
+		hTable->AddJunction(n->EID);
 		cache->insert(NAVertexTablePair(n));
 	}
 	else
@@ -112,20 +212,41 @@ NAVertexPtr NAVertexCache::New(INetworkJunctionPtr junction, INetworkQueryPtr ip
 	return n;
 }
 
-NAVertexPtr NAVertexCache::NewFromBucket(NAVertexPtr clone)
+NAVertexPtr NAVertexCache::New(long junctionEID, INetworkQueryPtr ipNetworkQuery)
 {
-	NAVertex * n = nullptr;
-	if (currentBucketIndex >= NAVertexCache_BucketSize) currentBucket = nullptr;
-	if (!currentBucket)
+	NAVertexPtr n = nullptr;
+	INetworkElementPtr ipJunctionElement;
+	INetworkJunctionPtr junction;
+	NAVertexTableItr it = cache->find(junctionEID);
+
+	if (it == cache->end())
 	{
-		currentBucket = new DEBUG_NEW_PLACEMENT NAVertex[NAVertexCache_BucketSize];
-		currentBucketIndex = 0;
-		bucketCache->push_back(currentBucket);
+		if (ipNetworkQuery)
+		{
+			if (FAILED(ipNetworkQuery->CreateNetworkElement(esriNETJunction, &ipJunctionElement))) return nullptr;
+			junction = ipJunctionElement;
+			if (FAILED(ipNetworkQuery->QueryJunction(junctionEID, junction))) return nullptr;
+			n = new DEBUG_NEW_PLACEMENT NAVertex(junction, nullptr, hTable);
+		}
+		else n = new DEBUG_NEW_PLACEMENT NAVertex(junctionEID, nullptr, hTable);
+		hTable->AddJunction(n->EID);
+		cache->insert(NAVertexTablePair(n));
 	}
+	else
+	{
+		n = NewFromBucket(it->second);
+	}
+	return n;
+}
 
-	n = &(currentBucket[currentBucketIndex]);
-	++currentBucketIndex;
-	n->Clone(clone);
+NAVertexPtr NAVertexCache::NewFromBucket(NAVertexPtr clone)
+{
+	NAVertex * n = nullptr;
+	if (nextSlot >= SlotCount()) bucketCache->push_back(new DEBUG_NEW_PLACEMENT NAVertex[NAVertexCache_BucketSize]);
+
+	n = &((*bucketCache)[nextSlot / NAVertexCache_BucketSize][nextSlot % NAVertexCache_BucketSize]);
+	++nextSlot;
+	n->Clone(clone, generation);
 
 	return n;
 }
@@ -147,9 +268,13 @@ NAVertexPtr NAVertexCache::Get(long eid)
 
 void NAVertexCache::Clear()
 {
-	CollectAndRelease();
+	for (std::vector<NAVertexPtr>::const_iterator i = bucketCache->begin(); i != bucketCache->end(); i++) delete [] (*i);
+	bucketCache->clear();
+	nextSlot = 0;
+	++generation;
 	for(NAVertexTableItr cit = cache->begin(); cit != cache->end(); cit++) delete cit->second;
 	cache->clear();
+	hTable->Clear();
 }
 
 void NAVertexCache::PrintVertexHeuristicFeq()
@@ -163,20 +288,12 @@ void NAVertexCache::PrintVertexHeuristicFeq()
 	OutputDebugStringW( os_.str().c_str() );
 }
 
+// Every label handed out before this call belongs to an old generation. Edges may still point to them
+// but nobody reads the label of an edge before the new search writes one for it.
 void NAVertexCache::CollectAndRelease()
 {
-	int count = 0;
-	NAVertexPtr temp = nullptr;
-	size_t j = 0;
-	for(std::vector<NAVertexPtr>::const_iterator i = bucketCache->begin(); i != bucketCache->end(); i++)
-	{
-		temp = (*i);
-		for (j = 0; j < NAVertexCache_BucketSize; ++j) temp[j].SetBehindEdge(nullptr);
-		delete [] temp;
-		count++;
-	}
-	currentBucket = nullptr;
-	bucketCache->clear();
+	nextSlot = 0;
+	++generation;
 }
 
 NAVertexPtr NAVertexCollector::New(INetworkJunctionPtr junction)
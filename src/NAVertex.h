@@ -14,6 +14,7 @@
 
 #include "StdAfx.h"
 #include "utils.h"
+#include "Landmarks.h"
 
 class Evacuee;
 class NAEdge;
@@ -43,12 +44,78 @@ public:
 	}
 };
 
+// CARMA heuristics. A junction has one h value for each of its outgoing edges that a CARMA loop settled. That value
+// is kept on the directed edge itself and the junction record only keeps the minimum and the head of an intrusive
+// list through those edges. Junction records sit in a flat array indexed by junction EID. Junctions that CARMA did
+// not reach yet use the outside value, a single watermark for the whole network. When a landmark table is attached the
+// minimum is never less than its lower bound so that junctions near or beyond the explored radius still get a useful h.
+class NAHeuristicTable
+{
+private:
+	struct JunctionH
+	{
+		double       EdgeMinH;
+		NAEdge       * MinEdge;
+		NAEdge       * FirstEdge;
+		double       OwnH;
+		unsigned int OwnStamp;
+
+		JunctionH() : EdgeMinH(CASPER_INFINITY), MinEdge(nullptr), FirstEdge(nullptr), OwnH(0.0), OwnStamp(0) { }
+	};
+
+	std::vector<JunctionH> junctions;
+	double       outsideH;
+	unsigned int outsideStamp;
+	unsigned int stamp;
+	const NALandmarkTable * landmarks;
+
+	inline JunctionH & At(long eid) { if ((size_t)eid >= junctions.size()) junctions.resize(eid + 1); return junctions[eid]; }
+	inline double OwnOrOutsideH(const JunctionH & j) const { return j.OwnStamp > outsideStamp ? j.OwnH : outsideH; }
+	void Unlink(JunctionH & j, NAEdge * edge);
+	void RescanMin(JunctionH & j);
+
+public:
+	NAHeuristicTable() : outsideH(0.0), outsideStamp(0), stamp(0), landmarks(nullptr) { }
+	virtual ~NAHeuristicTable() { Clear(); }
+
+	NAHeuristicTable(const NAHeuristicTable & that) = delete;
+	NAHeuristicTable & operator=(const NAHeuristicTable &) = delete;
+
+	inline void   AddJunction(long eid) { if (eid >= 0) At(eid); }
+	inline double GetOutsideH() const { return outsideH; }
+	inline void   SetOutsideH(double h) { outsideH = h; outsideStamp = ++stamp; }
+	inline void   SetLandmarks(const NALandmarkTable * table) { landmarks = table; }
+
+	// the landmark bound only orders the queue. the global penalty keeps using the heuristic the CARMA tree gave.
+	inline double GetMinOrOutside(long junction, bool withLandmarks = true) const
+	{
+		double h = outsideH;
+		if (junction >= 0 && (size_t)junction < junctions.size())
+		{
+			const JunctionH & j = junctions[junction];
+			double own = OwnOrOutsideH(j);
+			h = min(j.EdgeMinH, own);
+		}
+		if (withLandmarks && landmarks)
+		{
+			double alt = landmarks->LowerBound(junction);
+			if (alt > h) h = alt;
+		}
+		return h;
+	}
+
+	void   Update(long junction, NAEdge * edge, double h);
+	double Get(long junction, const NAEdge * edge) const;
+	size_t Count(long junction) const;
+	void   Clear();
+};
+
 class NAVertex
 {
 private:
 	NAEdge * BehindEdge;
-	MinimumArrayList<long, double> * h;
-	bool     isShadowCopy;
+	NAHeuristicTable * hTable;
+	unsigned int generation;
 
 public:
 	double GVal;
@@ -57,22 +124,25 @@ public:
 	NAVertex * Previous;
 	long EID;
 
-	double GetMinHOrZero() const { return h->GetMinValueOrDefault(0.0); }
-	double GetH(long eid) const { return h->GetByKey(eid); }
-	size_t HCount() const { return h->size(); }
+	double GetMinHOrZero() const { return hTable ? hTable->GetMinOrOutside(EID) : 0.0; }
+	double GetCARMAHOrZero() const { return hTable ? hTable->GetMinOrOutside(EID, false) : 0.0; }
+	double GetH(const NAEdge * edge) const { _ASSERT(hTable); return hTable->Get(EID, edge); }
+	size_t HCount() const { return hTable ? hTable->Count(EID) : 0; }
 
 	inline void SetBehindEdge(NAEdge * behindEdge);
 	NAEdge * GetBehindEdge() { return BehindEdge; }
-	inline bool IsHEmpty()   const { return h->empty(); }
-	void UpdateHeuristic(long edgeid, double hur);
-	void UpdateYourHeuristic();
+	inline bool IsHEmpty()   const { return HCount() == 0; }
+	void UpdateHeuristic(NAEdge * edge, double hur) { hTable->Update(EID, edge, hur); }
+	void UpdateYourHeuristic() { UpdateHeuristic(BehindEdge, GVal); }
 
-	inline void Clone (NAVertex * cpy);
+	inline unsigned int GetGeneration() const { return generation; }
+	inline void Clone (NAVertex * cpy, unsigned int gen);
 	NAVertex(void);
 	NAVertex(const NAVertex& cpy) = delete;
 	NAVertex & operator=(const NAVertex &) = delete;
-	NAVertex(INetworkJunctionPtr junction, NAEdge * behindEdge);
-	virtual ~NAVertex(void) { if (!isShadowCopy) delete h; }
+	NAVertex(INetworkJunctionPtr junction, NAEdge * behindEdge, NAHeuristicTable * table = nullptr);
+	NAVertex(long junctionEID, NAEdge * behindEdge, NAHeuristicTable * table = nullptr);
+	virtual ~NAVertex(void) { }
 };
 
 typedef NAVertex * NAVertexPtr;
@@ -88,6 +158,8 @@ typedef std::pair<long, NAVertexPtr> _NAVertexTablePair;
 // to vertex will be always fresh and there will be no inconsistency. Care has to be taken not to overwrite
 // important vertices with new ones. The second job is just a GC. since all vertices are being created here,
 // it can all be deleted at the end here as well.
+// The search labels (shadow copies) come from a pool of buckets that is kept for the whole solve. Releasing
+// them only starts a new generation and rewinds the pool so the next search writes over the same slots.
 
 #define NAVertexCache_BucketSize 500
 
@@ -96,9 +168,10 @@ class NAVertexCache
 private:
 	NAVertexTable * cache;
 	std::vector<NAVertex *> * bucketCache;
-	NAVertex * currentBucket;
-	size_t currentBucketIndex;
-	double heuristicForOutsideVertices;
+	size_t nextSlot;
+	unsigned int generation;
+	NAHeuristicTable * hTable;
+	NALandmarkTablePtr landmarks;
 
 public:
 	NAVertexCache(const NAVertexCache & that) = delete;
@@ -108,9 +181,9 @@ public:
 	{
 		cache = new DEBUG_NEW_PLACEMENT std::unordered_map<long, NAVertexPtr>();
 		bucketCache = new DEBUG_NEW_PLACEMENT std::vector<NAVertex *>();
-		heuristicForOutsideVertices = 0.0;
-		currentBucket = nullptr;
-		currentBucketIndex = 0;
+		hTable = new DEBUG_NEW_PLACEMENT NAHeuristicTable();
+		nextSlot = 0;
+		generation = 1;
 	}
 
 	virtual ~NAVertexCache(void)
@@ -118,16 +191,24 @@ public:
 		Clear();
 		delete cache;
 		delete bucketCache;
+		delete hTable;
 	}
 
 	void PrintVertexHeuristicFeq();
 	NAVertexPtr New(INetworkJunctionPtr junction, INetworkQueryPtr ipNetworkQuery = nullptr);
-	void UpdateHeuristicForOutsideVertices(double hur, bool goDeep);
+
+	// A new vertex looks up its network junction only if a network query is given. Adjacency queries on the graph snapshot
+	// never need it so those vertices are keyed by the junction EID alone.
+	NAVertexPtr New(long junctionEID, INetworkQueryPtr ipNetworkQuery = nullptr);
+	void UpdateHeuristicForOutsideVertices(double hur);
 	NAVertexPtr Get(long eid);
 	NAVertexPtr Get(INetworkJunctionPtr junction);
 	NAVertexPtr NewFromBucket(NAVertexPtr clone);
 	void Clear();
 	void CollectAndRelease();
+	inline bool IsCurrent(const NAVertex * v) const { return v && v->GetGeneration() == generation; }
+	inline void SetLandmarks(NALandmarkTablePtr table) { landmarks = table; hTable->SetLandmarks(table.get()); }
+	inline size_t SlotCount() const { return bucketCache->size() * NAVertexCache_BucketSize; }
 };
 
 class NAVertexCollector
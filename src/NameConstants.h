@@ -116,4 +116,5 @@
 #define TRAFFIC_MODEL_STEP                          L"STEP"
 #define TRAFFIC_MODEL_POWER                         L"POWER"
 #define TRAFFIC_MODEL_EXP                           L"EXP"
+#define TRAFFIC_MODEL_TABLE                         L"TABLE"
 #define TRAFFIC_MODEL_FLAT                          L"FLAT"
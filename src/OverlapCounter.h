@@ -0,0 +1,59 @@
+// ===============================================================================================
+// Evacuation Solver: Overlap counter
+// Description: Sums weights per item over a small dense id space and picks the heaviest items.
+// The second chance step uses it to find the paths that share the most with a late path.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "CoreTypes.h"
+
+// Ids are small and dense so the weights live in a flat array indexed by id instead of a hash map, and only the entries
+// touched since the last extraction are reset afterwards. One counter is meant to be reused for many rounds (one per
+// thread) so after warming up it does not allocate anymore. 'IdOf' gives the dense id of an item.
+template <class T, class IdOf> class OverlapCounter
+{
+private:
+	std::vector<double> weights;
+	std::vector<char>   seen;
+	std::vector<T>      touched;
+	double              maxWeight;
+
+public:
+	OverlapCounter(void) : maxWeight(-CASPER_INFINITY) { }
+
+	inline void Add(T item, double weight)
+	{
+		size_t id = IdOf()(item);
+		if (id >= weights.size())
+		{
+			size_t newSize = std::max(id + 1, 2 * weights.size());
+			weights.resize(newSize, 0.0);
+			seen.resize(newSize, 0);
+		}
+		if (!seen[id]) { seen[id] = 1; touched.push_back(item); }
+		weights[id] += weight;
+		if (weights[id] > maxWeight) maxWeight = weights[id];
+	}
+
+	// appends the items that weigh more than 'ratio' of the heaviest one in the order they were first seen and resets the counter
+	void ExtractAbove(double ratio, std::vector<T> & result)
+	{
+		double cutOffWeight = ratio * maxWeight;
+		for (const auto & item : touched)
+		{
+			size_t id = IdOf()(item);
+			if (weights[id] > cutOffWeight) result.push_back(item);
+			weights[id] = 0.0;
+			seen[id] = 0;
+		}
+		touched.clear();
+		maxWeight = -CASPER_INFINITY;
+	}
+};
@@ -0,0 +1,332 @@
+// ===============================================================================================
+// Evacuation Solver: Parallel backward shortest path tree implementation
+// Description: Worker pool, delta-stepping distances and the deterministic tree reconstruction
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "ParallelSPT.h"
+#include <map>
+
+// frontiers smaller than this are relaxed on the calling thread only
+#define ParallelSPT_MinParallelFrontier 512
+
+//******************************************************************************************/
+// SPTWorkerPool Methods
+
+SPTWorkerPool::SPTWorkerPool(unsigned int threadCount) : generation(0), pending(0), quit(false)
+{
+	if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+	threadCount = std::max(1U, threadCount);
+	for (unsigned int id = 1; id < threadCount; ++id) threads.push_back(std::thread(&SPTWorkerPool::WorkerLoop, this, id));
+}
+
+SPTWorkerPool::~SPTWorkerPool(void)
+{
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		quit = true;
+	}
+	startSignal.notify_all();
+	for (auto & t : threads) t.join();
+}
+
+void SPTWorkerPool::WorkerLoop(unsigned int id)
+{
+	size_t seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			startSignal.wait(guard, [&]() { return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+		}
+		task(id);
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			if (--pending == 0) doneSignal.notify_one();
+		}
+	}
+}
+
+void SPTWorkerPool::Run(const std::function<void(unsigned int)> & work)
+{
+	if (threads.empty())
+	{
+		work(0);
+		return;
+	}
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		task = work;
+		pending = (unsigned int)threads.size();
+		++generation;
+	}
+	startSignal.notify_all();
+	work(0);
+	std::unique_lock<std::mutex> guard(lock);
+	doneSignal.wait(guard, [&]() { return pending == 0; });
+}
+
+//******************************************************************************************/
+// ParallelBackwardSPT Methods
+
+ParallelBackwardSPT::ParallelBackwardSPT(NAGraphSnapshotPtr snapshot, unsigned int threadCount) : graph(snapshot), pool(threadCount), phaseCount(0)
+{
+	edgeCount = graph->EdgeCount();
+	dist.reset(new DEBUG_NEW_PLACEMENT std::atomic<unsigned long long>[edgeCount]);
+	improved.resize(pool.Size());
+}
+
+void ParallelBackwardSPT::ForEachEdge(const std::function<void(NAGraphEdgeIndex)> & work)
+{
+	const unsigned int workers = pool.Size();
+	pool.Run([&](unsigned int id)
+	{
+		NAGraphEdgeIndex last = (NAGraphEdgeIndex)((edgeCount * (id + 1)) / workers);
+		for (NAGraphEdgeIndex e = (NAGraphEdgeIndex)((edgeCount * id) / workers); e < last; ++e) work(e);
+	});
+}
+
+void ParallelBackwardSPT::Run(const std::vector<double> & cost, const std::vector<std::pair<NAGraphEdgeIndex, double>> & seeds)
+{
+	double delta = 0.0;
+	size_t finiteCount = 0;
+	std::vector<NAGraphEdgeIndex> seedEdges;
+	const unsigned long long unreached = ToBits(DBL_MAX);
+
+	phaseCount = 0;
+	seedLabel.assign(edgeCount, DBL_MAX);
+	parent.assign(edgeCount, NAGraphSnapshot::NoEdge);
+	level.assign(edgeCount, 0);
+	settleOrder.clear();
+	for (size_t e = 0; e < edgeCount; ++e) dist[e].store(unreached, std::memory_order_relaxed);
+
+	// a seed inserted twice keeps its smaller label just like a decrease-key would
+	for (const auto & s : seeds)
+	{
+		if (s.first >= edgeCount) continue;
+		if (seedLabel[s.first] == DBL_MAX) seedEdges.push_back(s.first);
+		seedLabel[s.first] = std::min(seedLabel[s.first], s.second);
+		dist[s.first].store(ToBits(seedLabel[s.first]), std::memory_order_relaxed);
+	}
+
+	// the bucket width is the mean edge cost which keeps phases wide without too many re-relaxations
+	for (const auto & c : cost) if (c < CASPER_INFINITY) { delta += c; ++finiteCount; }
+	delta = finiteCount > 0 ? std::max(delta / finiteCount, (double)FLT_MIN) : 1.0;
+
+	ComputeDistances(cost, seedEdges, delta);
+	ComputeParents(cost);
+
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)edgeCount; ++e) if (IsReached(e)) settleOrder.push_back(e);
+	std::sort(settleOrder.begin(), settleOrder.end(), [&](NAGraphEdgeIndex a, NAGraphEdgeIndex b)->bool
+	{
+		double da = GetDistance(a), db = GetDistance(b);
+		if (da != db) return da < db;
+		if (level[a] != level[b]) return level[a] < level[b];
+		return a < b;
+	});
+	rank.assign(edgeCount, SIZE_MAX);
+	for (size_t i = 0; i < settleOrder.size(); ++i) rank[settleOrder[i]] = i;
+}
+
+void ParallelBackwardSPT::ComputeDistances(const std::vector<double> & cost, const std::vector<NAGraphEdgeIndex> & seeds, double delta)
+{
+	std::map<size_t, std::vector<NAGraphEdgeIndex>> buckets;
+	std::vector<size_t> queuedIn(edgeCount, SIZE_MAX);
+	std::vector<NAGraphEdgeIndex> frontier;
+	const double maxBucket = (double)(SIZE_MAX / 2);
+	auto BucketOf = [&](double d)->size_t { return (size_t)std::min(d / delta, maxBucket); };
+
+	// seeds with an infinite label are still part of the tree but they never relax anything
+	for (const auto & e : seeds) if (seedLabel[e] < CASPER_INFINITY)
+	{
+		queuedIn[e] = BucketOf(seedLabel[e]);
+		buckets[queuedIn[e]].push_back(e);
+	}
+
+	while (!buckets.empty())
+	{
+		auto top = buckets.begin();
+		size_t b = top->first;
+		frontier.clear();
+		for (const auto & e : top->second) if (queuedIn[e] == b)
+		{
+			queuedIn[e] = SIZE_MAX;
+			frontier.push_back(e);
+		}
+		buckets.erase(top);
+		if (frontier.empty()) continue;
+		++phaseCount;
+
+		// relax every edge entering the from-junction of each frontier edge. Labels only go down so the order
+		// of the atomic updates does not matter: the final distances are the same for any thread count.
+		auto relax = [&](unsigned int id, size_t first, size_t last)
+		{
+			NAGraphStarItr begin, end;
+			for (size_t i = first; i < last; ++i)
+			{
+				NAGraphEdgeIndex e = frontier[i];
+				double d = GetDistance(e);
+				graph->BackwardStar(graph->GetFromJunction(e), begin, end);
+				for (; begin != end; ++begin)
+				{
+					NAGraphEdgeIndex n = *begin;
+					if (cost[n] >= CASPER_INFINITY) continue;
+					double newCost = d + cost[n];
+					if (newCost >= CASPER_INFINITY) continue;
+					if (AtomicMin(n, newCost)) improved[id].push_back(n);
+				}
+			}
+		};
+
+		if (frontier.size() < ParallelSPT_MinParallelFrontier || pool.Size() == 1) relax(0, 0, frontier.size());
+		else
+		{
+			const unsigned int workers = pool.Size();
+			pool.Run([&](unsigned int id) { relax(id, (frontier.size() * id) / workers, (frontier.size() * (id + 1)) / workers); });
+		}
+
+		// improved edges go to the bucket of their (current) label. An edge can only move to a smaller bucket
+		// so its stale entry in the old bucket is skipped by the queuedIn check.
+		for (auto & list : improved)
+		{
+			for (const auto & n : list)
+			{
+				size_t nb = BucketOf(GetDistance(n));
+				if (queuedIn[n] == nb) continue;
+				queuedIn[n] = nb;
+				buckets[nb].push_back(n);
+			}
+			list.clear();
+		}
+	}
+}
+
+void ParallelBackwardSPT::ComputeParents(const std::vector<double> & cost)
+{
+	const unsigned int unresolved = UINT_MAX;
+
+	// An edge whose label only comes from a neighbor with the very same label (a cost below the precision of the label)
+	// has to wait for the tie levels. Every other edge takes its parent once those are known.
+	ForEachEdge([&](NAGraphEdgeIndex n)
+	{
+		NAGraphStarItr begin, end;
+		double d = GetDistance(n);
+		bool tied = false;
+
+		if (d >= DBL_MAX || seedLabel[n] <= d || cost[n] >= CASPER_INFINITY) return;
+		graph->ForwardStar(graph->GetToJunction(n), begin, end);
+		for (; begin != end; ++begin)
+		{
+			NAGraphEdgeIndex p = *begin;
+			double dp = GetDistance(p);
+			if (p == n || dp >= CASPER_INFINITY || dp + cost[n] != d) continue;
+			if (dp != d) return;
+			tied = true;
+		}
+		if (tied) level[n] = unresolved;
+	});
+
+	// the tied edges are attached breadth first so the tree stays acyclic and parents still settle before their children
+	std::vector<NAGraphEdgeIndex> pending, next;
+	for (NAGraphEdgeIndex n = 0; n < (NAGraphEdgeIndex)edgeCount; ++n) if (level[n] == unresolved) pending.push_back(n);
+
+	for (unsigned int round = 1; !pending.empty(); ++round)
+	{
+		std::vector<std::pair<NAGraphEdgeIndex, NAGraphEdgeIndex>> attached;
+		next.clear();
+		for (const auto & n : pending)
+		{
+			NAGraphStarItr begin, end;
+			NAGraphEdgeIndex best = NAGraphSnapshot::NoEdge;
+			double d = GetDistance(n);
+			graph->ForwardStar(graph->GetToJunction(n), begin, end);
+			for (; begin != end; ++begin)
+			{
+				NAGraphEdgeIndex p = *begin;
+				if (p == n || level[p] >= round || GetDistance(p) + cost[n] != d) continue;
+				if (best == NAGraphSnapshot::NoEdge || level[p] < level[best] || (level[p] == level[best] && p < best)) best = p;
+			}
+			if (best == NAGraphSnapshot::NoEdge) next.push_back(n);
+			else attached.push_back(std::pair<NAGraphEdgeIndex, NAGraphEdgeIndex>(n, best));
+		}
+
+		// nothing could be attached this round so the rest hangs from nothing
+		if (attached.empty())
+		{
+			for (const auto & n : next) level[n] = 0;
+			break;
+		}
+		for (const auto & a : attached)
+		{
+			parent[a.first] = a.second;
+			level[a.first] = round;
+		}
+		pending.swap(next);
+	}
+
+	// The serial loop gives an edge the first settled neighbor that produces its final label. Settled first means the
+	// smallest distance, then the smallest tie level and then the smallest index.
+	ForEachEdge([&](NAGraphEdgeIndex n)
+	{
+		NAGraphStarItr begin, end;
+		NAGraphEdgeIndex best = NAGraphSnapshot::NoEdge;
+		double d = GetDistance(n), bestD = DBL_MAX;
+
+		if (d >= DBL_MAX || seedLabel[n] <= d || cost[n] >= CASPER_INFINITY || level[n] != 0) return;
+		graph->ForwardStar(graph->GetToJunction(n), begin, end);
+		for (; begin != end; ++begin)
+		{
+			NAGraphEdgeIndex p = *begin;
+			double dp = GetDistance(p);
+			if (p == n || dp >= d || dp + cost[n] != d) continue;
+			if (dp < bestD || (dp == bestD && (level[p] < level[best] || (level[p] == level[best] && p < best)))) { best = p; bestD = dp; }
+		}
+		if (best != NAGraphSnapshot::NoEdge) parent[n] = best;
+	});
+}
+
+void ParallelBackwardSPT::Frontier(size_t expandedCount, const std::vector<double> & cost, std::vector<SPTFrontierEdge> & frontier)
+{
+	std::vector<double> label(edgeCount, DBL_MAX);
+	std::vector<NAGraphEdgeIndex> labelParent(edgeCount, NAGraphSnapshot::NoEdge);
+	frontier.clear();
+
+	// an edge is still queued if it is a seed or if an expanded edge relaxed it. Its label is the best one
+	// offered by the expanded edges and ties go to the one expanded first since later ones do not strictly improve.
+	ForEachEdge([&](NAGraphEdgeIndex n)
+	{
+		NAGraphStarItr begin, end;
+		if (rank[n] < expandedCount) return;
+		label[n] = seedLabel[n];
+		if (cost[n] >= CASPER_INFINITY) return;
+		graph->ForwardStar(graph->GetToJunction(n), begin, end);
+		for (; begin != end; ++begin)
+		{
+			NAGraphEdgeIndex p = *begin;
+			if (rank[p] >= expandedCount) continue;
+			double newCost = GetDistance(p) + cost[n];
+			if (newCost >= CASPER_INFINITY) continue;
+			if (newCost < label[n] || (newCost == label[n] && labelParent[n] != NAGraphSnapshot::NoEdge && rank[p] < rank[labelParent[n]]))
+			{
+				label[n] = newCost;
+				labelParent[n] = p;
+			}
+		}
+	});
+
+	for (NAGraphEdgeIndex n = 0; n < (NAGraphEdgeIndex)edgeCount; ++n)
+		if (label[n] < DBL_MAX) frontier.push_back(SPTFrontierEdge(label[n], n, labelParent[n]));
+
+	std::sort(frontier.begin(), frontier.end(), [](const SPTFrontierEdge & a, const SPTFrontierEdge & b)->bool
+	{
+		if (a.Label != b.Label) return a.Label < b.Label;
+		return a.Edge < b.Edge;
+	});
+}
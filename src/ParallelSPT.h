@@ -0,0 +1,121 @@
+// ===============================================================================================
+// Evacuation Solver: Parallel backward shortest path tree
+// Description: Multi-threaded delta-stepping over the graph snapshot that computes the same
+// backward shortest path tree as the CARMA Dijkstra loop. The result (distances, tree parents and
+// the settle order) is deterministic and does not depend on the number of threads.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "NAGraph.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+// An edge that was still queued when the serial loop stopped expanding along with the label and parent it had at that time
+struct SPTFrontierEdge
+{
+	double           Label;
+	NAGraphEdgeIndex Edge;
+	NAGraphEdgeIndex Parent;
+	SPTFrontierEdge(double label, NAGraphEdgeIndex edge, NAGraphEdgeIndex parent) : Label(label), Edge(edge), Parent(parent) { }
+};
+
+// A fixed set of worker threads that all run the same task. The calling thread works as worker zero.
+class SPTWorkerPool
+{
+private:
+	std::vector<std::thread>                threads;
+	std::mutex                              lock;
+	std::condition_variable                 startSignal;
+	std::condition_variable                 doneSignal;
+	std::function<void(unsigned int)>       task;
+	size_t                                  generation;
+	unsigned int                            pending;
+	bool                                    quit;
+
+	void WorkerLoop(unsigned int id);
+
+public:
+	SPTWorkerPool(unsigned int threadCount);
+	virtual ~SPTWorkerPool(void);
+
+	SPTWorkerPool(const SPTWorkerPool & that) = delete;
+	SPTWorkerPool & operator=(const SPTWorkerPool &) = delete;
+
+	unsigned int Size() const { return (unsigned int)threads.size() + 1; }
+
+	// runs task(id) on every worker and returns once all of them are done
+	void Run(const std::function<void(unsigned int)> & work);
+};
+
+// Edge-based backward search just like CARMA: the label of an edge is the cost from its from-junction to a safe zone
+// through the edge itself and an edge 'n' is relaxed by every edge 'p' leaving the to-junction of 'n'.
+// Distances are computed with delta-stepping where all the relaxations of one bucket phase run in parallel.
+// Tree parents are then picked exactly like the serial Dijkstra would pick them: the first settled edge that
+// gives the final label (smallest distance, tie level, then index). Seeds keep a null parent unless strictly improved.
+class ParallelBackwardSPT
+{
+private:
+	NAGraphSnapshotPtr                              graph;
+	SPTWorkerPool                                   pool;
+	std::unique_ptr<std::atomic<unsigned long long>[]> dist;
+	std::vector<double>                             seedLabel;
+	std::vector<NAGraphEdgeIndex>                   parent;
+	std::vector<unsigned int>                       level;
+	std::vector<NAGraphEdgeIndex>                   settleOrder;
+	std::vector<size_t>                             rank;
+	std::vector<std::vector<NAGraphEdgeIndex>>      improved;
+	size_t                                          edgeCount;
+	size_t                                          phaseCount;
+
+	static inline unsigned long long ToBits(double d)            { unsigned long long b; memcpy(&b, &d, sizeof(b)); return b; }
+	static inline double             ToDouble(unsigned long long b) { double d; memcpy(&d, &b, sizeof(d)); return d; }
+
+	// non-negative doubles keep their order when compared as unsigned integers
+	inline bool AtomicMin(NAGraphEdgeIndex e, double value)
+	{
+		unsigned long long newBits = ToBits(value), oldBits = dist[e].load(std::memory_order_relaxed);
+		while (newBits < oldBits) if (dist[e].compare_exchange_weak(oldBits, newBits, std::memory_order_relaxed)) return true;
+		return false;
+	}
+
+	void ComputeDistances(const std::vector<double> & cost, const std::vector<NAGraphEdgeIndex> & seeds, double delta);
+	void ComputeParents(const std::vector<double> & cost);
+	void ForEachEdge(const std::function<void(NAGraphEdgeIndex)> & work);
+
+public:
+	ParallelBackwardSPT(NAGraphSnapshotPtr snapshot, unsigned int threadCount);
+	virtual ~ParallelBackwardSPT(void) { }
+
+	ParallelBackwardSPT(const ParallelBackwardSPT & that) = delete;
+	ParallelBackwardSPT & operator=(const ParallelBackwardSPT &) = delete;
+
+	// cost is indexed by the snapshot edge index and any cost at or above CASPER_INFINITY blocks the edge
+	void Run(const std::vector<double> & cost, const std::vector<std::pair<NAGraphEdgeIndex, double>> & seeds);
+
+	inline bool             IsReached(NAGraphEdgeIndex e) const { return ToDouble(dist[e].load(std::memory_order_relaxed)) < DBL_MAX; }
+	inline double           GetDistance(NAGraphEdgeIndex e) const { return ToDouble(dist[e].load(std::memory_order_relaxed)); }
+	inline NAGraphEdgeIndex GetParent(NAGraphEdgeIndex e) const { return parent[e]; }
+	inline bool             IsSeed(NAGraphEdgeIndex e) const { return seedLabel[e] < DBL_MAX; }
+	inline double           GetSeedLabel(NAGraphEdgeIndex e) const { return seedLabel[e]; }
+	inline unsigned int     ThreadCount() const { return pool.Size(); }
+	inline size_t           PhaseCount() const { return phaseCount; }
+
+	// every reached edge sorted by (distance, tie level, index) so that a parent always comes before its children
+	const std::vector<NAGraphEdgeIndex> & SettleOrder() const { return settleOrder; }
+
+	// The queue of the serial loop had it stopped expanding after the first 'expandedCount' edges of the settle order.
+	// Sorted by label then index; each parent is the earliest expanded edge that gave the label.
+	void Frontier(size_t expandedCount, const std::vector<double> & cost, std::vector<SPTFrontierEdge> & frontier);
+};
+
+typedef std::shared_ptr<ParallelBackwardSPT> ParallelBackwardSPTPtr;
@@ -0,0 +1,152 @@
+// ===============================================================================================
+// Evacuation Solver: Edge reservation bookkeeping
+// Description: The order in which paths first reserved an edge along with their multiplicity, and
+// the multiset of the evacuation costs of the committed paths so that the largest one is always at hand.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "CoreTypes.h"
+#include <cassert>
+#include <map>
+#include <unordered_map>
+
+// Every path appears once in the reservation order along with its multiplicity so adding, removing and swapping a path
+// takes constant time. A removed path leaves a hole that is skipped by the iterator until there are enough holes to compact.
+// 'T' is a pointer type and a null pointer marks a hole.
+template <class T, class Hasher = std::hash<T>, class Equal = std::equal_to<T>> class ReservationOrder
+{
+private:
+	struct Slot
+	{
+		size_t       Index;
+		unsigned int Count;
+		Slot(size_t index, unsigned int count) : Index(index), Count(count) { }
+	};
+
+	std::vector<T>                             items;
+	std::unordered_map<T, Slot, Hasher, Equal> slots;
+	size_t                                     holes;
+
+	// compacts the order once at least half of it is holes so each removal is amortized constant time
+	void RemoveSlot(size_t index)
+	{
+		items[index] = nullptr;
+		if (++holes < 16 || holes * 2 < items.size()) return;
+
+		size_t j = 0;
+		for (const auto p : items) if (p)
+		{
+			slots.find(p)->second.Index = j;
+			items[j++] = p;
+		}
+		items.resize(j);
+		holes = 0;
+	}
+
+public:
+	class const_iterator
+	{
+	private:
+		typename std::vector<T>::const_iterator current;
+		typename std::vector<T>::const_iterator last;
+		inline void SkipHoles() { while (current != last && !(*current)) ++current; }
+
+	public:
+		const_iterator(typename std::vector<T>::const_iterator begin, typename std::vector<T>::const_iterator end) : current(begin), last(end) { SkipHoles(); }
+		const_iterator & operator++() { ++current; SkipHoles(); return *this; }
+		const T & operator*() const { return *current; }
+		bool operator==(const const_iterator & rhs) const { return current == rhs.current; }
+		bool operator!=(const const_iterator & rhs) const { return current != rhs.current; }
+	};
+
+	ReservationOrder(void) : holes(0) { }
+
+	// distinct items in the order they were first added
+	const_iterator begin() const { return const_iterator(items.cbegin(), items.cend()); }
+	const_iterator end()   const { return const_iterator(items.cend(),   items.cend()); }
+	inline bool    empty() const { return slots.empty(); }
+	inline size_t  size()  const { return slots.size(); }
+
+	// the order including the holes; only the compaction policy makes this interesting
+	inline size_t Capacity() const { return items.size(); }
+
+	unsigned int Count(const T & item) const
+	{
+		auto i = slots.find(item);
+		return i == slots.end() ? 0 : i->second.Count;
+	}
+
+	void Add(const T & item)
+	{
+		auto i = slots.find(item);
+		if (i != slots.end()) ++(i->second.Count);
+		else
+		{
+			slots.insert(std::pair<T, Slot>(item, Slot(items.size(), 1)));
+			items.push_back(item);
+		}
+	}
+
+	// all copies of the item go away at once. returns how many there were.
+	unsigned int Remove(const T & item)
+	{
+		auto i = slots.find(item);
+		if (i == slots.end()) return 0;
+		unsigned int count = i->second.Count;
+		size_t index = i->second.Index;
+		slots.erase(i);
+		RemoveSlot(index);
+		return count;
+	}
+
+	// the new item takes the place of the old one unless it is already in the order. returns how many copies moved.
+	unsigned int Swap(const T & oldItem, const T & newItem)
+	{
+		auto i = slots.find(oldItem);
+		if (i == slots.end()) return 0;
+		unsigned int count = i->second.Count;
+		size_t index = i->second.Index;
+		slots.erase(i);
+		auto j = slots.find(newItem);
+		if (j != slots.end())
+		{
+			j->second.Count += count;
+			RemoveSlot(index);
+		}
+		else
+		{
+			items[index] = newItem;
+			slots.insert(std::pair<T, Slot>(newItem, Slot(index, count)));
+		}
+		return count;
+	}
+};
+
+// The evacuation costs of the complete paths on an edge along with their multiplicity so that the max is always at hand
+class ReservedCostSet
+{
+private:
+	std::map<double, unsigned int> costs;
+
+public:
+	inline bool   empty() const { return costs.empty(); }
+	inline double Max()   const { return costs.empty() ? 0.0 : costs.crbegin()->first; }
+
+	void Add(double cost, unsigned int count = 1) { costs[cost] += count; }
+
+	void Remove(double cost, unsigned int count = 1)
+	{
+		auto i = costs.find(cost);
+		assert(i != costs.end() && i->second >= count && "Removing a reserved path cost that was never added");
+		if (i == costs.end()) return;
+		if (i->second > count) i->second -= count;
+		else costs.erase(i);
+	}
+};
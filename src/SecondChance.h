@@ -0,0 +1,83 @@
+// ===============================================================================================
+// Evacuation Solver: Second chance selection
+// Description: Picks the evacuees of the next iteration from the most expensive paths down. The
+// overlaps of a batch of paths are collected on a worker pool and applied one path at a time in
+// heap order so the picks are the same for any number of workers.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "ParallelSPT.h"
+
+// The adapter 'Paths' defines the path type 'Path', the picked type 'Pick', the per worker overlap counter 'Counter' and:
+//   static bool Less(Path a, Path b)                                           heap order, the most expensive path on top
+//   bool NeedsSecondChance(Path p)                                             only reads, runs on any worker
+//   void CollectOverlaps(Path p, Counter & counter, std::vector<Path> & out)   only reads, runs on any worker
+//   void ApplySecondChance(Path p, const std::vector<Path> & overlaps, std::vector<Pick> & picked)
+// The last one runs on the calling thread only, in heap order, and is the only one that changes anything.
+template <class Paths> class SecondChance
+{
+public:
+	typedef typename Paths::Path Path;
+	typedef typename Paths::Pick Pick;
+
+private:
+	Paths                                & paths;
+	SPTWorkerPool                        & pool;
+	std::vector<Path>                    batch;
+	std::vector<std::vector<Path>>       overlaps;
+	std::vector<typename Paths::Counter> counters;
+	std::vector<char>                    needsSecondChance;
+
+public:
+	SecondChance(Paths & _paths, SPTWorkerPool & _pool) : paths(_paths), pool(_pool), counters(_pool.Size()) { }
+
+	SecondChance(const SecondChance & that) = delete;
+	SecondChance & operator=(const SecondChance &) = delete;
+
+	// Pops paths off the heap 'heap' (built with 'Paths::Less') until 'maxPicks' are picked or the heap is empty. The overlaps
+	// of the paths after the one that fills up the picks are simply thrown away. The overlap vectors are cleared but kept
+	// across batches so they stop allocating after a while.
+	void Run(std::vector<Path> & heap, size_t maxPicks, std::vector<Pick> & picked)
+	{
+		auto heapEnd = heap.end();
+		const size_t batchSize = pool.Size() > 1 ? 4 * pool.Size() : 1;
+		std::atomic<size_t> next;
+
+		while (heapEnd != heap.begin() && picked.size() < maxPicks)
+		{
+			batch.clear();
+			for (; heapEnd != heap.begin() && batch.size() < batchSize; --heapEnd)
+			{
+				std::pop_heap(heap.begin(), heapEnd, Paths::Less);
+				batch.push_back(*(heapEnd - 1));
+			}
+
+			if (overlaps.size() < batch.size()) overlaps.resize(batch.size());
+			for (size_t i = 0; i < batch.size(); ++i) overlaps[i].clear();
+			needsSecondChance.assign(batch.size(), 0);
+			next = 0;
+			pool.Run([&](unsigned int worker)
+			{
+				for (size_t i = next++; i < batch.size(); i = next++)
+					if (paths.NeedsSecondChance(batch[i]))
+					{
+						needsSecondChance[i] = 1;
+						paths.CollectOverlaps(batch[i], counters[worker], overlaps[i]);
+					}
+			});
+
+			for (size_t i = 0; i < batch.size(); ++i)
+			{
+				if (picked.size() >= maxPicks) break;
+				if (needsSecondChance[i]) paths.ApplySecondChance(batch[i], overlaps[i], picked);
+			}
+		}
+	}
+};
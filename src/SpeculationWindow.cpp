@@ -0,0 +1,78 @@
+// ===============================================================================================
+// Evacuation Solver: Speculative routing window
+// Description: Implementation of the window bookkeeping and the validation of speculative routes
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "SpeculationWindow.h"
+
+SpeculationWindow::SpeculationWindow(NAGraphSnapshotPtr _graph, size_t k) : graph(_graph), windowSize(std::max((size_t)1, k)), slotCount(0), window(0),
+	evacueeCount(0), conflictCount(0), windowCount(0)
+{
+	slots.resize(windowSize);
+	dirty.assign(graph->EdgeCount(), 0);
+}
+
+size_t SpeculationWindow::MemoryUsage() const
+{
+	size_t mem = sizeof(unsigned int) * dirty.capacity();
+	for (const auto & s : slots) mem += sizeof(NAHierarchySeed) * (s.Sources.capacity() + s.Targets.capacity()) + sizeof(NAGraphEdgeIndex) * (s.Read.capacity() + s.Route.Edges.capacity()) +
+		sizeof(double) * s.ReadCost.capacity();
+	for (const auto & search : searches) mem += search->MemoryUsage();
+	return mem;
+}
+
+bool SpeculationWindow::SameSeeds(const std::vector<NAHierarchySeed> & a, const std::vector<NAHierarchySeed> & b)
+{
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); ++i)
+		if (a[i].Junction != b[i].Junction || a[i].Offset != b[i].Offset || a[i].Tag != b[i].Tag) return false;
+	return true;
+}
+
+void SpeculationWindow::MarkDirty(long eid, EdgeDirection dir)
+{
+	NAGraphEdgeIndex e = graph->Find(eid, dir);
+	if (e != NAGraphSnapshot::NoEdge) dirty[e] = window;
+}
+
+bool SpeculationWindow::Add(size_t key, double population, const std::vector<NAHierarchySeed> & sources, const std::vector<NAHierarchySeed> & targets)
+{
+	if (slotCount >= windowSize) return false;
+	Slot & s = slots[slotCount++];
+	s.Key = key;
+	s.Population = population;
+	s.Sources = sources;
+	s.Targets = targets;
+	s.Read.clear();
+	s.ReadCost.clear();
+	s.Route = NAHierarchyRoute();
+	s.Scanned = 0;
+	s.Found = false;
+	s.Taken = false;
+	return true;
+}
+
+bool SpeculationWindow::Holds(size_t key) const
+{
+	for (size_t i = 0; i < slotCount; ++i) if (slots[i].Key == key) return !slots[i].Taken;
+	return false;
+}
+
+SpeculationWindow::Slot * SpeculationWindow::Claim(size_t key, double population, const std::vector<NAHierarchySeed> & sources, const std::vector<NAHierarchySeed> & targets)
+{
+	Slot * s = nullptr;
+	for (size_t i = 0; i < slotCount && !s; ++i) if (slots[i].Key == key && !slots[i].Taken) s = &(slots[i]);
+	if (!s) return nullptr;
+
+	s->Taken = true;
+	++evacueeCount;
+	if (s->Population == population && SameSeeds(s->Sources, sources) && SameSeeds(s->Targets, targets)) return s;
+	++conflictCount;
+	return nullptr;
+}
@@ -0,0 +1,146 @@
+// ===============================================================================================
+// Evacuation Solver: Speculative routing window
+// Description: Routes a window of the next K evacuees concurrently with the bidirectional search
+// against the reservations at the start of the window. The routes are then committed in process
+// order and an evacuee is routed again only if an earlier commit changed something its search read.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "BidirectionalSearch.h"
+#include <atomic>
+
+// The bidirectional search is deterministic: given the same sources, the same targets and the same cost for every edge
+// it asks about, it returns the same route. A speculative route is therefore exactly the route the sequential loop would
+// have found as long as its sources and targets are still the same and every edge it asked about still costs the same.
+// Only the edges of roads that were reserved since the window was routed are costed again; a reservation that stays
+// within the slack of the traffic model leaves the cost as it was. Both directions of a road are marked since they may
+// share capacity.
+class SpeculationWindow
+{
+private:
+	struct Slot
+	{
+		size_t                        Key;
+		double                        Population;
+		std::vector<NAHierarchySeed>  Sources;
+		std::vector<NAHierarchySeed>  Targets;
+		std::vector<NAGraphEdgeIndex> Read;
+		std::vector<double>           ReadCost;
+		NAHierarchyRoute              Route;
+		size_t                        Scanned;
+		bool                          Found;
+		bool                          Taken;
+	};
+
+	NAGraphSnapshotPtr                    graph;
+	size_t                                windowSize;
+	std::vector<Slot>                     slots;
+	size_t                                slotCount;
+	std::vector<NABidirectionalSearchPtr> searches;
+	std::vector<unsigned int>             dirty;
+	unsigned int                          window;
+
+	size_t                                evacueeCount;
+	size_t                                conflictCount;
+	size_t                                windowCount;
+
+	static bool SameSeeds(const std::vector<NAHierarchySeed> & a, const std::vector<NAHierarchySeed> & b);
+	void MarkDirty(long eid, EdgeDirection dir);
+
+	// the unused slot of 'key' if its population, sources and targets are still the same. the slot is used up either way.
+	Slot * Claim(size_t key, double population, const std::vector<NAHierarchySeed> & sources, const std::vector<NAHierarchySeed> & targets);
+
+public:
+	SpeculationWindow(NAGraphSnapshotPtr _graph, size_t k);
+	virtual ~SpeculationWindow(void) { }
+
+	SpeculationWindow(const SpeculationWindow & that) = delete;
+	SpeculationWindow & operator=(const SpeculationWindow &) = delete;
+
+	// drops the routes of the current window. CARMA changes the order of the evacuees between buckets so a window never spans two of them.
+	void Clear() { slotCount = 0; }
+
+	// adds the first chunk of the evacuee at position 'key' of the sorted list to the next window. returns false once the window is full.
+	bool Add(size_t key, double population, const std::vector<NAHierarchySeed> & sources, const std::vector<NAHierarchySeed> & targets);
+
+	// true if the window still has a route for the evacuee at position 'key'
+	bool Holds(size_t key) const;
+
+	// Routes every evacuee of the window. 'pool' runs a task on each of its 'Size()' workers with the worker id and
+	// 'costOf(population, edge)' gives the cost of a snapshot edge for a chunk on the reservations at the start of the window.
+	template <class Pool, class CostOf> void Route(Pool & pool, CostOf costOf)
+	{
+		std::atomic<size_t> next(0);
+		while (searches.size() < pool.Size()) searches.push_back(NABidirectionalSearchPtr(new DEBUG_NEW_PLACEMENT NABidirectionalSearch(graph)));
+
+		// a wrap around of the window counter would make an old mark look current so every mark is cleared
+		if (++window == 0)
+		{
+			std::fill(dirty.begin(), dirty.end(), 0);
+			window = 1;
+		}
+		++windowCount;
+
+		pool.Run([&](unsigned int id)
+		{
+			NABidirectionalSearch & search = *searches[id];
+			for (size_t i = next++; i < slotCount; i = next++)
+			{
+				Slot & s = slots[i];
+				s.Read.clear();
+				s.ReadCost.clear();
+				s.Found = search.Nearest(s.Sources, s.Targets, [&](NAGraphEdgeIndex e) -> double
+				{
+					double c = costOf(s.Population, e);
+					s.Read.push_back(e);
+					s.ReadCost.push_back(c);
+					return c;
+				}, s.Route);
+				s.Scanned = search.GetLastForwardScanned() + search.GetLastBackwardScanned();
+			}
+		});
+	}
+
+	// Gives the speculative route of the evacuee at position 'key' if it is still valid for a chunk of 'population' with these
+	// sources and targets and 'costOf' on the current reservations. Otherwise the caller has to search again. Either way the
+	// route is used up.
+	template <class CostOf> bool Take(size_t key, double population, const std::vector<NAHierarchySeed> & sources, const std::vector<NAHierarchySeed> & targets,
+		CostOf costOf, NAHierarchyRoute & route, bool & found, size_t & scanned)
+	{
+		Slot * s = Claim(key, population, sources, targets);
+		if (!s) return false;
+		for (size_t i = 0; i < s->Read.size(); ++i)
+			if (dirty[s->Read[i]] == window && costOf(population, s->Read[i]) != s->ReadCost[i])
+			{
+				++conflictCount;
+				return false;
+			}
+
+		route = s->Route;
+		found = s->Found;
+		scanned = s->Scanned;
+		return true;
+	}
+
+	// a path was reserved on this road so both of its directions may cost more now
+	void Commit(long eid)
+	{
+		MarkDirty(eid, EdgeDirection::Along);
+		MarkDirty(eid, EdgeDirection::Against);
+	}
+
+	inline size_t WindowSize()    const { return windowSize;    }
+	inline size_t EvacueeCount()  const { return evacueeCount;  }
+	inline size_t ConflictCount() const { return conflictCount; }
+	inline size_t WindowCount()   const { return windowCount;   }
+	size_t MemoryUsage() const;
+};
+
+typedef std::shared_ptr<SpeculationWindow> SpeculationWindowPtr;
@@ -13,61 +13,37 @@
 
 #include "StdAfx.h"
 #include "utils.h"
+#include "TrafficPolicies.h"
 
-struct TrafficModelCacheNode
-{
-public:
-	double Capacity;
-	double Flow;
-	TrafficModelCacheNode(double capacity, double flow) : Capacity(capacity), Flow(flow) { }
-
-	inline bool friend operator<(const TrafficModelCacheNode& lhs, const TrafficModelCacheNode& rhs)
-	{
-		if (lhs.Capacity == rhs.Capacity) return lhs.Flow < rhs.Flow;
-		else return lhs.Capacity < rhs.Capacity;
-	}
-
-	inline bool friend operator==(const TrafficModelCacheNode& lhs, const TrafficModelCacheNode& rhs)
-	{
-		if (lhs.Capacity == rhs.Capacity) return lhs.Flow == rhs.Flow;
-		else return lhs.Capacity == rhs.Capacity;
-	}
-
-	inline bool friend operator!=(const TrafficModelCacheNode& lhs, const TrafficModelCacheNode& rhs){ return !(lhs == rhs); }
-	inline bool friend operator> (const TrafficModelCacheNode& lhs, const TrafficModelCacheNode& rhs){ return rhs < lhs;     }
-	inline bool friend operator<=(const TrafficModelCacheNode& lhs, const TrafficModelCacheNode& rhs){ return !(lhs > rhs);  }
-	inline bool friend operator>=(const TrafficModelCacheNode& lhs, const TrafficModelCacheNode& rhs){ return !(lhs < rhs);  }
-
-	struct Hasher : public std::hash<double>
-	{
-		size_t operator()(const TrafficModelCacheNode & e) const
-		{
-			return std::hash<double>::operator()(e.Capacity * 100.0 * e.Flow);
-		}
-	};
-};
-
+// The model parameters never change after construction so any number of threads can read them. The only mutable
+// state is the congestion memo which keeps one shard per thread (see 'CongestionMemo').
 class TrafficModel
 {
 private:
-	EvcTrafficModel model;
-	double saturationDensPerCap;
-	std::unordered_map<TrafficModelCacheNode, double, TrafficModelCacheNode::Hasher> myCache;
-	unsigned int cacheMiss;
-	unsigned int cacheHit;
-
-	double internalGetCongestionPercentage(double capacity, double flow) const;
+	const EvcTrafficModel model;
+	const double saturationDensPerCap;
+	const SpeedDensityTable speedTable;
+	CongestionMemo memo;
 
 public:
-	double InitDelayCostPerPop;
-	double CriticalDensPerCap;
+	const double InitDelayCostPerPop;
+	const double CriticalDensPerCap;
 
-	TrafficModel(EvcTrafficModel Model, double _criticalDensPerCap, double _saturationDensPerCap, double _initDelayCostPerPop);
+	TrafficModel(EvcTrafficModel Model, double _criticalDensPerCap, double _saturationDensPerCap, double _initDelayCostPerPop, const SpeedDensityTable & _speedTable);
 	virtual ~TrafficModel(void) { }
 	TrafficModel(const TrafficModel & that) = delete;
 	TrafficModel & operator=(const TrafficModel &) = delete;
-	double GetCongestionPercentage(double capacity, double flow);
+	double GetCongestionPercentage(double capacity, double flow) const;
 	double LeftCapacityOnEdge(double capacity, double reservedFlow, double originalEdgeCost) const;
-	double GetCacheHitPercentage() const { return 100.0 * cacheHit / (cacheHit + cacheMiss); }
+	double GetCacheHitPercentage() const;
+	inline EvcTrafficModel GetModel() const { return model; }
+	inline double GetSaturationDensPerCap() const { return saturationDensPerCap; }
+	inline const SpeedDensityTable & GetSpeedTable() const { return speedTable; }
+
+	template <class TrafficPolicy> inline double GetCongestionPercentage(double capacity, double flow) const
+	{
+		_ASSERT(TrafficPolicy::ModelID == (unsigned char)model);
+		return memo.SpeedPercent<TrafficPolicy>(CriticalDensPerCap, saturationDensPerCap, capacity, flow, speedTable);
+	}
 };
 
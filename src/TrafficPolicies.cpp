@@ -0,0 +1,88 @@
+// ===============================================================================================
+// Evacuation Solver: Traffic model policies implementation
+// Description: Parses the text form of the speed-density table
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "TrafficPolicies.h"
+#include <cwchar>
+#include <cwctype>
+#include <sstream>
+
+// reads exactly 'count' numbers from the text and fails if anything else is left in it
+static bool ParseSpeedTableNumbers(const std::wstring & value, double * numbers, size_t count)
+{
+	const wchar_t * p = value.c_str();
+	wchar_t * end = nullptr;
+	for (size_t i = 0; i < count; ++i)
+	{
+		numbers[i] = std::wcstod(p, &end);
+		if (end == p) return false;
+		p = end;
+	}
+	while (std::iswspace(*p)) ++p;
+	return *p == L'\0';
+}
+
+bool SpeedDensityTable::Parse(const std::wstring & value)
+{
+	std::vector<CapacityClass> newClasses;
+	std::wstring segment, point;
+	std::wistringstream segments(value);
+	double pair[2];
+
+	while (std::getline(segments, segment, L';'))
+	{
+		if (segment.find_first_not_of(L" \t\r\n") == std::wstring::npos) continue;
+		CapacityClass c;
+		size_t count = 0, colon = segment.find(L':');
+		c.MinCapacity = 0.0;
+		if (colon != std::wstring::npos)
+		{
+			if (!ParseSpeedTableNumbers(segment.substr(0, colon), &c.MinCapacity, 1)) return false;
+			segment = segment.substr(colon + 1);
+		}
+
+		// breakpoints have to be sorted by density and the speed is a percentage of the free flow speed. speed is not
+		// allowed to rise with density otherwise more people on an edge could make it cheaper.
+		std::wistringstream points(segment);
+		while (std::getline(points, point, L','))
+		{
+			if (count >= MaxBreakpoints || !ParseSpeedTableNumbers(point, pair, 2)) return false;
+			if (pair[0] < 0.0 || pair[1] < 0.0 || pair[1] > 1.0 || (count > 0 && pair[0] <= c.Density[count - 1])) return false;
+			if (count > 0 && pair[1] > c.Speed[count - 1]) return false;
+			c.Density[count] = pair[0];
+			c.Speed[count] = pair[1];
+			++count;
+		}
+		if (count == 0) return false;
+
+		// pad the curve so that the lookup never lands beyond the last real breakpoint
+		for (size_t i = 0; i < MaxBreakpoints; ++i)
+		{
+			c.Slope[i] = i + 1 < count ? (c.Speed[i + 1] - c.Speed[i]) / (c.Density[i + 1] - c.Density[i]) : 0.0;
+			if (i >= count)
+			{
+				c.Density[i] = DBL_MAX;
+				c.Speed[i] = c.Speed[count - 1];
+			}
+		}
+		c.FirstDensity = c.Density[0];
+		c.LastDensity = c.Density[count - 1];
+		newClasses.push_back(c);
+	}
+
+	std::sort(newClasses.begin(), newClasses.end(), [](const CapacityClass & a, const CapacityClass & b) { return a.MinCapacity < b.MinCapacity; });
+	for (size_t i = 1; i < newClasses.size(); ++i) if (newClasses[i].MinCapacity == newClasses[i - 1].MinCapacity) return false;
+
+	classes.swap(newClasses);
+	minCapacities.clear();
+	for (const auto & c : classes) minCapacities.push_back(c.MinCapacity);
+	text = value;
+	return true;
+}
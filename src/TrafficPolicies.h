@@ -0,0 +1,310 @@
+// ===============================================================================================
+// Evacuation Solver: Traffic model policies
+// Description: The speed-density math of every traffic model, the user supplied speed-density
+// table and the per-thread congestion cache. None of this depends on ATL or ArcObjects.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "CoreTypes.h"
+#include <atomic>
+#include <cstring>
+
+// A direct mapped congestion cache with a fixed number of slots. A key that lands on an occupied slot replaces the old
+// entry so the memory never grows and there is never a rehash. Every slot keeps its exact key so a hit returns exactly
+// what the model would have computed: the cache has no approximation error for any of the models.
+class CongestionCache
+{
+private:
+	struct Slot
+	{
+		double Capacity;
+		double Flow;
+		double Percentage;
+	};
+
+	std::vector<Slot> slots;
+	size_t mask;
+
+	// mixes the bits of both keys. hashing a product of the two puts every (c, f) and (f, c) and many more in one bucket.
+	inline size_t Index(double capacity, double flow) const
+	{
+		unsigned long long c, f, h;
+		std::memcpy(&c, &capacity, sizeof(c));
+		std::memcpy(&f, &flow, sizeof(f));
+		h = (c * 0x9E3779B97F4A7C15ull) ^ (f + 0x632BE59BD9B4E019ull + (c << 6) + (c >> 2));
+		h ^= h >> 31;
+		h *= 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 29;
+		return (size_t)h & mask;
+	}
+
+public:
+	CongestionCache(unsigned int bits = 16) : mask(((size_t)1 << bits) - 1)
+	{
+		Slot empty = { -1.0, -1.0, 1.0 };
+		slots.assign(mask + 1, empty);
+	}
+
+	CongestionCache(const CongestionCache & that) = delete;
+	CongestionCache & operator=(const CongestionCache &) = delete;
+
+	inline bool Find(double capacity, double flow, double & percentage) const
+	{
+		const Slot & s = slots[Index(capacity, flow)];
+		if (s.Capacity != capacity || s.Flow != flow) return false;
+		percentage = s.Percentage;
+		return true;
+	}
+
+	inline void Insert(double capacity, double flow, double percentage)
+	{
+		Slot & s = slots[Index(capacity, flow)];
+		s.Capacity = capacity;
+		s.Flow = flow;
+		s.Percentage = percentage;
+	}
+
+	inline size_t SlotCount() const { return slots.size(); }
+};
+
+// A user supplied speed-density curve. Each capacity class (all edges with at least that much capacity) has a piecewise
+// linear curve from density per unit capacity to speed percentage. The text form is
+//     "<min capacity>: <density> <speed>, <density> <speed>, ...; <min capacity>: ..."
+// and the capacity prefix can be left out for a single class. Densities beyond both ends of a curve keep the end speed.
+// Every curve is padded to a fixed number of breakpoints so the lookup is a branch-free binary search of fixed depth.
+class SpeedDensityTable
+{
+public:
+	static const size_t MaxBreakpoints = 16;
+
+private:
+	struct CapacityClass
+	{
+		double MinCapacity;
+		double FirstDensity;
+		double LastDensity;
+		double Density[MaxBreakpoints];
+		double Speed  [MaxBreakpoints];
+		double Slope  [MaxBreakpoints];
+	};
+
+	std::vector<CapacityClass> classes;
+	std::vector<double> minCapacities;
+	std::wstring text;
+
+	// index of the last element of the sorted array 'values' that is not larger than 'key'. the first element is the fallback.
+	static inline size_t LastNotAbove(const double * values, size_t count, double key)
+	{
+		const double * base = values;
+		while (count > 1)
+		{
+			size_t half = count >> 1;
+			base = base[half] <= key ? base + half : base;
+			count -= half;
+		}
+		return base - values;
+	}
+
+public:
+	SpeedDensityTable() { }
+
+	// returns false and leaves the table untouched if the text is malformed or a speed rises with density
+	bool Parse(const std::wstring & value);
+	inline const std::wstring & GetText() const { return text; }
+	inline bool IsEmpty() const { return classes.empty(); }
+
+	inline double SpeedPercent(double capacity, double flow) const
+	{
+		if (classes.empty()) return 1.0;
+		const CapacityClass & c = classes[LastNotAbove(minCapacities.data(), minCapacities.size(), capacity)];
+		double density = std::min(c.LastDensity, std::max(c.FirstDensity, flow / capacity));
+		size_t i = LastNotAbove(c.Density, MaxBreakpoints, density);
+		return c.Speed[i] + c.Slope[i] * (density - c.Density[i]);
+	}
+};
+
+// Traffic model policies. This is where the actual capacity aware part is happening: each policy knows how much the
+// speed of an edge drops once its flow is beyond the critical density. The search loops are instantiated once per
+// policy so the math of the selected model is inlined into the edge relaxation. Only the models with expensive math
+// (exp, pow, log) go through the congestion cache; the rest are cheaper to compute than to look up. 'ModelID' is the value
+// of the matching EvcTrafficModel which is a type library enum and therefore not visible here. 'Monotone' promises that more
+// flow never makes an edge faster; the searches that keep labels across reservations are only allowed when it holds.
+struct FLATModelPolicy
+{
+	static const unsigned char ModelID = 0x0;
+	static const bool Cached = false;
+	static const bool Monotone = true;
+	static inline double SpeedPercent(double /*criticalDensPerCap*/, double /*saturationDensPerCap*/, double /*capacity*/, double /*flow*/, const SpeedDensityTable & /*table*/) { return 1.0; }
+};
+
+struct STEPModelPolicy
+{
+	static const unsigned char ModelID = 0x1;
+	static const bool Cached = false;
+	static const bool Monotone = true;
+	static inline double SpeedPercent(double /*criticalDensPerCap*/, double /*saturationDensPerCap*/, double /*capacity*/, double /*flow*/, const SpeedDensityTable & /*table*/) { return 0.0; }
+};
+
+struct LINEARModelPolicy
+{
+	static const unsigned char ModelID = 0x2;
+	static const bool Cached = false;
+	static const bool Monotone = true;
+	static inline double SpeedPercent(double criticalDensPerCap, double saturationDensPerCap, double capacity, double flow, const SpeedDensityTable & /*table*/)
+	{
+		return 1.0 - (flow - criticalDensPerCap * capacity) / (2.0 * (saturationDensPerCap * capacity - criticalDensPerCap * capacity));
+	}
+};
+
+struct POWERModelPolicy
+{
+	static const unsigned char ModelID = 0x3;
+	static const bool Cached = true;
+	static const bool Monotone = true;
+	static inline double SpeedPercent(double /*criticalDensPerCap*/, double saturationDensPerCap, double capacity, double flow, const SpeedDensityTable & /*table*/)
+	{
+		/* Power model z = 1.0 - 0.0202 * sqrt(x) * exp(-0.01127 * y)
+			modelRatio = 0.0202 * exp(-0.01127 * reservations->Capacity);
+		*/
+		double modelRatio = 0.5 / (std::sqrt(saturationDensPerCap) * std::exp(-0.01127));
+		modelRatio *= std::exp(-0.01127 * capacity);
+		return 1.0 - modelRatio * std::sqrt(flow);
+	}
+};
+
+struct EXPModelPolicy
+{
+	static const unsigned char ModelID = 0x4;
+	static const bool Cached = true;
+	static const bool Monotone = true;
+	static inline double SpeedPercent(double /*criticalDensPerCap*/, double saturationDensPerCap, double capacity, double flow, const SpeedDensityTable & /*table*/)
+	{
+		/* Exp Model z = exp(-(((flow - 1) / beta) ^ gamma) * log(2))
+			a = flow of normal speed, 	b = flow where the speed is dropped to half
+			(modelRatio) beta  = b * lane - 1;
+			(expGamma)   gamma = (log(log(0.96) / log(0.5))) / log((a * lane - 1) / (b * lane - 1));
+		*/
+		double a = 2.0;
+		double b = std::max(a + 1.0, saturationDensPerCap);
+		double modelRatio = b * capacity - 1.0;
+		double expGamma   = (std::log(std::log(0.9) / std::log(0.5))) / std::log((a * capacity - 1.0) / (b * capacity - 1.0));
+		return std::exp(-std::pow(((flow - 1.0) / modelRatio), expGamma) * std::log(2.0));
+	}
+};
+
+struct TABLEModelPolicy
+{
+	static const unsigned char ModelID = 0x5;
+	static const bool Cached = false;
+	static const bool Monotone = true; // the parser rejects a curve whose speed rises with density
+	static inline double SpeedPercent(double /*criticalDensPerCap*/, double /*saturationDensPerCap*/, double capacity, double flow, const SpeedDensityTable & table)
+	{
+		return table.SpeedPercent(capacity, flow);
+	}
+};
+
+// The congestion memo and the cache statistics of one thread. Only the owner thread ever touches a claimed shard so
+// there is no lock on the lookup. The padding keeps the counters of two threads out of the same cache line.
+struct CongestionShard
+{
+	std::atomic<size_t> Owner;
+	std::unique_ptr<CongestionCache> Cache;
+	unsigned int Hit;
+	unsigned int Miss;
+	char padding[64];
+
+	CongestionShard() : Owner(0), Cache(nullptr), Hit(0), Miss(0) { }
+	CongestionShard(const CongestionShard & that) = delete;
+	CongestionShard & operator=(const CongestionShard &) = delete;
+};
+
+// The congestion memo of a traffic model split into per-thread shards: a thread claims a free shard the first time it
+// has to look up a congested edge (by thread token, lock-free) and keeps it for the lifetime of the memo. A thread that
+// finds all shards taken computes the speed without the memo. Uncongested edges never need the memo so they never claim.
+class CongestionMemo
+{
+public:
+	static const size_t ShardCount = 16;
+
+private:
+	mutable CongestionShard shards[ShardCount];
+
+	// a small number that is unique to the calling thread and never zero
+	static inline size_t ThreadToken()
+	{
+		static std::atomic<size_t> lastToken(0);
+		static thread_local size_t token = ++lastToken;
+		return token;
+	}
+
+	inline CongestionShard * GetShard() const
+	{
+		size_t id = ThreadToken(), owner = 0;
+
+		// shards are never released so the first free shard on the probe sequence is always after the one this thread owns
+		for (size_t i = 0; i < ShardCount; ++i)
+		{
+			CongestionShard & shard = shards[(id + i) & (ShardCount - 1)];
+			owner = shard.Owner.load(std::memory_order_acquire);
+			if (owner == id) return &shard;
+			if (owner == 0)
+			{
+				if (shard.Owner.compare_exchange_strong(owner, id, std::memory_order_acq_rel)) return &shard;
+				if (owner == id) return &shard;
+			}
+		}
+		return nullptr;
+	}
+
+public:
+	CongestionMemo(void) { }
+	CongestionMemo(const CongestionMemo & that) = delete;
+	CongestionMemo & operator=(const CongestionMemo &) = delete;
+
+	// only the cached models keep statistics and only for the congested edges they actually look up
+	template <class TrafficPolicy> inline double SpeedPercent(double criticalDensPerCap, double saturationDensPerCap, double capacity, double flow,
+		const SpeedDensityTable & table) const
+	{
+		double percentage = 1.0;
+		if (flow <= criticalDensPerCap * capacity) return percentage;
+		if (!TrafficPolicy::Cached) return TrafficPolicy::SpeedPercent(criticalDensPerCap, saturationDensPerCap, capacity, flow, table);
+
+		CongestionShard * shard = GetShard();
+		if (!shard) return TrafficPolicy::SpeedPercent(criticalDensPerCap, saturationDensPerCap, capacity, flow, table);
+		if (!shard->Cache) shard->Cache.reset(new DEBUG_NEW_PLACEMENT CongestionCache());
+		if (shard->Cache->Find(capacity, flow, percentage)) ++shard->Hit;
+		else
+		{
+			percentage = TrafficPolicy::SpeedPercent(criticalDensPerCap, saturationDensPerCap, capacity, flow, table);
+			shard->Cache->Insert(capacity, flow, percentage);
+			++shard->Miss;
+		}
+		return percentage;
+	}
+
+	// the statistics are summed over all shards once the threads are done
+	double GetHitPercentage() const
+	{
+		unsigned long long hit = 0, miss = 0;
+		for (const auto & shard : shards)
+		{
+			hit += shard.Hit;
+			miss += shard.Miss;
+		}
+		return hit + miss == 0 ? 100.0 : 100.0 * hit / (hit + miss);
+	}
+
+	size_t GetClaimedCount() const
+	{
+		size_t claimed = 0;
+		for (const auto & shard : shards) if (shard.Owner.load(std::memory_order_acquire) != 0) ++claimed;
+		return claimed;
+	}
+};
@@ -1096,6 +1096,18 @@
 #define WM_SYSKEYDOWN                   0x0104
 #define IDC_COMBO_CAPACITY2             260
 #define IDC_COMBO_DYNMODE               260
+#define IDC_EDIT_CARMAThreads           261
+#define IDC_Lable_CARMAThreads          262
+#define IDC_CHECK_IncrementalChunks     263
+#define IDC_EDIT_SpeedTable             264
+#define IDC_Lable_SpeedTable            265
+#define IDC_CHECK_LifelongCARMA         266
+#define IDC_CHECK_ALTLandmarks          267
+#define IDC_CHECK_HierarchySP           268
+#define IDC_CHECK_CellOverlay           269
+#define IDC_CHECK_Bidirectional         270
+#define IDC_EDIT_SpeculationWindow      271
+#define IDC_Lable_SpeculationWindow     272
 #define WM_SYSKEYUP                     0x0105
 #define WM_SYSCHAR                      0x0106
 #define WM_SYSDEADCHAR                  0x0107
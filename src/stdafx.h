@@ -119,7 +119,9 @@ using ATL::CRegistryVirtualMachine;
 // other needed libraries
 #include <algorithm>
 #include <ctime>
+#include <cmath>
 #include <string>
+#include <cstring>
 #include <sstream>
 #include <windows.h>
 #include <Windowsx.h>
@@ -134,6 +136,15 @@ using ATL::CRegistryVirtualMachine;
 #include <functional>
 #include <memory>
 #include <iterator>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include <new>
+#include <immintrin.h>
 
 #pragma warning(push)
 #pragma warning(disable : 4521) /* Ignore warning for boost::heap multiple copy constructors  */
@@ -12,21 +12,15 @@
 #pragma once
 
 #include "StdAfx.h"
+#include "CoreTypes.h"
 
-#ifndef CASPER_INFINITY
-#define CASPER_INFINITY 3.402823466e+38
-#endif
-
-enum class EdgeDirtyState      : unsigned char { CleanState = 0x0, CostIncreased = 0x1, CostDecreased = 0x2 };
-enum class NAEdgeMapGeneration : unsigned char { None = 0x0, OldGen = 0x1, NewGen = 0x2, AllGens = 0x3 };
 enum class EvacueeStatus       : unsigned char { Unprocessed = 0x0, Processed = 0x1, Unreachable = 0x2, CARMALooking = 0x3 };
 enum class QueryDirection      : unsigned char { Forward = 0x1, Backward = 0x2 };
 enum class FlockingStatus      : unsigned char { None = '\0', Init = 'I', Moving = 'M', End = 'E', Stopped = 'S', Collided = 'C' };
-enum class EdgeDirection       : unsigned char { None = 0x0, Along = 0x1, Against = 0x2, Both = 0x3 };
 enum class PathStatus          : unsigned char { ActiveComplete = 0x0, FrozenComplete = 0x1, FrozenSplitted = 0x2 };
 
 [export, uuid("096CB996-9144-4CC3-BB69-FCFAA5C273FC")] enum class EvcSolverMethod : unsigned char { SPSolver = 0x0, CCRPSolver = 0x1, CASPERSolver = 0x2 };
-[export, uuid("BFDD2DB3-DA25-42CA-8021-F67BF7D14948")] enum class EvcTrafficModel : unsigned char { FLATModel = 0x0, STEPModel = 0x1, LINEARModel = 0x2, POWERModel = 0x3, EXPModel = 0x4 };
+[export, uuid("BFDD2DB3-DA25-42CA-8021-F67BF7D14948")] enum class EvcTrafficModel : unsigned char { FLATModel = 0x0, STEPModel = 0x1, LINEARModel = 0x2, POWERModel = 0x3, EXPModel = 0x4, TABLEModel = 0x5 };
 [export, uuid("C46A6356-07A6-473A-B39F-FBB74469201D")] enum class EvacueeGrouping : unsigned char { None = 0x0, Merge = 0x1, Separate = 0x2, MergeSeparate = 0x3 };
 [export, uuid("1B84C35A-9585-49DA-9B81-BB4873E8D331")] enum class DynamicMode     : unsigned char { Disabled = 0x0, Simple = 0x1, Full = 0x2, Smart = 0x3 };
 
@@ -37,7 +31,6 @@ enum class PathStatus          : unsigned char { ActiveComplete = 0x0, FrozenCom
 DEFINE_ENUM_FLAG_OPERATORS(NAEdgeMapGeneration)
 DEFINE_ENUM_FLAG_OPERATORS(EvacueeGrouping)
 DEFINE_ENUM_FLAG_OPERATORS(EdgeDirection)
-template <class T> inline bool CheckFlag(T var, T flag) { return (var & flag) != T::None; }
 
 #define FLOCK_PROFILE char
 #define FLOCK_PROFILE_CAR		0x0
@@ -353,3 +346,109 @@ public:
 		maxWeight = max(maxWeight, newWeight);
 	}
 };
+
+// A solve scoped slab allocator. Objects are carved out of big slabs instead of being new-ed one by one so the
+// ones that are created together also sit together in memory. A released object goes to a free list and its slot
+// is handed out again by the next allocation. DestroyAll runs all the remaining destructors in one linear sweep over
+// the slabs and gives the memory back in bulk.
+template <class T, size_t SlabItems = 1024>
+class SlabPool
+{
+private:
+	union Slot
+	{
+		Slot * next;
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type item;
+	};
+
+	std::vector<Slot *> slabs;
+	Slot   * freeList;
+	size_t lastSlabUsed;
+	size_t allocCount;
+	size_t liveCount;
+	size_t peakLiveCount;
+
+public:
+	SlabPool() : freeList(nullptr), lastSlabUsed(SlabItems), allocCount(0), liveCount(0), peakLiveCount(0) { }
+	virtual ~SlabPool() { Release(); }
+
+	SlabPool(const SlabPool & that) = delete;
+	SlabPool & operator=(const SlabPool &) = delete;
+
+	void * Allocate()
+	{
+		Slot * slot = nullptr;
+		if (freeList)
+		{
+			slot = freeList;
+			freeList = freeList->next;
+		}
+		else
+		{
+			if (lastSlabUsed >= SlabItems)
+			{
+				slabs.push_back(new DEBUG_NEW_PLACEMENT Slot[SlabItems]);
+				lastSlabUsed = 0;
+			}
+			slot = slabs.back() + lastSlabUsed++;
+		}
+		++allocCount;
+		++liveCount;
+		peakLiveCount = max(peakLiveCount, liveCount);
+		return &(slot->item);
+	}
+
+	void Deallocate(void * item)
+	{
+		if (!item) return;
+		_ASSERT(liveCount > 0);
+		Slot * slot = reinterpret_cast<Slot *>(item);
+		slot->next = freeList;
+		freeList = slot;
+		--liveCount;
+	}
+
+	template <class... Args> T * New(Args&&... args)
+	{
+		void * item = Allocate();
+		try { return new (item) T(std::forward<Args>(args)...); }
+		catch (...) { Deallocate(item); throw; }
+	}
+
+	void Delete(T * item) { if (item) { item->~T(); Deallocate(item); } }
+
+	// destroys every live object of the pool in allocation order and releases all slabs
+	void DestroyAll()
+	{
+		// the slots on the free list hold no object. they are rare so a set is enough to skip them during the sweep
+		std::unordered_set<const Slot *> freeSlots;
+		for (const Slot * f = freeList; f; f = f->next) freeSlots.insert(f);
+
+		for (size_t s = 0; s < slabs.size(); ++s)
+		{
+			size_t count = s + 1 == slabs.size() ? lastSlabUsed : SlabItems;
+			for (size_t i = 0; i < count; ++i)
+				if (freeSlots.empty() || freeSlots.find(slabs[s] + i) == freeSlots.end()) reinterpret_cast<T *>(&(slabs[s][i].item))->~T();
+		}
+		liveCount = 0;
+		Release();
+	}
+
+	// gives the slabs back to the heap once every object is gone. Otherwise the memory is kept for later allocations.
+	bool Release()
+	{
+		if (liveCount > 0) return false;
+		for (auto s : slabs) delete [] s;
+		slabs.clear();
+		freeList = nullptr;
+		lastSlabUsed = SlabItems;
+		return true;
+	}
+
+	inline size_t AllocationCount() const { return allocCount;    }
+	inline size_t LiveCount()       const { return liveCount;     }
+	inline size_t PeakLiveCount()   const { return peakLiveCount; }
+	inline size_t SlabCount()       const { return slabs.size();  }
+	inline size_t SlabBytes()       const { return slabs.size() * SlabItems * sizeof(Slot); }
+	inline void   ResetCounters()         { allocCount = 0; peakLiveCount = liveCount; }
+};
@@ -0,0 +1,142 @@
+// ===============================================================================================
+// Evacuation Solver: Bidirectional search tests
+// Description: Many-to-nearest queries of the bidirectional search on random networks against the
+// same search with only its forward side and against plain Dijkstra while edge costs keep changing,
+// and the scanned edges and time of each.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "RandomNetwork.h"
+#include "BidirectionalSearch.h"
+#include <chrono>
+
+static void TestNetwork(long rows, long cols, unsigned int seed, size_t rounds, size_t queriesPerRound)
+{
+	NAGraphSnapshotPtr graph = RandomNetwork(rows, cols, seed);
+	std::vector<double> cost(graph->EdgeCount());
+	std::vector<unsigned int> asked(graph->EdgeCount(), 0);
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)cost.size(); ++e) cost[e] = graph->GetCost(e);
+
+	// the search has to ask for each edge at most once per query so both sides see the same cost
+	bool askedTwice = false;
+	auto CostOf = [&](NAGraphEdgeIndex e) -> double
+	{
+		if (++asked[e] > 1) askedTwice = true;
+		return cost[e];
+	};
+
+	NABidirectionalSearch search(graph);
+	std::mt19937 random(seed + 1);
+	std::uniform_int_distribution<NAGraphEdgeIndex> edge(0, (NAGraphEdgeIndex)cost.size() - 1);
+	std::uniform_real_distribution<double> factor(1.0, 3.0);
+	std::vector<NAHierarchySeed> targets = RandomSeeds(*graph, 8, random);
+	NAHierarchyRoute both, forward;
+	double dijkstraTime = 0.0, bothTime = 0.0, forwardTime = 0.0;
+	size_t found = 0, queries = 0, bothScanned = 0, forwardScanned = 0;
+
+	for (size_t r = 0; r < rounds; ++r)
+	{
+		// a committed route raises the cost of its own edges only; now and then an edge is closed or opens again
+		for (int k = 0; k < 20; ++k)
+		{
+			NAGraphEdgeIndex e = edge(random);
+			if (k == 0) cost[e] = cost[e] >= CASPER_INFINITY ? graph->GetCost(e) : CASPER_INFINITY;
+			else if (cost[e] < CASPER_INFINITY) cost[e] *= factor(random);
+		}
+
+		for (size_t q = 0; q < queriesPerRound; ++q, ++queries)
+		{
+			std::vector<NAHierarchySeed> sources = RandomSeeds(*graph, 1 + q % 3, random);
+			auto t0 = std::chrono::steady_clock::now();
+			double expected = DijkstraNearest(*graph, cost, sources, targets);
+			auto t1 = std::chrono::steady_clock::now();
+			bool hitBoth = search.Nearest(sources, targets, CostOf, both);
+			auto t2 = std::chrono::steady_clock::now();
+			std::fill(asked.begin(), asked.end(), 0);
+			bothScanned += search.GetLastForwardScanned() + search.GetLastBackwardScanned();
+			auto t3 = std::chrono::steady_clock::now();
+			bool hitForward = search.Nearest(sources, targets, CostOf, forward, false);
+			auto t4 = std::chrono::steady_clock::now();
+			std::fill(asked.begin(), asked.end(), 0);
+			forwardScanned += search.GetLastForwardScanned();
+			dijkstraTime += std::chrono::duration<double, std::micro>(t1 - t0).count();
+			bothTime += std::chrono::duration<double, std::micro>(t2 - t1).count();
+			forwardTime += std::chrono::duration<double, std::micro>(t4 - t3).count();
+
+			CHECK(!askedTwice);
+			CHECK(hitBoth == (expected < CASPER_INFINITY));
+			CHECK(hitForward == hitBoth);
+			if (!hitBoth || !hitForward) continue;
+			++found;
+			CHECK_NEAR(both.Cost, expected);
+			CHECK_NEAR(forward.Cost, both.Cost);
+			CheckRoute(*graph, cost, sources, targets, both);
+			CheckRoute(*graph, cost, sources, targets, forward);
+		}
+		if (testFailures > 0) break;
+	}
+
+	// the forward only runs are comparisons and stay out of the totals of the search
+	CHECK(found > 0);
+	CHECK(search.GetQueryCount() == queries);
+	std::printf("%ld x %ld grid: scanned edges bidirectional %.0f, forward only %.0f per query; Dijkstra %.1f us, bidirectional %.1f us, forward only %.1f us per query\n",
+		rows, cols, (double)bothScanned / queries, (double)forwardScanned / queries, dijkstraTime / queries, bothTime / queries, forwardTime / queries);
+}
+
+static void TestSmall()
+{
+	// 1 -> 2 -> 3 is cheaper than the direct 1 -> 3; junction 5 is a second safe zone that costs more to get into
+	std::vector<NAGraphEdge> edges;
+	edges.push_back(NAGraphEdge(1, EdgeDirection::Along, 1, 2, 1.0, 10.0f));
+	edges.push_back(NAGraphEdge(2, EdgeDirection::Along, 2, 3, 1.0, 10.0f));
+	edges.push_back(NAGraphEdge(3, EdgeDirection::Along, 1, 3, 5.0, 10.0f));
+	edges.push_back(NAGraphEdge(4, EdgeDirection::Along, 4, 1, 1.0, 10.0f));
+	edges.push_back(NAGraphEdge(5, EdgeDirection::Along, 1, 5, 1.0, 10.0f));
+	NAGraphSnapshotPtr graph(new NAGraphSnapshot());
+	graph->Build(edges);
+
+	std::vector<double> cost(graph->EdgeCount());
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)cost.size(); ++e) cost[e] = graph->GetCost(e);
+	auto CostOf = [&](NAGraphEdgeIndex e) { return cost[e]; };
+	NABidirectionalSearch search(graph);
+	NAHierarchyRoute route;
+	std::vector<NAHierarchySeed> sources, targets;
+
+	// nothing to find without a safe zone
+	sources.push_back(NAHierarchySeed(4, 0.5, 0));
+	CHECK(!search.Nearest(sources, targets, CostOf, route));
+	CHECK(route.Cost >= CASPER_INFINITY && route.Edges.empty());
+
+	targets.push_back(NAHierarchySeed(3, 0.25, 0));
+	targets.push_back(NAHierarchySeed(5, 3.0, 1));
+	CHECK(search.Nearest(sources, targets, CostOf, route));
+	CHECK_NEAR(route.Cost, 3.75);
+	CHECK(route.TargetTag == 0 && route.Edges.size() == 3);
+	CheckRoute(*graph, cost, sources, targets, route);
+
+	// closing 2 -> 3 makes the direct edge and the second safe zone tie; either one is the nearest
+	cost[graph->Find(2, EdgeDirection::Along)] = CASPER_INFINITY;
+	CHECK(search.Nearest(sources, targets, CostOf, route));
+	CHECK_NEAR(route.Cost, 5.5);
+	CheckRoute(*graph, cost, sources, targets, route);
+
+	// a source on a safe zone junction is its own meeting point
+	sources.push_back(NAHierarchySeed(5, 0.0, 1));
+	CHECK(search.Nearest(sources, targets, CostOf, route));
+	CHECK_NEAR(route.Cost, 3.0);
+	CHECK(route.SourceTag == 1 && route.TargetTag == 1 && route.Edges.empty());
+}
+
+int main()
+{
+	TestSmall();
+	TestNetwork(20, 20, 51, 30, 20);
+	TestNetwork(60, 60, 52, 30, 20);
+	TestNetwork(150, 150, 53, 5, 20);
+	return TestResult("BidirectionalTest");
+}
@@ -0,0 +1,124 @@
+// ===============================================================================================
+// Evacuation Solver: Batch edge cost tests
+// Description: The batch cost kernel and the batch dirty test against the single edge cost and
+// dirty test of every traffic policy and solver method on random edges: blocked, never cleaned,
+// clean and dirty ones. CMake builds this twice so both the AVX2 and the plain loops are covered.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "TestUtils.h"
+#include "EdgeCost.h"
+#include <random>
+
+// the values match EvcSolverMethod
+enum class TestMethod : unsigned char { SPSolver = 0x0, CCRPSolver = 0x1, CASPERSolver = 0x2 };
+
+// the parts of TrafficModel that the edge cost reads
+class TestModel
+{
+private:
+	const double saturationDensPerCap;
+	const SpeedDensityTable & speedTable;
+	CongestionMemo memo;
+
+public:
+	const double InitDelayCostPerPop;
+	const double CriticalDensPerCap;
+
+	TestModel(double critical, double saturation, double initDelay, const SpeedDensityTable & table) :
+		saturationDensPerCap(saturation), speedTable(table), InitDelayCostPerPop(initDelay), CriticalDensPerCap(critical) { }
+
+	inline double GetSaturationDensPerCap() const { return saturationDensPerCap; }
+	inline const SpeedDensityTable & GetSpeedTable() const { return speedTable; }
+
+	template <class TrafficPolicy> inline double GetCongestionPercentage(double capacity, double flow) const
+	{
+		return memo.SpeedPercent<TrafficPolicy>(CriticalDensPerCap, saturationDensPerCap, capacity, flow, speedTable);
+	}
+};
+
+// what 'NAEdge::HowDirty' does with 'exhaustive' set
+template <class TrafficPolicy> static EdgeDirtyState HowDirty(const TestModel & model, const EdgeCostBatch & b, size_t i, TestMethod method, double newPop)
+{
+	if (b.CleanCost[i] <= 0.0) return EdgeDirtyState::CostIncreased;
+	return CostChange(CapacityAwareCost<TrafficPolicy>(&model, b.OriginalCost[i], b.Capacity[i], b.ReservedPop[i], newPop, method), b.CleanCost[i]);
+}
+
+// The batch is reused from one call to the next like the solver does, so whatever the last one left behind the count
+// must not be seen. Every clean cost is picked around the cost the edge has now.
+template <class TrafficPolicy> static void TestPolicy(const char * name, const SpeedDensityTable & table, std::mt19937 & random)
+{
+	static EdgeCostBatch b;
+	std::uniform_int_distribution<int> kind(0, 99);
+	std::uniform_real_distribution<double> cost(0.1, 100.0), capacity(0.5, 30.0), pop(0.0, 300.0), ratio(0.5, 2.0);
+	EdgeDirtyState states[EdgeCostBatch::Size];
+	size_t costErrors = 0, stateErrors = 0, counts[3] = { 0, 0, 0 };
+
+	for (TestMethod method : { TestMethod::SPSolver, TestMethod::CCRPSolver, TestMethod::CASPERSolver })
+		for (double initDelay : { 0.0, 0.5 })
+			for (size_t count : { EdgeCostBatch::Size, EdgeCostBatch::Size - 1, (size_t)6, (size_t)1 })
+			{
+				TestModel model(2.0, 5.0, initDelay, table);
+				double newPop = kind(random) < 50 ? 1.0 : 20.0;
+
+				b.Count = count;
+				for (size_t i = 0; i < count; ++i)
+				{
+					int k = kind(random);
+					b.OriginalCost[i] = k < 5 ? CASPER_INFINITY : (k < 10 ? 0.0 : std::floor(cost(random)));
+					k = kind(random);
+					b.Capacity[i] = k < 5 ? 0.0 : (k < 8 ? -1.0 : std::floor(capacity(random)));
+					b.ReservedPop[i] = kind(random) < 30 ? 0.0 : std::floor(pop(random));
+
+					double now = CapacityAwareCost<TrafficPolicy>(&model, b.OriginalCost[i], b.Capacity[i], b.ReservedPop[i], newPop, method);
+					k = kind(random);
+					if      (k < 10) b.CleanCost[i] = 0.0;
+					else if (k < 15) b.CleanCost[i] = -1.0;
+					else if (k < 35) b.CleanCost[i] = now;
+					else if (k < 45) b.CleanCost[i] = now * (k < 40 ? 1.0 + FLT_EPSILON / 2.0 : 1.0 - FLT_EPSILON / 2.0);
+					else if (k < 50) b.CleanCost[i] = now * (k < 48 ? 1.0 + FLT_EPSILON * 4.0 : 1.0 - FLT_EPSILON * 4.0);
+					else b.CleanCost[i] = now * ratio(random);
+				}
+
+				CostKernel<TrafficPolicy>(b, &model, method, newPop);
+				CostChangeBatch(b, states);
+				for (size_t i = 0; i < count; ++i)
+				{
+					// 'SetClean' keeps the exact same cost
+					if (b.Cost[i] != CapacityAwareCost<TrafficPolicy>(&model, b.OriginalCost[i], b.Capacity[i], b.ReservedPop[i], newPop, method)) ++costErrors;
+					if (states[i] != HowDirty<TrafficPolicy>(model, b, i, method, newPop)) ++stateErrors;
+					++counts[(int)states[i]];
+				}
+			}
+
+	CHECK(costErrors == 0);
+	CHECK(stateErrors == 0);
+	CHECK(counts[0] > 0 && counts[1] > 0 && counts[2] > 0);
+	std::printf("%-6s: %d clean, %d increased and %d decreased edges, %d costs and %d states differ\n", name, (int)counts[0], (int)counts[1], (int)counts[2],
+		(int)costErrors, (int)stateErrors);
+}
+
+int main()
+{
+	SpeedDensityTable table;
+	std::mt19937 random(17);
+	CHECK(table.Parse(L"10: 0 1, 2 1, 4 0.6, 8 0.1; 0: 0 1, 2 1, 3 0.8, 5 0.5, 10 0.1"));
+
+	#ifdef __AVX2__
+	std::printf("AVX2 kernels\n");
+	#else
+	std::printf("plain kernels\n");
+	#endif
+	TestPolicy<FLATModelPolicy>  ("FLAT",   table, random);
+	TestPolicy<STEPModelPolicy>  ("STEP",   table, random);
+	TestPolicy<LINEARModelPolicy>("LINEAR", table, random);
+	TestPolicy<POWERModelPolicy> ("POWER",  table, random);
+	TestPolicy<EXPModelPolicy>   ("EXP",    table, random);
+	TestPolicy<TABLEModelPolicy> ("TABLE",  table, random);
+	return TestResult("EdgeCostTest");
+}
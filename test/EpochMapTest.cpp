@@ -0,0 +1,161 @@
+// ===============================================================================================
+// Evacuation Solver: Epoch map tests
+// Description: Membership, clearing and the two generation closed list on plain items, plus a
+// random stress run against std::set.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "TestUtils.h"
+#include "EpochMap.h"
+#include <random>
+#include <set>
+
+struct Item { size_t Slot; };
+struct ItemSlot { size_t operator()(const Item * i) const { return i->Slot; } };
+typedef EpochMap<Item *, ItemSlot> ItemMap;
+
+static void TestSingleMap(std::vector<Item> & items)
+{
+	ItemMap map;
+	size_t visited = 0;
+
+	CHECK(map.Size() == 0 && !map.Contains(0) && !map.Contains(1000000));
+	CHECK(map.Add(&items[3]));
+	CHECK(!map.Add(&items[3]));
+	CHECK(map.Add(&items[7]));
+	CHECK(map.Size() == 2 && map.Contains(3) && map.Contains(7) && !map.Contains(4));
+
+	CHECK(map.Remove(3));
+	CHECK(!map.Remove(3));
+	CHECK(map.Size() == 1 && !map.Contains(3));
+
+	// an item that left and came back is still listed only once
+	CHECK(map.Add(&items[3]));
+	map.ForEachMember([&visited](Item *) { ++visited; });
+	CHECK(visited == 2);
+
+	map.Reset();
+	CHECK(map.Size() == 0 && !map.Contains(3) && !map.Contains(7));
+	visited = 0;
+	map.ForEachMember([&visited](Item *) { ++visited; });
+	CHECK(visited == 0);
+	CHECK(map.Add(&items[7]));
+	CHECK(map.Size() == 1 && map.Contains(7));
+}
+
+static void TestTwoGenerations(std::vector<Item> & items)
+{
+	EpochMapTwoGen<ItemMap> gens;
+
+	// inserting into all generations puts the item in both of them
+	CHECK(gens.Add(&items[1], NAEdgeMapGeneration::AllGens));
+	CHECK(gens.Contains(1, NAEdgeMapGeneration::OldGen));
+	CHECK(gens.Contains(1, NAEdgeMapGeneration::NewGen));
+	CHECK(gens.Size(NAEdgeMapGeneration::AllGens) == 2);
+
+	// an item of the old generation can join the new one without leaving the old one
+	CHECK(gens.Add(&items[2], NAEdgeMapGeneration::OldGen));
+	CHECK(gens.Add(&items[2], NAEdgeMapGeneration::NewGen));
+	CHECK(gens.Contains(2, NAEdgeMapGeneration::OldGen) && gens.Contains(2, NAEdgeMapGeneration::NewGen));
+	CHECK(!gens.Add(&items[2], NAEdgeMapGeneration::AllGens));
+
+	// clearing one generation leaves the other one alone
+	gens.newGen->Reset();
+	CHECK(gens.Contains(1, NAEdgeMapGeneration::OldGen) && gens.Contains(2, NAEdgeMapGeneration::OldGen));
+	CHECK(!gens.Contains(1, NAEdgeMapGeneration::NewGen) && gens.Size(NAEdgeMapGeneration::NewGen) == 0);
+
+	CHECK(gens.Add(&items[5], NAEdgeMapGeneration::NewGen));
+	CHECK(gens.Add(&items[1], NAEdgeMapGeneration::NewGen));
+	gens.MarkAllAsOldGen();
+	CHECK(gens.Size(NAEdgeMapGeneration::NewGen) == 0);
+	CHECK(gens.Size(NAEdgeMapGeneration::OldGen) == 3);
+	CHECK(gens.Contains(5, NAEdgeMapGeneration::OldGen) && gens.Contains(1, NAEdgeMapGeneration::OldGen));
+
+	gens.Remove(5, NAEdgeMapGeneration::AllGens);
+	CHECK(!gens.Contains(5, NAEdgeMapGeneration::AllGens));
+	gens.oldGen->Reset();
+	CHECK(gens.Size(NAEdgeMapGeneration::AllGens) == 0);
+}
+
+// random operations on both generations against two std::sets
+static void StressTwoGenerations(std::vector<Item> & items)
+{
+	std::mt19937 random(12345);
+	std::uniform_int_distribution<int> op(0, 99);
+	std::uniform_int_distribution<size_t> pick(0, items.size() - 1);
+	EpochMapTwoGen<ItemMap> gens;
+	std::set<size_t> oldSet, newSet;
+	bool added = false;
+
+	for (int step = 0; step < 200000; ++step)
+	{
+		size_t i = pick(random);
+		int o = op(random);
+		if (o < 35)
+		{
+			added = gens.Add(&items[i], NAEdgeMapGeneration::NewGen);
+			CHECK(added == newSet.insert(i).second);
+		}
+		else if (o < 50)
+		{
+			added = gens.Add(&items[i], NAEdgeMapGeneration::OldGen);
+			CHECK(added == oldSet.insert(i).second);
+		}
+		else if (o < 60)
+		{
+			// the new generation is only tried when the old one took the item
+			bool inOld = oldSet.count(i) > 0, inNew = newSet.count(i) > 0;
+			added = gens.Add(&items[i], NAEdgeMapGeneration::AllGens);
+			CHECK(added == (!inOld && !inNew));
+			oldSet.insert(i);
+			if (!inOld) newSet.insert(i);
+		}
+		else if (o < 80)
+		{
+			gens.Remove(i, NAEdgeMapGeneration::OldGen);
+			oldSet.erase(i);
+		}
+		else if (o < 95)
+		{
+			gens.Remove(i, NAEdgeMapGeneration::NewGen);
+			newSet.erase(i);
+		}
+		else if (o < 98)
+		{
+			gens.MarkAllAsOldGen();
+			oldSet.insert(newSet.begin(), newSet.end());
+			newSet.clear();
+		}
+		else
+		{
+			gens.oldGen->Reset();
+			oldSet.clear();
+		}
+
+		CHECK(gens.Contains(i, NAEdgeMapGeneration::OldGen) == (oldSet.count(i) > 0));
+		CHECK(gens.Contains(i, NAEdgeMapGeneration::NewGen) == (newSet.count(i) > 0));
+		CHECK(gens.Size(NAEdgeMapGeneration::OldGen) == oldSet.size());
+		CHECK(gens.Size(NAEdgeMapGeneration::NewGen) == newSet.size());
+		if (testFailures > 0) break;
+	}
+
+	size_t members = 0;
+	gens.oldGen->ForEachMember([&](Item * item) { ++members; CHECK(oldSet.count(item->Slot) > 0); });
+	CHECK(members == oldSet.size());
+}
+
+int main()
+{
+	std::vector<Item> items(512);
+	for (size_t i = 0; i < items.size(); ++i) items[i].Slot = i;
+
+	TestSingleMap(items);
+	TestTwoGenerations(items);
+	StressTwoGenerations(items);
+	return TestResult("EpochMapTest");
+}
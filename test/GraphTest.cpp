@@ -0,0 +1,99 @@
+// ===============================================================================================
+// Evacuation Solver: Graph snapshot tests
+// Description: Builds a snapshot from an edge list, reads the edge list back and checks that a
+// second snapshot built from it is the same graph.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "TestUtils.h"
+#include "NAGraph.h"
+
+static void CheckSameStars(const NAGraphSnapshot & a, const NAGraphSnapshot & b)
+{
+	NAGraphStarItr ab, ae, bb, be;
+	CHECK(a.JunctionCount() == b.JunctionCount());
+	for (long j = 0; j < (long)a.JunctionCount(); ++j)
+	{
+		a.ForwardStar(j, ab, ae);
+		b.ForwardStar(j, bb, be);
+		CHECK(ae - ab == be - bb);
+		for (; ab != ae && bb != be; ++ab, ++bb) CHECK(a.GetEID(*ab) == b.GetEID(*bb) && a.GetDirection(*ab) == b.GetDirection(*bb));
+		a.BackwardStar(j, ab, ae);
+		b.BackwardStar(j, bb, be);
+		CHECK(ae - ab == be - bb);
+		for (; ab != ae && bb != be; ++ab, ++bb) CHECK(a.GetEID(*ab) == b.GetEID(*bb) && a.GetDirection(*ab) == b.GetDirection(*bb));
+	}
+}
+
+int main()
+{
+	std::vector<NAGraphEdge> input, output, again;
+	NAGraphSnapshot graph, copy;
+	NAGraphStarItr begin, end;
+
+	input.push_back(NAGraphEdge(1, EdgeDirection::Along,   1, 2, 10.0, 100.0f));
+	input.push_back(NAGraphEdge(1, EdgeDirection::Against, 2, 1, 10.0, 100.0f));
+	input.push_back(NAGraphEdge(2, EdgeDirection::Along,   2, 3,  5.0,  50.0f));
+	input.push_back(NAGraphEdge(3, EdgeDirection::Along,   1, 3, 20.0,  10.0f));
+	input.push_back(NAGraphEdge(3, EdgeDirection::Against, 3, 1, 20.0,  10.0f));
+	input.push_back(NAGraphEdge(5, EdgeDirection::Against, 4, 3,  1.5,   1.0f));
+
+	// a repeated edge and an edge without a junction are both dropped
+	input.push_back(NAGraphEdge(2, EdgeDirection::Along,   2, 3, 99.0,  50.0f));
+	input.push_back(NAGraphEdge(6, EdgeDirection::Along,  -1, 3,  1.0,   1.0f));
+
+	graph.Build(input);
+	CHECK(graph.EdgeCount() == 6);
+	CHECK(graph.JunctionCount() == 5);
+	CHECK(graph.Find(2, EdgeDirection::Along) != NAGraphSnapshot::NoEdge);
+	CHECK(graph.GetCost(graph.Find(2, EdgeDirection::Along)) == 5.0);
+	CHECK(graph.Find(2, EdgeDirection::Against) == NAGraphSnapshot::NoEdge);
+	CHECK(graph.Find(6, EdgeDirection::Along) == NAGraphSnapshot::NoEdge);
+	CHECK(graph.Find(1000, EdgeDirection::Along) == NAGraphSnapshot::NoEdge);
+
+	graph.ForwardStar(1, begin, end);
+	CHECK(end - begin == 2);
+	graph.BackwardStar(3, begin, end);
+	CHECK(end - begin == 3);
+	graph.ForwardStar(-1, begin, end);
+	CHECK(begin == end);
+	graph.ForwardStar(100, begin, end);
+	CHECK(begin == end);
+
+	// round trip: the edge list read back builds the very same snapshot
+	graph.GetEdges(output);
+	CHECK(output.size() == graph.EdgeCount());
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)output.size(); ++e)
+	{
+		CHECK(output[e].EID == graph.GetEID(e));
+		CHECK(output[e].Direction == graph.GetDirection(e));
+		CHECK(output[e].FromJunction == graph.GetFromJunction(e));
+		CHECK(output[e].ToJunction == graph.GetToJunction(e));
+		CHECK(output[e].Cost == graph.GetCost(e));
+		CHECK(output[e].Capacity == graph.GetCapacity(e));
+		CHECK(graph.Find(output[e].EID, output[e].Direction) == e);
+	}
+
+	copy.Build(output);
+	CHECK(copy.EdgeCount() == graph.EdgeCount());
+	CHECK(copy.Fingerprint() == graph.Fingerprint());
+	CheckSameStars(graph, copy);
+	copy.GetEdges(again);
+	CHECK(again.size() == output.size());
+	for (size_t i = 0; i < again.size() && i < output.size(); ++i)
+		CHECK(again[i].EID == output[i].EID && again[i].Direction == output[i].Direction && again[i].Cost == output[i].Cost && again[i].Capacity == output[i].Capacity);
+
+	// a change in cost is a different graph for the disk caches
+	output[0].Cost += 1.0;
+	copy.Build(output);
+	CHECK(copy.Fingerprint() != graph.Fingerprint());
+
+	copy.Clear();
+	CHECK(copy.IsEmpty() && copy.EdgeCount() == 0 && copy.JunctionCount() == 0);
+	return TestResult("GraphTest");
+}
@@ -0,0 +1,174 @@
+// ===============================================================================================
+// Evacuation Solver: Indexed heap tests
+// Description: Random insert / update-key / delete-min runs of every indexed heap against a sorted
+// reference, and a record and replay round trip of a heap trace with its replay timing.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "TestUtils.h"
+#include "IndexedHeap.h"
+#include "HeapTrace.h"
+#include <random>
+#include <set>
+
+struct Node
+{
+	double Key;
+	size_t Handle;
+	unsigned int ID;
+	Node(void) : Key(0.0), Handle(HeapNullHandle), ID(0) { }
+
+	struct KeyOf    { double       operator()(const Node * n) const { return n->Key;    } };
+	struct HandleOf { size_t &     operator()(Node * n)       const { return n->Handle; } };
+	struct IDOf     { unsigned int operator()(const Node * n) const { return n->ID;     } };
+};
+
+typedef IndexedDAryHeap<Node *, 2, Node::KeyOf, Node::HandleOf>  BinaryHeap;
+typedef IndexedDAryHeap<Node *, 4, Node::KeyOf, Node::HandleOf>  QuaternaryHeap;
+typedef IndexedPairingHeap<Node *, Node::KeyOf, Node::HandleOf>  PairingHeap;
+
+// the same random operations on 'Heap' and on a set of (key, id) pairs. both have to agree on every minimum key.
+template <class Heap> static void StressHeap(const char * name, unsigned int seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_int_distribution<int> op(0, 99);
+	std::uniform_real_distribution<double> key(0.0, 1000.0);
+	std::vector<Node> nodes(2000);
+	std::set<std::pair<double, unsigned int>> reference;
+	Heap heap;
+	int before = testFailures;
+
+	for (unsigned int i = 0; i < nodes.size(); ++i) nodes[i].ID = i;
+	std::uniform_int_distribution<size_t> pick(0, nodes.size() - 1);
+
+	for (int step = 0; step < 100000 && testFailures == before; ++step)
+	{
+		Node * n = &(nodes[pick(random)]);
+		int o = op(random);
+		if (o < 40)
+		{
+			if (heap.IsVisited(n))
+			{
+				// both directions of a key change are used by the searches (decrease) and by the CARMA repair (increase)
+				reference.erase(std::make_pair(n->Key, n->ID));
+				n->Key = o < 20 ? n->Key * 0.5 : n->Key + key(random);
+				heap.UpdateKey(n);
+			}
+			else
+			{
+				n->Key = key(random);
+				heap.Insert(n);
+			}
+			reference.insert(std::make_pair(n->Key, n->ID));
+		}
+		else if (o < 98)
+		{
+			if (heap.empty()) continue;
+			Node * m = heap.DeleteMin();
+			CHECK(!heap.IsVisited(m));
+			CHECK(m->Key == reference.begin()->first);
+			reference.erase(std::make_pair(m->Key, m->ID));
+		}
+		else
+		{
+			heap.Clear();
+			reference.clear();
+			for (const auto & x : nodes) CHECK(x.Handle == HeapNullHandle);
+		}
+		CHECK(heap.size() == reference.size());
+	}
+
+	// drain what is left in order
+	double last = -1.0;
+	while (!heap.empty())
+	{
+		Node * m = heap.DeleteMin();
+		CHECK(m->Key >= last);
+		last = m->Key;
+	}
+	if (testFailures != before) std::fprintf(stderr, "%s failed the random run\n", name);
+}
+
+template <class Heap> static void CheckErrors()
+{
+	Node n;
+	Heap heap;
+	bool thrown = false;
+	try { heap.DeleteMin(); } catch (const std::logic_error &) { thrown = true; }
+	CHECK(thrown);
+	thrown = false;
+	try { heap.UpdateKey(&n); } catch (const std::logic_error &) { thrown = true; }
+	CHECK(thrown);
+	heap.Insert(&n);
+	thrown = false;
+	try { heap.Insert(&n); } catch (const std::logic_error &) { thrown = true; }
+	CHECK(thrown);
+	heap.Clear();
+	CHECK(!heap.IsVisited(&n));
+}
+
+// records a search-like workload through TracedHeap, reads it back and replays it on every heap
+static void TraceRoundTrip()
+{
+	typedef TracedHeap<BinaryHeap, Node *, Node::KeyOf, Node::IDOf> RecordedHeap;
+	const char * path = "HeapTest.trace";
+	std::vector<HeapTraceRecord> trace;
+	std::vector<Node> nodes(5000);
+	std::mt19937 random(7);
+	std::uniform_real_distribution<double> key(0.0, 100.0);
+	size_t inserts = 0, peak = 0;
+
+	for (unsigned int i = 0; i < nodes.size(); ++i) nodes[i].ID = i;
+	{
+		HeapTraceRecorder recorder(path);
+		HeapTraceRecorder::Active() = &recorder;
+		RecordedHeap heap;
+		for (auto & n : nodes)
+		{
+			n.Key = key(random);
+			heap.Insert(&n);
+			++inserts;
+			peak = std::max(peak, heap.size());
+			if (inserts % 3 == 0) heap.DeleteMin();
+		}
+		for (size_t i = 0; i < nodes.size(); i += 7) if (heap.IsVisited(&nodes[i]))
+		{
+			nodes[i].Key *= 0.25;
+			heap.UpdateKey(&nodes[i]);
+		}
+		while (!heap.empty()) heap.DeleteMin();
+	}
+	CHECK(HeapTraceRecorder::Active() == nullptr);
+
+	CHECK(LoadHeapTrace(path, trace));
+	CHECK(sizeof(HeapTraceRecord) == 15);
+	CHECK(!trace.empty() && trace.front().Op == HeapTraceOp::NewHeap && trace.back().Op == HeapTraceOp::DeleteHeap);
+
+	HeapReplayStats binary  = ReplayHeapTrace<IndexedDAryHeap<HeapReplayItem *, 2, HeapReplayItem::KeyOf, HeapReplayItem::HandleOf>>(trace);
+	HeapReplayStats quad    = ReplayHeapTrace<IndexedDAryHeap<HeapReplayItem *, 4, HeapReplayItem::KeyOf, HeapReplayItem::HandleOf>>(trace);
+	HeapReplayStats pairing = ReplayHeapTrace<IndexedPairingHeap<HeapReplayItem *, HeapReplayItem::KeyOf, HeapReplayItem::HandleOf>>(trace);
+	CHECK(binary.Operations == trace.size() - 1);
+	CHECK(binary.PeakSize == peak);
+	CHECK(quad.Operations == binary.Operations && quad.PeakSize == binary.PeakSize);
+	CHECK(pairing.Operations == binary.Operations && pairing.PeakSize == binary.PeakSize);
+	std::printf("replay of %u operations: binary %.1f ns/op, 4-ary %.1f ns/op, pairing %.1f ns/op\n",
+		(unsigned int)binary.Operations, binary.NanoSecPerOp(), quad.NanoSecPerOp(), pairing.NanoSecPerOp());
+	std::remove(path);
+}
+
+int main()
+{
+	CheckErrors<BinaryHeap>();
+	CheckErrors<QuaternaryHeap>();
+	CheckErrors<PairingHeap>();
+	StressHeap<BinaryHeap>("binary heap", 1);
+	StressHeap<QuaternaryHeap>("4-ary heap", 2);
+	StressHeap<PairingHeap>("pairing heap", 3);
+	TraceRoundTrip();
+	return TestResult("HeapTest");
+}
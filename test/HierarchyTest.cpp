@@ -0,0 +1,100 @@
+// ===============================================================================================
+// Evacuation Solver: Contraction hierarchy tests
+// Description: Many-to-nearest queries on the hierarchy of random networks against plain Dijkstra,
+// the unpacked routes, and the time of both.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "RandomNetwork.h"
+#include <chrono>
+
+static void TestNetwork(long rows, long cols, unsigned int seed, size_t queries)
+{
+	NAGraphSnapshotPtr graph = RandomNetwork(rows, cols, seed);
+	std::vector<double> cost(graph->EdgeCount());
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)cost.size(); ++e) cost[e] = graph->GetCost(e);
+
+	auto t0 = std::chrono::steady_clock::now();
+	NAContractionHierarchy hierarchy;
+	hierarchy.Build(*graph);
+	auto t1 = std::chrono::steady_clock::now();
+	CHECK(!hierarchy.IsEmpty() && hierarchy.JunctionCount() == graph->JunctionCount());
+
+	std::mt19937 random(seed + 1);
+	std::vector<NAHierarchySeed> targets = RandomSeeds(*graph, 8, random);
+	std::vector<std::vector<NAHierarchySeed>> sources;
+	std::vector<double> expected;
+	NAHierarchyQuery query(hierarchy);
+	NAHierarchyRoute route;
+	size_t found = 0;
+
+	query.SetTargets(targets);
+	CHECK(query.HasTargets());
+	for (size_t q = 0; q < queries; ++q) sources.push_back(RandomSeeds(*graph, 1 + q % 3, random));
+
+	auto t2 = std::chrono::steady_clock::now();
+	for (const auto & s : sources) expected.push_back(DijkstraNearest(*graph, cost, s, targets));
+	auto t3 = std::chrono::steady_clock::now();
+	for (size_t q = 0; q < queries; ++q)
+	{
+		bool hit = query.Nearest(sources[q], route);
+		CHECK(hit == (expected[q] < CASPER_INFINITY));
+		if (!hit) continue;
+		++found;
+		CHECK_NEAR(route.Cost, expected[q]);
+		CheckRoute(*graph, cost, sources[q], targets, route);
+	}
+	auto t4 = std::chrono::steady_clock::now();
+
+	CHECK(found > 0);
+	std::printf("%ld x %ld grid: %u shortcuts built in %.0f ms, Dijkstra %.1f us/query, hierarchy %.1f us/query\n", rows, cols, (unsigned int)hierarchy.GetShortcutCount(),
+		std::chrono::duration<double, std::milli>(t1 - t0).count(), std::chrono::duration<double, std::micro>(t3 - t2).count() / queries,
+		std::chrono::duration<double, std::micro>(t4 - t3).count() / queries);
+}
+
+static void TestSmall()
+{
+	// 1 -> 2 -> 3 is cheaper than the direct 1 -> 3 and the hierarchy has to find it whatever it contracts first
+	std::vector<NAGraphEdge> edges;
+	edges.push_back(NAGraphEdge(1, EdgeDirection::Along, 1, 2, 1.0, 10.0f));
+	edges.push_back(NAGraphEdge(2, EdgeDirection::Along, 2, 3, 1.0, 10.0f));
+	edges.push_back(NAGraphEdge(3, EdgeDirection::Along, 1, 3, 5.0, 10.0f));
+	edges.push_back(NAGraphEdge(4, EdgeDirection::Along, 4, 1, 1.0, 10.0f));
+	NAGraphSnapshot graph;
+	graph.Build(edges);
+
+	NAContractionHierarchy hierarchy;
+	hierarchy.Build(graph);
+	NAHierarchyQuery query(hierarchy);
+	NAHierarchyRoute route;
+	std::vector<NAHierarchySeed> targets, sources;
+
+	// nothing to find before the targets are set
+	sources.push_back(NAHierarchySeed(4, 0.5, 0));
+	CHECK(!query.Nearest(sources, route));
+
+	targets.push_back(NAHierarchySeed(3, 0.25, 0));
+	query.SetTargets(targets);
+	CHECK(query.Nearest(sources, route));
+	CHECK_NEAR(route.Cost, 3.75);
+	CHECK(route.Edges.size() == 3);
+
+	// a target that cannot be reached
+	sources[0] = NAHierarchySeed(3, 0.0, 0);
+	targets[0] = NAHierarchySeed(4, 0.0, 0);
+	query.SetTargets(targets);
+	CHECK(!query.Nearest(sources, route));
+}
+
+int main()
+{
+	TestSmall();
+	TestNetwork(20, 20, 31, 300);
+	TestNetwork(50, 50, 32, 300);
+	return TestResult("HierarchyTest");
+}
@@ -0,0 +1,168 @@
+// ===============================================================================================
+// Evacuation Solver: Landmark (ALT) lower bound tests
+// Description: The landmark bound of every junction against the distance to its closest safe zone
+// on random networks with unreachable parts, and the disk cache layout on a memory stream.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "RandomNetwork.h"
+#include "Landmarks.h"
+#include <sstream>
+
+// junction based multi-source Dijkstra on the free-flow costs: min over the targets z of d(v, z)
+static void DistanceToTargets(const NAGraphSnapshot & graph, const std::vector<long> & targets, std::vector<double> & dist)
+{
+	typedef std::pair<double, long> Label;
+	std::priority_queue<Label, std::vector<Label>, std::greater<Label>> heap;
+	NAGraphStarItr begin, end;
+
+	dist.assign(graph.JunctionCount(), CASPER_INFINITY);
+	for (const auto & z : targets) { dist[z] = 0.0; heap.push(Label(0.0, z)); }
+	while (!heap.empty())
+	{
+		Label top = heap.top();
+		heap.pop();
+		if (top.first > dist[top.second]) continue;
+		for (graph.BackwardStar(top.second, begin, end); begin != end; ++begin)
+		{
+			long prev = graph.GetFromJunction(*begin);
+			double d = top.first + graph.GetCost(*begin);
+			if (d < dist[prev]) { dist[prev] = d; heap.push(Label(d, prev)); }
+		}
+	}
+}
+
+static void CheckBounds(const NAGraphSnapshot & graph, const NALandmarkTable & table, const std::vector<long> & targets, size_t & tight)
+{
+	std::vector<double> dist;
+	size_t wrong = 0;
+	tight = 0;
+	DistanceToTargets(graph, targets, dist);
+	for (long v = 0; v < (long)graph.JunctionCount(); ++v)
+	{
+		double bound = table.LowerBound(v);
+		if (bound < 0.0 || (dist[v] < CASPER_INFINITY && bound > dist[v])) ++wrong;
+		if (bound > 0.0) ++tight;
+	}
+	CHECK(wrong == 0);
+}
+
+// Every bound is at most the distance to the closest safe zone, with one or more safe zones and on junctions that
+// cannot reach any of them or that no landmark can reach.
+static void TestBounds(long rows, long cols, unsigned int seed)
+{
+	NAGraphSnapshotPtr graph = RandomNetwork(rows, cols, seed);
+	std::mt19937 random(seed + 1);
+	NALandmarkTable table;
+	table.Build(*graph, NALandmarkTable::DefaultLandmarkCount);
+	CHECK(table.GetLandmarkCount() == NALandmarkTable::DefaultLandmarkCount);
+
+	// no targets, no bound
+	CHECK(table.LowerBound(1) == 0.0);
+
+	for (size_t zoneCount : { (size_t)1, (size_t)3, (size_t)8 })
+	{
+		std::vector<long> targets;
+		for (const auto & s : RandomSeeds(*graph, zoneCount, random)) targets.push_back(s.Junction);
+		table.SetTargets(targets);
+
+		size_t tight = 0;
+		CheckBounds(*graph, table, targets, tight);
+		CHECK(tight > 0);
+		std::printf("%ld x %ld grid, %d safe zones: %d of %d junctions have a bound\n", rows, cols, (int)zoneCount, (int)tight, (int)graph->JunctionCount());
+	}
+}
+
+// two islands: the landmarks end up on the big one and the other one never gets a bound
+static void TestIslands()
+{
+	std::vector<NAGraphEdge> edges;
+	long eid = 0;
+	for (long j = 1; j < 6; ++j)
+	{
+		edges.push_back(NAGraphEdge(++eid, EdgeDirection::Along, j, j + 1, 1.0 + j, 1.0f));
+		edges.push_back(NAGraphEdge(eid, EdgeDirection::Against, j + 1, j, 1.0 + j, 1.0f));
+	}
+	edges.push_back(NAGraphEdge(++eid, EdgeDirection::Along, 10, 11, 2.0, 1.0f));
+	edges.push_back(NAGraphEdge(++eid, EdgeDirection::Along, 11, 12, 3.0, 1.0f));
+	NAGraphSnapshotPtr graph(new NAGraphSnapshot());
+	graph->Build(edges);
+
+	NALandmarkTable table;
+	table.Build(*graph, 4);
+	std::vector<long> targets(1, 6);
+	table.SetTargets(targets);
+	size_t tight = 0;
+	CheckBounds(*graph, table, targets, tight);
+	CHECK(tight > 0);
+	CHECK(table.LowerBound(10) == 0.0 && table.LowerBound(11) == 0.0 && table.LowerBound(12) == 0.0);
+
+	// a safe zone on the other island leaves the whole first island without a finite distance
+	targets.assign(1, 12);
+	table.SetTargets(targets);
+	CheckBounds(*graph, table, targets, tight);
+	CHECK(table.LowerBound(-1) == 0.0 && table.LowerBound((long)graph->JunctionCount()) == 0.0);
+}
+
+static void TestCache(long rows, long cols, unsigned int seed)
+{
+	NAGraphSnapshotPtr graph = RandomNetwork(rows, cols, seed);
+	std::mt19937 random(seed + 1);
+	std::vector<long> targets;
+	for (const auto & s : RandomSeeds(*graph, 3, random)) targets.push_back(s.Junction);
+	const std::wstring key = L"network|cost";
+	const unsigned long long fingerprint = 0x1234567890ULL;
+
+	NALandmarkTable table, empty;
+	std::ostringstream out;
+	CHECK(!empty.Write(out, key, fingerprint));
+	table.Build(*graph, 6);
+	CHECK(table.Write(out, key, fingerprint));
+	const std::string saved = out.str();
+
+	// the round trip gives the exact same bounds
+	NALandmarkTable loaded;
+	std::istringstream in(saved);
+	CHECK(loaded.Read(in, key, fingerprint));
+	CHECK(loaded.GetLandmarkCount() == table.GetLandmarkCount());
+	table.SetTargets(targets);
+	loaded.SetTargets(targets);
+	size_t differ = 0;
+	for (long v = 0; v < (long)graph->JunctionCount(); ++v) if (loaded.LowerBound(v) != table.LowerBound(v)) ++differ;
+	CHECK(differ == 0);
+
+	// a different network, cost attribute or snapshot is not accepted
+	std::istringstream otherKey(saved), otherPrint(saved);
+	NALandmarkTable rejected;
+	CHECK(!rejected.Read(otherKey, L"network|time", fingerprint) && rejected.IsEmpty());
+	CHECK(!rejected.Read(otherPrint, key, fingerprint + 1) && rejected.IsEmpty());
+
+	// and neither is a file that was cut short, no matter where
+	size_t truncated = 0;
+	for (size_t length : { (size_t)0, (size_t)5, (size_t)20, saved.size() / 2, saved.size() - 1 })
+	{
+		std::istringstream cut(saved.substr(0, length));
+		NALandmarkTable partial;
+		if (!partial.Read(cut, key, fingerprint) && partial.IsEmpty() && partial.LowerBound(1) == 0.0) ++truncated;
+	}
+	CHECK(truncated == 5);
+
+	// a table that is already loaded is emptied by a truncated one instead of keeping half of each
+	std::istringstream cut(saved.substr(0, saved.size() - 4));
+	CHECK(!loaded.Read(cut, key, fingerprint) && loaded.IsEmpty());
+}
+
+int main()
+{
+	TestIslands();
+	TestBounds(10, 10, 91);
+	TestBounds(60, 60, 92);
+	TestBounds(150, 150, 93);
+	TestCache(40, 40, 94);
+	return TestResult("LandmarkTest");
+}
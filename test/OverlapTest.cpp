@@ -0,0 +1,151 @@
+// ===============================================================================================
+// Evacuation Solver: Overlap counter tests
+// Description: One counter reused for many random paths against a fresh hash map histogram per
+// path, and the time of both.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "TestUtils.h"
+#include "OverlapCounter.h"
+#include <chrono>
+#include <random>
+#include <unordered_map>
+
+struct Path { unsigned int Order; };
+struct PathOrder { size_t operator()(const Path * p) const { return p->Order; } };
+typedef OverlapCounter<Path *, PathOrder> PathCounter;
+
+// A road network in miniature: every edge has a cost and the paths reserved on it. A path is a list of edges.
+struct World
+{
+	std::vector<Path>                 paths;
+	std::vector<double>               cost;
+	std::vector<std::vector<Path *>>  crossing;
+	std::vector<std::vector<size_t>>  route;
+
+	World(size_t pathCount, size_t edgeCount, size_t routeLength, unsigned int seed) : paths(pathCount), cost(edgeCount), crossing(edgeCount), route(pathCount)
+	{
+		std::mt19937 random(seed);
+		std::uniform_int_distribution<size_t> edge(0, edgeCount - 1);
+		std::uniform_real_distribution<double> c(1.0, 10.0);
+		for (auto & x : cost) x = c(random);
+		for (unsigned int p = 0; p < pathCount; ++p)
+		{
+			paths[p].Order = p;
+			size_t e = edge(random);
+			for (size_t i = 0; i < routeLength; ++i, e = (e + 1 + (edge(random) % 3)) % edgeCount)
+			{
+				route[p].push_back(e);
+				crossing[e].push_back(&paths[p]);
+			}
+		}
+	}
+};
+
+// the histogram the counter replaced: a hash map filled from scratch for each path and a pass to find the heaviest
+static void HistogramAbove(const World & w, size_t p, double ratio, std::vector<Path *> & result)
+{
+	std::unordered_map<Path *, double> weight;
+	std::vector<Path *> firstSeen;
+	double maxWeight = -CASPER_INFINITY;
+	for (const auto & e : w.route[p]) for (const auto & q : w.crossing[e])
+	{
+		auto i = weight.find(q);
+		if (i == weight.end())
+		{
+			firstSeen.push_back(q);
+			i = weight.insert(std::make_pair(q, 0.0)).first;
+		}
+		i->second += w.cost[e];
+	}
+	for (const auto & x : weight) maxWeight = std::max(maxWeight, x.second);
+	for (const auto & q : firstSeen) if (weight[q] > ratio * maxWeight) result.push_back(q);
+}
+
+static void CounterAbove(PathCounter & counter, const World & w, size_t p, double ratio, std::vector<Path *> & result)
+{
+	for (const auto & e : w.route[p]) for (const auto & q : w.crossing[e]) counter.Add(q, w.cost[e]);
+	counter.ExtractAbove(ratio, result);
+}
+
+static void TestCounter()
+{
+	Path a = { 3 }, b = { 40 }, c = { 7 };
+	PathCounter counter;
+	std::vector<Path *> result;
+
+	counter.Add(&a, 2.0);
+	counter.Add(&b, 1.0);
+	counter.Add(&a, 2.0);
+	counter.Add(&c, 3.5);
+	counter.ExtractAbove(0.8, result);
+	CHECK(result.size() == 2 && result[0] == &a && result[1] == &c);
+
+	// the counter starts from zero after an extraction
+	result.clear();
+	counter.Add(&b, 1.0);
+	counter.ExtractAbove(0.5, result);
+	CHECK(result.size() == 1 && result[0] == &b);
+	result.clear();
+	counter.ExtractAbove(0.0, result);
+	CHECK(result.empty());
+}
+
+static void StressCounter()
+{
+	World w(3000, 20000, 60, 20);
+	PathCounter counter;
+	std::vector<Path *> expected, actual;
+	double ratios[] = { 0.0, 0.3, 0.5, 0.9, 1.0 };
+
+	for (size_t p = 0; p < w.paths.size() && testFailures == 0; ++p)
+	{
+		double ratio = ratios[p % 5];
+		expected.clear();
+		actual.clear();
+		HistogramAbove(w, p, ratio, expected);
+		CounterAbove(counter, w, p, ratio, actual);
+		CHECK(expected == actual);
+	}
+}
+
+static void BenchmarkCounter()
+{
+	World w(5000, 50000, 100, 21);
+	PathCounter counter;
+	std::vector<Path *> result;
+	size_t sumHistogram = 0, sumCounter = 0;
+
+	auto t0 = std::chrono::steady_clock::now();
+	for (size_t p = 0; p < w.paths.size(); ++p)
+	{
+		result.clear();
+		HistogramAbove(w, p, 0.5, result);
+		sumHistogram += result.size();
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	for (size_t p = 0; p < w.paths.size(); ++p)
+	{
+		result.clear();
+		CounterAbove(counter, w, p, 0.5, result);
+		sumCounter += result.size();
+	}
+	auto t2 = std::chrono::steady_clock::now();
+
+	CHECK(sumHistogram == sumCounter);
+	std::printf("overlap of %u paths: hash map histogram %.2f us/path, overlap counter %.2f us/path\n", (unsigned int)w.paths.size(),
+		std::chrono::duration<double, std::micro>(t1 - t0).count() / w.paths.size(), std::chrono::duration<double, std::micro>(t2 - t1).count() / w.paths.size());
+}
+
+int main()
+{
+	TestCounter();
+	StressCounter();
+	BenchmarkCounter();
+	return TestResult("OverlapTest");
+}
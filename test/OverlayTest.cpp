@@ -0,0 +1,84 @@
+// ===============================================================================================
+// Evacuation Solver: Partition overlay tests
+// Description: Many-to-nearest queries on the overlay of random networks against plain Dijkstra
+// while edge costs keep changing, the cells each change customizes again, and the time of both.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "RandomNetwork.h"
+#include "CellOverlay.h"
+#include <chrono>
+
+static void TestNetwork(long rows, long cols, unsigned int seed, size_t rounds, size_t queriesPerRound)
+{
+	NAGraphSnapshotPtr graph = RandomNetwork(rows, cols, seed);
+	std::vector<double> cost(graph->EdgeCount());
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)cost.size(); ++e) cost[e] = graph->GetCost(e);
+
+	NACellOverlay overlay(graph);
+	overlay.Customize();
+	CHECK(overlay.CellCount() > 1 && overlay.GetCustomizedCells() == overlay.CellCount());
+
+	std::mt19937 random(seed + 1);
+	std::uniform_int_distribution<NAGraphEdgeIndex> edge(0, (NAGraphEdgeIndex)cost.size() - 1);
+	std::uniform_real_distribution<double> factor(1.0, 3.0);
+	std::vector<NAHierarchySeed> targets = RandomSeeds(*graph, 8, random);
+	NAHierarchyRoute route;
+	double dijkstraTime = 0.0, overlayTime = 0.0, customizeTime = 0.0;
+	size_t found = 0, queries = 0, changed = 0;
+
+	for (size_t r = 0; r < rounds; ++r)
+	{
+		// a committed route raises the cost of its own edges only; now and then an edge is closed or opens again
+		size_t before = overlay.GetCustomizedCells();
+		for (int k = 0; k < 20; ++k)
+		{
+			NAGraphEdgeIndex e = edge(random);
+			if (k == 0) cost[e] = cost[e] >= CASPER_INFINITY ? graph->GetCost(e) : CASPER_INFINITY;
+			else if (cost[e] < CASPER_INFINITY) cost[e] *= factor(random);
+			overlay.SetCost(e, cost[e]);
+			++changed;
+		}
+		auto t0 = std::chrono::steady_clock::now();
+		overlay.Customize();
+		customizeTime += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+
+		// only the cells of the changed edges are customized again and at most one per changed edge
+		CHECK(overlay.GetCustomizedCells() - before <= 20);
+
+		for (size_t q = 0; q < queriesPerRound; ++q, ++queries)
+		{
+			std::vector<NAHierarchySeed> sources = RandomSeeds(*graph, 1 + q % 3, random);
+			auto t1 = std::chrono::steady_clock::now();
+			double expected = DijkstraNearest(*graph, cost, sources, targets);
+			auto t2 = std::chrono::steady_clock::now();
+			bool hit = overlay.Nearest(sources, targets, route);
+			auto t3 = std::chrono::steady_clock::now();
+			dijkstraTime += std::chrono::duration<double, std::micro>(t2 - t1).count();
+			overlayTime += std::chrono::duration<double, std::micro>(t3 - t2).count();
+
+			CHECK(hit == (expected < CASPER_INFINITY));
+			if (!hit) continue;
+			++found;
+			CHECK_NEAR(route.Cost, expected);
+			CheckRoute(*graph, cost, sources, targets, route);
+		}
+		if (testFailures > 0) break;
+	}
+
+	CHECK(found > 0);
+	std::printf("%ld x %ld grid, %u cells, %u boundary junctions: customize %.1f us per round of 20 changes, Dijkstra %.1f us/query, overlay %.1f us/query\n", rows, cols,
+		(unsigned int)overlay.CellCount(), (unsigned int)overlay.BoundaryCount(), customizeTime / rounds, dijkstraTime / queries, overlayTime / queries);
+}
+
+int main()
+{
+	TestNetwork(20, 20, 41, 30, 20);
+	TestNetwork(60, 60, 42, 30, 20);
+	return TestResult("OverlayTest");
+}
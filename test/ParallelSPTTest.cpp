@@ -0,0 +1,150 @@
+// ===============================================================================================
+// Evacuation Solver: Parallel backward shortest path tree tests
+// Description: The delta-stepping tree on random networks with tied and zero-cost edges against a
+// serial edge-based Dijkstra: every label, tree parent and the settle order for 1, 2 and 8 threads.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "RandomNetwork.h"
+#include "ParallelSPT.h"
+#include <tuple>
+
+struct SerialTree
+{
+	std::vector<double>           Label;
+	std::vector<NAGraphEdgeIndex> Parent;
+	std::vector<NAGraphEdgeIndex> Order;
+};
+
+// The CARMA loop on the snapshot: an edge is settled in the order (label, tie level, index) and keeps the parent that
+// first gave it its final label. The tie level counts the edges in a row that did not add to the label.
+static void SerialBackwardSPT(const NAGraphSnapshot & graph, const std::vector<double> & cost, const std::vector<std::pair<NAGraphEdgeIndex, double>> & seeds,
+	SerialTree & tree)
+{
+	typedef std::tuple<double, unsigned int, NAGraphEdgeIndex> Key;
+	std::priority_queue<Key, std::vector<Key>, std::greater<Key>> heap;
+	std::vector<unsigned int> level(graph.EdgeCount(), 0);
+	std::vector<char> settled(graph.EdgeCount(), 0);
+	NAGraphStarItr begin, end;
+
+	tree.Label.assign(graph.EdgeCount(), DBL_MAX);
+	tree.Parent.assign(graph.EdgeCount(), NAGraphSnapshot::NoEdge);
+	tree.Order.clear();
+	for (const auto & s : seeds) if (s.second < tree.Label[s.first])
+	{
+		tree.Label[s.first] = s.second;
+		heap.push(Key(s.second, 0, s.first));
+	}
+
+	while (!heap.empty())
+	{
+		Key top = heap.top();
+		heap.pop();
+		NAGraphEdgeIndex e = std::get<2>(top);
+		if (settled[e] || std::get<0>(top) != tree.Label[e] || std::get<1>(top) != level[e]) continue;
+		settled[e] = 1;
+		tree.Order.push_back(e);
+		double d = tree.Label[e];
+		if (d >= CASPER_INFINITY) continue;
+
+		graph.BackwardStar(graph.GetFromJunction(e), begin, end);
+		for (; begin != end; ++begin)
+		{
+			NAGraphEdgeIndex n = *begin;
+			if (cost[n] >= CASPER_INFINITY) continue;
+			double newCost = d + cost[n];
+			if (newCost >= CASPER_INFINITY || newCost >= tree.Label[n]) continue;
+			tree.Label[n] = newCost;
+			tree.Parent[n] = e;
+			level[n] = newCost == d ? level[e] + 1 : 0;
+			heap.push(Key(newCost, level[n], n));
+		}
+	}
+}
+
+static void TestNetwork(long rows, long cols, unsigned int seed, size_t seedCount)
+{
+	NAGraphSnapshotPtr graph = RandomNetwork(rows, cols, seed);
+	std::mt19937 random(seed + 1);
+	std::uniform_int_distribution<int> kind(0, 99);
+	std::uniform_int_distribution<NAGraphEdgeIndex> edge(0, (NAGraphEdgeIndex)graph->EdgeCount() - 1);
+	std::uniform_int_distribution<int> label(0, 20);
+
+	// whole costs tie a lot of labels, zero costs tie an edge with its parent and a few edges are blocked
+	std::vector<double> cost(graph->EdgeCount());
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)cost.size(); ++e)
+	{
+		int k = kind(random);
+		if (k < 15) cost[e] = 0.0;
+		else if (k < 18) cost[e] = CASPER_INFINITY;
+		else if (k < 70) cost[e] = std::floor(graph->GetCost(e) / 2.0);
+		else cost[e] = graph->GetCost(e);
+	}
+
+	// a seed can show up twice and one never relaxes anything
+	std::vector<std::pair<NAGraphEdgeIndex, double>> seeds;
+	for (size_t i = 0; i < seedCount; ++i) seeds.push_back(std::pair<NAGraphEdgeIndex, double>(edge(random), (double)label(random)));
+	seeds.push_back(std::pair<NAGraphEdgeIndex, double>(seeds.front().first, seeds.front().second + 1.0));
+	seeds.push_back(std::pair<NAGraphEdgeIndex, double>(edge(random), CASPER_INFINITY));
+
+	SerialTree expected;
+	SerialBackwardSPT(*graph, cost, seeds, expected);
+
+	for (unsigned int threads : { 1U, 2U, 8U })
+	{
+		ParallelBackwardSPT spt(graph, threads);
+		spt.Run(cost, seeds);
+		CHECK(spt.ThreadCount() == threads);
+
+		size_t labelErrors = 0, parentErrors = 0;
+		for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)cost.size(); ++e)
+		{
+			if (spt.IsReached(e) != (expected.Label[e] < DBL_MAX) || (spt.IsReached(e) && spt.GetDistance(e) != expected.Label[e])) ++labelErrors;
+			if (spt.GetParent(e) != expected.Parent[e]) ++parentErrors;
+		}
+		CHECK(labelErrors == 0);
+		CHECK(parentErrors == 0);
+		CHECK(spt.SettleOrder() == expected.Order);
+		std::printf("%ld x %ld grid on %u threads: %d edges settled in %d phases, %d labels and %d parents differ\n", rows, cols, threads,
+			(int)spt.SettleOrder().size(), (int)spt.PhaseCount(), (int)labelErrors, (int)parentErrors);
+	}
+}
+
+// a chain of zero-cost edges hangs from the seed one edge after the other even though all of them have the same label
+static void TestZeroChain()
+{
+	std::vector<NAGraphEdge> edges;
+	edges.push_back(NAGraphEdge(1, EdgeDirection::Along, 4, 5, 1.0, 1.0f));
+	edges.push_back(NAGraphEdge(2, EdgeDirection::Along, 3, 4, 0.0, 1.0f));
+	edges.push_back(NAGraphEdge(3, EdgeDirection::Along, 2, 3, 0.0, 1.0f));
+	edges.push_back(NAGraphEdge(4, EdgeDirection::Along, 1, 2, 0.0, 1.0f));
+	NAGraphSnapshotPtr graph(new NAGraphSnapshot());
+	graph->Build(edges);
+
+	std::vector<double> cost(graph->EdgeCount());
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)cost.size(); ++e) cost[e] = graph->GetCost(e);
+	NAGraphEdgeIndex e1 = graph->Find(1, EdgeDirection::Along), e2 = graph->Find(2, EdgeDirection::Along), e3 = graph->Find(3, EdgeDirection::Along),
+		e4 = graph->Find(4, EdgeDirection::Along);
+	std::vector<std::pair<NAGraphEdgeIndex, double>> seeds(1, std::pair<NAGraphEdgeIndex, double>(e1, 2.0));
+
+	ParallelBackwardSPT spt(graph, 2);
+	spt.Run(cost, seeds);
+	CHECK(spt.GetParent(e1) == NAGraphSnapshot::NoEdge && spt.GetParent(e2) == e1 && spt.GetParent(e3) == e2 && spt.GetParent(e4) == e3);
+	CHECK(spt.GetDistance(e4) == 2.0);
+	std::vector<NAGraphEdgeIndex> order = { e1, e2, e3, e4 };
+	CHECK(spt.SettleOrder() == order);
+}
+
+int main()
+{
+	TestZeroChain();
+	TestNetwork(10, 10, 71, 3);
+	TestNetwork(60, 60, 72, 8);
+	TestNetwork(150, 150, 73, 20);
+	return TestResult("ParallelSPTTest");
+}
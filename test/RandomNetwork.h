@@ -0,0 +1,130 @@
+// ===============================================================================================
+// Evacuation Solver: Random road networks for the search tests
+// Description: A grid-like road network with one-way streets, closed streets and a few highways,
+// random evacuee and safe zone seeds, and the plain Dijkstra that every faster search has to agree with.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include "TestUtils.h"
+#include "ContractionHierarchy.h"
+#include <queue>
+#include <random>
+
+// Junctions are numbered from one like in a network dataset. Every street is one EID with an along and an against edge
+// unless it is one-way; a few streets are closed in both directions and some highways connect far apart junctions.
+inline NAGraphSnapshotPtr RandomNetwork(long rows, long cols, unsigned int seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<double> cost(1.0, 10.0);
+	std::uniform_real_distribution<float> capacity(1.0f, 50.0f);
+	std::uniform_int_distribution<int> kind(0, 99);
+	std::uniform_int_distribution<long> junction(1, rows * cols);
+	std::vector<NAGraphEdge> edges;
+	long eid = 0;
+
+	auto Street = [&](long from, long to, double c)
+	{
+		int k = kind(random);
+		float cap = capacity(random);
+		if (k < 5) return;
+		++eid;
+		edges.push_back(NAGraphEdge(eid, EdgeDirection::Along, from, to, c, cap));
+		if (k >= 20) edges.push_back(NAGraphEdge(eid, EdgeDirection::Against, to, from, c, cap));
+	};
+
+	for (long r = 0; r < rows; ++r)
+		for (long c = 0; c < cols; ++c)
+		{
+			long j = r * cols + c + 1;
+			if (c + 1 < cols) Street(j, j + 1, cost(random));
+			if (r + 1 < rows) Street(j, j + cols, cost(random));
+		}
+	for (long h = 0; h < rows + cols; ++h) Street(junction(random), junction(random), 5.0 * cost(random));
+
+	NAGraphSnapshotPtr graph(new NAGraphSnapshot());
+	graph->Build(edges);
+	return graph;
+}
+
+// 'count' seeds on distinct junctions with random offsets; the tag is the position in the list
+inline std::vector<NAHierarchySeed> RandomSeeds(const NAGraphSnapshot & graph, size_t count, std::mt19937 & random, double maxOffset = 3.0)
+{
+	std::uniform_int_distribution<long> junction(1, (long)graph.JunctionCount() - 1);
+	std::uniform_real_distribution<double> offset(0.0, maxOffset);
+	std::vector<NAHierarchySeed> seeds;
+	std::vector<long> used;
+	while (seeds.size() < count)
+	{
+		long j = junction(random);
+		if (std::find(used.begin(), used.end(), j) != used.end()) continue;
+		used.push_back(j);
+		seeds.push_back(NAHierarchySeed(j, offset(random), seeds.size()));
+	}
+	return seeds;
+}
+
+// plain multi-source Dijkstra that stops at the first settled target junction. returns CASPER_INFINITY if none is reachable.
+inline double DijkstraNearest(const NAGraphSnapshot & graph, const std::vector<double> & cost, const std::vector<NAHierarchySeed> & sources,
+	const std::vector<NAHierarchySeed> & targets)
+{
+	typedef std::pair<double, long> Label;
+	std::vector<double> label(graph.JunctionCount(), CASPER_INFINITY), exitCost(graph.JunctionCount(), CASPER_INFINITY);
+	std::priority_queue<Label, std::vector<Label>, std::greater<Label>> heap;
+	double best = CASPER_INFINITY;
+	NAGraphStarItr begin, end;
+
+	for (const auto & t : targets) exitCost[t.Junction] = std::min(exitCost[t.Junction], t.Offset);
+	for (const auto & s : sources) if (s.Offset < label[s.Junction])
+	{
+		label[s.Junction] = s.Offset;
+		heap.push(Label(s.Offset, s.Junction));
+	}
+	while (!heap.empty())
+	{
+		Label top = heap.top();
+		heap.pop();
+		if (top.first > label[top.second]) continue;
+		if (top.first >= best) break;
+		if (exitCost[top.second] < CASPER_INFINITY) best = std::min(best, top.first + exitCost[top.second]);
+		graph.ForwardStar(top.second, begin, end);
+		for (; begin != end; ++begin)
+		{
+			if (cost[*begin] >= CASPER_INFINITY) continue;
+			long w = graph.GetToJunction(*begin);
+			double d = top.first + cost[*begin];
+			if (d < label[w])
+			{
+				label[w] = d;
+				heap.push(Label(d, w));
+			}
+		}
+	}
+	return best;
+}
+
+// The route edges have to be a chain from the junction of the source it names to the junction of the target it names,
+// and its cost has to be the two offsets plus the edges on 'cost'
+inline void CheckRoute(const NAGraphSnapshot & graph, const std::vector<double> & cost, const std::vector<NAHierarchySeed> & sources,
+	const std::vector<NAHierarchySeed> & targets, const NAHierarchyRoute & route)
+{
+	CHECK(route.SourceTag < sources.size() && route.TargetTag < targets.size());
+	if (route.SourceTag >= sources.size() || route.TargetTag >= targets.size()) return;
+	const NAHierarchySeed & s = sources[route.SourceTag], & t = targets[route.TargetTag];
+	double sum = s.Offset + t.Offset;
+	long at = s.Junction;
+	for (const auto & e : route.Edges)
+	{
+		CHECK(graph.GetFromJunction(e) == at);
+		at = graph.GetToJunction(e);
+		sum += cost[e];
+	}
+	CHECK(at == t.Junction);
+	CHECK_NEAR(sum, route.Cost);
+}
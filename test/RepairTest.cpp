@@ -0,0 +1,229 @@
+// ===============================================================================================
+// Evacuation Solver: Lifelong tree repair tests
+// Description: A backward tree over part of a random network is repaired after random cost changes
+// and every repaired label up to the radius is compared with a backward Dijkstra from scratch.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "RandomNetwork.h"
+#include "LifelongRepair.h"
+
+// The closed list on the snapshot. An edge that enters a safe zone junction is seeded with the offset of that safe zone
+// plus its own cost, just like the label of an edge includes the edge itself.
+class SnapshotTree
+{
+public:
+	typedef NAGraphEdgeIndex Edge;
+
+	const NAGraphSnapshot &       Graph;
+	std::vector<double>           Label;
+	std::vector<double>           CleanCost;
+	std::vector<double>           NewCost;
+	std::vector<double>           Offset;
+	std::vector<NAGraphEdgeIndex> Parent;
+	std::vector<char>             Closed;
+	std::vector<char>             Dirty;
+
+	SnapshotTree(const NAGraphSnapshot & graph) : Graph(graph) { }
+
+	static inline Edge None() { return NAGraphSnapshot::NoEdge; }
+	inline bool InTree(Edge e) const { return Closed[e] != 0; }
+	inline double OldLabel(Edge e) const { return Label[e]; }
+	inline size_t Slot(Edge e) const { return e; }
+	inline double OldCost(Edge e) const { return CleanCost[e]; }
+	inline Edge OldParent(Edge e) const { return Parent[e]; }
+	inline double Cost(Edge e) const { return Dirty[e] ? NewCost[e] : CleanCost[e]; }
+	inline double Seed(Edge e, double cost) const { return Offset[e] < CASPER_INFINITY && cost < CASPER_INFINITY ? Offset[e] + cost : CASPER_INFINITY; }
+
+	template <class Visit> bool ForEachNext(Edge e, Visit visit) const
+	{
+		NAGraphStarItr begin, end;
+		Graph.ForwardStar(Graph.GetToJunction(e), begin, end);
+		for (; begin != end; ++begin) visit(*begin);
+		return true;
+	}
+
+	template <class Visit> bool ForEachPrevious(Edge e, Visit visit) const
+	{
+		NAGraphStarItr begin, end;
+		Graph.BackwardStar(Graph.GetFromJunction(e), begin, end);
+		for (; begin != end; ++begin) visit(*begin);
+		return true;
+	}
+};
+
+// edge-based backward Dijkstra over the allowed edges only
+static void BackwardLabels(const NAGraphSnapshot & graph, const std::vector<double> & cost, const std::vector<double> & offset, const std::vector<char> & allowed,
+	std::vector<double> & label, std::vector<NAGraphEdgeIndex> & parent)
+{
+	typedef std::pair<double, NAGraphEdgeIndex> Item;
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+	NAGraphStarItr begin, end;
+
+	label.assign(graph.EdgeCount(), CASPER_INFINITY);
+	parent.assign(graph.EdgeCount(), NAGraphSnapshot::NoEdge);
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)graph.EdgeCount(); ++e)
+		if (allowed[e] && offset[e] < CASPER_INFINITY && cost[e] < CASPER_INFINITY)
+		{
+			label[e] = offset[e] + cost[e];
+			heap.push(Item(label[e], e));
+		}
+
+	while (!heap.empty())
+	{
+		Item top = heap.top();
+		heap.pop();
+		if (top.first != label[top.second]) continue;
+		graph.BackwardStar(graph.GetFromJunction(top.second), begin, end);
+		for (; begin != end; ++begin)
+		{
+			NAGraphEdgeIndex p = *begin;
+			if (!allowed[p] || cost[p] >= CASPER_INFINITY || top.first + cost[p] >= label[p]) continue;
+			label[p] = top.first + cost[p];
+			parent[p] = top.second;
+			heap.push(Item(label[p], p));
+		}
+	}
+}
+
+// Grows a tree up to the median label, changes the cost of some of its edges and repairs it. Without cheaper edges
+// nothing outside the tree can get below the radius and the repair has to match a Dijkstra over the whole network.
+// With cheaper edges it can only match a Dijkstra over the tree itself.
+static void TestRepair(long rows, long cols, unsigned int seed, size_t changeCount, bool cheaper)
+{
+	NAGraphSnapshotPtr graph = RandomNetwork(rows, cols, seed);
+	std::mt19937 random(seed + 1);
+	std::uniform_int_distribution<int> kind(0, 99);
+	std::uniform_real_distribution<double> factor(1.0, 4.0);
+	size_t n = graph->EdgeCount();
+	SnapshotTree tree(*graph);
+	std::vector<char> all(n, 1);
+
+	// whole and zero costs tie many labels. the zones are a few junctions with an offset.
+	tree.CleanCost.resize(n);
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)n; ++e) tree.CleanCost[e] = kind(random) < 20 ? 0.0 : std::floor(graph->GetCost(e));
+	std::vector<NAHierarchySeed> zones = RandomSeeds(*graph, 4, random);
+	tree.Offset.assign(n, CASPER_INFINITY);
+	NAGraphStarItr begin, end;
+	for (const auto & z : zones)
+		for (graph->BackwardStar(z.Junction, begin, end); begin != end; ++begin) tree.Offset[*begin] = std::floor(z.Offset);
+
+	BackwardLabels(*graph, tree.CleanCost, tree.Offset, all, tree.Label, tree.Parent);
+	std::vector<double> finite;
+	for (const auto & l : tree.Label) if (l < CASPER_INFINITY) finite.push_back(l);
+	std::sort(finite.begin(), finite.end());
+	double radius = finite[finite.size() / 2];
+	tree.Closed.assign(n, 0);
+	std::vector<NAGraphEdgeIndex> closed;
+	for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)n; ++e) if (tree.Label[e] <= radius) { tree.Closed[e] = 1; closed.push_back(e); }
+
+	// the reservations: slower, blocked, a zero-cost edge that gets a cost and (if allowed) faster
+	tree.NewCost = tree.CleanCost;
+	tree.Dirty.assign(n, 0);
+	std::vector<NAGraphEdgeIndex> dirty;
+	std::uniform_int_distribution<size_t> pick(0, closed.size() - 1);
+	for (size_t i = 0; i < changeCount; ++i)
+	{
+		NAGraphEdgeIndex e = closed[pick(random)];
+		int k = kind(random);
+		double & c = tree.NewCost[e];
+		if (k < 5) c = CASPER_INFINITY;
+		else if (c == 0.0) c = cheaper && k < 50 ? 0.0 : 1.0;
+		else if (cheaper && k < 40) c = k < 20 ? 0.0 : std::floor(c / 2.0);
+		else c = std::floor(c * factor(random));
+		if (!tree.Dirty[e]) dirty.push_back(e);
+		tree.Dirty[e] = 1;
+	}
+
+	LifelongRepair<SnapshotTree> repair(tree);
+	CHECK(repair.Repair(dirty, radius));
+	CHECK(repair.Decided().size() >= dirty.size());
+
+	std::vector<double> expected;
+	std::vector<NAGraphEdgeIndex> expectedParent;
+	BackwardLabels(*graph, tree.NewCost, tree.Offset, cheaper ? tree.Closed : all, expected, expectedParent);
+
+	auto G = [&](NAGraphEdgeIndex e) { return repair.Touched(e) ? repair.State(e).G : tree.Label[e]; };
+	auto Next = [&](NAGraphEdgeIndex e) { return repair.Touched(e) ? repair.State(e).BestNext : tree.Parent[e]; };
+	auto Evicted = [&](NAGraphEdgeIndex e) { return repair.Touched(e) && repair.State(e).Evicted; };
+	size_t labelErrors = 0, evictErrors = 0, treeErrors = 0, evicted = 0;
+
+	for (const auto & e : closed)
+	{
+		if (Evicted(e)) ++evicted;
+
+		// every label up to the radius is exact and stays in the tree along with its whole path to a safe zone
+		if (expected[e] <= radius)
+		{
+			if (G(e) != expected[e]) ++labelErrors;
+			for (NAGraphEdgeIndex p = e; p != NAGraphSnapshot::NoEdge; p = Next(p)) if (Evicted(p)) { ++evictErrors; break; }
+		}
+
+		// a repaired edge that stays hangs below an edge that stays and its label adds up
+		if (repair.Touched(e) && !Evicted(e))
+		{
+			const auto & s = repair.State(e);
+			if (s.BestNext == NAGraphSnapshot::NoEdge) { if (s.G != s.Seed) ++treeErrors; }
+			else if (Evicted(s.BestNext) || !tree.Closed[s.BestNext] || s.G != s.Cost + G(s.BestNext)) ++treeErrors;
+		}
+	}
+	CHECK(labelErrors == 0);
+	CHECK(evictErrors == 0);
+	CHECK(treeErrors == 0);
+	std::printf("%ld x %ld grid, %d changes%s: %d edges repaired, %d of %d closed edges evicted, %d labels, %d evictions and %d parents wrong\n", rows, cols,
+		(int)dirty.size(), cheaper ? " with cheaper edges" : "", (int)repair.GetRepairCount(), (int)evicted, (int)closed.size(), (int)labelErrors, (int)evictErrors,
+		(int)treeErrors);
+}
+
+// A zero-cost child keeps its old label even though its parent got a new one above the radius. The child has to leave
+// with its parent no matter which of the two has the smaller slot.
+static void TestZeroCostChild(bool childFirst)
+{
+	std::vector<NAGraphEdge> edges;
+	edges.push_back(NAGraphEdge(childFirst ? 1 : 2, EdgeDirection::Along, 3, 2, 3.0, 1.0f));
+	edges.push_back(NAGraphEdge(childFirst ? 2 : 1, EdgeDirection::Along, 2, 1, 5.0, 1.0f));
+	NAGraphSnapshotPtr graph(new NAGraphSnapshot());
+	graph->Build(edges);
+	NAGraphEdgeIndex child = graph->Find(childFirst ? 1 : 2, EdgeDirection::Along), parent = graph->Find(childFirst ? 2 : 1, EdgeDirection::Along);
+
+	SnapshotTree tree(*graph);
+	tree.CleanCost.assign(2, 0.0);
+	tree.CleanCost[child] = 3.0;
+	tree.CleanCost[parent] = 5.0;
+	tree.NewCost = tree.CleanCost;
+	tree.NewCost[child] = 0.0;
+	tree.NewCost[parent] = 8.0;
+	tree.Offset.assign(2, CASPER_INFINITY);
+	tree.Offset[parent] = 0.0;
+	tree.Label.assign(2, 0.0);
+	tree.Label[child] = 8.0;
+	tree.Label[parent] = 5.0;
+	tree.Parent.assign(2, NAGraphSnapshot::NoEdge);
+	tree.Parent[child] = parent;
+	tree.Closed.assign(2, 1);
+	tree.Dirty.assign(2, 1);
+
+	LifelongRepair<SnapshotTree> repair(tree);
+	CHECK(repair.Repair(std::vector<NAGraphEdgeIndex>({ child, parent }), 6.0));
+	CHECK(repair.State(parent).G == 8.0 && repair.State(parent).Evicted);
+	CHECK(repair.State(child).G == 8.0 && repair.State(child).G == repair.State(child).OldG && repair.State(child).Evicted);
+	CHECK(repair.Decided().size() == 2 && repair.Decided().front() == parent);
+}
+
+int main()
+{
+	TestZeroCostChild(true);
+	TestZeroCostChild(false);
+	TestRepair(10, 10, 81, 5, false);
+	TestRepair(10, 10, 82, 5, true);
+	TestRepair(60, 60, 83, 50, false);
+	TestRepair(60, 60, 84, 50, true);
+	TestRepair(150, 150, 85, 300, false);
+	TestRepair(150, 150, 86, 300, true);
+	return TestResult("RepairTest");
+}
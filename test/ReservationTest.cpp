@@ -0,0 +1,199 @@
+// ===============================================================================================
+// Evacuation Solver: Edge reservation tests
+// Description: The reservation order and the running max of the reserved path costs against plain
+// references, the hole compaction bound, and timings of both against the scans they replaced.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "TestUtils.h"
+#include "Reservations.h"
+#include <chrono>
+#include <random>
+#include <set>
+
+struct Path { unsigned int ID; };
+typedef ReservationOrder<Path *> PathOrder;
+
+static void TestCostSet()
+{
+	ReservedCostSet costs;
+	CHECK(costs.empty() && costs.Max() == 0.0);
+	costs.Add(5.0);
+	costs.Add(9.0, 3);
+	costs.Add(2.0);
+	CHECK(costs.Max() == 9.0);
+
+	// a cost leaves only when all of its copies are gone
+	costs.Remove(9.0, 2);
+	CHECK(costs.Max() == 9.0);
+	costs.Remove(9.0);
+	CHECK(costs.Max() == 5.0);
+	costs.Remove(5.0);
+	costs.Remove(2.0);
+	CHECK(costs.empty() && costs.Max() == 0.0);
+}
+
+// random adds and removes of whole multiplicities like the reservations of paths do
+static void StressCostSet()
+{
+	std::mt19937 random(8);
+	std::uniform_int_distribution<int> op(0, 99);
+	std::uniform_int_distribution<unsigned int> copies(1, 4);
+	std::uniform_int_distribution<int> cost(0, 500);
+	std::multiset<double> reference;
+	ReservedCostSet costs;
+
+	for (int step = 0; step < 200000 && testFailures == 0; ++step)
+	{
+		if (op(random) < 55 || reference.empty())
+		{
+			double c = cost(random) * 0.25;
+			unsigned int n = copies(random);
+			costs.Add(c, n);
+			for (unsigned int i = 0; i < n; ++i) reference.insert(c);
+		}
+		else
+		{
+			auto r = reference.begin();
+			std::advance(r, std::uniform_int_distribution<size_t>(0, std::min(reference.size() - 1, (size_t)64))(random));
+			double c = *r;
+			unsigned int n = std::min((unsigned int)reference.count(c), copies(random));
+			costs.Remove(c, n);
+			for (unsigned int i = 0; i < n; ++i) reference.erase(reference.find(c));
+		}
+		CHECK(costs.empty() == reference.empty());
+		CHECK(costs.Max() == (reference.empty() ? 0.0 : *reference.rbegin()));
+	}
+}
+
+// what the max used to cost: a scan over every reservation of the edge
+static void BenchmarkMax()
+{
+	const size_t pathCount = 2000, queries = 200000;
+	std::mt19937 random(9);
+	std::uniform_real_distribution<double> cost(0.0, 1000.0);
+	std::vector<double> reserved(pathCount);
+	ReservedCostSet costs;
+	double sumSet = 0.0, sumScan = 0.0;
+
+	for (auto & c : reserved)
+	{
+		c = cost(random);
+		costs.Add(c);
+	}
+	auto t0 = std::chrono::steady_clock::now();
+	for (size_t q = 0; q < queries; ++q) sumSet += costs.Max();
+	auto t1 = std::chrono::steady_clock::now();
+	for (size_t q = 0; q < queries / 100; ++q) sumScan += *std::max_element(reserved.begin(), reserved.end());
+	auto t2 = std::chrono::steady_clock::now();
+
+	CHECK_NEAR(sumSet, sumScan * 100.0);
+	std::printf("max of %u reserved costs: running max %.1f ns, scan %.1f ns\n", (unsigned int)pathCount,
+		std::chrono::duration<double, std::nano>(t1 - t0).count() / queries, std::chrono::duration<double, std::nano>(t2 - t1).count() / (queries / 100));
+}
+
+// the reference keeps the first-reserved order with the multiplicity of each path; a removed path just leaves it
+static void CheckOrder(const PathOrder & order, const std::vector<std::pair<Path *, unsigned int>> & reference)
+{
+	size_t i = 0;
+	for (const auto p : order)
+	{
+		if (i >= reference.size()) { CHECK(i < reference.size()); return; }
+		CHECK(p == reference[i].first);
+		CHECK(order.Count(p) == reference[i].second);
+		++i;
+	}
+	CHECK(i == reference.size() && order.size() == reference.size() && order.empty() == reference.empty());
+}
+
+static void StressOrder()
+{
+	std::mt19937 random(10);
+	std::uniform_int_distribution<int> op(0, 99);
+	std::vector<Path> pool(300);
+	std::vector<std::pair<Path *, unsigned int>> reference;
+	PathOrder order;
+
+	for (unsigned int i = 0; i < pool.size(); ++i) pool[i].ID = i;
+	std::uniform_int_distribution<size_t> pick(0, pool.size() - 1);
+	auto Find = [&](Path * p) { return std::find_if(reference.begin(), reference.end(), [p](const std::pair<Path *, unsigned int> & r) { return r.first == p; }); };
+
+	for (int step = 0; step < 100000 && testFailures == 0; ++step)
+	{
+		Path * a = &pool[pick(random)], * b = &pool[pick(random)];
+		auto ra = Find(a);
+		unsigned int expected = ra == reference.end() ? 0 : ra->second;
+		int o = op(random);
+		if (o < 50)
+		{
+			order.Add(a);
+			if (ra == reference.end()) reference.push_back(std::make_pair(a, 1U));
+			else ++(ra->second);
+		}
+		else if (o < 80)
+		{
+			CHECK(order.Remove(a) == expected);
+			if (ra != reference.end()) reference.erase(ra);
+		}
+		else
+		{
+			// the new path takes the old one's place unless it already has a place of its own
+			CHECK(order.Swap(a, b) == expected);
+			if (ra != reference.end() && a != b)
+			{
+				auto rb = Find(b);
+				if (rb != reference.end())
+				{
+					rb->second += expected;
+					reference.erase(Find(a));
+				}
+				else ra->first = b;
+			}
+		}
+		CheckOrder(order, reference);
+
+		// holes never take more than half of the order once there are enough of them to bother
+		CHECK(order.Capacity() <= std::max((size_t)16, 2 * order.size()) + 1);
+	}
+}
+
+// a reservation list with a given number of paths: adding one path, swapping it for another and removing it again.
+// the time per round has to stay the same as the list grows.
+static void BenchmarkOrder()
+{
+	std::vector<Path> pool(20001);
+	for (unsigned int i = 0; i < pool.size(); ++i) pool[i].ID = i;
+
+	for (size_t n : { (size_t)100, (size_t)10000 })
+	{
+		const size_t rounds = 200000;
+		PathOrder order;
+		for (size_t i = 0; i < n; ++i) order.Add(&pool[i]);
+		auto t0 = std::chrono::steady_clock::now();
+		for (size_t r = 0; r < rounds; ++r)
+		{
+			Path * p = &pool[n + (r % 2)], * q = &pool[n + 1 - (r % 2)];
+			order.Add(p);
+			order.Swap(p, q);
+			order.Remove(q);
+		}
+		auto t1 = std::chrono::steady_clock::now();
+		CHECK(order.size() == n);
+		std::printf("reservation order of %u paths: add + swap + remove %.1f ns\n", (unsigned int)n, std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds);
+	}
+}
+
+int main()
+{
+	StressOrder();
+	BenchmarkOrder();
+	TestCostSet();
+	StressCostSet();
+	BenchmarkMax();
+	return TestResult("ReservationTest");
+}
@@ -0,0 +1,178 @@
+// ===============================================================================================
+// Evacuation Solver: Second chance selection tests
+// Description: The batched selection of the evacuees for the next iteration on random paths with
+// shared edges, tied costs and frozen paths against the serial one path at a time selection, for
+// 1, 2, 3 and 8 workers and for a few iteration sizes.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "TestUtils.h"
+#include "SecondChance.h"
+#include "OverlapCounter.h"
+#include <random>
+
+struct TestEvacuee
+{
+	bool Processed;
+};
+
+struct TestPath
+{
+	size_t              Id;
+	double              FinalCost;
+	double              ReserveCost;
+	double              PredictedCost;
+	bool                Active;
+	TestEvacuee       * Evacuee;
+	std::vector<size_t> Edges;
+	std::vector<double> Costs;
+};
+
+struct TestPathId
+{
+	size_t operator()(const TestPath * path) const { return path->Id; }
+};
+
+// what EvcPath does with the reservations of the edges: 'Crossing' lists the paths of every edge
+class TestPaths
+{
+public:
+	typedef TestPath *                             Path;
+	typedef TestEvacuee *                          Pick;
+	typedef OverlapCounter<TestPath *, TestPathId> Counter;
+
+	std::vector<std::vector<TestPath *>> Crossing;
+	double                               ThreasholdForCost;
+	double                               ThreasholdForPathOverlap;
+	double                               ThisIterationMaxCost;
+
+	static inline bool Less(TestPath * p1, TestPath * p2) { return p1->FinalCost < p2->FinalCost; }
+
+	inline bool NeedsSecondChance(TestPath * path) const
+	{
+		double PredictionCostRatio = (path->ReserveCost - path->PredictedCost) / ThisIterationMaxCost;
+		double EvacuationCostRatio = (path->FinalCost   - path->ReserveCost  ) / ThisIterationMaxCost;
+		return path->Active && (PredictionCostRatio >= ThreasholdForCost || EvacuationCostRatio >= ThreasholdForCost);
+	}
+
+	inline void CollectOverlaps(TestPath * path, Counter & counter, std::vector<TestPath *> & overlaps) const
+	{
+		for (size_t i = 0; i < path->Edges.size(); ++i)
+			for (const auto & crossing : Crossing[path->Edges[i]]) counter.Add(crossing, path->Costs[i]);
+		counter.ExtractAbove(ThreasholdForPathOverlap, overlaps);
+	}
+
+	inline void ApplySecondChance(TestPath * path, const std::vector<TestPath *> & overlaps, std::vector<TestEvacuee *> & picked) const
+	{
+		if (path->Evacuee->Processed)
+		{
+			picked.push_back(path->Evacuee);
+			path->Evacuee->Processed = false;
+		}
+		for (const auto & p : overlaps)
+			if (p->Active && p->Evacuee->Processed)
+			{
+				picked.push_back(p->Evacuee);
+				p->Evacuee->Processed = false;
+			}
+	}
+};
+
+// the loop before the worker pool: one path off the heap, its overlaps and its picks, and then the next one
+static void SerialSecondChance(const TestPaths & paths, std::vector<TestPath *> heap, size_t maxPicks, std::vector<TestEvacuee *> & picked)
+{
+	TestPaths::Counter counter;
+	std::vector<TestPath *> overlaps;
+	for (auto heapEnd = heap.end(); heapEnd != heap.begin() && picked.size() < maxPicks; --heapEnd)
+	{
+		std::pop_heap(heap.begin(), heapEnd, TestPaths::Less);
+		TestPath * path = *(heapEnd - 1);
+		if (!paths.NeedsSecondChance(path)) continue;
+		overlaps.clear();
+		paths.CollectOverlaps(path, counter, overlaps);
+		paths.ApplySecondChance(path, overlaps, picked);
+	}
+}
+
+static void TestSelection(size_t evacueeCount, size_t edgeCount, unsigned int seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_int_distribution<int> kind(0, 99), pathCount(1, 3), length(3, 25), segmentCost(1, 10), shift(0, 20);
+	std::uniform_int_distribution<size_t> edge(0, edgeCount - 1);
+	std::uniform_real_distribution<double> cost(0.0, 100.0);
+	std::vector<TestEvacuee> evacuees(evacueeCount);
+	std::vector<TestPath> all;
+	TestPaths paths;
+
+	// whole costs tie many paths and the paths of an evacuee start close to each other so they share edges
+	all.reserve(3 * evacueeCount);
+	paths.Crossing.resize(edgeCount);
+	for (auto & evc : evacuees)
+	{
+		evc.Processed = kind(random) < 85;
+		size_t start = edge(random);
+		for (int i = pathCount(random); i > 0; --i)
+		{
+			size_t first = start + (size_t)shift(random);
+			TestPath p;
+			p.Id = all.size();
+			p.FinalCost = std::floor(cost(random));
+			p.ReserveCost = std::floor(p.FinalCost * cost(random) / 100.0);
+			p.PredictedCost = std::floor(p.ReserveCost * cost(random) / 100.0);
+			p.Active = kind(random) < 90;
+			p.Evacuee = &evc;
+			for (int j = length(random); j > 0; --j)
+			{
+				p.Edges.push_back((first + (size_t)j) % edgeCount);
+				p.Costs.push_back((double)segmentCost(random));
+			}
+			all.push_back(p);
+		}
+	}
+	for (auto & p : all) for (const auto & e : p.Edges) paths.Crossing[e].push_back(&p);
+
+	std::vector<TestPath *> heap;
+	for (auto & p : all) heap.push_back(&p);
+	std::make_heap(heap.begin(), heap.end(), TestPaths::Less);
+	paths.ThisIterationMaxCost = heap.front()->FinalCost;
+	paths.ThreasholdForCost = 0.15;
+	paths.ThreasholdForPathOverlap = 0.4;
+
+	std::vector<char> status;
+	for (const auto & evc : evacuees) status.push_back(evc.Processed);
+	auto Reset = [&]() { for (size_t i = 0; i < evacuees.size(); ++i) evacuees[i].Processed = status[i] != 0; };
+
+	for (unsigned int threads : { 1U, 2U, 3U, 8U })
+	{
+		// one selection object for all the iteration sizes so the reused buffers are covered too
+		SPTWorkerPool pool(threads);
+		SecondChance<TestPaths> secondChance(paths, pool);
+		for (size_t maxPicks : { (size_t)1, (size_t)10, evacueeCount / 20, evacueeCount })
+		{
+			std::vector<TestEvacuee *> expected, picked;
+			Reset();
+			SerialSecondChance(paths, heap, maxPicks, expected);
+			Reset();
+			std::vector<TestPath *> copy(heap);
+			secondChance.Run(copy, maxPicks, picked);
+
+			CHECK(!expected.empty());
+			CHECK(picked == expected);
+			std::printf("%d evacuees on %u threads, at most %d picks: %d picked, %s\n", (int)evacueeCount, threads, (int)maxPicks, (int)picked.size(),
+				picked == expected ? "same as serial" : "differs from serial");
+		}
+	}
+}
+
+int main()
+{
+	TestSelection(50, 200, 101);
+	TestSelection(2000, 10000, 102);
+	TestSelection(20000, 80000, 103);
+	return TestResult("SecondChanceTest");
+}
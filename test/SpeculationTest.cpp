@@ -0,0 +1,210 @@
+// ===============================================================================================
+// Evacuation Solver: Speculative routing window tests
+// Description: Evacuees are routed one by one and again in windows that are searched concurrently
+// and committed in order. Every route has to match the one by one route exactly.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "RandomNetwork.h"
+#include "SpeculationWindow.h"
+#include <thread>
+
+// the same interface as the solver worker pool: every worker runs the task once and the caller is worker zero
+struct TestPool
+{
+	unsigned int Threads;
+
+	unsigned int Size() const { return Threads; }
+	void Run(const std::function<void(unsigned int)> & work)
+	{
+		std::vector<std::thread> threads;
+		for (unsigned int id = 1; id < Threads; ++id) threads.push_back(std::thread(work, id));
+		work(0);
+		for (auto & t : threads) t.join();
+	}
+};
+
+struct TestEvacuee
+{
+	std::vector<NAHierarchySeed> Sources;
+	double                       Population;
+};
+
+// Like the traffic models a road only gets slower once the evacuees routed over it in either direction pass five times its
+// capacity. A safe zone costs more once a hundred evacuees went there.
+class TestReservations
+{
+	const NAGraphSnapshot & graph;
+	std::vector<double>     road;
+	std::vector<double>     zoneLoad;
+	std::vector<NAHierarchySeed> zones;
+
+public:
+	TestReservations(const NAGraphSnapshot & _graph, const std::vector<NAHierarchySeed> & _zones) : graph(_graph), zones(_zones)
+	{
+		long maxEID = 0;
+		for (NAGraphEdgeIndex e = 0; e < (NAGraphEdgeIndex)graph.EdgeCount(); ++e) maxEID = std::max(maxEID, graph.GetEID(e));
+		road.assign(maxEID + 1, 0.0);
+		zoneLoad.assign(zones.size(), 0.0);
+	}
+
+	double Cost(double pop, NAGraphEdgeIndex e) const
+	{
+		double jam = road[graph.GetEID(e)] + pop - 5.0 * graph.GetCapacity(e);
+		return graph.GetCost(e) * (1.0 + std::max(0.0, jam) / graph.GetCapacity(e));
+	}
+
+	std::vector<NAHierarchySeed> Targets() const
+	{
+		std::vector<NAHierarchySeed> targets = zones;
+		for (size_t z = 0; z < targets.size(); ++z) targets[z].Offset += 0.01 * std::max(0.0, zoneLoad[z] - 100.0);
+		return targets;
+	}
+
+	void Commit(const NAHierarchyRoute & route, double pop)
+	{
+		for (const auto e : route.Edges) road[graph.GetEID(e)] += pop;
+		zoneLoad[route.TargetTag] += pop;
+	}
+};
+
+static bool SameRoute(const NAHierarchyRoute & a, const NAHierarchyRoute & b)
+{
+	return a.Cost == b.Cost && a.SourceTag == b.SourceTag && a.TargetTag == b.TargetTag && a.Edges == b.Edges;
+}
+
+static void TestWindow(long rows, long cols, unsigned int seed, size_t evacueeCount, size_t windowSize, unsigned int threads)
+{
+	NAGraphSnapshotPtr graph = RandomNetwork(rows, cols, seed);
+	std::mt19937 random(seed + 1);
+	std::uniform_real_distribution<double> population(1.0, 20.0);
+	std::vector<NAHierarchySeed> zones = RandomSeeds(*graph, 8, random);
+	std::vector<TestEvacuee> evacuees(evacueeCount);
+	for (size_t i = 0; i < evacueeCount; ++i)
+	{
+		evacuees[i].Sources = RandomSeeds(*graph, 1 + i % 3, random);
+		evacuees[i].Population = population(random);
+	}
+
+	// the one by one routes
+	std::vector<NAHierarchyRoute> expected(evacueeCount);
+	std::vector<bool> expectedFound(evacueeCount);
+	{
+		TestReservations state(*graph, zones);
+		NABidirectionalSearch search(graph);
+		for (size_t i = 0; i < evacueeCount; ++i)
+		{
+			double pop = evacuees[i].Population;
+			expectedFound[i] = search.Nearest(evacuees[i].Sources, state.Targets(), [&](NAGraphEdgeIndex e) { return state.Cost(pop, e); }, expected[i]);
+			if (expectedFound[i]) state.Commit(expected[i], pop);
+		}
+	}
+
+	// the same evacuees in windows
+	TestReservations state(*graph, zones);
+	NABidirectionalSearch search(graph);
+	SpeculationWindow window(graph, windowSize);
+	TestPool pool = { threads };
+	NAHierarchyRoute route;
+	bool found = false;
+	size_t scanned = 0, taken = 0;
+
+	for (size_t i = 0; i < evacueeCount; ++i)
+	{
+		double pop = evacuees[i].Population;
+		if (!window.Holds(i))
+		{
+			window.Clear();
+			for (size_t j = i; j < evacueeCount && window.Add(j, evacuees[j].Population, evacuees[j].Sources, state.Targets()); ++j) { }
+			window.Route(pool, [&](double p, NAGraphEdgeIndex e) { return state.Cost(p, e); });
+		}
+
+		if (window.Take(i, pop, evacuees[i].Sources, state.Targets(), [&](double p, NAGraphEdgeIndex e) { return state.Cost(p, e); }, route, found, scanned)) ++taken;
+		else found = search.Nearest(evacuees[i].Sources, state.Targets(), [&](NAGraphEdgeIndex e) { return state.Cost(pop, e); }, route);
+
+		CHECK(found == expectedFound[i]);
+		CHECK(!found || SameRoute(route, expected[i]));
+		if (!found) continue;
+		state.Commit(route, pop);
+		for (const auto e : route.Edges) window.Commit(graph->GetEID(e));
+		if (testFailures > 0) break;
+	}
+
+	// the first evacuee of a window is never in conflict
+	CHECK(window.EvacueeCount() == evacueeCount);
+	CHECK(window.ConflictCount() + taken == evacueeCount);
+	CHECK(taken >= window.WindowCount());
+	CHECK(window.WindowCount() >= (evacueeCount + windowSize - 1) / windowSize);
+	std::printf("%ld x %ld grid, window of %d on %u threads: %d out of %d evacuees searched again after %d windows\n", rows, cols, (int)windowSize, threads,
+		(int)window.ConflictCount(), (int)window.EvacueeCount(), (int)window.WindowCount());
+}
+
+static void TestSmall()
+{
+	// two evacuees share the only street into the safe zone so the second one has to be searched again
+	std::vector<NAGraphEdge> edges;
+	edges.push_back(NAGraphEdge(1, EdgeDirection::Along, 1, 3, 1.0, 1.0f));
+	edges.push_back(NAGraphEdge(2, EdgeDirection::Along, 2, 3, 1.0, 1.0f));
+	edges.push_back(NAGraphEdge(3, EdgeDirection::Along, 3, 4, 1.0, 1.0f));
+	edges.push_back(NAGraphEdge(4, EdgeDirection::Along, 5, 6, 1.0, 1.0f));
+	NAGraphSnapshotPtr graph(new NAGraphSnapshot());
+	graph->Build(edges);
+
+	std::vector<double> reserved(5, 0.0);
+	auto Cost = [&](double pop, NAGraphEdgeIndex e) { return graph->GetCost(e) + reserved[graph->GetEID(e)] + pop; };
+	std::vector<NAHierarchySeed> first(1, NAHierarchySeed(1, 0.0, 0)), second(1, NAHierarchySeed(2, 0.0, 0)), third(1, NAHierarchySeed(5, 0.0, 0));
+	std::vector<NAHierarchySeed> targets(1, NAHierarchySeed(4, 0.0, 0));
+	SpeculationWindow window(graph, 4);
+	TestPool pool = { 2 };
+	NAHierarchyRoute route;
+	bool found = false;
+	size_t scanned = 0;
+
+	CHECK(!window.Holds(0));
+	CHECK(window.Add(0, 1.0, first, targets) && window.Add(1, 1.0, second, targets) && window.Add(2, 1.0, third, targets));
+	window.Route(pool, Cost);
+	CHECK(window.Holds(0) && window.Holds(1) && window.Holds(2) && !window.Holds(3));
+
+	CHECK(window.Take(0, 1.0, first, targets, Cost, route, found, scanned));
+	CHECK(found && route.Edges.size() == 2);
+	for (const auto e : route.Edges) { reserved[graph->GetEID(e)] += 1.0; window.Commit(graph->GetEID(e)); }
+	CHECK(!window.Holds(0));
+
+	// the street 3 -> 4 was reserved after the window was searched
+	CHECK(!window.Take(1, 1.0, second, targets, Cost, route, found, scanned));
+	CHECK(!window.Holds(1));
+
+	// a different chunk or different safe zone costs also need a new search
+	CHECK(!window.Take(2, 2.0, third, targets, Cost, route, found, scanned));
+	CHECK(window.ConflictCount() == 2 && window.EvacueeCount() == 3);
+
+	// nothing reachable from junction 5: a valid 'not found' is taken like any other route
+	window.Clear();
+	CHECK(window.Add(2, 1.0, third, targets));
+	window.Route(pool, Cost);
+	CHECK(window.Take(2, 1.0, third, targets, Cost, route, found, scanned));
+	CHECK(!found && route.Edges.empty());
+
+	// a reservation that leaves the cost of every edge as it was does not get in the way
+	window.Clear();
+	CHECK(window.Add(3, 1.0, second, targets));
+	window.Route(pool, Cost);
+	window.Commit(3);
+	CHECK(window.Take(3, 1.0, second, targets, Cost, route, found, scanned));
+	CHECK(found && route.Edges.size() == 2);
+}
+
+int main()
+{
+	TestSmall();
+	TestWindow(20, 20, 61, 200, 4, 2);
+	TestWindow(60, 60, 62, 300, 8, 4);
+	TestWindow(60, 60, 63, 300, 32, 1);
+	TestWindow(150, 150, 64, 200, 16, 4);
+	return TestResult("SpeculationTest");
+}
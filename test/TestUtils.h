@@ -0,0 +1,28 @@
+// ===============================================================================================
+// Evacuation Solver: Test helpers
+// Description: A tiny check macro for the test programs of the parts of the solver that do not
+// need ArcObjects. Each test program returns the number of failed checks.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#pragma once
+
+#include <cstdio>
+#include <cmath>
+
+static int testFailures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { ++testFailures; std::fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #cond); } } while (0)
+#define CHECK_NEAR(a, b) CHECK(std::fabs((a) - (b)) <= 1e-9 * (1.0 + std::fabs(a) + std::fabs(b)))
+
+inline int TestResult(const char * name)
+{
+	if (testFailures == 0) std::printf("%s: all checks passed\n", name);
+	else std::printf("%s: %d checks failed\n", name, testFailures);
+	return testFailures;
+}
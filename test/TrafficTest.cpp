@@ -0,0 +1,329 @@
+// ===============================================================================================
+// Evacuation Solver: Traffic model tests
+// Description: Known points and the monotone shape of every traffic policy, parsing of the
+// speed-density table, exact hits of the congestion cache, the per-thread shards of the congestion memo, and timings
+// of the inlined policy and of the cache against what they replaced.
+//
+// Copyright (C) 2015 Kaveh Shahabi
+// Distributed under the Apache Software License, Version 2.0. (See accompanying file LICENSE.txt)
+//
+// Author: Kaveh Shahabi
+// URL: http://github.com/spatial-computing/CASPER
+// ===============================================================================================
+
+#include "TestUtils.h"
+#include "TrafficPolicies.h"
+#include <chrono>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+static const double critical = 2.0, saturation = 5.0;
+static SpeedDensityTable table;
+
+// what the edge cost sees: full speed up to the critical density and never a zero speed
+template <class TrafficPolicy> static inline double Speed(double capacity, double flow)
+{
+	double s = flow > critical * capacity ? TrafficPolicy::SpeedPercent(critical, saturation, capacity, flow, table) : 1.0;
+	return std::min(1.0, std::max(0.0001, s));
+}
+
+static double SpeedOf(unsigned char model, double capacity, double flow)
+{
+	switch (model)
+	{
+	case STEPModelPolicy::ModelID:   return Speed<STEPModelPolicy>  (capacity, flow);
+	case LINEARModelPolicy::ModelID: return Speed<LINEARModelPolicy>(capacity, flow);
+	case POWERModelPolicy::ModelID:  return Speed<POWERModelPolicy> (capacity, flow);
+	case EXPModelPolicy::ModelID:    return Speed<EXPModelPolicy>   (capacity, flow);
+	case TABLEModelPolicy::ModelID:  return Speed<TABLEModelPolicy> (capacity, flow);
+	default:                         return Speed<FLATModelPolicy>  (capacity, flow);
+	}
+}
+
+static void TestKnownPoints()
+{
+	const double capacity = 40.0;
+	CHECK(Speed<FLATModelPolicy>(capacity, 1e6) == 1.0);
+	CHECK(Speed<STEPModelPolicy>(capacity, critical * capacity) == 1.0);
+	CHECK(Speed<STEPModelPolicy>(capacity, critical * capacity + 1.0) == 0.0001);
+
+	// the linear model is at half speed at the saturation density and the exp model where b = max(3, saturation) is
+	CHECK_NEAR(Speed<LINEARModelPolicy>(capacity, saturation * capacity), 0.5);
+	CHECK_NEAR(Speed<EXPModelPolicy>(capacity, saturation * capacity), 0.5);
+	CHECK(Speed<POWERModelPolicy>(capacity, critical * capacity + 1.0) < 1.0);
+	CHECK_NEAR(Speed<TABLEModelPolicy>(capacity, 3.0 * capacity), 0.8);
+	CHECK_NEAR(Speed<TABLEModelPolicy>(capacity, 5.0 * capacity), 0.5);
+}
+
+// More people on an edge never make it faster. The incremental searches rely on this since a reservation can only raise a cost.
+static void TestMonotone()
+{
+	for (unsigned char model = 0; model <= TABLEModelPolicy::ModelID; ++model)
+	{
+		int before = testFailures;
+		for (double capacity = 1.0; capacity <= 500.0 && testFailures == before; capacity *= 1.7)
+		{
+			double last = 1.0;
+			for (double flow = 0.0; flow <= 20.0 * capacity; flow += capacity / 8.0)
+			{
+				double s = SpeedOf(model, capacity, flow);
+				CHECK(s > 0.0 && s <= 1.0);
+				CHECK(s <= last);
+				last = s;
+			}
+		}
+		if (testFailures != before) std::fprintf(stderr, "traffic model %u is not monotone\n", (unsigned int)model);
+	}
+}
+
+static void TestTableParse()
+{
+	SpeedDensityTable t;
+	CHECK(t.IsEmpty() && t.SpeedPercent(10.0, 1e6) == 1.0);
+
+	// two capacity classes given out of order; each edge takes the class of the largest minimum it reaches
+	CHECK(t.Parse(L"50: 0 1, 4 0.2; 0: 0 1, 2 0.5"));
+	CHECK(!t.IsEmpty() && t.GetText() == L"50: 0 1, 4 0.2; 0: 0 1, 2 0.5");
+	CHECK_NEAR(t.SpeedPercent(10.0, 10.0), 0.75);
+	CHECK_NEAR(t.SpeedPercent(100.0, 200.0), 0.6);
+
+	// densities beyond both ends keep the end speed
+	CHECK_NEAR(t.SpeedPercent(10.0, 1000.0), 0.5);
+	CHECK_NEAR(t.SpeedPercent(100.0, 0.0), 1.0);
+
+	// a bad text is rejected and the table keeps what it had
+	const wchar_t * bad[] = {
+		L"0 1, 2 0.5, 3 0.7",      // speed rises with density
+		L"0 1, 2 0.5, 2 0.4",      // densities not strictly increasing
+		L"0 1.5, 2 0.5",           // speed above free flow
+		L"0 1, -1 0.5",            // negative density
+		L"0 1, 2",                 // missing speed
+		L"0 1, 2 0.5 7",           // extra number
+		L"10: 0 1; 10: 0 0.5",     // the same capacity class twice
+		L"x: 0 1",                 // bad capacity
+		L"5:",                     // class without a curve
+		L"0 1,1 1,2 1,3 1,4 1,5 1,6 1,7 1,8 1,9 1,10 1,11 1,12 1,13 1,14 1,15 1,16 1" };
+	for (const auto & text : bad)
+	{
+		if (t.Parse(text)) std::fprintf(stderr, "accepted a bad speed table: %ls\n", text);
+		CHECK(t.GetText() == L"50: 0 1, 4 0.2; 0: 0 1, 2 0.5");
+	}
+	CHECK(t.Parse(L" 0 1 , 1 0.9 ; "));
+	CHECK_NEAR(t.SpeedPercent(1.0, 0.5), 0.95);
+}
+
+// the search loops are compiled once per policy; this is what a switch on the model in every relaxation would cost
+template <class TrafficPolicy> static void BenchmarkPolicy(const char * name, const std::vector<double> & capacity, const std::vector<double> & flow)
+{
+	double sumInline = 0.0, sumSwitch = 0.0;
+	auto t0 = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < flow.size(); ++i) sumInline += Speed<TrafficPolicy>(capacity[i], flow[i]);
+	auto t1 = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < flow.size(); ++i) sumSwitch += SpeedOf(TrafficPolicy::ModelID, capacity[i], flow[i]);
+	auto t2 = std::chrono::steady_clock::now();
+
+	CHECK(sumInline == sumSwitch);
+	std::printf("%-6s policy %.1f ns, switch %.1f ns\n", name, std::chrono::duration<double, std::nano>(t1 - t0).count() / flow.size(),
+		std::chrono::duration<double, std::nano>(t2 - t1).count() / flow.size());
+}
+
+struct PairHasher
+{
+	size_t operator()(const std::pair<double, double> & p) const { return std::hash<double>()(p.first) ^ (std::hash<double>()(p.second) * 31); }
+};
+typedef std::unordered_map<std::pair<double, double>, double, PairHasher> CongestionMap;
+
+static void TestCache()
+{
+	CongestionCache cache(4);
+	double percentage = 0.0;
+	CHECK(cache.SlotCount() == 16);
+	CHECK(!cache.Find(10.0, 20.0, percentage));
+	cache.Insert(10.0, 20.0, 0.25);
+	CHECK(cache.Find(10.0, 20.0, percentage) && percentage == 0.25);
+
+	// swapped keys are a different entry
+	CHECK(!cache.Find(20.0, 10.0, percentage));
+}
+
+// A hit has to give back exactly what was stored for that very key; a replaced entry is only ever a miss.
+static void StressCache()
+{
+	std::mt19937 random(14);
+	std::uniform_int_distribution<int> cap(1, 300), flow(0, 3000);
+	CongestionCache cache(10);
+	CongestionMap latest;
+	double percentage = 0.0;
+	unsigned int hits = 0, lookups = 200000;
+
+	for (unsigned int i = 0; i < lookups && testFailures == 0; ++i)
+	{
+		std::pair<double, double> key((double)cap(random), flow(random) * 0.5);
+		if (cache.Find(key.first, key.second, percentage))
+		{
+			++hits;
+			CHECK(latest.count(key) > 0 && latest[key] == percentage);
+		}
+		else
+		{
+			percentage = Speed<EXPModelPolicy>(key.first, key.second);
+			cache.Insert(key.first, key.second, percentage);
+			latest[key] = percentage;
+		}
+	}
+	CHECK(hits > 0);
+}
+
+// Runs 'work(thread)' on that many threads at once and waits for all of them
+static void RunThreads(unsigned int threadCount, const std::function<void(unsigned int)> & work)
+{
+	std::vector<std::thread> threads;
+	for (unsigned int id = 0; id < threadCount; ++id) threads.push_back(std::thread(work, id));
+	for (auto & t : threads) t.join();
+}
+
+// More threads than shards look up the same congested edges over and over. Every answer has to be exactly what the
+// policy computes. A thread only claims a shard once it sees a congested edge of a cached model, it keeps that shard
+// for all of its lookups, and the threads that find all shards taken still get the right answer without one.
+static void TestMemoShards()
+{
+	const unsigned int threadCount = 24, rounds = 20;
+	const size_t shardCount = CongestionMemo::ShardCount;
+	std::vector<double> capacity(200), flow(capacity.size());
+	std::mt19937 random(16);
+	std::uniform_real_distribution<double> cap(1.0, 200.0), density(2.5, 10.0);
+	for (size_t e = 0; e < capacity.size(); ++e)
+	{
+		capacity[e] = std::floor(cap(random));
+		flow[e] = std::floor(density(random) * capacity[e]);
+	}
+
+	CongestionMemo memo;
+	std::vector<size_t> wrong(threadCount, 0);
+
+	// free-flowing edges and a model that is never cached do not need the memo at all
+	RunThreads(threadCount, [&](unsigned int id)
+	{
+		for (size_t e = 0; e < capacity.size(); ++e)
+		{
+			if (memo.SpeedPercent<EXPModelPolicy>(critical, saturation, capacity[e], critical * capacity[e], table) != 1.0) ++wrong[id];
+			if (memo.SpeedPercent<LINEARModelPolicy>(critical, saturation, capacity[e], flow[e], table) !=
+				LINEARModelPolicy::SpeedPercent(critical, saturation, capacity[e], flow[e], table)) ++wrong[id];
+		}
+	});
+	CHECK(memo.GetClaimedCount() == 0);
+	CHECK(memo.GetHitPercentage() == 100.0);
+
+	RunThreads(threadCount, [&](unsigned int id)
+	{
+		for (unsigned int r = 0; r < rounds; ++r)
+			for (size_t e = 0; e < capacity.size(); ++e)
+				if (memo.SpeedPercent<EXPModelPolicy>(critical, saturation, capacity[e], flow[e], table) !=
+					EXPModelPolicy::SpeedPercent(critical, saturation, capacity[e], flow[e], table)) ++wrong[id];
+	});
+	size_t wrongCount = 0;
+	for (const auto & w : wrong) wrongCount += w;
+	CHECK(wrongCount == 0);
+	CHECK(memo.GetClaimedCount() == shardCount);
+
+	// a thread that moved to another shard half way would miss every key once more
+	double hitPercentage = memo.GetHitPercentage();
+	CHECK(hitPercentage >= 100.0 * (rounds - 1) / rounds - 1.0);
+	std::printf("congestion memo: %u threads on %d shards, %.1f%% hits\n", threadCount, (int)memo.GetClaimedCount(), hitPercentage);
+}
+
+// The workload of a search: a few thousand edges whose flow changes now and then so most lookups repeat a key.
+// The exp model is the expensive one and the unordered_map is the memo the cache replaced.
+static void BenchmarkCache()
+{
+	const size_t lookups = 2000000;
+	std::mt19937 random(15);
+	std::uniform_int_distribution<size_t> edge(0, 4999);
+	std::uniform_real_distribution<double> cap(1.0, 200.0);
+	std::vector<double> capacity(5000), flow(5000);
+	CongestionCache cache;
+	CongestionMap map;
+	double percentage = 0.0, sumCompute = 0.0, sumCache = 0.0, sumMap = 0.0;
+	size_t cacheHits = 0;
+
+	for (size_t e = 0; e < capacity.size(); ++e)
+	{
+		capacity[e] = std::floor(cap(random));
+		flow[e] = capacity[e] * 3.0;
+	}
+	std::vector<size_t> order(lookups);
+	for (auto & o : order) o = edge(random);
+	const std::vector<double> initialFlow(flow);
+
+	// every 97th lookup is a reservation that adds one more person to that edge
+	auto Run = [&](const std::function<double(double, double)> & lookup)->double
+	{
+		double sum = 0.0;
+		flow = initialFlow;
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			size_t o = order[i];
+			if (i % 97 == 0) flow[o] += 1.0;
+			sum += lookup(capacity[o], flow[o]);
+		}
+		return sum;
+	};
+
+	auto t0 = std::chrono::steady_clock::now();
+	sumCompute = Run([&](double c, double f) { return EXPModelPolicy::SpeedPercent(critical, saturation, c, f, table); });
+	auto t1 = std::chrono::steady_clock::now();
+	sumCache = Run([&](double c, double f)
+	{
+		if (cache.Find(c, f, percentage)) ++cacheHits;
+		else
+		{
+			percentage = EXPModelPolicy::SpeedPercent(critical, saturation, c, f, table);
+			cache.Insert(c, f, percentage);
+		}
+		return percentage;
+	});
+	auto t2 = std::chrono::steady_clock::now();
+	sumMap = Run([&](double c, double f)
+	{
+		std::pair<double, double> key(c, f);
+		auto i = map.find(key);
+		if (i != map.end()) return i->second;
+		percentage = EXPModelPolicy::SpeedPercent(critical, saturation, c, f, table);
+		map.insert(std::make_pair(key, percentage));
+		return percentage;
+	});
+	auto t3 = std::chrono::steady_clock::now();
+
+	// the cache has no approximation error so all three agree to the last bit
+	CHECK(sumCache == sumCompute && sumMap == sumCompute);
+	std::printf("EXP congestion: compute %.1f ns, cache %.1f ns (%.1f%% hits), unordered_map %.1f ns\n",
+		std::chrono::duration<double, std::nano>(t1 - t0).count() / lookups, std::chrono::duration<double, std::nano>(t2 - t1).count() / lookups,
+		100.0 * cacheHits / lookups, std::chrono::duration<double, std::nano>(t3 - t2).count() / lookups);
+}
+
+int main()
+{
+	CHECK(table.Parse(L"0: 0 1, 2 1, 3 0.8, 5 0.5, 10 0.1"));
+	TestKnownPoints();
+	TestMonotone();
+	TestTableParse();
+	TestCache();
+	StressCache();
+	TestMemoShards();
+	BenchmarkCache();
+
+	std::mt19937 random(13);
+	std::uniform_real_distribution<double> cap(1.0, 200.0), density(0.0, 10.0);
+	std::vector<double> capacity(1000000), flow(capacity.size());
+	for (size_t i = 0; i < capacity.size(); ++i)
+	{
+		capacity[i] = cap(random);
+		flow[i] = density(random) * capacity[i];
+	}
+	BenchmarkPolicy<LINEARModelPolicy>("LINEAR", capacity, flow);
+	BenchmarkPolicy<POWERModelPolicy>("POWER", capacity, flow);
+	BenchmarkPolicy<EXPModelPolicy>("EXP", capacity, flow);
+	BenchmarkPolicy<TABLEModelPolicy>("TABLE", capacity, flow);
+	return TestResult("TrafficTest");
+}